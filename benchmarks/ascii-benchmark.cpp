@@ -0,0 +1,118 @@
+//=============================================================================
+//
+//   Exercise code for the lecture "Geometric Modeling"
+//   by Prof. Dr. Mario Botsch, TU Dortmund
+//
+//   Copyright (C) 2023 Computer Graphics Group, TU Dortmund.
+//
+//=============================================================================
+
+#include <01-reconstruction/AsciiParser.h>
+#include <pmp/Timer.h>
+#include <random>
+#include <iostream>
+#include <cstdio>
+#include <cstdlib>
+#include <clocale>
+
+using namespace pmp;
+
+//=============================================================================
+
+// Compare parsing an ASCII point file (x y z nx ny nz r g b per line) line by
+// line with fgets/sscanf, as the point set readers did before, with the
+// chunked parallel parser. Instead of a file, a number of lines can be given,
+// for which a synthetic file is written (and removed afterwards).
+//
+// usage: ascii-benchmark [file | n_lines]
+
+//=============================================================================
+
+void write_file(const char* filename, size_t n_lines)
+{
+    FILE* out = fopen(filename, "w");
+    std::mt19937 rng(42);
+    std::uniform_real_distribution<float> uniform(-1, 1);
+    for (size_t i = 0; i < n_lines; ++i)
+    {
+        fprintf(out, "%f %f %f %f %f %f %d %d %d\n", uniform(rng),
+                uniform(rng), uniform(rng), uniform(rng), uniform(rng),
+                uniform(rng), int(i % 256), int(i * 7 % 256), 255);
+    }
+    fclose(out);
+}
+
+
+//-----------------------------------------------------------------------------
+
+
+// previous implementation of the readers
+bool read_sscanf(const char* filename, std::vector<float>& values)
+{
+    FILE* in = fopen(filename, "r");
+    if (!in) return false;
+
+    char line[200];
+    float v[9];
+
+    while (in && !feof(in) && fgets(line, 200, in))
+    {
+        int n = sscanf(line, "%f %f %f %f %f %f %f %f %f", &v[0], &v[1],
+                       &v[2], &v[3], &v[4], &v[5], &v[6], &v[7], &v[8]);
+        if (n >= 9)
+            values.insert(values.end(), v, v + 9);
+    }
+
+    fclose(in);
+    return true;
+}
+
+
+//-----------------------------------------------------------------------------
+
+
+int main(int argc, char** argv)
+{
+    std::setlocale(LC_NUMERIC, "C");
+
+    std::string filename = "ascii-benchmark.txt";
+    char* end = nullptr;
+    size_t n_lines = argc > 1 ? strtoull(argv[1], &end, 10) : 2000000;
+    const bool synthetic = (argc <= 1 || *end == 0);
+    if (synthetic)
+        write_file(filename.c_str(), n_lines);
+    else
+        filename = argv[1];
+
+    Timer timer;
+    std::vector<float> old_values, new_values;
+
+    timer.start();
+    if (!read_sscanf(filename.c_str(), old_values))
+    {
+        std::cerr << "cannot read " << filename << std::endl;
+        return 1;
+    }
+    timer.stop();
+    const double old_ms = timer.elapsed();
+
+    ParseStatistics stats;
+    read_float_columns(filename.c_str(), 9, 0, new_values, &stats);
+
+    const double mb = stats.bytes / 1024.0 / 1024.0;
+    std::cout << new_values.size() / 9 << " lines, " << mb << " MB\n";
+    std::cout << "sscanf:  " << old_ms << " ms (" << mb / (old_ms / 1000.0)
+              << " MB/s)\n";
+    std::cout << "chunked: " << stats.milliseconds << " ms ("
+              << stats.mb_per_second() << " MB/s)\n";
+    std::cout << "values " << (old_values == new_values ? "identical" : "DIFFER")
+              << std::endl;
+
+    if (synthetic)
+        std::remove(filename.c_str());
+
+    return 0;
+}
+
+
+//=============================================================================
@@ -0,0 +1,137 @@
+//=============================================================================
+//
+//   Exercise code for the lecture "Geometric Modeling"
+//   by Prof. Dr. Mario Botsch, TU Dortmund
+//
+//   Copyright (C) 2023 Computer Graphics Group, TU Dortmund.
+//
+//=============================================================================
+
+#include <pmp/visualization/SurfaceMeshGL.h>
+#include <pmp/Timer.h>
+#include <GLFW/glfw3.h>
+#include <iostream>
+#include <cstdlib>
+#include <cstdio>
+
+using namespace pmp;
+
+//=============================================================================
+
+// Time the construction of the OpenGL buffer arrays of a mesh
+// (SurfaceMeshGL::build_buffer_arrays(), no GPU needed) for smooth
+// (indexed), flat, and crease-angle shading, each for a full rebuild and
+// for an update of the positions only. If an OpenGL context can be created,
+// the same is timed for SurfaceMeshGL::update_opengl_buffers(), which
+// additionally uploads the arrays.
+//
+// usage: buffer-benchmark <mesh> [repetitions]
+
+//=============================================================================
+
+bool init_opengl()
+{
+    if (!glfwInit())
+        return false;
+    glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
+    glfwWindowHint(GLFW_OPENGL_FORWARD_COMPAT, GLFW_TRUE);
+    glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
+    glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 2);
+    glfwWindowHint(GLFW_VISIBLE, GLFW_FALSE);
+    GLFWwindow* window = glfwCreateWindow(64, 64, "", nullptr, nullptr);
+    if (!window)
+        return false;
+    glfwMakeContextCurrent(window);
+    glewExperimental = GL_TRUE;
+    return glewInit() == GLEW_OK;
+}
+
+
+//-----------------------------------------------------------------------------
+
+
+// average time of building (or, with gl, uploading) the changed buffers
+double time_update(SurfaceMeshGL& mesh, unsigned int changed, int repetitions,
+                   bool gl)
+{
+    SurfaceMeshGL::BufferArrays arrays;
+    Timer timer;
+    timer.start();
+    for (int i = 0; i < repetitions; ++i)
+    {
+        if (gl)
+            mesh.update_opengl_buffers(changed);
+        else
+            mesh.build_buffer_arrays(arrays, changed);
+    }
+    if (gl)
+        glFinish();
+    timer.stop();
+    return timer.elapsed() / repetitions;
+}
+
+
+//-----------------------------------------------------------------------------
+
+
+int main(int argc, char** argv)
+{
+    if (argc < 2)
+    {
+        std::cerr << "usage: " << argv[0] << " <mesh> [repetitions]\n";
+        return 1;
+    }
+    const int repetitions = argc > 2 ? std::max(atoi(argv[2]), 1) : 5;
+
+    const bool gl = init_opengl();
+    if (!gl)
+        std::cout << "no OpenGL context, timing the arrays only\n";
+
+    SurfaceMeshGL mesh;
+    try
+    {
+        mesh.read(argv[1]);
+    }
+    catch (const std::exception& e)
+    {
+        std::cerr << e.what() << std::endl;
+        return 1;
+    }
+    std::cout << mesh.n_vertices() << " vertices, " << mesh.n_faces()
+              << " faces\n";
+
+    printf("%-18s %12s %12s", "shading", "arrays", "positions");
+    if (gl)
+        printf(" %12s %12s", "upload", "positions");
+    printf("  (ms)\n");
+
+    const std::pair<const char*, float> modes[] = {
+        {"smooth (indexed)", 180}, {"flat", 0}, {"crease 60", 60}};
+    for (const auto& mode : modes)
+    {
+        mesh.set_crease_angle(mode.second);
+
+        const double full = time_update(mesh, SurfaceMeshGL::UpdateAll,
+                                        repetitions, false);
+        const double positions = time_update(
+            mesh, SurfaceMeshGL::UpdatePositions, repetitions, false);
+        printf("%-18s %12.2f %12.2f", mode.first, full, positions);
+        if (gl)
+        {
+            const double full_gl = time_update(mesh, SurfaceMeshGL::UpdateAll,
+                                               repetitions, true);
+            const double positions_gl = time_update(
+                mesh, SurfaceMeshGL::UpdatePositions, repetitions, true);
+            printf(" %12.2f %12.2f", full_gl, positions_gl);
+        }
+        printf("\n");
+    }
+
+    if (gl)
+        glfwTerminate();
+
+    return 0;
+}
+
+
+//=============================================================================
@@ -0,0 +1,82 @@
+//=============================================================================
+//
+//   Exercise code for the lecture "Geometric Modeling"
+//   by Prof. Dr. Mario Botsch, TU Dortmund
+//
+//   Copyright (C) 2023 Computer Graphics Group, TU Dortmund.
+//
+//=============================================================================
+
+#include <pmp/SurfaceMesh.h>
+#include <pmp/algorithms/SurfaceSimplification.h>
+#include <iostream>
+#include <cstdlib>
+#include <cstdio>
+
+using namespace pmp;
+
+//=============================================================================
+
+// Decimate a triangle mesh to the given fraction of its faces with
+// SurfaceSimplification, once serially and once with the region-parallel
+// mode, and report run time and collapse throughput of both. Meshes written
+// by pts-benchmark ... poisson-ply are typical inputs.
+//
+// usage: decimation-benchmark <mesh> [ratio] [max_error]
+
+//=============================================================================
+
+void run(const char* name, const SurfaceMesh& input, size_t n_faces,
+         Scalar max_error, bool parallel)
+{
+    SurfaceMesh mesh = input;
+    SurfaceSimplification simplification(mesh);
+    simplification.simplify(n_faces, max_error, parallel);
+
+    const auto& stats = simplification.statistics();
+    printf("%-9s %10zu %10zu %10zu %7u %10.3f %12.0f\n", name, mesh.n_faces(),
+           stats.collapses, stats.parallel_collapses, stats.rounds,
+           stats.seconds, stats.collapses_per_second());
+}
+
+
+//-----------------------------------------------------------------------------
+
+
+int main(int argc, char** argv)
+{
+    if (argc < 2)
+    {
+        std::cerr << "usage: " << argv[0] << " <mesh> [ratio] [max_error]\n";
+        return 1;
+    }
+    const double ratio = argc > 2 ? atof(argv[2]) : 0.1;
+    const Scalar max_error = argc > 3 ? Scalar(atof(argv[3]))
+                                      : std::numeric_limits<Scalar>::max();
+
+    SurfaceMesh mesh;
+    try
+    {
+        mesh.read(argv[1]);
+        if (!mesh.is_triangle_mesh())
+            throw InvalidInputException("Input is not a triangle mesh!");
+    }
+    catch (const std::exception& e)
+    {
+        std::cerr << e.what() << std::endl;
+        return 1;
+    }
+    std::cout << mesh.n_vertices() << " vertices, " << mesh.n_faces()
+              << " faces\n";
+
+    const auto n_faces = size_t(ratio * mesh.n_faces());
+    printf("%-9s %10s %10s %10s %7s %10s %12s\n", "mode", "faces",
+           "collapses", "parallel", "rounds", "time (s)", "collapses/s");
+    run("serial", mesh, n_faces, max_error, false);
+    run("parallel", mesh, n_faces, max_error, true);
+
+    return 0;
+}
+
+
+//=============================================================================
@@ -0,0 +1,141 @@
+//=============================================================================
+//
+//   Exercise code for the lecture "Geometric Modeling"
+//   by Prof. Dr. Mario Botsch, TU Dortmund
+//
+//   Copyright (C) 2023 Computer Graphics Group, TU Dortmund.
+//
+//=============================================================================
+
+#include <01-reconstruction/reconstruction.h>
+#include <01-reconstruction/MappedPointSet.h>
+#include <01-reconstruction/MeshDistance.h>
+#include <pmp/algorithms/TriangleKdTree.h>
+#include <pmp/Timer.h>
+#include <iostream>
+#include <cstdlib>
+#include <cstdio>
+#include <cmath>
+
+using namespace pmp;
+
+//=============================================================================
+
+// Reconstruct a surface from a .pts point set with Hoppe's method and with
+// Poisson reconstruction, and report the deviation of both meshes from the
+// input points: distances of the points to the mesh and of the mesh
+// vertices to the closest point (mean, RMS, percentiles, one-sided and
+// symmetric Hausdorff distance), relative to the bounding box diagonal of
+// the points. For the Poisson mesh, the batched point-to-mesh query of
+// pmp::TriangleKdTree is timed against one query per point.
+//
+// usage: distance-benchmark <file.pts> [resolution] [depth]
+
+//=============================================================================
+
+void print(const char* name, const DistanceStatistics& s, Scalar scale)
+{
+    printf("  %-15s %10.5f %10.5f %10.5f %10.5f %10.5f %10.5f\n", name,
+           s.mean / scale, s.rms / scale, s.median / scale, s.p90 / scale,
+           s.p99 / scale, s.max / scale);
+}
+
+
+//-----------------------------------------------------------------------------
+
+
+void evaluate(const char* method, const PointCloudView& points,
+              const SurfaceMesh& mesh, double ms)
+{
+    std::cout << method << ": " << mesh.n_vertices() << " vertices, "
+              << mesh.n_faces() << " faces, " << ms << " ms\n";
+
+    Timer timer;
+    timer.start();
+    ReconstructionError error;
+    const bool ok = reconstruction_error(points, mesh, error);
+    timer.stop();
+    if (!ok)
+    {
+        std::cout << "  not a triangle mesh\n";
+        return;
+    }
+
+    const Scalar diagonal = points.bounds().size();
+    printf("  %-15s %10s %10s %10s %10s %10s %10s  (/ bbox diagonal)\n", "",
+           "mean", "RMS", "median", "p90", "p99", "max");
+    print("points to mesh", error.points_to_mesh, diagonal);
+    print("mesh to points", error.mesh_to_points, diagonal);
+    printf("  Hausdorff %.5f (mesh samples %.5f apart), evaluated in %.1f ms\n",
+           error.hausdorff() / diagonal, error.sample_spacing / diagonal,
+           timer.elapsed());
+}
+
+
+//-----------------------------------------------------------------------------
+
+
+int main(int argc, char** argv)
+{
+    if (argc < 2)
+    {
+        std::cerr << "usage: " << argv[0]
+                  << " <file.pts> [resolution] [depth]\n";
+        return 1;
+    }
+    const unsigned int resolution = argc > 2 ? atoi(argv[2]) : 100;
+    const int depth = argc > 3 ? atoi(argv[3]) : 8;
+
+    MappedPointSet pts;
+    if (!pts.open(argv[1]))
+    {
+        std::cerr << "cannot read " << argv[1] << std::endl;
+        return 1;
+    }
+    const PointCloudView& points = pts.view();
+    std::cout << points.size() << " points\n";
+
+    Timer timer;
+    SurfaceMesh hoppe, poisson;
+
+    timer.start();
+    reconstruct_hoppe(points, hoppe, resolution);
+    timer.stop();
+    evaluate("Hoppe", points, hoppe, timer.elapsed());
+
+    timer.start();
+    reconstruct_poisson(points, poisson, depth, 8, 2.0);
+    timer.stop();
+    evaluate("Poisson", points, poisson, timer.elapsed());
+
+    if (!poisson.is_triangle_mesh() || points.empty())
+        return 0;
+
+    // batched versus single queries of the points against the Poisson mesh
+    TriangleKdTree tree(std::make_shared<SurfaceMesh>(poisson));
+    std::vector<TriangleKdTree::NearestNeighbor> batch(points.size());
+    timer.start();
+    tree.nearest(points.points.data(), points.size(), batch.data());
+    timer.stop();
+    const double batch_ms = timer.elapsed();
+
+    const Scalar diagonal = points.bounds().size();
+    size_t mismatches = 0;
+    timer.start();
+    for (size_t i = 0; i < points.size(); ++i)
+    {
+        const auto single = tree.nearest(points.points[i]);
+        if (std::fabs(single.dist - batch[i].dist) >
+            1e-5 * (single.dist + diagonal))
+            ++mismatches;
+    }
+    timer.stop();
+    std::cout << "point to mesh queries: single " << timer.elapsed()
+              << " ms, batch " << batch_ms << " ms, " << mismatches
+              << " mismatching distances\n";
+
+    return mismatches ? EXIT_FAILURE : EXIT_SUCCESS;
+}
+
+
+//=============================================================================
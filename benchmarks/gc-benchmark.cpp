@@ -0,0 +1,156 @@
+//=============================================================================
+//
+//   Exercise code for the lecture "Geometric Modeling"
+//   by Prof. Dr. Mario Botsch, TU Dortmund
+//
+//   Copyright (C) 2023 Computer Graphics Group, TU Dortmund.
+//
+//=============================================================================
+
+#include <pmp/SurfaceMesh.h>
+#include <pmp/Timer.h>
+#include <random>
+#include <iostream>
+#include <cstdlib>
+#include <algorithm>
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+using namespace pmp;
+
+//=============================================================================
+
+// Time SurfaceMesh::garbage_collection() on a triangulated grid with a few
+// additional properties (as left behind by smoothing, texturing, or
+// decimation), after deleting the faces of a random half of its blocks of
+// block_size^2 cells. This deletes half of the faces and edges and about
+// 40% of the vertices, scattered over the arrays. The compaction runs with
+// one thread and with all threads, and both results are compared.
+//
+// usage: gc-benchmark [grid_resolution] [block_size]
+
+//=============================================================================
+
+void build_grid(SurfaceMesh& mesh, int n)
+{
+    std::vector<Point> points;
+    std::vector<IndexType> triangles;
+    for (int j = 0; j <= n; ++j)
+        for (int i = 0; i <= n; ++i)
+            points.push_back(Point(i, j, 0));
+    for (int j = 0; j < n; ++j)
+    {
+        for (int i = 0; i < n; ++i)
+        {
+            IndexType a = j * (n + 1) + i, b = a + 1, c = a + n + 1, d = c + 1;
+            triangles.insert(triangles.end(), {a, b, d, a, d, c});
+        }
+    }
+    mesh.build(std::move(points), triangles);
+
+    auto vnormal = mesh.add_vertex_property<Normal>("v:normal");
+    auto vcolor = mesh.add_vertex_property<Color>("v:color");
+    auto htex = mesh.add_halfedge_property<TexCoord>("h:tex");
+    auto eweight = mesh.add_edge_property<Scalar>("e:weight");
+    auto fnormal = mesh.add_face_property<Normal>("f:normal");
+    for (auto v : mesh.vertices())
+    {
+        vnormal[v] = Normal(0, 0, 1);
+        vcolor[v] = Color(v.idx() % 256 / 255.0, 0, 0);
+    }
+    for (auto h : mesh.halfedges())
+        htex[h] = TexCoord(h.idx(), 0);
+    for (auto e : mesh.edges())
+        eweight[e] = e.idx();
+    for (auto f : mesh.faces())
+        fnormal[f] = Normal(0, 0, 1);
+}
+
+
+//-----------------------------------------------------------------------------
+
+
+double collect(SurfaceMesh& mesh, int threads)
+{
+#ifdef _OPENMP
+    omp_set_num_threads(threads);
+#else
+    (void)threads;
+#endif
+    Timer timer;
+    timer.start();
+    mesh.garbage_collection();
+    timer.stop();
+    return timer.elapsed();
+}
+
+
+//-----------------------------------------------------------------------------
+
+
+bool equal(const SurfaceMesh& a, const SurfaceMesh& b)
+{
+    if (a.vertices_size() != b.vertices_size() ||
+        a.halfedges_size() != b.halfedges_size() ||
+        a.faces_size() != b.faces_size())
+        return false;
+    for (auto v : a.vertices())
+        if (a.position(v) != b.position(v) || a.halfedge(v) != b.halfedge(v))
+            return false;
+    for (auto h : a.halfedges())
+        if (a.to_vertex(h) != b.to_vertex(h) ||
+            a.next_halfedge(h) != b.next_halfedge(h) || a.face(h) != b.face(h))
+            return false;
+    return true;
+}
+
+
+//-----------------------------------------------------------------------------
+
+
+int main(int argc, char** argv)
+{
+    const int n = argc > 1 ? atoi(argv[1]) : 1000;
+    const int block = argc > 2 ? std::max(atoi(argv[2]), 1) : 4;
+#ifdef _OPENMP
+    const int max_threads = omp_get_max_threads();
+#else
+    const int max_threads = 1;
+#endif
+
+    SurfaceMesh mesh;
+    build_grid(mesh, n);
+
+    // faces are stored row by row, two per cell
+    const int n_blocks = (n + block - 1) / block;
+    std::mt19937 rng(42);
+    std::vector<bool> delete_block(n_blocks * n_blocks);
+    for (size_t i = 0; i < delete_block.size(); ++i)
+        delete_block[i] = rng() & 1;
+    for (auto f : mesh.faces())
+    {
+        const int cell = f.idx() / 2, i = cell % n, j = cell / n;
+        if (delete_block[j / block * n_blocks + i / block])
+            mesh.delete_face(f);
+    }
+
+    std::cout << mesh.faces_size() << " faces, deleted: "
+              << mesh.vertices_size() - mesh.n_vertices() << " vertices, "
+              << mesh.edges_size() - mesh.n_edges() << " edges, "
+              << mesh.faces_size() - mesh.n_faces() << " faces\n";
+
+    SurfaceMesh serial = mesh;
+    SurfaceMesh parallel = mesh;
+    std::cout << "1 thread:   " << collect(serial, 1) << " ms\n";
+    std::cout << max_threads << " threads:  " << collect(parallel, max_threads)
+              << " ms\n";
+    std::cout << "results " << (equal(serial, parallel) ? "identical" : "DIFFER")
+              << ", " << parallel.n_vertices() << " vertices, "
+              << parallel.n_faces() << " faces remain" << std::endl;
+
+    return 0;
+}
+
+
+//=============================================================================
@@ -0,0 +1,192 @@
+//=============================================================================
+//
+//   Exercise code for the lecture "Geometric Modeling"
+//   by Prof. Dr. Mario Botsch, TU Dortmund
+//
+//   Copyright (C) 2023 Computer Graphics Group, TU Dortmund.
+//
+//=============================================================================
+
+#include <01-reconstruction/kDTree.h>
+#include <pmp/Timer.h>
+#include <pmp/MemoryUsage.h>
+#include <pmp/algorithms/DistanceKernels.h>
+#include <random>
+#include <cstdlib>
+
+using namespace pmp;
+
+//=============================================================================
+
+// Compare build time, query time and memory of the linked and flat kd-tree
+// layouts on a synthetic scan (noisy sphere) and query points in a band
+// around it, similar to the grid nodes close to the surface in Hoppe's method.
+//
+// usage: kdtree-benchmark [n_points] [n_queries] [max_handles] [k]
+
+//=============================================================================
+
+struct Result
+{
+    double        build_ms;
+    double        query_ms;
+    double        batch_ms;
+    double        knearest_ms;
+    double        radius_ms;
+    double        avg_radius_neighbors;
+    double        memory_mb;
+    unsigned int  n_nodes;
+    double        leaf_tests;
+    std::vector<int> nearest;
+    std::vector<int> kth_nearest;
+};
+
+
+//-----------------------------------------------------------------------------
+
+
+Result run(const std::vector<Point>& points,
+           const std::vector<Point>& queries,
+           kDTree::Layout layout,
+           unsigned int max_handles,
+           unsigned int k)
+{
+    Result result;
+    Timer  timer;
+
+    size_t mem_before = MemoryUsage::current_size();
+    kDTree tree(points, layout);
+
+    timer.start();
+    result.n_nodes = tree.build(max_handles);
+    timer.stop();
+    result.build_ms  = timer.elapsed();
+    result.memory_mb = (MemoryUsage::current_size() - mem_before) / 1048576.0;
+
+    result.nearest.resize(queries.size());
+    result.leaf_tests = 0;
+    timer.start();
+    for (size_t i=0; i<queries.size(); ++i)
+    {
+        auto data = tree.nearest(queries[i]);
+        result.nearest[i] = data.nearest;
+        result.leaf_tests += data.leaf_tests;
+    }
+    timer.stop();
+    result.query_ms = timer.elapsed();
+    result.leaf_tests /= std::max(queries.size(), size_t(1));
+
+    // same queries as one (Morton-sorted, multi-threaded) batch
+    std::vector<int> batch(queries.size());
+    timer.start();
+    tree.nearest(queries.data(), queries.size(), batch.data());
+    timer.stop();
+    result.batch_ms = timer.elapsed();
+    for (size_t i=0; i<queries.size(); ++i)
+        if (batch[i] != result.nearest[i] &&
+            sqrnorm(points[batch[i]] - queries[i]) !=
+            sqrnorm(points[result.nearest[i]] - queries[i]))
+            std::cerr << "batch query " << i << " differs\n";
+
+    // k nearest neighbors, radius query with the k-th distance
+    kDTree::Neighbors neighbors;
+    std::vector<Scalar> radii(queries.size(), 0);
+    result.kth_nearest.resize(queries.size(), -1);
+    timer.start();
+    for (size_t i=0; i<queries.size(); ++i)
+    {
+        if (tree.knearest(queries[i], k, neighbors))
+        {
+            result.kth_nearest[i] = neighbors.back().idx;
+            radii[i] = neighbors.back().dist;
+        }
+    }
+    timer.stop();
+    result.knearest_ms = timer.elapsed();
+
+    result.avg_radius_neighbors = 0;
+    timer.start();
+    for (size_t i=0; i<queries.size(); ++i)
+        result.avg_radius_neighbors += tree.radius(queries[i], radii[i], neighbors);
+    timer.stop();
+    result.radius_ms = timer.elapsed();
+    result.avg_radius_neighbors /= std::max(queries.size(), size_t(1));
+
+    return result;
+}
+
+
+//-----------------------------------------------------------------------------
+
+
+void print(const char* name, const Result& r)
+{
+    std::cout << name
+              << "\tnodes "      << r.n_nodes
+              << "\tbuild "      << r.build_ms  << " ms"
+              << "\tqueries "    << r.query_ms  << " ms"
+              << "\tbatch "      << r.batch_ms  << " ms"
+              << "\tleaves/query " << r.leaf_tests
+              << "\tknearest "   << r.knearest_ms << " ms"
+              << "\tradius "     << r.radius_ms << " ms"
+              << " (" << r.avg_radius_neighbors << " points/query)"
+              << "\tmemory "     << r.memory_mb << " MB\n";
+}
+
+
+//-----------------------------------------------------------------------------
+
+
+int main(int argc, char** argv)
+{
+    const size_t n_points    = argc > 1 ? atol(argv[1]) : 1000000;
+    const size_t n_queries   = argc > 2 ? atol(argv[2]) : 1000000;
+    const unsigned int max_handles = argc > 3 ? atoi(argv[3]) : 100;
+    const unsigned int k = argc > 4 ? atoi(argv[4]) : 10;
+
+    // sample a noisy unit sphere
+    std::mt19937 rng(42);
+    std::normal_distribution<Scalar> gauss(0.0, 1.0);
+    std::uniform_real_distribution<Scalar> uniform(0.8, 1.2);
+
+    std::vector<Point> points(n_points);
+    for (auto& p : points)
+    {
+        p = normalize(Point(gauss(rng), gauss(rng), gauss(rng)));
+        p *= 1.0 + 0.01*gauss(rng);
+    }
+
+    std::vector<Point> queries(n_queries);
+    for (auto& q : queries)
+        q = uniform(rng) * normalize(Point(gauss(rng), gauss(rng), gauss(rng)));
+
+    std::cout << n_points << " points, " << n_queries << " queries, "
+              << max_handles << " points per leaf, k = " << k
+              << ", leaf scan " << pmp::distance_kernel_isa()
+              << " (set PMP_DISTANCE_KERNEL=scalar|sse2|avx2 to compare)\n";
+
+    // flat layout first: its few large blocks are returned to the OS on
+    // destruction and do not distort the measurement of the linked tree
+    Result flat   = run(points, queries, kDTree::Flat,   max_handles, k);
+    Result linked = run(points, queries, kDTree::Linked, max_handles, k);
+
+    print("linked", linked);
+    print("flat  ", flat);
+
+    size_t mismatches = 0;
+    for (size_t i=0; i<n_queries; ++i)
+        if (sqrnorm(points[flat.nearest[i]] - queries[i]) !=
+            sqrnorm(points[linked.nearest[i]] - queries[i]))
+            ++mismatches;
+    for (size_t i=0; i<n_queries; ++i)
+        if (sqrnorm(points[flat.kth_nearest[i]] - queries[i]) !=
+            sqrnorm(points[linked.kth_nearest[i]] - queries[i]))
+            ++mismatches;
+    std::cout << "speedup: build " << linked.build_ms / flat.build_ms
+              << "x, queries " << linked.query_ms / flat.query_ms << "x, "
+              << mismatches << " mismatching results\n";
+
+    return mismatches ? EXIT_FAILURE : EXIT_SUCCESS;
+}
+
+//=============================================================================
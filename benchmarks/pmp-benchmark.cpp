@@ -0,0 +1,105 @@
+//=============================================================================
+//
+//   Exercise code for the lecture "Geometric Modeling"
+//   by Prof. Dr. Mario Botsch, TU Dortmund
+//
+//   Copyright (C) 2023 Computer Graphics Group, TU Dortmund.
+//
+//=============================================================================
+
+#include <pmp/SurfaceMesh.h>
+#include <pmp/algorithms/SurfaceNormals.h>
+#include <pmp/Timer.h>
+#include <algorithm>
+#include <iostream>
+#include <fstream>
+#include <string>
+#include <cstdlib>
+#include <cstdio>
+
+using namespace pmp;
+
+//=============================================================================
+
+// Write a mesh (with vertex normals) as pmp-benchmark.off, .obj, .ply, and
+// .pmp to the current directory and compare the times for reading each of
+// them. Only the pmp format restores the normals and further properties;
+// it maps the file and copies the raw property arrays without parsing.
+//
+// usage: pmp-benchmark <mesh> [repetitions]
+
+//=============================================================================
+
+size_t file_size(const std::string& filename)
+{
+    std::ifstream file(filename, std::ios::binary | std::ios::ate);
+    return file ? size_t(file.tellg()) : 0;
+}
+
+
+//-----------------------------------------------------------------------------
+
+
+int main(int argc, char** argv)
+{
+    if (argc < 2)
+    {
+        std::cerr << "usage: " << argv[0] << " <mesh> [repetitions]\n";
+        return 1;
+    }
+    const int repetitions = argc > 2 ? std::max(atoi(argv[2]), 1) : 3;
+
+    SurfaceMesh mesh;
+    try
+    {
+        mesh.read(argv[1]);
+    }
+    catch (const std::exception& e)
+    {
+        std::cerr << e.what() << std::endl;
+        return 1;
+    }
+    SurfaceNormals::compute_vertex_normals(mesh);
+    std::cout << mesh.n_vertices() << " vertices, " << mesh.n_faces()
+              << " faces\n";
+
+    printf("%-6s %10s %10s %10s %12s\n", "format", "MB", "write", "read",
+           "properties");
+
+    IOFlags binary;
+    binary.use_binary = true;
+    const std::pair<const char*, bool> formats[] = {
+        {"off", true}, {"obj", false}, {"ply", true}, {"pmp", true}};
+    for (const auto& format : formats)
+    {
+        const std::string filename =
+            std::string("pmp-benchmark.") + format.first;
+        const IOFlags flags = format.second ? binary : IOFlags();
+
+        Timer timer;
+        timer.start();
+        mesh.write(filename, flags);
+        timer.stop();
+        const double write_ms = timer.elapsed();
+
+        SurfaceMesh copy;
+        timer.start();
+        for (int i = 0; i < repetitions; ++i)
+            copy.read(filename, flags);
+        timer.stop();
+        const double read_ms = timer.elapsed() / repetitions;
+
+        const size_t n_properties =
+            copy.vertex_properties().size() +
+            copy.halfedge_properties().size() +
+            copy.edge_properties().size() + copy.face_properties().size();
+        const double mb = file_size(filename) / (1024.0 * 1024.0);
+        printf("%-6s %10.1f %10.1f %10.1f %12zu\n", format.first, mb,
+               write_ms, read_ms, n_properties);
+    }
+
+    return 0;
+}
+
+
+//=============================================================================
@@ -0,0 +1,139 @@
+//=============================================================================
+//
+//   Exercise code for the lecture "Geometric Modeling"
+//   by Prof. Dr. Mario Botsch, TU Dortmund
+//
+//   Copyright (C) 2023 Computer Graphics Group, TU Dortmund.
+//
+//=============================================================================
+
+#include <01-reconstruction/reconstruction.h>
+#include <01-reconstruction/MappedPointSet.h>
+#include <pmp/Timer.h>
+#include <iostream>
+#include <cstdlib>
+#include <cstdio>
+
+using namespace pmp;
+
+//=============================================================================
+
+// Time the two steps of Poisson reconstruction with a PoissonField: solving
+// for the indicator function once, and extracting its iso-surface with
+// different iso-value offsets and extraction options. The field is then
+// written to and read from a file, and the surface extracted from the read
+// field is compared with the one of the solved field.
+//
+// usage: poisson-field-benchmark <file.pts> [depth] [threads]
+
+//=============================================================================
+
+bool equal(const SurfaceMesh& a, const SurfaceMesh& b)
+{
+    if (a.n_vertices() != b.n_vertices() || a.n_faces() != b.n_faces())
+        return false;
+    for (auto v : a.vertices())
+        if (a.position(v) != b.position(v))
+            return false;
+    for (auto f : a.faces())
+    {
+        auto vb = b.vertices(f).begin();
+        for (auto v : a.vertices(f))
+            if (v != *vb++)
+                return false;
+    }
+    return true;
+}
+
+
+//-----------------------------------------------------------------------------
+
+
+void extract(PoissonField& field, SurfaceMesh& mesh, float offset,
+             int iso_divide, bool manifold, bool polygon_mesh)
+{
+    Timer timer;
+    timer.start();
+    field.extract(mesh, offset, iso_divide, manifold, polygon_mesh);
+    timer.stop();
+    printf("  offset %.2f, divide %2d%s%s: %8zu vertices, %8zu faces, "
+           "%8.1f ms\n",
+           offset, iso_divide, manifold ? ", manifold" : "",
+           polygon_mesh ? ", polygons" : "", mesh.n_vertices(), mesh.n_faces(),
+           timer.elapsed());
+}
+
+
+//-----------------------------------------------------------------------------
+
+
+int main(int argc, char** argv)
+{
+    if (argc < 2)
+    {
+        std::cerr << "usage: " << argv[0] << " <file.pts> [depth] [threads]\n";
+        return 1;
+    }
+    const int depth = argc > 2 ? atoi(argv[2]) : 8;
+    const unsigned int threads = argc > 3 ? atoi(argv[3]) : 0;
+    const char* filename = "poisson-field-benchmark.field";
+
+    MappedPointSet pts;
+    if (!pts.open(argv[1]))
+    {
+        std::cerr << "cannot read " << argv[1] << std::endl;
+        return 1;
+    }
+    const PointCloudView& points = pts.view();
+    std::cout << points.size() << " points, depth " << depth << "\n";
+
+    Timer timer;
+    PoissonField field;
+    timer.start();
+    if (!field.solve(points, depth, 8, 2.0, threads))
+    {
+        std::cerr << "Poisson reconstruction failed\n";
+        return 1;
+    }
+    timer.stop();
+    printf("solve: %.1f ms\n", timer.elapsed());
+
+    printf("extract:\n");
+    SurfaceMesh mesh, other;
+    extract(field, mesh, 1.0f, 8, true, false);
+    extract(field, other, 0.95f, 8, true, false);
+    extract(field, other, 1.05f, 8, true, false);
+    extract(field, other, 1.0f, 6, true, false);
+    extract(field, other, 1.0f, 8, false, true);
+
+    timer.start();
+    const bool written = field.write(filename);
+    timer.stop();
+    if (!written)
+    {
+        std::cerr << "cannot write " << filename << std::endl;
+        return 1;
+    }
+    printf("write: %.1f ms\n", timer.elapsed());
+
+    PoissonField read;
+    timer.start();
+    if (!read.read(filename, threads))
+    {
+        std::cerr << "cannot read " << filename << std::endl;
+        return 1;
+    }
+    timer.stop();
+    printf("read: %.1f ms\n", timer.elapsed());
+
+    printf("extract from the read field:\n");
+    extract(read, other, 1.0f, 8, true, false);
+    std::cout << "  " << (equal(mesh, other) ? "same" : "different")
+              << " mesh as from the solved field\n";
+    remove(filename);
+
+    return 0;
+}
+
+
+//=============================================================================
@@ -0,0 +1,277 @@
+//=============================================================================
+//
+//   Exercise code for the lecture "Geometric Modeling"
+//   by Prof. Dr. Mario Botsch, TU Dortmund
+//
+//   Copyright (C) 2023 Computer Graphics Group, TU Dortmund.
+//
+//=============================================================================
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <cmath>
+#include <algorithm>
+#include <vector>
+#include <iostream>
+#include <poisson/PoissonVector.h>
+#include <poisson/SparseMatrix.h>
+#include <pmp/Timer.h>
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+using pmp::Timer;
+
+//=============================================================================
+
+// Compare the sparse matrix-vector products and conjugate gradient solvers
+// of the Poisson reconstruction on a system like the ones it solves: the
+// 5x5x5 stencil of the degree-2 B-spline Laplacian on an n^3 grid (in the
+// octree, each row of the finest levels couples a node with its 5x5x5
+// neighborhood). The solvers are
+//   - SparseMatrix::SolveSymmetric, which stores full rows,
+//   - SparseSymmetricMatrix::Solve with per-thread scratch vectors, which
+//     was used for the reconstruction before,
+//   - CSRSymmetricMatrix::Solve with a float matrix and float or double
+//     arithmetic, and with a double matrix.
+// All run the given number of iterations (no early termination) and report
+// the matrix memory, the time per product, the time per iteration, and the
+// relative residual of the result.
+//
+// usage: poisson-solver-benchmark [n] [iterations] [threads]
+
+//=============================================================================
+
+// half of the symmetric system: the entries (i,j) with j<=i of row i, the
+// diagonal halved
+void build_system(int n, SparseSymmetricMatrix<float>& M)
+{
+    // stencil of a Laplacian with a small screening term, so that the
+    // system is positive definite
+    double stencil[5][5][5];
+    for (int x = 0; x < 5; ++x)
+        for (int y = 0; y < 5; ++y)
+            for (int z = 0; z < 5; ++z)
+            {
+                const int d2 = (x - 2) * (x - 2) + (y - 2) * (y - 2) +
+                               (z - 2) * (z - 2);
+                stencil[x][y][z] = -1.0 / (1 << d2);
+            }
+    double diagonal = 1e-3;
+    for (int x = 0; x < 5; ++x)
+        for (int y = 0; y < 5; ++y)
+            for (int z = 0; z < 5; ++z)
+                if (x != 2 || y != 2 || z != 2)
+                    diagonal -= stencil[x][y][z];
+    stencil[2][2][2] = diagonal;
+
+    M.Resize(n * n * n);
+    std::vector<MatrixEntry<float>> row;
+    for (int i = 0; i < n * n * n; ++i)
+    {
+        const int x = i / (n * n), y = (i / n) % n, z = i % n;
+        row.clear();
+        for (int dx = -2; dx <= 2; ++dx)
+            for (int dy = -2; dy <= 2; ++dy)
+                for (int dz = -2; dz <= 2; ++dz)
+                {
+                    const int xx = x + dx, yy = y + dy, zz = z + dz;
+                    if (xx < 0 || xx >= n || yy < 0 || yy >= n || zz < 0 ||
+                        zz >= n)
+                        continue;
+                    const int j = (xx * n + yy) * n + zz;
+                    if (j > i)
+                        continue;
+                    double v = stencil[dx + 2][dy + 2][dz + 2];
+                    if (j == i)
+                        v /= 2;
+                    row.push_back(MatrixEntry<float>(j, float(v)));
+                }
+        M.SetRowSize(i, int(row.size()));
+        M.rowSizes[i] = int(row.size());
+        std::copy(row.begin(), row.end(), M[i]);
+    }
+}
+
+
+//-----------------------------------------------------------------------------
+
+
+// the full rows for SparseMatrix::SolveSymmetric
+void expand_rows(const SparseSymmetricMatrix<float>& H, SparseMatrix<float>& M)
+{
+    const int rows = H.rows;
+    std::vector<int> sizes(rows, 0);
+    for (int i = 0; i < rows; ++i)
+        for (int j = 0; j < H.rowSizes[i]; ++j)
+        {
+            ++sizes[i];
+            if (H[i][j].N != i)
+                ++sizes[H[i][j].N];
+        }
+    M.Resize(rows);
+    for (int i = 0; i < rows; ++i)
+    {
+        M.SetRowSize(i, sizes[i]);
+        M.rowSizes[i] = 0;
+    }
+    for (int i = 0; i < rows; ++i)
+        for (int j = 0; j < H.rowSizes[i]; ++j)
+        {
+            const int k = H[i][j].N;
+            if (k == i)
+                M[i][M.rowSizes[i]++] = MatrixEntry<float>(i, 2 * H[i][j].Value);
+            else
+            {
+                M[i][M.rowSizes[i]++] = H[i][j];
+                M[k][M.rowSizes[k]++] = MatrixEntry<float>(i, H[i][j].Value);
+            }
+        }
+}
+
+
+//-----------------------------------------------------------------------------
+
+
+// |b - Mx| / |b|
+template <class T>
+double residual(const SparseSymmetricMatrix<float>& M, const PoissonVector<T>& b,
+                const PoissonVector<T>& x)
+{
+    PoissonVector<double> xd(x.Dimensions()), Mx(x.Dimensions());
+    for (size_t i = 0; i < x.Dimensions(); ++i)
+        xd[i] = x[i];
+    M.Multiply(xd, Mx);
+    double r = 0, bb = 0;
+    for (size_t i = 0; i < b.Dimensions(); ++i)
+    {
+        r += (b[i] - Mx[i]) * (b[i] - Mx[i]);
+        bb += double(b[i]) * b[i];
+    }
+    return std::sqrt(r / bb);
+}
+
+
+//-----------------------------------------------------------------------------
+
+
+void report(const char* name, size_t bytes, double multiply_ms,
+            double solve_ms, int iterations, double res)
+{
+    printf("%-28s %10.1f %10.2f %10.2f %12.2e\n", name, bytes / 1048576.0,
+           multiply_ms, solve_ms / std::max(iterations, 1), res);
+}
+
+
+//-----------------------------------------------------------------------------
+
+
+// CSRSymmetricMatrix with matrix type T and arithmetic in T2
+template <class T, class T2>
+void run_csr(const char* name, const SparseSymmetricMatrix<float>& H,
+             const PoissonVector<float>& b, int iterations, int threads,
+             int repetitions)
+{
+    CSRSymmetricMatrix<T> M;
+    M.set(H, threads);
+
+    PoissonVector<T2> b2(b.Dimensions()), x(b.Dimensions()), y(b.Dimensions());
+    for (size_t i = 0; i < b.Dimensions(); ++i)
+        b2[i] = b[i];
+
+    Timer timer;
+    timer.start();
+    for (int i = 0; i < repetitions; ++i)
+        M.Multiply(b2, y);
+    timer.stop();
+    const double multiply_ms = timer.elapsed() / repetitions;
+
+    timer.start();
+    const int it = CSRSymmetricMatrix<T>::Solve(M, b2, iterations, x, T2(0));
+    timer.stop();
+    report(name, M.memoryUsage(), multiply_ms, timer.elapsed(), it,
+           residual(H, b2, x));
+}
+
+
+//-----------------------------------------------------------------------------
+
+
+int main(int argc, char** argv)
+{
+    const int n = argc > 1 ? std::max(atoi(argv[1]), 5) : 64;
+    const int iterations = argc > 2 ? std::max(atoi(argv[2]), 1) : 50;
+    int threads = 1;
+#ifdef _OPENMP
+    threads = omp_get_max_threads();
+#endif
+    if (argc > 3)
+        threads = std::max(atoi(argv[3]), 1);
+    const int repetitions = 10;
+
+    SparseSymmetricMatrix<float> H;
+    build_system(n, H);
+    size_t entries = 0;
+    for (int i = 0; i < H.rows; ++i)
+        entries += H.rowSizes[i];
+    std::cout << H.rows << " rows, " << entries << " stored entries, "
+              << iterations << " iterations, " << threads << " threads\n";
+
+    PoissonVector<float> b(H.rows), y(H.rows);
+    for (int i = 0; i < H.rows; ++i)
+        b[i] = float(std::sin(0.1 * i));
+
+    printf("%-28s %10s %10s %10s %12s\n", "solver", "MB", "product",
+           "iteration", "residual");
+    printf("%-28s %10s %10s %10s\n", "", "", "(ms)", "(ms)");
+
+    Timer timer;
+    {
+        SparseMatrix<float> M;
+        expand_rows(H, M);
+        timer.start();
+        for (int i = 0; i < repetitions; ++i)
+            M.Multiply(b, y, threads);
+        timer.stop();
+        const double multiply_ms = timer.elapsed() / repetitions;
+
+        PoissonVector<float> x;
+        timer.start();
+        const int it = SparseMatrix<float>::SolveSymmetric(
+            M, b, iterations, x, 0.0f, 1, threads);
+        timer.stop();
+        report("SparseMatrix (full rows)",
+               2 * entries * sizeof(MatrixEntry<float>), multiply_ms,
+               timer.elapsed(), it, residual(H, b, x));
+    }
+    {
+        MapReducePoissonVector<float> scratch;
+        scratch.resize(threads, H.rows);
+        timer.start();
+        for (int i = 0; i < repetitions; ++i)
+            H.Multiply(b, y, scratch);
+        timer.stop();
+        const double multiply_ms = timer.elapsed() / repetitions;
+
+        PoissonVector<float> x;
+        timer.start();
+        const int it = SparseSymmetricMatrix<float>::Solve(
+            H, b, iterations, x, scratch, 0.0f);
+        timer.stop();
+        report("SparseSymmetricMatrix",
+               entries * sizeof(MatrixEntry<float>) +
+                   size_t(threads) * H.rows * sizeof(float),
+               multiply_ms, timer.elapsed(), it, residual(H, b, x));
+    }
+    run_csr<float, float>("CSR float", H, b, iterations, threads, repetitions);
+    run_csr<float, double>("CSR float, double solver", H, b, iterations,
+                           threads, repetitions);
+    run_csr<double, double>("CSR double", H, b, iterations, threads,
+                            repetitions);
+
+    return 0;
+}
+
+
+//=============================================================================
@@ -0,0 +1,126 @@
+//=============================================================================
+//
+//   Exercise code for the lecture "Geometric Modeling"
+//   by Prof. Dr. Mario Botsch, TU Dortmund
+//
+//   Copyright (C) 2023 Computer Graphics Group, TU Dortmund.
+//
+//=============================================================================
+
+#include <01-reconstruction/MappedPointSet.h>
+#include <poisson/poisson.h>
+#include <pmp/Timer.h>
+#include <iostream>
+#include <cstdlib>
+#include <cstdio>
+#include <algorithm>
+
+using namespace pmp;
+
+//=============================================================================
+
+// Time the B-spline tables of the Poisson reconstruction per octree depth:
+// the dot-product tables of the system setup and the value tables of the
+// iso-value and the iso-surface extraction, as the reconstruction sets them
+// up. BSplineData computes them once per process and shares them, so the
+// first setup of a depth (cold) computes the tables and the second one
+// (warm) takes them from the cache. With a point set, the whole
+// reconstruction is timed cold and warm as well.
+//
+// usage: poisson-startup-benchmark [max_depth] [file.pts]
+
+//=============================================================================
+
+typedef BSplineData<2, Real> Tables;
+
+// the table setup of one reconstruction with free boundaries (see
+// Octree::setBSplineData and its callers)
+double setup_tables(int depth)
+{
+    Timer timer;
+    timer.start();
+
+    Tables data;
+    data.set(depth, true, 1);
+    data.setDotTables(Tables::DD_DOT_FLAG | Tables::DV_DOT_FLAG, false);
+    data.clearDotTables(Tables::VV_DOT_FLAG | Tables::DV_DOT_FLAG |
+                        Tables::DD_DOT_FLAG);
+    data.setDotTables(Tables::VV_DOT_FLAG | Tables::DV_DOT_FLAG, false);
+    data.clearDotTables(Tables::DV_DOT_FLAG);
+    data.setValueTables(Tables::VALUE_FLAG, 0);
+    data.setValueTables(Tables::VALUE_FLAG | Tables::D_VALUE_FLAG, 0,
+                        1.0 / (1 << depth));
+
+    timer.stop();
+    return timer.elapsed();
+}
+
+
+//-----------------------------------------------------------------------------
+
+
+// solve and extract, the number of polygons is returned in n_polygons
+double reconstruct(const PointCloudView& points, int depth, int& n_polygons)
+{
+    Timer timer;
+    timer.start();
+    Octree<2, false> tree;
+    CoredPoissonVectorMeshData<PlyVertex<float>> mesh;
+    if (PoissonSolve(tree, points.points.data(), points.normals.data(),
+                     points.size(), depth, 8, 2.0f))
+        PoissonExtract(tree, tree.GetIsoValue(), mesh);
+    timer.stop();
+    n_polygons = mesh.polygonCount();
+    return timer.elapsed();
+}
+
+
+//-----------------------------------------------------------------------------
+
+
+int main(int argc, char** argv)
+{
+    const int max_depth = argc > 1 ? std::max(atoi(argv[1]), 5) : 10;
+
+    MappedPointSet pts;
+    if (argc > 2 && !pts.open(argv[2]))
+    {
+        std::cerr << "cannot read " << argv[2] << std::endl;
+        return 1;
+    }
+    const PointCloudView& points = pts.view();
+    if (argc > 2)
+        std::cout << points.size() << " points\n";
+
+    printf("%5s %12s %12s", "depth", "tables cold", "tables warm");
+    if (argc > 2)
+        printf(" %12s %12s %10s", "recon. cold", "recon. warm", "polygons");
+    printf("\n%5s %12s %12s", "", "(ms)", "(ms)");
+    if (argc > 2)
+        printf(" %12s %12s", "(ms)", "(ms)");
+    printf("\n");
+
+    for (int depth = 5; depth <= max_depth; ++depth)
+    {
+        Tables::ClearTableCache();
+        const double cold = setup_tables(depth);
+        const double warm = setup_tables(depth);
+        printf("%5d %12.2f %12.3f", depth, cold, warm);
+
+        if (argc > 2)
+        {
+            int n_polygons;
+            Tables::ClearTableCache();
+            const double first = reconstruct(points, depth, n_polygons);
+            const double second = reconstruct(points, depth, n_polygons);
+            printf(" %12.1f %12.1f %10d", first, second, n_polygons);
+        }
+        printf("\n");
+        fflush(stdout);
+    }
+
+    return 0;
+}
+
+
+//=============================================================================
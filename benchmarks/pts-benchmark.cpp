@@ -0,0 +1,287 @@
+//=============================================================================
+//
+//   Exercise code for the lecture "Geometric Modeling"
+//   by Prof. Dr. Mario Botsch, TU Dortmund
+//
+//   Copyright (C) 2023 Computer Graphics Group, TU Dortmund.
+//
+//=============================================================================
+
+#include <01-reconstruction/MappedPointSet.h>
+#include <01-reconstruction/PointSet.h>
+#include <01-reconstruction/reconstruction.h>
+#include <01-reconstruction/MeshDistance.h>
+#include <pmp/Timer.h>
+#include <pmp/MemoryUsage.h>
+#include <random>
+#include <cstdio>
+#include <cstring>
+#include <cstdlib>
+
+using namespace pmp;
+
+//=============================================================================
+
+// Compare loading a binary .pts file by copying (fread into arrays, then
+// into SurfaceMesh vertex properties, as PointSet::read_data() used to) with
+// the viewer's load path (PointSet::read_points(), arrays moved into the
+// vertex properties) and with memory-mapping it (MappedPointSet),
+// optionally followed by a Hoppe or
+// Poisson reconstruction from the loaded data (poisson-ply writes the
+// Poisson result to pts-benchmark.ply instead of a SurfaceMesh). Reconstructed
+// meshes are compared with the input points (see reconstruction_error()).
+// Peak memory is only meaningful for a single mode per process, so run each
+// mode separately.
+//
+// usage: pts-benchmark copy|viewer|mmap <file.pts> [hoppe|hoppe-sparse|poisson|poisson-ply] [resolution/depth]
+//        pts-benchmark convert <in.pts> <out.pts>    (write aligned layout)
+//        pts-benchmark generate <out.pts> <n_points> (noisy sphere)
+
+//=============================================================================
+
+double mb(size_t bytes) { return bytes / 1024.0 / 1024.0; }
+
+void report(const char* stage, double ms)
+{
+    std::cout << stage << ": " << ms << " ms, RSS "
+              << mb(MemoryUsage::current_size()) << " MB, peak RSS "
+              << mb(MemoryUsage::max_size()) << " MB\n";
+}
+
+
+//-----------------------------------------------------------------------------
+
+
+// copy path: arrays read with fread, then copied into a SurfaceMesh
+bool load_copy(const char* filename, std::vector<Point>& points,
+               std::vector<Normal>& normals, std::vector<Color>& colors,
+               SurfaceMesh& mesh)
+{
+    FILE* in = fopen(filename, "rb");
+    if (!in) return false;
+
+    // aligned layout has a 16 byte header, legacy layout 5 bytes
+    char magic[4] = {0, 0, 0, 0};
+    size_t n = 0;
+    bool has_colors = false;
+    if (fread(magic, 1, 4, in) == 4 && !strncmp(magic, "PTS2", 4))
+    {
+        unsigned int flags;
+        unsigned long long n64;
+        if (fread(&flags, sizeof(flags), 1, in) != 1 ||
+            fread(&n64, sizeof(n64), 1, in) != 1)
+        {
+            fclose(in);
+            return false;
+        }
+        n = n64;
+        has_colors = flags & 1;
+    }
+    else
+    {
+        unsigned int n32;
+        std::memcpy(&n32, magic, 4);
+        char c;
+        if (fread(&c, 1, 1, in) != 1)
+        {
+            fclose(in);
+            return false;
+        }
+        n = n32;
+        has_colors = c;
+    }
+
+    points.resize(n);
+    normals.resize(n);
+    bool ok = fread((char*)points.data(), sizeof(Point), n, in) == n;
+    ok = ok && fread((char*)normals.data(), sizeof(Normal), n, in) == n;
+    if (has_colors)
+    {
+        colors.resize(n);
+        ok = ok && fread((char*)colors.data(), sizeof(Color), n, in) == n;
+    }
+    fclose(in);
+
+    // copy to mesh for rendering, as PointSet does
+    mesh.reserve(n, 0, 0);
+    for (size_t i = 0; i < n; ++i)
+        mesh.add_vertex(points[i]);
+    auto vnormal = mesh.vertex_property<Normal>("v:normal");
+    for (auto v : mesh.vertices())
+        vnormal[v] = normals[v.idx()];
+    if (has_colors)
+    {
+        auto vcolor = mesh.vertex_property<Color>("v:color");
+        for (auto v : mesh.vertices())
+            vcolor[v] = colors[v.idx()];
+    }
+
+    return ok;
+}
+
+
+//-----------------------------------------------------------------------------
+
+
+void reconstruct(const PointCloudView& pc, const char* method, int param)
+{
+    SurfaceMesh mesh;
+    Timer timer;
+    timer.start();
+    if (!strcmp(method, "poisson-ply"))
+    {
+        bool ok = reconstruct_poisson(pc, "pts-benchmark.ply", param, 8, 2.0);
+        timer.stop();
+        std::cout << (ok ? "wrote" : "cannot write") << " pts-benchmark.ply\n";
+        report(method, timer.elapsed());
+        return;
+    }
+
+    if (!strcmp(method, "poisson"))
+        reconstruct_poisson(pc, mesh, param, 8, 2.0);
+    else
+        reconstruct_hoppe(pc, mesh, param, 1, !strcmp(method, "hoppe-sparse"));
+    timer.stop();
+
+    std::cout << mesh.n_vertices() << " vertices, " << mesh.n_faces()
+              << " faces\n";
+    report(method, timer.elapsed());
+
+    // deviation from the input points, relative to their bounding box
+    ReconstructionError error;
+    if (reconstruction_error(pc, mesh, error))
+    {
+        const Scalar diagonal = pc.bounds().size();
+        std::cout << "error / bbox diagonal: points to mesh RMS "
+                  << error.points_to_mesh.rms / diagonal << ", p99 "
+                  << error.points_to_mesh.p99 / diagonal
+                  << ", mesh to points RMS "
+                  << error.mesh_to_points.rms / diagonal
+                  << ", Hausdorff " << error.hausdorff() / diagonal << "\n";
+    }
+}
+
+
+//-----------------------------------------------------------------------------
+
+
+int main(int argc, char** argv)
+{
+    if (argc < 3)
+    {
+        std::cerr << "usage: " << argv[0]
+                  << " copy|viewer|mmap <file.pts> [hoppe|hoppe-sparse|poisson|poisson-ply] [resolution/depth]\n"
+                  << "       " << argv[0] << " convert <in.pts> <out.pts>\n"
+                  << "       " << argv[0] << " generate <out.pts> <n_points>\n";
+        return 1;
+    }
+
+    const char* mode     = argv[1];
+    const char* filename = argv[2];
+    const char* method   = argc > 3 ? argv[3] : nullptr;
+    const int   param    = argc > 4 ? atoi(argv[4]) :
+                           (method && !strncmp(method, "poisson", 7) ? 8 : 200);
+
+    Timer timer;
+    report("start", 0);
+
+    if (!strcmp(mode, "generate") && argc > 3)
+    {
+        size_t n = strtoull(argv[3], nullptr, 10);
+        std::vector<Point> points(n);
+        std::vector<Normal> normals(n);
+        std::mt19937 rng(42);
+        std::normal_distribution<float> gauss;
+        for (size_t i = 0; i < n; ++i)
+        {
+            normals[i] = normalize(Normal(gauss(rng), gauss(rng), gauss(rng)));
+            points[i]  = normals[i] * (1.0f + 0.001f * gauss(rng));
+        }
+        PointCloudView pc;
+        pc.points  = Span<Point>(points);
+        pc.normals = Span<Normal>(normals);
+        return write_pts(argv[2], pc) ? 0 : 1;
+    }
+
+    if (!strcmp(mode, "convert") && argc > 3)
+    {
+        MappedPointSet pts;
+        if (!pts.open(filename) || !write_pts(argv[3], pts.view()))
+        {
+            std::cerr << "cannot convert " << filename << std::endl;
+            return 1;
+        }
+        return 0;
+    }
+
+    if (!strcmp(mode, "copy"))
+    {
+        std::vector<Point> points;
+        std::vector<Normal> normals;
+        std::vector<Color> colors;
+        SurfaceMesh mesh;
+
+        timer.start();
+        bool ok = load_copy(filename, points, normals, colors, mesh);
+        timer.stop();
+        if (!ok)
+        {
+            std::cerr << "cannot read " << filename << std::endl;
+            return 1;
+        }
+        std::cout << points.size() << " points (copied)\n";
+        report("load", timer.elapsed());
+
+        PointCloudView pc;
+        pc.points  = Span<Point>(points);
+        pc.normals = Span<Normal>(normals);
+        pc.colors  = Span<Color>(colors);
+        if (method) reconstruct(pc, method, param);
+    }
+    else if (!strcmp(mode, "viewer"))
+    {
+        PointSet pointset;
+
+        timer.start();
+        bool ok = pointset.read_points(filename);
+        timer.stop();
+        if (!ok)
+        {
+            std::cerr << "cannot read " << filename << std::endl;
+            return 1;
+        }
+        std::cout << pointset.n_vertices() << " points (viewer)\n";
+        report("load", timer.elapsed());
+
+        if (method) reconstruct(pointset.view(), method, param);
+    }
+    else if (!strcmp(mode, "mmap"))
+    {
+        MappedPointSet pts;
+
+        timer.start();
+        bool ok = pts.open(filename);
+        timer.stop();
+        if (!ok)
+        {
+            std::cerr << "cannot read " << filename << std::endl;
+            return 1;
+        }
+        std::cout << pts.view().size() << " points ("
+                  << (pts.is_zero_copy() ? "mapped" : "legacy layout, copied")
+                  << ")\n";
+        report("load", timer.elapsed());
+
+        if (method) reconstruct(pts.view(), method, param);
+    }
+    else
+    {
+        std::cerr << "unknown mode " << mode << std::endl;
+        return 1;
+    }
+
+    return 0;
+}
+
+
+//=============================================================================
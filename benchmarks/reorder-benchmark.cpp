@@ -0,0 +1,201 @@
+//=============================================================================
+//
+//   Exercise code for the lecture "Geometric Modeling"
+//   by Prof. Dr. Mario Botsch, TU Dortmund
+//
+//   Copyright (C) 2023 Computer Graphics Group, TU Dortmund.
+//
+//=============================================================================
+
+#include <pmp/visualization/SurfaceMeshGL.h>
+#include <pmp/algorithms/SurfaceNormals.h>
+#include <pmp/algorithms/SurfaceReorder.h>
+#include <pmp/Timer.h>
+#include <GLFW/glfw3.h>
+#include <iostream>
+#include <cstdlib>
+#include <cstdio>
+#include <cstring>
+#include <numeric>
+#include <random>
+#include <cmath>
+
+using namespace pmp;
+
+//=============================================================================
+
+// Time SurfaceNormals::compute_vertex_normals() and the upload of the
+// OpenGL buffers (SurfaceMeshGL::update_opengl_buffers()) for a mesh in its
+// original order and after reorder() with each strategy. The mean index
+// distance between the two vertices of an edge and between a face and its
+// vertices indicates the locality of each order. Upload times are skipped
+// if no OpenGL context can be created. Meshes extracted by marching cubes
+// or Poisson reconstruction (e.g., pts-benchmark.ply written by
+// pts-benchmark) are typical inputs; with "shuffle", all elements are put
+// into random order first.
+//
+// usage: reorder-benchmark <mesh> [repetitions] [shuffle]
+
+//=============================================================================
+
+bool init_opengl()
+{
+    if (!glfwInit())
+        return false;
+    glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
+    glfwWindowHint(GLFW_OPENGL_FORWARD_COMPAT, GLFW_TRUE);
+    glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
+    glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 2);
+    glfwWindowHint(GLFW_VISIBLE, GLFW_FALSE);
+    GLFWwindow* window = glfwCreateWindow(64, 64, "", nullptr, nullptr);
+    if (!window)
+        return false;
+    glfwMakeContextCurrent(window);
+    glewExperimental = GL_TRUE;
+    return glewInit() == GLEW_OK;
+}
+
+
+//-----------------------------------------------------------------------------
+
+
+// mean index distance of edge vertices and of face-vertex pairs
+void locality(const SurfaceMesh& mesh, double& edge_span, double& face_span)
+{
+    edge_span = face_span = 0.0;
+    for (auto e : mesh.edges())
+        edge_span += std::abs(double(mesh.vertex(e, 0).idx()) -
+                              double(mesh.vertex(e, 1).idx()));
+    edge_span /= std::max<size_t>(mesh.n_edges(), 1);
+
+    // faces are scaled to the index range of the vertices
+    const double scale = double(mesh.n_vertices()) / mesh.n_faces();
+    size_t n = 0;
+    for (auto f : mesh.faces())
+    {
+        for (auto v : mesh.vertices(f))
+        {
+            face_span += std::abs(scale * f.idx() - double(v.idx()));
+            ++n;
+        }
+    }
+    face_span /= std::max<size_t>(n, 1);
+}
+
+
+//-----------------------------------------------------------------------------
+
+
+void run(const char* name, const SurfaceMesh& input, ReorderStrategy* strategy,
+         int repetitions, bool gl)
+{
+    SurfaceMesh mesh = input;
+
+    Timer timer;
+    double reorder_ms = 0.0;
+    if (strategy)
+    {
+        timer.start();
+        reorder(mesh, *strategy);
+        timer.stop();
+        reorder_ms = timer.elapsed();
+    }
+
+    double edge_span, face_span;
+    locality(mesh, edge_span, face_span);
+
+    timer.start();
+    for (int i = 0; i < repetitions; ++i)
+        SurfaceNormals::compute_vertex_normals(mesh);
+    timer.stop();
+    const double normals_ms = timer.elapsed() / repetitions;
+
+    double upload_ms = 0.0;
+    if (gl)
+    {
+        SurfaceMeshGL gl_mesh;
+        static_cast<SurfaceMesh&>(gl_mesh) = mesh;
+        gl_mesh.set_crease_angle(180); // smooth shading, vertex normals
+        gl_mesh.update_opengl_buffers();
+        glFinish();
+        timer.start();
+        for (int i = 0; i < repetitions; ++i)
+            gl_mesh.update_opengl_buffers();
+        glFinish();
+        timer.stop();
+        upload_ms = timer.elapsed() / repetitions;
+    }
+
+    printf("%-9s %10.1f %10.1f %10.2f %10.2f", name, edge_span, face_span,
+           reorder_ms, normals_ms);
+    if (gl)
+        printf(" %10.2f", upload_ms);
+    printf("\n");
+}
+
+
+//-----------------------------------------------------------------------------
+
+
+int main(int argc, char** argv)
+{
+    if (argc < 2)
+    {
+        std::cerr << "usage: " << argv[0]
+                  << " <mesh> [repetitions] [shuffle]\n";
+        return 1;
+    }
+    const int repetitions = argc > 2 ? std::max(atoi(argv[2]), 1) : 5;
+
+    SurfaceMesh mesh;
+    try
+    {
+        mesh.read(argv[1]);
+    }
+    catch (const std::exception& e)
+    {
+        std::cerr << e.what() << std::endl;
+        return 1;
+    }
+    if (argc > 3 && !strcmp(argv[3], "shuffle"))
+    {
+        std::mt19937 rng(42);
+        auto shuffled = [&](size_t n) {
+            std::vector<IndexType> order(n);
+            std::iota(order.begin(), order.end(), 0);
+            std::shuffle(order.begin(), order.end(), rng);
+            return order;
+        };
+        mesh.permute(shuffled(mesh.vertices_size()),
+                     shuffled(mesh.edges_size()), shuffled(mesh.faces_size()));
+    }
+
+    std::cout << mesh.n_vertices() << " vertices, " << mesh.n_faces()
+              << " faces\n";
+
+    const bool gl = init_opengl();
+    if (!gl)
+        std::cout << "no OpenGL context, skipping upload timings\n";
+
+    printf("%-9s %10s %10s %10s %10s", "order", "edge span", "face span",
+           "reorder", "normals");
+    if (gl)
+        printf(" %10s", "upload");
+    printf("  (ms)\n");
+
+    ReorderStrategy morton = ReorderStrategy::Morton;
+    ReorderStrategy hilbert = ReorderStrategy::Hilbert;
+    ReorderStrategy rcm = ReorderStrategy::RCM;
+    run("original", mesh, nullptr, repetitions, gl);
+    run("Morton", mesh, &morton, repetitions, gl);
+    run("Hilbert", mesh, &hilbert, repetitions, gl);
+    run("RCM", mesh, &rcm, repetitions, gl);
+
+    if (gl)
+        glfwTerminate();
+
+    return 0;
+}
+
+
+//=============================================================================
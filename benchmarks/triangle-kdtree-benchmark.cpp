@@ -0,0 +1,157 @@
+//=============================================================================
+//
+//   Exercise code for the lecture "Geometric Modeling"
+//   by Prof. Dr. Mario Botsch, TU Dortmund
+//
+//   Copyright (C) 2023 Computer Graphics Group, TU Dortmund.
+//
+//=============================================================================
+
+#include <pmp/SurfaceMesh.h>
+#include <pmp/algorithms/TriangleKdTree.h>
+#include <pmp/BoundingBox.h>
+#include <pmp/Timer.h>
+#include <pmp/MemoryUsage.h>
+#include <iostream>
+#include <random>
+#include <cstdlib>
+#include <cstdio>
+#include <cmath>
+
+using namespace pmp;
+
+//=============================================================================
+
+// Compare build time, memory, and query time of the TriangleKdTree build
+// methods: the original Midpoint tree and the parallel Median and SAH trees
+// with flat node storage. Queries are mesh vertices displaced by up to 1% of
+// the bounding box diagonal, as in a mesh-to-mesh distance; the distances
+// have to agree for all trees. Memory is reported as the size of the tree
+// and as the increase of the resident set size after the build.
+//
+// usage: triangle-kdtree-benchmark <mesh> [n_queries] [max_faces]
+
+//=============================================================================
+
+struct Result
+{
+    double build_ms;
+    double query_ms;
+    double memory_mb;
+    double rss_mb;
+    size_t n_nodes;
+    size_t n_leaf_faces;
+    std::vector<Scalar> dist;
+};
+
+
+//-----------------------------------------------------------------------------
+
+
+Result run(const std::shared_ptr<const SurfaceMesh>& mesh,
+           const std::vector<Point>& queries, unsigned int max_faces,
+           TriangleKdTree::BuildMethod method)
+{
+    Result result;
+    Timer timer;
+
+    const size_t rss_before = MemoryUsage::current_size();
+    timer.start();
+    TriangleKdTree tree(mesh, max_faces, 30, method);
+    timer.stop();
+    result.build_ms = timer.elapsed();
+    result.rss_mb =
+        (double(MemoryUsage::current_size()) - double(rss_before)) / 1048576.0;
+    result.memory_mb = tree.memory_usage() / 1048576.0;
+    result.n_nodes = tree.n_nodes();
+    result.n_leaf_faces = tree.n_leaf_faces();
+
+    result.dist.resize(queries.size());
+    timer.start();
+    for (size_t i = 0; i < queries.size(); ++i)
+        result.dist[i] = tree.nearest(queries[i]).dist;
+    timer.stop();
+    result.query_ms = timer.elapsed();
+
+    return result;
+}
+
+
+//-----------------------------------------------------------------------------
+
+
+int main(int argc, char** argv)
+{
+    if (argc < 2)
+    {
+        std::cerr << "usage: " << argv[0]
+                  << " <mesh> [n_queries] [max_faces]\n";
+        return 1;
+    }
+    const size_t n_queries = argc > 2 ? atol(argv[2]) : 1000000;
+    const unsigned int max_faces = argc > 3 ? atoi(argv[3]) : 10;
+
+    auto mesh = std::make_shared<SurfaceMesh>();
+    try
+    {
+        mesh->read(argv[1]);
+    }
+    catch (const std::exception& e)
+    {
+        std::cerr << e.what() << std::endl;
+        return 1;
+    }
+    if (mesh->n_vertices() == 0)
+        return 1;
+
+    BoundingBox bbox = mesh->bounds();
+    std::mt19937 rng(42);
+    std::uniform_real_distribution<Scalar> offset(-0.01 * bbox.size(),
+                                                  0.01 * bbox.size());
+    std::uniform_int_distribution<IndexType> vertex(
+        0, IndexType(mesh->vertices_size() - 1));
+    auto points = mesh->get_vertex_property<Point>("v:point");
+    std::vector<Point> queries(n_queries);
+    for (auto& q : queries)
+        q = points[Vertex(vertex(rng))] +
+            Point(offset(rng), offset(rng), offset(rng));
+
+    std::cout << mesh->n_vertices() << " vertices, " << mesh->n_faces()
+              << " faces, " << n_queries << " queries, " << max_faces
+              << " faces per leaf\n";
+
+    // flat trees first: their few large blocks are returned to the OS on
+    // destruction and do not distort the measurement of the linked tree
+    const Result sah = run(mesh, queries, max_faces,
+                           TriangleKdTree::BuildMethod::SAH);
+    const Result median = run(mesh, queries, max_faces,
+                              TriangleKdTree::BuildMethod::Median);
+    const Result midpoint = run(mesh, queries, max_faces,
+                                TriangleKdTree::BuildMethod::Midpoint);
+
+    printf("%-9s %10s %12s %10s %10s %10s %10s  (ms, MB)\n", "method",
+           "nodes", "leaf faces", "build", "memory", "RSS", "queries");
+    auto print = [](const char* name, const Result& r) {
+        printf("%-9s %10zu %12zu %10.1f %10.1f %10.1f %10.1f\n", name,
+               r.n_nodes, r.n_leaf_faces, r.build_ms, r.memory_mb, r.rss_mb,
+               r.query_ms);
+    };
+    print("Midpoint", midpoint);
+    print("Median", median);
+    print("SAH", sah);
+
+    size_t mismatches = 0;
+    for (size_t i = 0; i < n_queries; ++i)
+    {
+        const Scalar eps = 1e-5 * (midpoint.dist[i] + bbox.size());
+        if (std::fabs(median.dist[i] - midpoint.dist[i]) > eps ||
+            std::fabs(sah.dist[i] - midpoint.dist[i]) > eps)
+            ++mismatches;
+    }
+    std::cout << mismatches << " mismatching distances\n";
+
+    return mismatches ? EXIT_FAILURE : EXIT_SUCCESS;
+}
+
+
+//=============================================================================
@@ -0,0 +1,50 @@
+// Copyright 2011-2020 the Polygon Mesh Processing Library developers.
+// Distributed under a MIT-style license, see LICENSE.txt for details.
+
+#pragma once
+
+#include <cstddef>
+#include <string>
+
+namespace pmp {
+
+//! A file mapped read-only into memory.
+//! \ingroup core
+class MappedFile
+{
+public:
+    //! Constructor, no file is mapped
+    MappedFile() = default;
+
+    //! Destructor, unmaps the file
+    ~MappedFile() { close(); }
+
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    //! Map the whole file, returns false if it cannot be opened.
+    bool open(const std::string& filename);
+
+    //! Unmap the file
+    void close();
+
+    //! Is a file mapped?
+    bool is_open() const { return is_open_; }
+
+    //! Begin of the mapped file, nullptr for empty files
+    const char* data() const { return data_; }
+
+    //! Size of the mapped file in bytes
+    size_t size() const { return size_; }
+
+private:
+    const char* data_{nullptr};
+    size_t size_{0};
+    bool is_open_{false};
+#ifdef _WIN32
+    void* file_{nullptr};
+    void* mapping_{nullptr};
+#endif
+};
+
+} // namespace pmp
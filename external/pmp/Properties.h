@@ -5,14 +5,18 @@
 #pragma once
 
 #include <cassert>
+#include <cstring>
 
 #include <string>
 #include <utility>
 #include <vector>
 #include <algorithm>
 #include <typeinfo>
+#include <type_traits>
 #include <iostream>
 
+#include "pmp/Types.h"
+
 namespace pmp {
 
 class BasePropertyArray
@@ -39,12 +43,29 @@ public:
     //! Let two elements swap their storage place.
     virtual void swap(size_t i0, size_t i1) = 0;
 
+    //! Reorder elements such that element i is the old element \p order[i].
+    //! The size changes to the size of \p order, i.e., elements not listed
+    //! are removed.
+    virtual void permute(const std::vector<IndexType>& order) = 0;
+
     //! Return a deep copy of self.
     virtual BasePropertyArray* clone() const = 0;
 
     //! Return the type_info of the property
     virtual const std::type_info& type() = 0;
 
+    //! Size in bytes of one element when stored as raw bytes, or 0 if the
+    //! element type is not trivially copyable.
+    virtual size_t raw_element_size() const = 0;
+
+    //! Copy all elements as raw bytes to \p dst, which has to provide
+    //! raw_element_size() bytes per element.
+    virtual void raw_copy_to(char* dst) const = 0;
+
+    //! Copy \p n elements from the raw bytes \p src, which have been
+    //! written by raw_copy_to(). The array has to hold n elements.
+    virtual void raw_copy_from(const char* src, size_t n) = 0;
+
     //! Return the name of the property
     const std::string& name() const { return name_; }
 
@@ -81,6 +102,14 @@ public:
         data_[i1] = d;
     }
 
+    void permute(const std::vector<IndexType>& order) override
+    {
+        VectorType data(order.size());
+        for (size_t i = 0; i < order.size(); ++i)
+            data[i] = std::move(data_[order[i]]);
+        data_.swap(data);
+    }
+
     BasePropertyArray* clone() const override
     {
         auto* p = new PropertyArray<T>(name_, value_);
@@ -90,6 +119,25 @@ public:
 
     const std::type_info& type() override { return typeid(T); }
 
+    size_t raw_element_size() const override
+    {
+        return std::is_trivially_copyable<T>::value ? sizeof(T) : 0;
+    }
+
+    void raw_copy_to(char* dst) const override
+    {
+        if (std::is_trivially_copyable<T>::value && !data_.empty())
+            std::memcpy(dst, (const void*)data_.data(),
+                        data_.size() * sizeof(T));
+    }
+
+    void raw_copy_from(const char* src, size_t n) override
+    {
+        assert(n <= data_.size());
+        if (std::is_trivially_copyable<T>::value && n > 0)
+            std::memcpy((void*)data_.data(), src, n * sizeof(T));
+    }
+
     //! Get pointer to array (does not work for T==bool)
     const T* data() const { return &data_[0]; }
 
@@ -123,6 +171,28 @@ inline const bool* PropertyArray<bool>::data() const
     return nullptr;
 }
 
+// std::vector<bool> is bit-packed, store one byte per element
+template <>
+inline size_t PropertyArray<bool>::raw_element_size() const
+{
+    return 1;
+}
+
+template <>
+inline void PropertyArray<bool>::raw_copy_to(char* dst) const
+{
+    for (size_t i = 0; i < data_.size(); ++i)
+        dst[i] = data_[i] ? 1 : 0;
+}
+
+template <>
+inline void PropertyArray<bool>::raw_copy_from(const char* src, size_t n)
+{
+    assert(n <= data_.size());
+    for (size_t i = 0; i < n; ++i)
+        data_[i] = src[i] != 0;
+}
+
 template <class T>
 class Property
 {
@@ -220,6 +290,9 @@ public:
         return names;
     }
 
+    // returns all property arrays, e.g., for type-independent file I/O
+    const std::vector<BasePropertyArray*>& arrays() const { return parrays_; }
+
     // add a property with name \p name and default value \p t
     template <class T>
     Property<T> add(const std::string& name, const T t = T())
@@ -344,6 +417,17 @@ public:
             parray->swap(i0, i1);
     }
 
+    // reorder all arrays such that element i is the old element order[i],
+    // one gather pass per array, different arrays in parallel
+    void permute(const std::vector<IndexType>& order)
+    {
+        const int n = int(parrays_.size());
+#pragma omp parallel for schedule(dynamic)
+        for (int i = 0; i < n; ++i)
+            parrays_[i]->permute(order);
+        size_ = order.size();
+    }
+
 private:
     std::vector<BasePropertyArray*> parrays_;
     size_t size_{0};
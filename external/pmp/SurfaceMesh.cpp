@@ -4,7 +4,10 @@
 
 #include "pmp/SurfaceMesh.h"
 
+#include <algorithm>
 #include <cmath>
+#include <cstdint>
+#include <string>
 
 #include "pmp/SurfaceMeshIO.h"
 
@@ -445,6 +448,326 @@ Face SurfaceMesh::add_face(const std::vector<Vertex>& vertices)
     return f;
 }
 
+void SurfaceMesh::build(std::vector<Point> points,
+                        const std::vector<IndexType>& indices,
+                        const std::vector<IndexType>& valences)
+{
+    // OpenMP wants signed loop variables
+    using Index = std::int64_t;
+    const IndexType invalid = PMP_MAX_INDEX;
+
+    const Index nv = points.size();
+    const Index nc = indices.size(); // corners, one per face halfedge
+    const bool triangles = valences.empty();
+    const Index nf = triangles ? nc / 3 : Index(valences.size());
+
+    if (points.size() >= PMP_MAX_INDEX || 2 * indices.size() >= PMP_MAX_INDEX)
+    {
+        auto what = "SurfaceMesh::build: max. index reached";
+        throw AllocationException(what);
+    }
+
+    // first corner of each face, only needed for general polygons
+    std::vector<IndexType> face_begin, corner_face;
+    if (triangles)
+    {
+        if (nc % 3)
+        {
+            auto what = "SurfaceMesh::build: Number of indices is not a "
+                        "multiple of three.";
+            throw InvalidInputException(what);
+        }
+    }
+    else
+    {
+        face_begin.resize(nf + 1);
+        face_begin[0] = 0;
+        Index n = 0;
+        for (Index f = 0; f < nf; ++f)
+        {
+            n += valences[f];
+            if (n > nc)
+                break;
+            face_begin[f + 1] = IndexType(n);
+        }
+        if (n != nc)
+        {
+            auto what = "SurfaceMesh::build: Valences do not match the "
+                        "number of indices.";
+            throw InvalidInputException(what);
+        }
+
+        corner_face.resize(nc);
+#pragma omp parallel for
+        for (Index f = 0; f < nf; ++f)
+            for (IndexType c = face_begin[f]; c < face_begin[f + 1]; ++c)
+                corner_face[c] = IndexType(f);
+    }
+
+    // corner c is the halfedge from indices[c] to indices[next(c)]
+    auto begin = [&](Index f) -> Index {
+        return triangles ? 3 * f : Index(face_begin[f]);
+    };
+    auto end = [&](Index f) -> Index {
+        return triangles ? 3 * f + 3 : Index(face_begin[f + 1]);
+    };
+    auto next = [&](Index c) -> Index {
+        if (triangles)
+            return c % 3 == 2 ? c - 2 : c + 1;
+        const Index f = corner_face[c];
+        return c + 1 == Index(face_begin[f + 1]) ? Index(face_begin[f]) : c + 1;
+    };
+    auto prev = [&](Index c) -> Index {
+        if (triangles)
+            return c % 3 == 0 ? c + 2 : c - 1;
+        const Index f = corner_face[c];
+        return c == Index(face_begin[f]) ? Index(face_begin[f + 1]) - 1 : c - 1;
+    };
+    auto target = [&](Index c) { return indices[next(c)]; };
+
+    // check indices and degenerate faces
+    Index n_out_of_range = 0, n_degenerate = 0;
+#pragma omp parallel for reduction(+ : n_out_of_range, n_degenerate)
+    for (Index f = 0; f < nf; ++f)
+    {
+        const Index b = begin(f), e = end(f);
+        bool degenerate = (e - b < 3);
+        for (Index c = b; c < e; ++c)
+        {
+            if (indices[c] >= IndexType(nv))
+                ++n_out_of_range;
+            for (Index d = c + 1; d < e; ++d)
+                if (indices[c] == indices[d])
+                    degenerate = true;
+        }
+        if (degenerate)
+            ++n_degenerate;
+    }
+    if (n_out_of_range)
+    {
+        auto what = "SurfaceMesh::build: " + std::to_string(n_out_of_range) +
+                    " vertex indices out of range.";
+        throw InvalidInputException(what);
+    }
+    if (n_degenerate)
+    {
+        auto what = "SurfaceMesh::build: " + std::to_string(n_degenerate) +
+                    " degenerate faces.";
+        throw TopologyException(what);
+    }
+
+    // Outgoing corners of each vertex v, sorted by a counting sort. For each
+    // we store its target and the source of its previous corner, i.e., the
+    // other vertex of the incoming corner of the same face. This way all
+    // edges of v can be matched without leaving v's part of the array.
+    std::vector<IndexType> out_begin(nv + 1, 0);
+    for (Index c = 0; c < nc; ++c)
+        ++out_begin[indices[c] + 1];
+    for (Index v = 0; v < nv; ++v)
+        out_begin[v + 1] += out_begin[v];
+
+    struct OutCorner
+    {
+        IndexType corner, target, source;
+    };
+    std::vector<OutCorner> out(nc);
+    {
+        std::vector<IndexType> fill(out_begin.begin(), out_begin.end() - 1);
+        for (Index c = 0; c < nc; ++c)
+            out[fill[indices[c]]++] = {IndexType(c), target(c),
+                                       indices[prev(c)]};
+    }
+
+    // An edge from v to t is manifold if there is at most one corner v->t
+    // and at most one corner t->v, the two corners are opposite then.
+    // Complex edges are counted once, at a vertex with outgoing corners
+    // along the edge (the smaller one if both have). The fans around v are
+    // chained by rotate, from the incoming corner of a face to the outgoing
+    // corner of the next face, and have to cover all corners of v.
+    std::vector<IndexType> opposite(nc, invalid);
+    Index n_complex_edges = 0, n_complex_vertices = 0;
+#pragma omp parallel reduction(+ : n_complex_edges, n_complex_vertices)
+    {
+        std::vector<Index> rotate;
+        std::vector<char> matched;
+
+#pragma omp for schedule(dynamic, 1024)
+        for (Index v = 0; v < nv; ++v)
+        {
+            const Index b = out_begin[v], e = out_begin[v + 1];
+            const Index degree = e - b;
+            rotate.assign(degree, -1);
+            matched.assign(degree, false);
+
+            for (Index i = b; i < e; ++i)
+            {
+                const IndexType t = out[i].target;
+                Index n_out = 0, n_in = 0, i_in = 0;
+                for (Index j = b; j < e; ++j)
+                {
+                    n_out += (out[j].target == t);
+                    if (out[j].source == t)
+                        ++n_in, i_in = j;
+                }
+
+                if (n_out == 1 && n_in == 1)
+                {
+                    opposite[out[i].corner] = IndexType(prev(out[i_in].corner));
+                    rotate[i_in - b] = i - b;
+                    matched[i - b] = true;
+                }
+                else if ((n_out > 1 || n_in > 1) &&
+                         (n_in == 0 || IndexType(v) < t) &&
+                         std::none_of(out.begin() + b, out.begin() + i,
+                                      [t](const OutCorner& o) {
+                                          return o.target == t;
+                                      }))
+                {
+                    ++n_complex_edges;
+                }
+            }
+
+            // walk the open fans from their unmatched first corner, or
+            // the single closed fan
+            Index visited = 0;
+            bool closed = true;
+            for (Index i = 0; i < degree; ++i)
+            {
+                if (matched[i])
+                    continue;
+                closed = false;
+                for (Index j = i; j != -1 && visited <= degree; j = rotate[j])
+                    ++visited;
+            }
+            if (closed && degree)
+            {
+                Index j = 0;
+                do
+                    ++visited;
+                while ((j = rotate[j]) > 0 && visited <= degree);
+            }
+
+            if (visited != degree)
+                ++n_complex_vertices;
+        }
+    }
+
+    // only the corners are needed to link the boundary below
+    std::vector<IndexType> out_corner(nc);
+#pragma omp parallel for
+    for (Index i = 0; i < nc; ++i)
+        out_corner[i] = out[i].corner;
+    std::vector<OutCorner>().swap(out);
+
+    if (n_complex_edges || n_complex_vertices)
+    {
+        auto what = "SurfaceMesh::build: " + std::to_string(n_complex_edges) +
+                    " complex edges, " + std::to_string(n_complex_vertices) +
+                    " complex vertices.";
+        throw TopologyException(what);
+    }
+
+    // number the edges in order of their first corner, as add_face() does:
+    // the halfedge of the first corner gets the even index
+    std::vector<IndexType> half(nc);
+    const Index n_blocks = std::min<Index>(nc, 1024) + 1;
+    std::vector<IndexType> block_edges(n_blocks + 1, 0);
+    auto is_first = [&](Index c) {
+        return opposite[c] == invalid || c < Index(opposite[c]);
+    };
+#pragma omp parallel for
+    for (Index k = 0; k < n_blocks; ++k)
+        for (Index c = nc * k / n_blocks; c < nc * (k + 1) / n_blocks; ++c)
+            if (is_first(c))
+                ++block_edges[k + 1];
+    for (Index k = 0; k < n_blocks; ++k)
+        block_edges[k + 1] += block_edges[k];
+    const Index ne = block_edges[n_blocks];
+#pragma omp parallel for
+    for (Index k = 0; k < n_blocks; ++k)
+    {
+        IndexType e = block_edges[k];
+        for (Index c = nc * k / n_blocks; c < nc * (k + 1) / n_blocks; ++c)
+            if (is_first(c))
+                half[c] = 2 * e++;
+    }
+#pragma omp parallel for
+    for (Index c = 0; c < nc; ++c)
+        if (!is_first(c))
+            half[c] = half[opposite[c]] + 1;
+
+    // replace the mesh, keep only the standard properties
+    clear();
+    vpoint_.vector().swap(points);
+    vprops_.resize(nv);
+    hprops_.resize(2 * ne);
+    eprops_.resize(ne);
+    fprops_.resize(nf);
+
+#pragma omp parallel for
+    for (Index f = 0; f < nf; ++f)
+    {
+        for (Index c = begin(f); c < end(f); ++c)
+        {
+            auto& hc = hconn_[Halfedge(half[c])];
+            hc.face_ = Face(IndexType(f));
+            hc.vertex_ = Vertex(target(c));
+            hc.next_halfedge_ = Halfedge(half[next(c)]);
+            hc.prev_halfedge_ = Halfedge(half[prev(c)]);
+        }
+        fconn_[Face(IndexType(f))].halfedge_ = Halfedge(half[end(f) - 1]);
+    }
+
+    // Outgoing halfedges and boundary halfedges. The boundary halfedge
+    // entering v at the end of one fan continues with the one leaving v at
+    // the next fan, boundary(c) is the boundary halfedge opposite to c.
+    auto boundary = [&](Index c) { return Halfedge(half[c] + 1); };
+#pragma omp parallel for schedule(dynamic, 1024)
+    for (Index v = 0; v < nv; ++v)
+    {
+        const Index b = out_begin[v], e = out_begin[v + 1];
+        if (b == e)
+            continue;
+
+        const Vertex vh(static_cast<IndexType>(v));
+        Index first_end = -1, last_start = -1;
+        for (Index i = b; i < e; ++i)
+        {
+            const Index s = out_corner[i];
+            if (opposite[s] != invalid)
+                continue;
+
+            // the fan starting at s ends at the incoming corner p
+            Index p = prev(s);
+            while (opposite[p] != invalid)
+                p = prev(opposite[p]);
+
+            if (last_start == -1)
+            {
+                first_end = p;
+                vconn_[vh].halfedge_ = boundary(p);
+            }
+            else
+            {
+                hconn_[boundary(last_start)].next_halfedge_ = boundary(p);
+                hconn_[boundary(p)].prev_halfedge_ = boundary(last_start);
+            }
+            hconn_[boundary(s)].vertex_ = vh;
+            last_start = s;
+        }
+
+        if (last_start == -1)
+        {
+            vconn_[vh].halfedge_ = Halfedge(half[out_corner[b]]);
+        }
+        else
+        {
+            hconn_[boundary(last_start)].next_halfedge_ = boundary(first_end);
+            hconn_[boundary(first_end)].prev_halfedge_ = boundary(last_start);
+        }
+    }
+}
+
 size_t SurfaceMesh::valence(Vertex v) const
 {
     auto vv = vertices(v);
@@ -1157,146 +1480,156 @@ void SurfaceMesh::delete_face(Face f)
     has_garbage_ = true;
 }
 
-void SurfaceMesh::garbage_collection()
-{
-    if (!has_garbage_)
-        return;
+namespace {
 
-    auto nV = vertices_size();
-    auto nE = edges_size();
-    auto nH = halfedges_size();
-    auto nF = faces_size();
-
-    // setup handle mapping
-    VertexProperty<Vertex> vmap =
-        add_vertex_property<Vertex>("v:garbage-collection");
-    HalfedgeProperty<Halfedge> hmap =
-        add_halfedge_property<Halfedge>("h:garbage-collection");
-    FaceProperty<Face> fmap = add_face_property<Face>("f:garbage-collection");
-    for (size_t i = 0; i < nV; ++i)
-        vmap[Vertex(i)] = Vertex(i);
-    for (size_t i = 0; i < nH; ++i)
-        hmap[Halfedge(i)] = Halfedge(i);
-    for (size_t i = 0; i < nF; ++i)
-        fmap[Face(i)] = Face(i);
-
-    // remove deleted vertices
-    if (nV > 0)
+// Compute the old index of each element that is not deleted (keep) and
+// the new index of each old element (map, PMP_MAX_INDEX if deleted) by a
+// prefix sum over blocks of elements, which are processed in parallel.
+void compaction_map(const std::vector<bool>& deleted,
+                    std::vector<IndexType>& keep, std::vector<IndexType>& map)
+{
+    using Index = std::int64_t;
+    const Index n = deleted.size();
+    const Index n_blocks = std::min<Index>(n, 1024) + 1;
+
+    std::vector<IndexType> offsets(n_blocks + 1, 0);
+#pragma omp parallel for
+    for (Index k = 0; k < n_blocks; ++k)
+        for (Index i = n * k / n_blocks; i < n * (k + 1) / n_blocks; ++i)
+            if (!deleted[i])
+                ++offsets[k + 1];
+    for (Index k = 0; k < n_blocks; ++k)
+        offsets[k + 1] += offsets[k];
+
+    keep.resize(offsets[n_blocks]);
+    map.resize(n);
+#pragma omp parallel for
+    for (Index k = 0; k < n_blocks; ++k)
     {
-        int i0 = 0;
-        int i1 = nV - 1;
-
-        while (true)
+        IndexType j = offsets[k];
+        for (Index i = n * k / n_blocks; i < n * (k + 1) / n_blocks; ++i)
         {
-            // find first deleted and last un-deleted
-            while (!vdeleted_[Vertex(i0)] && i0 < i1)
-                ++i0;
-            while (vdeleted_[Vertex(i1)] && i0 < i1)
-                --i1;
-            if (i0 >= i1)
-                break;
-
-            // swap
-            vprops_.swap(i0, i1);
-        };
-
-        // remember new size
-        nV = vdeleted_[Vertex(i0)] ? i0 : i0 + 1;
+            if (deleted[i])
+            {
+                map[i] = PMP_MAX_INDEX;
+            }
+            else
+            {
+                map[i] = j;
+                keep[j++] = IndexType(i);
+            }
+        }
     }
+}
 
-    // remove deleted edges
-    if (nE > 0)
-    {
-        int i0 = 0;
-        int i1 = nE - 1;
+} // namespace
 
-        while (true)
-        {
-            // find first deleted and last un-deleted
-            while (!edeleted_[Edge(i0)] && i0 < i1)
-                ++i0;
-            while (edeleted_[Edge(i1)] && i0 < i1)
-                --i1;
-            if (i0 >= i1)
-                break;
+void SurfaceMesh::garbage_collection()
+{
+    if (!has_garbage_)
+        return;
 
-            // swap
-            eprops_.swap(i0, i1);
-            hprops_.swap(2 * i0, 2 * i1);
-            hprops_.swap(2 * i0 + 1, 2 * i1 + 1);
-        };
+    // old index of each remaining element and new index of each old one
+    std::vector<IndexType> vkeep, vmap, ekeep, emap, fkeep, fmap;
+    compaction_map(vdeleted_.vector(), vkeep, vmap);
+    compaction_map(edeleted_.vector(), ekeep, emap);
+    compaction_map(fdeleted_.vector(), fkeep, fmap);
 
-        // remember new size
-        nE = edeleted_[Edge(i0)] ? i0 : i0 + 1;
-        nH = 2 * nE;
-    }
+    remap(vkeep, vmap, ekeep, emap, fkeep, fmap);
 
-    // remove deleted faces
-    if (nF > 0)
-    {
-        int i0 = 0;
-        int i1 = nF - 1;
+    deleted_vertices_ = deleted_edges_ = deleted_faces_ = 0;
+    has_garbage_ = false;
+}
 
-        while (true)
+void SurfaceMesh::permute(const std::vector<IndexType>& vertex_order,
+                          const std::vector<IndexType>& edge_order,
+                          const std::vector<IndexType>& face_order)
+{
+    if (has_garbage_)
+        throw InvalidInputException(
+            "SurfaceMesh::permute: Mesh contains deleted elements.");
+
+    // invert the orders, checking that they are permutations
+    auto invert = [](const std::vector<IndexType>& order, size_t n,
+                     std::vector<IndexType>& map, const char* what) {
+        map.assign(n, PMP_MAX_INDEX);
+        bool ok = (order.size() == n);
+        for (size_t i = 0; ok && i < n; ++i)
         {
-            // find 1st deleted and last un-deleted
-            while (!fdeleted_[Face(i0)] && i0 < i1)
-                ++i0;
-            while (fdeleted_[Face(i1)] && i0 < i1)
-                --i1;
-            if (i0 >= i1)
-                break;
+            ok = order[i] < n && map[order[i]] == PMP_MAX_INDEX;
+            if (ok)
+                map[order[i]] = IndexType(i);
+        }
+        if (!ok)
+            throw InvalidInputException(std::string("SurfaceMesh::permute: ") +
+                                        what + " order is not a permutation.");
+    };
 
-            // swap
-            fprops_.swap(i0, i1);
-        };
+    std::vector<IndexType> vmap, emap, fmap;
+    invert(vertex_order, vertices_size(), vmap, "Vertex");
+    invert(edge_order, edges_size(), emap, "Edge");
+    invert(face_order, faces_size(), fmap, "Face");
+
+    remap(vertex_order, vmap, edge_order, emap, face_order, fmap);
+}
 
-        // remember new size
-        nF = fdeleted_[Face(i0)] ? i0 : i0 + 1;
+void SurfaceMesh::remap(const std::vector<IndexType>& vkeep,
+                        const std::vector<IndexType>& vmap,
+                        const std::vector<IndexType>& ekeep,
+                        const std::vector<IndexType>& emap,
+                        const std::vector<IndexType>& fkeep,
+                        const std::vector<IndexType>& fmap)
+{
+    using Index = std::int64_t;
+
+    // halfedges stay with their edge
+    const Index nV = vkeep.size(), nE = ekeep.size(), nF = fkeep.size();
+    const Index nH = 2 * nE;
+    std::vector<IndexType> hkeep(nH);
+#pragma omp parallel for
+    for (Index i = 0; i < nE; ++i)
+    {
+        hkeep[2 * i] = 2 * ekeep[i];
+        hkeep[2 * i + 1] = 2 * ekeep[i] + 1;
     }
+    auto hmap = [&](Halfedge h) {
+        return Halfedge(2 * emap[h.idx() / 2] + (h.idx() & 1));
+    };
+
+    // gather the elements in their new order
+    vprops_.permute(vkeep);
+    hprops_.permute(hkeep);
+    eprops_.permute(ekeep);
+    fprops_.permute(fkeep);
 
     // update vertex connectivity
-    for (size_t i = 0; i < nV; ++i)
+#pragma omp parallel for
+    for (Index i = 0; i < nV; ++i)
     {
-        auto v = Vertex(i);
-        if (!is_isolated(v))
-            set_halfedge(v, hmap[halfedge(v)]);
+        Halfedge& h = vconn_[Vertex(i)].halfedge_;
+        if (h.is_valid())
+            h = hmap(h);
     }
 
     // update halfedge connectivity
-    for (size_t i = 0; i < nH; ++i)
+#pragma omp parallel for
+    for (Index i = 0; i < nH; ++i)
     {
-        auto h = Halfedge(i);
-        set_vertex(h, vmap[to_vertex(h)]);
-        set_next_halfedge(h, hmap[next_halfedge(h)]);
-        if (!is_boundary(h))
-            set_face(h, fmap[face(h)]);
+        HalfedgeConnectivity& c = hconn_[Halfedge(i)];
+        c.vertex_ = Vertex(vmap[c.vertex_.idx()]);
+        c.next_halfedge_ = hmap(c.next_halfedge_);
+        c.prev_halfedge_ = hmap(c.prev_halfedge_);
+        if (c.face_.is_valid())
+            c.face_ = Face(fmap[c.face_.idx()]);
     }
 
     // update handles of faces
-    for (size_t i = 0; i < nF; ++i)
+#pragma omp parallel for
+    for (Index i = 0; i < nF; ++i)
     {
-        auto f = Face(i);
-        set_halfedge(f, hmap[halfedge(f)]);
+        Halfedge& h = fconn_[Face(i)].halfedge_;
+        h = hmap(h);
     }
-
-    // remove handle maps
-    remove_vertex_property(vmap);
-    remove_halfedge_property(hmap);
-    remove_face_property(fmap);
-
-    // finally resize arrays
-    vprops_.resize(nV);
-    vprops_.free_memory();
-    hprops_.resize(nH);
-    hprops_.free_memory();
-    eprops_.resize(nE);
-    eprops_.free_memory();
-    fprops_.resize(nF);
-    fprops_.free_memory();
-
-    deleted_vertices_ = deleted_edges_ = deleted_faces_ = 0;
-    has_garbage_ = false;
 }
 
 } // namespace pmp
@@ -1122,13 +1122,18 @@ public:
     //! OFF    | yes   | yes    | a / b   | a      | a / b
     //! OBJ    | yes   | no     | a       | no     | no
     //! STL    | yes   | yes    | no      | no     | no
-    //! PLY    | yes   | yes    | no      | no     | no
-    //! PMP    | no    | yes    | no      | no     | no
+    //! PLY    | yes   | yes    | a / b   | a / b  | no
+    //! PMP    | no    | yes    | b       | b      | b
     //! XYZ    | yes   | no     | a       | no     | no
     //! AGI    | yes   | no     | a       | a      | no
     //!
-    //! In addition, the OBJ and PMP formats support reading per-halfedge
-    //! texture coordinates.
+    //! In addition, the OBJ format supports reading per-halfedge texture
+    //! coordinates, and the PLY format reads per-vertex confidence (or
+    //! quality) values into the property "v:confidence". The PMP format
+    //! memory-maps the file and restores all vertex, halfedge, edge, and
+    //! face properties of built-in scalar, vector, and handle types; files
+    //! of earlier versions (connectivity, positions, and halfedge texture
+    //! coordinates only) are still read.
     void read(const std::string& filename, const IOFlags& flags = IOFlags());
 
     //! \brief Write mesh to file \p filename controlled by \p flags
@@ -1140,12 +1145,15 @@ public:
     //! OFF    | yes   | yes    | a       | a      | a
     //! OBJ    | yes   | no     | a       | no     | no
     //! STL    | yes   | no     | no      | no     | no
-    //! PLY    | yes   | yes    | no      | no     | no
-    //! PMP    | no    | yes    | no      | no     | no
+    //! PLY    | yes   | yes    | a / b   | a / b  | no
+    //! PMP    | no    | yes    | b       | b      | b
     //! XYZ    | yes   | no     | a       | no     | no
     //!
-    //! In addition, the OBJ and PMP formats support writing per-halfedge
-    //! texture coordinates.
+    //! In addition, the OBJ format supports writing per-halfedge texture
+    //! coordinates, and the PLY format writes the vertex property
+    //! "v:confidence" if present. The PMP format stores every vertex,
+    //! halfedge, edge, and face property of a trivially copyable type as a
+    //! raw, 64-byte aligned array; deleted elements are removed first.
     void write(const std::string& filename,
                const IOFlags& flags = IOFlags()) const;
 
@@ -1169,6 +1177,22 @@ public:
     //! \sa add_triangle, add_face
     Face add_quad(Vertex v0, Vertex v1, Vertex v2, Vertex v3);
 
+    //! \brief Replace the mesh by the polygon soup given as flat arrays.
+    //! \details Face \c f uses the next \c valences[f] entries of \p indices,
+    //! an empty \p valences denotes a pure triangle mesh. In contrast to
+    //! calling add_face() for each polygon, the halfedges are matched by
+    //! sorting them per vertex (in parallel if OpenMP is available), which
+    //! is much faster for large meshes. Edges are numbered as add_face()
+    //! would number them. As for clear(), all custom properties are removed.
+    //! \throw InvalidInputException if indices are out of range or do not
+    //! match \p valences.
+    //! \throw TopologyException for degenerate faces, complex edges or
+    //! complex vertices. The input is checked as a whole before the mesh is
+    //! modified, the message reports the number of offending elements.
+    //! \throw AllocationException if the mesh exceeds the maximum index.
+    void build(std::vector<Point> points, const std::vector<IndexType>& indices,
+               const std::vector<IndexType>& valences = {});
+
     //!@}
     //! \name Memory Management
     //!@{
@@ -1212,6 +1236,17 @@ public:
     //! remove deleted elements
     void garbage_collection();
 
+    //! \brief Reorder vertices, edges, and faces.
+    //! \details The new element i is the old element with index order[i].
+    //! The two halfedges of an edge move with their edge. All properties
+    //! are permuted accordingly, and the connectivity is updated.
+    //! \throw InvalidInputException if the mesh contains deleted elements
+    //! (call garbage_collection() first) or if one of the orders is not a
+    //! permutation of all elements of its kind.
+    void permute(const std::vector<IndexType>& vertex_order,
+                 const std::vector<IndexType>& edge_order,
+                 const std::vector<IndexType>& face_order);
+
     //! returns whether vertex \p v is deleted
     //! \sa garbage_collection()
     bool is_deleted(Vertex v) const { return vdeleted_[v]; }
@@ -2060,6 +2095,16 @@ private:
     // Helper for halfedge collapse
     void remove_loop_helper(Halfedge h);
 
+    // Move the old elements vkeep[i], ekeep[i], fkeep[i] to position i and
+    // update the connectivity with the inverse maps vmap, emap, fmap (used
+    // by garbage_collection() and permute())
+    void remap(const std::vector<IndexType>& vkeep,
+               const std::vector<IndexType>& vmap,
+               const std::vector<IndexType>& ekeep,
+               const std::vector<IndexType>& emap,
+               const std::vector<IndexType>& fkeep,
+               const std::vector<IndexType>& fmap);
+
     // are there any deleted entities?
     inline bool has_garbage() const { return has_garbage_; }
 
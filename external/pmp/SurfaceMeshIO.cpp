@@ -3,17 +3,22 @@
 // Distributed under a MIT-style license, see LICENSE.txt for details.
 
 #include "pmp/SurfaceMeshIO.h"
+#include "pmp/MappedFile.h"
 
 #include <clocale>
 #include <cstring>
 #include <cctype>
+#include <cstdint>
 
 #include <algorithm>
+#include <charconv>
+#include <initializer_list>
 #include <map>
+#include <memory>
 #include <fstream>
 #include <limits>
-
-#include <rply.h>
+#include <sstream>
+#include <typeinfo>
 
 // helper function
 template <typename T>
@@ -33,6 +38,107 @@ void tfwrite(FILE* out, const T& t)
 
 namespace pmp {
 
+namespace {
+
+// The pmp format: a 64-byte header, a table of contents with one entry
+// (followed by the property and type names) per property array, and the
+// raw property data, each array starting at a multiple of 64 bytes. All
+// values are little-endian.
+const char pmp_magic[8] = {'P', 'M', 'P', 'M', 'E', 'S', 'H', '\0'};
+const std::uint32_t pmp_version = 1;
+const std::uint64_t pmp_alignment = 64;
+
+struct PmpHeader
+{
+    char magic[8];
+    std::uint32_t version;
+    std::uint32_t n_arrays;
+    std::uint64_t n_elements[4]; // vertices, halfedges, edges, faces
+    std::uint64_t toc_offset;
+    std::uint64_t toc_size;
+};
+static_assert(sizeof(PmpHeader) == 64, "unexpected pmp header size");
+
+struct PmpArrayEntry
+{
+    std::uint32_t kind; // index into PmpHeader::n_elements
+    std::uint32_t element_size;
+    std::uint64_t offset;
+    std::uint64_t bytes;
+    std::uint32_t name_length;
+    std::uint32_t type_length;
+};
+static_assert(sizeof(PmpArrayEntry) == 32, "unexpected pmp entry size");
+
+std::uint64_t align(std::uint64_t offset)
+{
+    return (offset + pmp_alignment - 1) / pmp_alignment * pmp_alignment;
+}
+
+bool is_little_endian()
+{
+    const std::uint32_t one = 1;
+    char c;
+    memcpy(&c, &one, 1);
+    return c == 1;
+}
+
+// Property types that are restored when reading pmp files, identified by
+// portable names. Arrays of other trivially copyable types are written
+// with their (compiler-specific) type_info name but skipped when reading.
+struct PropertyType
+{
+    const char* name;
+    const std::type_info& type;
+    bool (*create)(PropertyContainer& props, const std::string& name);
+};
+
+template <class T>
+bool create_property(PropertyContainer& props, const std::string& name)
+{
+    return bool(props.add<T>(name));
+}
+
+const PropertyType property_types[] = {
+    {"bool", typeid(bool), create_property<bool>},
+    {"int8", typeid(std::int8_t), create_property<std::int8_t>},
+    {"uint8", typeid(std::uint8_t), create_property<std::uint8_t>},
+    {"int32", typeid(std::int32_t), create_property<std::int32_t>},
+    {"uint32", typeid(std::uint32_t), create_property<std::uint32_t>},
+    {"int64", typeid(std::int64_t), create_property<std::int64_t>},
+    {"uint64", typeid(std::uint64_t), create_property<std::uint64_t>},
+    {"float", typeid(float), create_property<float>},
+    {"double", typeid(double), create_property<double>},
+    {"vec2f", typeid(Vector<float, 2>), create_property<Vector<float, 2>>},
+    {"vec3f", typeid(Vector<float, 3>), create_property<Vector<float, 3>>},
+    {"vec4f", typeid(Vector<float, 4>), create_property<Vector<float, 4>>},
+    {"vec2d", typeid(Vector<double, 2>), create_property<Vector<double, 2>>},
+    {"vec3d", typeid(Vector<double, 3>), create_property<Vector<double, 3>>},
+    {"vec4d", typeid(Vector<double, 4>), create_property<Vector<double, 4>>},
+    {"vertex", typeid(Vertex), create_property<Vertex>},
+    {"halfedge", typeid(Halfedge), create_property<Halfedge>},
+    {"edge", typeid(Edge), create_property<Edge>},
+    {"face", typeid(Face), create_property<Face>},
+};
+
+const PropertyType* find_property_type(const std::string& name)
+{
+    for (const auto& t : property_types)
+        if (name == t.name)
+            return &t;
+    return nullptr;
+}
+
+std::string property_type_name(BasePropertyArray& array)
+{
+    for (const auto& t : property_types)
+        if (array.type() == t.type)
+            return t.name;
+    return array.type().name();
+}
+
+} // namespace
+
 void SurfaceMeshIO::read(SurfaceMesh& mesh)
 {
     std::setlocale(LC_NUMERIC, "C");
@@ -96,12 +202,11 @@ void SurfaceMeshIO::read_obj(SurfaceMesh& mesh)
 {
     std::array<char, 200> s;
     float x, y, z;
-    std::vector<Vertex> vertices;
+    std::vector<Point> points;
+    std::vector<IndexType> vertices, valences;
     std::vector<TexCoord> all_tex_coords; //individual texture coordinates
     std::vector<int>
         halfedge_tex_idx; //texture coordinates sorted for halfedges
-    HalfedgeProperty<TexCoord> tex_coords =
-        mesh.halfedge_property<TexCoord>("h:tex");
     bool with_tex_coord = false;
 
     // open file (in ASCII mode)
@@ -124,7 +229,7 @@ void SurfaceMeshIO::read_obj(SurfaceMesh& mesh)
         {
             if (sscanf(s.data(), "v %f %f %f", &x, &y, &z))
             {
-                mesh.add_vertex(Point(x, y, z));
+                points.emplace_back(x, y, z);
             }
         }
 
@@ -150,12 +255,11 @@ void SurfaceMeshIO::read_obj(SurfaceMesh& mesh)
         // face
         else if (strncmp(s.data(), "f ", 2) == 0)
         {
-            int component(0), nv(0);
+            int component(0);
             bool end_of_vertex(false);
             char *p0, *p1(s.data() + 1);
-
-            vertices.clear();
-            halfedge_tex_idx.clear();
+            const size_t n_vertices = vertices.size();
+            const size_t n_tex_idx = halfedge_tex_idx.size();
 
             // skip white-spaces
             while (*p1 == ' ')
@@ -200,8 +304,8 @@ void SurfaceMeshIO::read_obj(SurfaceMesh& mesh)
                         {
                             int idx = atoi(p0);
                             if (idx < 0)
-                                idx = mesh.n_vertices() + idx + 1;
-                            vertices.emplace_back(idx - 1);
+                                idx = int(points.size()) + idx + 1;
+                            vertices.push_back(idx - 1);
                             break;
                         }
                         case 1: // texture coord
@@ -221,40 +325,39 @@ void SurfaceMeshIO::read_obj(SurfaceMesh& mesh)
                 if (end_of_vertex)
                 {
                     component = 0;
-                    nv++;
                     end_of_vertex = false;
                 }
             }
 
-            Face f = mesh.add_face(vertices);
+            const size_t valence = vertices.size() - n_vertices;
+            valences.push_back(valence);
 
-            // add texture coordinates
-            if (with_tex_coord && f.is_valid())
-            {
-                SurfaceMesh::HalfedgeAroundFaceCirculator h_fit =
-                    mesh.halfedges(f);
-                SurfaceMesh::HalfedgeAroundFaceCirculator h_end = h_fit;
-                unsigned v_idx = 0;
-                do
-                {
-                    tex_coords[*h_fit] =
-                        all_tex_coords.at(halfedge_tex_idx.at(v_idx));
-                    ++v_idx;
-                    ++h_fit;
-                } while (h_fit != h_end);
-            }
+            // one texture coordinate index per vertex, -1 if missing
+            halfedge_tex_idx.resize(n_tex_idx + valence, -1);
         }
         // clear line
         memset(s.data(), 0, 200);
     }
 
-    // if there are no textures, delete texture property!
-    if (!with_tex_coord)
+    fclose(in);
+
+    mesh.build(std::move(points), vertices, valences);
+
+    // add texture coordinates, starting at the face's halfedge as before
+    if (with_tex_coord)
     {
-        mesh.remove_halfedge_property(tex_coords);
+        auto tex_coords = mesh.halfedge_property<TexCoord>("h:tex");
+        size_t v_idx = 0;
+        for (auto f : mesh.faces())
+        {
+            for (auto h : mesh.halfedges(f))
+            {
+                const int idx = halfedge_tex_idx[v_idx++];
+                if (idx >= 0)
+                    tex_coords[h] = all_tex_coords.at(idx);
+            }
+        }
     }
-
-    fclose(in);
 }
 
 void SurfaceMeshIO::write_obj(const SurfaceMesh& mesh)
@@ -323,6 +426,15 @@ void SurfaceMeshIO::write_obj(const SurfaceMesh& mesh)
     fclose(out);
 }
 
+// move per-vertex data read from a file into a vertex property
+template <typename T>
+void set_vertex_property(SurfaceMesh& mesh, const std::string& name,
+                         std::vector<T>& data)
+{
+    data.resize(mesh.vertices_size());
+    mesh.vertex_property<T>(name).vector().swap(data);
+}
+
 void read_off_ascii(SurfaceMesh& mesh, FILE* in, const bool has_normals,
                     const bool has_texcoords, const bool has_colors)
 {
@@ -331,24 +443,23 @@ void read_off_ascii(SurfaceMesh& mesh, FILE* in, const bool has_normals,
     unsigned int i, j, items, idx;
     unsigned int nv, nf, ne;
     float x, y, z, r, g, b;
-    Vertex v;
-
-    // properties
-    VertexProperty<Normal> normals;
-    VertexProperty<TexCoord> texcoords;
-    VertexProperty<Color> colors;
-    if (has_normals)
-        normals = mesh.vertex_property<Normal>("v:normal");
-    if (has_texcoords)
-        texcoords = mesh.vertex_property<TexCoord>("v:tex");
-    if (has_colors)
-        colors = mesh.vertex_property<Color>("v:color");
 
     // #Vertice, #Faces, #Edges
     items = fscanf(in, "%d %d %d\n", (int*)&nv, (int*)&nf, (int*)&ne);
     PMP_ASSERT(items);
 
-    mesh.reserve(nv, std::max(3 * nv, ne), nf);
+    // vertex data, properties are added after building the mesh
+    std::vector<Point> points;
+    std::vector<Normal> normals;
+    std::vector<TexCoord> texcoords;
+    std::vector<Color> colors;
+    points.reserve(nv);
+    if (has_normals)
+        normals.resize(nv);
+    if (has_texcoords)
+        texcoords.resize(nv);
+    if (has_colors)
+        colors.resize(nv);
 
     // read vertices: pos [normal] [color] [texcoord]
     for (i = 0; i < nv && !feof(in); ++i)
@@ -360,7 +471,7 @@ void read_off_ascii(SurfaceMesh& mesh, FILE* in, const bool has_normals,
         // position
         items = sscanf(lp, "%f %f %f%n", &x, &y, &z, &nc);
         assert(items == 3);
-        v = mesh.add_vertex(Point(x, y, z));
+        points.emplace_back(x, y, z);
         lp += nc;
 
         // normal
@@ -368,7 +479,7 @@ void read_off_ascii(SurfaceMesh& mesh, FILE* in, const bool has_normals,
         {
             if (sscanf(lp, "%f %f %f%n", &x, &y, &z, &nc) == 3)
             {
-                normals[v] = Normal(x, y, z);
+                normals[i] = Normal(x, y, z);
             }
             lp += nc;
         }
@@ -384,7 +495,7 @@ void read_off_ascii(SurfaceMesh& mesh, FILE* in, const bool has_normals,
                     g /= 255.0f;
                     b /= 255.0f;
                 }
-                colors[v] = Color(r, g, b);
+                colors[i] = Color(r, g, b);
             }
             lp += nc;
         }
@@ -394,14 +505,14 @@ void read_off_ascii(SurfaceMesh& mesh, FILE* in, const bool has_normals,
         {
             items = sscanf(lp, "%f %f%n", &x, &y, &nc);
             assert(items == 2);
-            texcoords[v][0] = x;
-            texcoords[v][1] = y;
+            texcoords[i][0] = x;
+            texcoords[i][1] = y;
             lp += nc;
         }
     }
 
     // read faces: #N v[1] v[2] ... v[n-1]
-    std::vector<Vertex> vertices;
+    std::vector<IndexType> vertices, valences(nf);
     for (i = 0; i < nf; ++i)
     {
         // read line
@@ -411,7 +522,7 @@ void read_off_ascii(SurfaceMesh& mesh, FILE* in, const bool has_normals,
         // #vertices
         items = sscanf(lp, "%d%n", (int*)&nv, &nc);
         assert(items == 1);
-        vertices.resize(nv);
+        valences[i] = nv;
         lp += nc;
 
         // indices
@@ -419,11 +530,18 @@ void read_off_ascii(SurfaceMesh& mesh, FILE* in, const bool has_normals,
         {
             items = sscanf(lp, "%d%n", (int*)&idx, &nc);
             assert(items == 1);
-            vertices[j] = Vertex(idx);
+            vertices.push_back(idx);
             lp += nc;
         }
-        mesh.add_face(vertices);
     }
+
+    mesh.build(std::move(points), vertices, valences);
+    if (has_normals)
+        set_vertex_property(mesh, "v:normal", normals);
+    if (has_texcoords)
+        set_vertex_property(mesh, "v:tex", texcoords);
+    if (has_colors)
+        set_vertex_property(mesh, "v:color", colors);
 }
 
 void read_off_binary(SurfaceMesh& mesh, FILE* in, const bool has_normals,
@@ -433,62 +551,67 @@ void read_off_binary(SurfaceMesh& mesh, FILE* in, const bool has_normals,
     IndexType nv(0), nf(0), ne(0);
     Point p, n;
     vec2 t;
-    Vertex v;
 
     // binary cannot (yet) read colors
     if (has_colors)
         throw IOException("Colors not supported for binary OFF file.");
 
-    // properties
-    VertexProperty<Normal> normals;
-    VertexProperty<TexCoord> texcoords;
-    if (has_normals)
-        normals = mesh.vertex_property<Normal>("v:normal");
-    if (has_texcoords)
-        texcoords = mesh.vertex_property<TexCoord>("v:tex");
-
     // #Vertice, #Faces, #Edges
     tfread(in, nv);
     tfread(in, nf);
     tfread(in, ne);
-    mesh.reserve(nv, std::max(3 * nv, ne), nf);
+
+    // vertex data, properties are added after building the mesh
+    std::vector<Point> points;
+    std::vector<Normal> normals;
+    std::vector<TexCoord> texcoords;
+    points.reserve(nv);
+    if (has_normals)
+        normals.resize(nv);
+    if (has_texcoords)
+        texcoords.resize(nv);
 
     // read vertices: pos [normal] [color] [texcoord]
     for (i = 0; i < nv && !feof(in); ++i)
     {
         // position
         tfread(in, p);
-        v = mesh.add_vertex((Point)p);
+        points.push_back(p);
 
         // normal
         if (has_normals)
         {
             tfread(in, n);
-            normals[v] = (Normal)n;
+            normals[i] = (Normal)n;
         }
 
         // tex coord
         if (has_texcoords)
         {
             tfread(in, t);
-            texcoords[v][0] = t[0];
-            texcoords[v][1] = t[1];
+            texcoords[i][0] = t[0];
+            texcoords[i][1] = t[1];
         }
     }
 
     // read faces: #N v[1] v[2] ... v[n-1]
-    std::vector<Vertex> vertices;
+    std::vector<IndexType> vertices, valences(nf);
     for (i = 0; i < nf; ++i)
     {
         tfread(in, nv);
-        vertices.resize(nv);
+        valences[i] = nv;
         for (j = 0; j < nv; ++j)
         {
             tfread(in, idx);
-            vertices[j] = Vertex(idx);
+            vertices.push_back(idx);
         }
-        mesh.add_face(vertices);
     }
+
+    mesh.build(std::move(points), vertices, valences);
+    if (has_normals)
+        set_vertex_property(mesh, "v:normal", normals);
+    if (has_texcoords)
+        set_vertex_property(mesh, "v:tex", texcoords);
 }
 
 void SurfaceMeshIO::write_off_binary(const SurfaceMesh& mesh)
@@ -689,6 +812,91 @@ void SurfaceMeshIO::write_off(const SurfaceMesh& mesh)
 }
 
 void SurfaceMeshIO::read_pmp(SurfaceMesh& mesh)
+{
+    if (!is_little_endian())
+        throw IOException("The pmp format requires a little-endian machine");
+
+    MappedFile file;
+    if (!file.open(filename_))
+        throw IOException("Failed to open file: " + filename_);
+
+    // files without magic number have been written by earlier versions
+    PmpHeader header;
+    if (file.size() < sizeof(header) ||
+        memcmp(file.data(), pmp_magic, sizeof(header.magic)) != 0)
+    {
+        read_pmp_legacy(mesh);
+        return;
+    }
+    memcpy(&header, file.data(), sizeof(header));
+    if (header.version != pmp_version)
+        throw IOException("Unsupported pmp version in file: " + filename_);
+    if (header.toc_offset > file.size() ||
+        header.toc_size > file.size() - header.toc_offset)
+        throw IOException("Corrupt pmp file: " + filename_);
+
+    // resize containers, which creates the default properties
+    PropertyContainer* containers[] = {&mesh.vprops_, &mesh.hprops_,
+                                       &mesh.eprops_, &mesh.fprops_};
+    for (int k = 0; k < 4; ++k)
+    {
+        if (header.n_elements[k] >= PMP_MAX_INDEX)
+            throw IOException("Corrupt pmp file: " + filename_);
+        containers[k]->resize(header.n_elements[k]);
+    }
+    if (header.n_elements[1] != 2 * header.n_elements[2])
+        throw IOException("Corrupt pmp file: " + filename_);
+
+    // adopt the arrays listed in the table of contents
+    const char* toc = file.data() + header.toc_offset;
+    const char* toc_end = toc + header.toc_size;
+    for (std::uint32_t i = 0; i < header.n_arrays; ++i)
+    {
+        PmpArrayEntry entry;
+        if (size_t(toc_end - toc) < sizeof(entry))
+            throw IOException("Corrupt pmp file: " + filename_);
+        memcpy(&entry, toc, sizeof(entry));
+        toc += sizeof(entry);
+        if (entry.kind > 3 || size_t(toc_end - toc) < size_t(entry.name_length) +
+                                                          entry.type_length)
+            throw IOException("Corrupt pmp file: " + filename_);
+        const std::string name(toc, entry.name_length);
+        toc += entry.name_length;
+        const std::string type(toc, entry.type_length);
+        toc += entry.type_length;
+
+        PropertyContainer& props = *containers[entry.kind];
+        const size_t n = props.size();
+        if (entry.bytes != n * entry.element_size ||
+            entry.offset > file.size() ||
+            entry.bytes > file.size() - entry.offset)
+            throw IOException("Corrupt pmp file: " + filename_);
+
+        // default properties (connectivity, points, deleted flags) exist
+        // already, others are created if their type is known
+        BasePropertyArray* array = nullptr;
+        for (auto a : props.arrays())
+            if (a->name() == name)
+                array = a;
+        if (!array)
+        {
+            const PropertyType* t = find_property_type(type);
+            if (t && t->create(props, name))
+                array = props.arrays().back();
+        }
+        if (!array || array->raw_element_size() != entry.element_size)
+        {
+            std::cerr << "[SurfaceMeshIO] Skipping property \"" << name
+                      << "\" of unknown type " << type << " in "
+                      << filename_ << "\n";
+            continue;
+        }
+
+        array->raw_copy_from(file.data() + entry.offset, n);
+    }
+}
+
+void SurfaceMeshIO::read_pmp_legacy(SurfaceMesh& mesh)
 {
     // open file (in binary mode)
     FILE* in = fopen(filename_.c_str(), "rb");
@@ -816,156 +1024,883 @@ void SurfaceMeshIO::read_agi(SurfaceMesh& mesh)
 
 void SurfaceMeshIO::write_pmp(const SurfaceMesh& mesh)
 {
+    if (!is_little_endian())
+        throw IOException("The pmp format requires a little-endian machine");
+
+    // deleted elements are not stored
+    if (mesh.has_garbage())
+    {
+        SurfaceMesh copy = mesh;
+        copy.garbage_collection();
+        write_pmp(copy);
+        return;
+    }
+
+    // collect the arrays of trivially copyable types
+    struct Array
+    {
+        std::uint32_t kind;
+        const BasePropertyArray* array;
+        std::string type;
+    };
+    std::vector<Array> arrays;
+    const PropertyContainer* containers[] = {&mesh.vprops_, &mesh.hprops_,
+                                             &mesh.eprops_, &mesh.fprops_};
+    for (std::uint32_t k = 0; k < 4; ++k)
+        for (auto a : containers[k]->arrays())
+            if (a->raw_element_size())
+                arrays.push_back({k, a, property_type_name(*a)});
+
+    // layout: header, table of contents, 64-byte aligned blobs
+    PmpHeader header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, pmp_magic, sizeof(header.magic));
+    header.version = pmp_version;
+    header.n_arrays = std::uint32_t(arrays.size());
+    for (int k = 0; k < 4; ++k)
+        header.n_elements[k] = containers[k]->size();
+    header.toc_offset = sizeof(header);
+
+    header.toc_size = 0;
+    for (auto& a : arrays)
+        header.toc_size +=
+            sizeof(PmpArrayEntry) + a.array->name().size() + a.type.size();
+
+    std::vector<char> toc;
+    std::uint64_t offset = align(header.toc_offset + header.toc_size);
+    for (auto& a : arrays)
+    {
+        PmpArrayEntry entry;
+        memset(&entry, 0, sizeof(entry));
+        entry.kind = a.kind;
+        entry.element_size = std::uint32_t(a.array->raw_element_size());
+        entry.offset = offset;
+        entry.bytes = containers[a.kind]->size() * entry.element_size;
+        entry.name_length = std::uint32_t(a.array->name().size());
+        entry.type_length = std::uint32_t(a.type.size());
+        offset = align(offset + entry.bytes);
+
+        const char* e = reinterpret_cast<const char*>(&entry);
+        toc.insert(toc.end(), e, e + sizeof(entry));
+        toc.insert(toc.end(), a.array->name().begin(), a.array->name().end());
+        toc.insert(toc.end(), a.type.begin(), a.type.end());
+    }
+
     // open file (in binary mode)
     FILE* out = fopen(filename_.c_str(), "wb");
     if (!out)
         throw IOException("Failed to open file: " + filename_);
 
-    // get properties
-    auto vconn = mesh.get_vertex_property<SurfaceMesh::VertexConnectivity>(
-        "v:connectivity");
-    auto hconn = mesh.get_halfedge_property<SurfaceMesh::HalfedgeConnectivity>(
-        "h:connectivity");
-    auto fconn =
-        mesh.get_face_property<SurfaceMesh::FaceConnectivity>("f:connectivity");
-    auto point = mesh.get_vertex_property<Point>("v:point");
-    auto htex = mesh.get_halfedge_property<TexCoord>("h:tex");
+    bool ok = fwrite(&header, sizeof(header), 1, out) == 1 &&
+              fwrite(toc.data(), 1, toc.size(), out) == toc.size();
+    std::uint64_t pos = header.toc_offset + header.toc_size;
+    std::vector<char> buffer;
+    const char zeros[pmp_alignment] = {};
+    for (auto& a : arrays)
+    {
+        if (!ok)
+            break;
+        const size_t padding = align(pos) - pos;
+        const size_t bytes =
+            containers[a.kind]->size() * a.array->raw_element_size();
+        buffer.resize(bytes);
+        a.array->raw_copy_to(buffer.data());
+        ok = fwrite(zeros, 1, padding, out) == padding &&
+             fwrite(buffer.data(), 1, bytes, out) == bytes;
+        pos += padding + bytes;
+    }
 
-    // how many elements?
-    unsigned int nv, ne, nh, nf;
-    nv = mesh.n_vertices();
-    ne = mesh.n_edges();
-    nh = mesh.n_halfedges();
-    nf = mesh.n_faces();
+    if (fclose(out) != 0 || !ok)
+        throw IOException("Failed to write file: " + filename_);
+}
 
-    // write header
-    tfwrite(out, nv);
-    tfwrite(out, ne);
-    tfwrite(out, nf);
-    tfwrite(out, (bool)htex);
+namespace {
 
-    // write properties to file
-    fwrite((char*)vconn.data(), sizeof(SurfaceMesh::VertexConnectivity), nv,
-           out);
-    fwrite((char*)hconn.data(), sizeof(SurfaceMesh::HalfedgeConnectivity), nh,
-           out);
-    fwrite((char*)fconn.data(), sizeof(SurfaceMesh::FaceConnectivity), nf, out);
-    fwrite((char*)point.data(), sizeof(Point), nv, out);
+// scalar types of PLY properties
+enum class PlyType
+{
+    Int8,
+    UInt8,
+    Int16,
+    UInt16,
+    Int32,
+    UInt32,
+    Float32,
+    Float64
+};
+
+bool ply_type(const std::string& name, PlyType& type)
+{
+    static const std::pair<const char*, PlyType> types[] = {
+        {"char", PlyType::Int8},       {"int8", PlyType::Int8},
+        {"uchar", PlyType::UInt8},     {"uint8", PlyType::UInt8},
+        {"short", PlyType::Int16},     {"int16", PlyType::Int16},
+        {"ushort", PlyType::UInt16},   {"uint16", PlyType::UInt16},
+        {"int", PlyType::Int32},       {"int32", PlyType::Int32},
+        {"uint", PlyType::UInt32},     {"uint32", PlyType::UInt32},
+        {"float", PlyType::Float32},   {"float32", PlyType::Float32},
+        {"double", PlyType::Float64},  {"float64", PlyType::Float64}};
+    for (const auto& t : types)
+    {
+        if (name == t.first)
+        {
+            type = t.second;
+            return true;
+        }
+    }
+    return false;
+}
 
-    // texture coordinates
-    if (htex)
-        fwrite((char*)htex.data(), sizeof(TexCoord), nh, out);
+size_t ply_size(PlyType type)
+{
+    switch (type)
+    {
+        case PlyType::Int8:
+        case PlyType::UInt8:
+            return 1;
+        case PlyType::Int16:
+        case PlyType::UInt16:
+            return 2;
+        case PlyType::Int32:
+        case PlyType::UInt32:
+        case PlyType::Float32:
+            return 4;
+        case PlyType::Float64:
+            return 8;
+    }
+    return 0;
+}
 
-    fclose(out);
+// largest value of integer types, colors are scaled by its inverse
+double ply_max(PlyType type)
+{
+    switch (type)
+    {
+        case PlyType::Int8:
+            return 127.0;
+        case PlyType::UInt8:
+            return 255.0;
+        case PlyType::Int16:
+            return 32767.0;
+        case PlyType::UInt16:
+            return 65535.0;
+        case PlyType::Int32:
+            return 2147483647.0;
+        case PlyType::UInt32:
+            return 4294967295.0;
+        default:
+            return 1.0;
+    }
 }
 
-// helper to assemble vertex data
-static int vertexCallback(p_ply_argument argument)
+template <typename T>
+double ply_cast(const char* p)
 {
-    long idx;
-    void* pdata;
-    ply_get_argument_user_data(argument, &pdata, &idx);
+    T t;
+    memcpy(&t, p, sizeof(T));
+    return double(t);
+}
 
-    auto* mesh = (pmp::SurfaceMesh*)pdata;
-    auto point = mesh->get_object_property<pmp::Point>("g:point");
-    point[0][idx] = ply_get_argument_value(argument);
+// read a binary value, swapping bytes if the file's byte order differs
+double ply_value(const char* p, PlyType type, bool swap)
+{
+    char b[8];
+    if (swap)
+    {
+        std::reverse_copy(p, p + ply_size(type), b);
+        p = b;
+    }
+    switch (type)
+    {
+        case PlyType::Int8:
+            return ply_cast<std::int8_t>(p);
+        case PlyType::UInt8:
+            return ply_cast<std::uint8_t>(p);
+        case PlyType::Int16:
+            return ply_cast<std::int16_t>(p);
+        case PlyType::UInt16:
+            return ply_cast<std::uint16_t>(p);
+        case PlyType::Int32:
+            return ply_cast<std::int32_t>(p);
+        case PlyType::UInt32:
+            return ply_cast<std::uint32_t>(p);
+        case PlyType::Float32:
+            return ply_cast<float>(p);
+        case PlyType::Float64:
+            return ply_cast<double>(p);
+    }
+    return 0.0;
+}
 
-    if (idx == 2)
-        mesh->add_vertex(point[0]);
+// Read the length of a binary list and advance past it. Signed count types
+// allow negative lengths, which only a corrupt file contains.
+size_t read_ply_count(const char*& data, const char* end, PlyType type,
+                      bool swap, const std::string& error)
+{
+    if (size_t(end - data) < ply_size(type))
+        throw IOException(error);
+    const double n = ply_value(data, type, swap);
+    if (!(n >= 0))
+        throw IOException(error);
+    data += ply_size(type);
+    return size_t(n);
+}
 
-    return 1;
+// Parse the next number of ASCII data in [p,end), skipping white space.
+// Returns the position after it, or nullptr if there is none. Unlike strtod
+// this neither needs null-terminated data nor depends on the locale.
+template <typename T>
+const char* parse_ply_number(const char* p, const char* end, T& value)
+{
+    while (p < end && isspace((unsigned char)*p))
+        ++p;
+    if (p < end && *p == '+')
+        ++p;
+    const auto r = std::from_chars(p, end, value);
+    return r.ec == std::errc() ? r.ptr : nullptr;
 }
 
-// helper to assemble face data
-static int faceCallback(p_ply_argument argument)
+struct PlyProperty
 {
-    long length, value_index;
-    void* pdata;
-    long idata;
-    ply_get_argument_user_data(argument, &pdata, &idata);
-    ply_get_argument_property(argument, nullptr, &length, &value_index);
+    std::string name;
+    PlyType type;
+    bool is_list;
+    PlyType count_type;
+};
 
-    auto* mesh = (pmp::SurfaceMesh*)pdata;
-    auto vertices =
-        mesh->get_object_property<std::vector<pmp::Vertex>>("g:vertices");
+struct PlyElement
+{
+    std::string name;
+    size_t count;
+    std::vector<PlyProperty> properties;
 
-    if (value_index == 0)
-        vertices[0].clear();
+    // index of the first of the given properties that exists, or -1
+    int find(std::initializer_list<const char*> names) const
+    {
+        for (auto name : names)
+            for (size_t i = 0; i < properties.size(); ++i)
+                if (properties[i].name == name)
+                    return int(i);
+        return -1;
+    }
 
-    auto idx = (IndexType)ply_get_argument_value(argument);
-    vertices[0].push_back(pmp::Vertex(idx));
+    // size of a binary record, 0 if it contains lists
+    size_t stride() const
+    {
+        size_t size = 0;
+        for (const auto& p : properties)
+        {
+            if (p.is_list)
+                return 0;
+            size += ply_size(p.type);
+        }
+        return size;
+    }
+};
 
-    if (value_index == length - 1)
-        mesh->add_face(vertices[0]);
+struct PlyHeader
+{
+    enum Format
+    {
+        Ascii,
+        BinaryLittleEndian,
+        BinaryBigEndian
+    } format{Ascii};
+    std::vector<PlyElement> elements;
+    size_t data_offset{0}; // begin of the data after "end_header"
+};
 
-    return 1;
+void read_ply_header(const char* data, size_t size, PlyHeader& header,
+                     const std::string& filename)
+{
+    const std::string error = "Failed to read PLY header of " + filename;
+    bool has_format = false;
+    size_t pos = 0;
+    for (int line_number = 0;; ++line_number)
+    {
+        const char* end = (const char*)memchr(data + pos, '\n', size - pos);
+        if (!end)
+            throw IOException(error);
+        std::string text(data + pos, end);
+        if (!text.empty() && text.back() == '\r')
+            text.pop_back();
+        std::istringstream line(text);
+        pos = end - data + 1;
+
+        std::string keyword;
+        line >> keyword;
+        if (line_number == 0)
+        {
+            if (keyword != "ply")
+                throw IOException(error);
+        }
+        else if (keyword == "format")
+        {
+            std::string format;
+            line >> format;
+            if (format == "ascii")
+                header.format = PlyHeader::Ascii;
+            else if (format == "binary_little_endian")
+                header.format = PlyHeader::BinaryLittleEndian;
+            else if (format == "binary_big_endian")
+                header.format = PlyHeader::BinaryBigEndian;
+            else
+                throw IOException(error);
+            has_format = true;
+        }
+        else if (keyword == "element")
+        {
+            PlyElement element;
+            if (!(line >> element.name >> element.count))
+                throw IOException(error);
+            header.elements.push_back(element);
+        }
+        else if (keyword == "property")
+        {
+            PlyProperty property;
+            std::string type;
+            line >> type;
+            property.is_list = type == "list";
+            if (property.is_list)
+            {
+                std::string count_type;
+                line >> count_type >> type;
+                if (!ply_type(count_type, property.count_type))
+                    throw IOException(error);
+            }
+            if (!ply_type(type, property.type) || !(line >> property.name) ||
+                header.elements.empty())
+                throw IOException(error);
+            header.elements.back().properties.push_back(property);
+        }
+        else if (keyword == "end_header")
+        {
+            break;
+        }
+        else if (keyword != "comment" && keyword != "obj_info" &&
+                 !keyword.empty())
+        {
+            throw IOException(error);
+        }
+    }
+    if (!has_format)
+        throw IOException(error);
+    header.data_offset = pos;
 }
 
-void SurfaceMeshIO::read_ply(SurfaceMesh& mesh)
+// Columns of the vertex element that are read, with their property index
+// (-1 if absent) and the factor that maps them to the property's range.
+struct PlyVertexLayout
 {
-    // add object properties to hold temporary data
-    auto point = mesh.add_object_property<Point>("g:point");
-    auto vertices = mesh.add_object_property<std::vector<Vertex>>("g:vertices");
+    enum
+    {
+        X,
+        Y,
+        Z,
+        NX,
+        NY,
+        NZ,
+        Red,
+        Green,
+        Blue,
+        Confidence,
+        n_columns
+    };
+    int index[n_columns];
+    double scale[n_columns];
+
+    explicit PlyVertexLayout(const PlyElement& vertex)
+    {
+        index[X] = vertex.find({"x"});
+        index[Y] = vertex.find({"y"});
+        index[Z] = vertex.find({"z"});
+        index[NX] = vertex.find({"nx", "normal_x"});
+        index[NY] = vertex.find({"ny", "normal_y"});
+        index[NZ] = vertex.find({"nz", "normal_z"});
+        index[Red] = vertex.find({"red", "r", "diffuse_red"});
+        index[Green] = vertex.find({"green", "g", "diffuse_green"});
+        index[Blue] = vertex.find({"blue", "b", "diffuse_blue"});
+        index[Confidence] = vertex.find({"confidence", "quality"});
+        for (int c = 0; c < n_columns; ++c)
+        {
+            scale[c] = 1.0;
+            if (index[c] >= 0 && c >= Red && c <= Blue)
+                scale[c] = 1.0 / ply_max(vertex.properties[index[c]].type);
+        }
+    }
 
-    // open file, read header
-    p_ply ply = ply_open(filename_.c_str(), nullptr, 0, nullptr);
+    bool has(int first, int last) const
+    {
+        for (int c = first; c <= last; ++c)
+            if (index[c] < 0)
+                return false;
+        return true;
+    }
+};
 
-    if (!ply)
-        throw IOException("Failed to open file: " + filename_);
+// Vertex data as separate arrays (empty if not in the file)
+struct PlyVertexData
+{
+    std::vector<Point> points;
+    std::vector<Normal> normals;
+    std::vector<Color> colors;
+    std::vector<float> confidences;
+
+    PlyVertexData(const PlyVertexLayout& layout, size_t n) : points(n)
+    {
+        if (layout.has(PlyVertexLayout::NX, PlyVertexLayout::NZ))
+            normals.resize(n);
+        if (layout.has(PlyVertexLayout::Red, PlyVertexLayout::Blue))
+            colors.resize(n);
+        if (layout.index[PlyVertexLayout::Confidence] >= 0)
+            confidences.resize(n);
+    }
+
+    // store the values of the columns of vertex i
+    void set(size_t i, const double v[PlyVertexLayout::n_columns])
+    {
+        using L = PlyVertexLayout;
+        points[i] = Point(v[L::X], v[L::Y], v[L::Z]);
+        if (!normals.empty())
+            normals[i] = Normal(v[L::NX], v[L::NY], v[L::NZ]);
+        if (!colors.empty())
+            colors[i] = Color(v[L::Red], v[L::Green], v[L::Blue]);
+        if (!confidences.empty())
+            confidences[i] = float(v[L::Confidence]);
+    }
+};
+
+// Read all records of the vertex element at once: records have a fixed
+// size, so they are decoded in parallel straight from the mapped file.
+void read_ply_vertices_binary(const char* data, const PlyElement& vertex,
+                              bool swap, PlyVertexData& vertices)
+{
+    const PlyVertexLayout layout(vertex);
+    size_t offset[PlyVertexLayout::n_columns];
+    for (int c = 0; c < PlyVertexLayout::n_columns; ++c)
+    {
+        offset[c] = 0;
+        for (int i = 0; i < layout.index[c]; ++i)
+            offset[c] += ply_size(vertex.properties[i].type);
+    }
+
+    const size_t stride = vertex.stride();
+    const auto n = std::int64_t(vertex.count);
+#pragma omp parallel for
+    for (std::int64_t i = 0; i < n; ++i)
+    {
+        const char* record = data + i * stride;
+        double v[PlyVertexLayout::n_columns] = {};
+        for (int c = 0; c < PlyVertexLayout::n_columns; ++c)
+            if (layout.index[c] >= 0)
+                v[c] = layout.scale[c] *
+                       ply_value(record + offset[c],
+                                 vertex.properties[layout.index[c]].type, swap);
+        vertices.set(i, v);
+    }
+}
 
-    if (!ply_read_header(ply))
-        throw IOException("Failed to read PLY header!");
+// Read the vertex element of an ASCII file, one vertex per line, lines are
+// parsed in parallel. Returns the position after the last vertex.
+const char* read_ply_vertices_ascii(const char* data, const char* end,
+                                    const PlyElement& vertex,
+                                    PlyVertexData& vertices,
+                                    const std::string& filename)
+{
+    const PlyVertexLayout layout(vertex);
+    std::vector<int> column(vertex.properties.size(), -1);
+    for (int c = 0; c < PlyVertexLayout::n_columns; ++c)
+        if (layout.index[c] >= 0)
+            column[layout.index[c]] = c;
+
+    // find the line starts first
+    std::vector<const char*> lines(vertex.count);
+    for (size_t i = 0; i < vertex.count; ++i)
+    {
+        while (data < end && isspace(*data))
+            ++data;
+        if (data == end)
+            throw IOException("Failed to read PLY vertices of " + filename);
+        lines[i] = data;
+        const char* eol = (const char*)memchr(data, '\n', end - data);
+        data = eol ? eol + 1 : end;
+    }
+
+    const auto n = std::int64_t(vertex.count);
+    bool ok = true;
+#pragma omp parallel for reduction(&& : ok)
+    for (std::int64_t i = 0; i < n; ++i)
+    {
+        const char* p = lines[i];
+        double v[PlyVertexLayout::n_columns] = {};
+        for (size_t j = 0; j < column.size() && p; ++j)
+        {
+            double value;
+            p = parse_ply_number(p, end, value);
+            if (!p)
+                ok = false;
+            else if (column[j] >= 0)
+                v[column[j]] = layout.scale[column[j]] * value;
+        }
+        vertices.set(i, v);
+    }
+    if (!ok)
+        throw IOException("Failed to read PLY vertices of " + filename);
+
+    return data;
+}
+
+// Read the face element: the records have varying length, so they are read
+// sequentially, keeping only the vertex indices. Returns the position after
+// the last face.
+const char* read_ply_faces(const char* data, const char* end,
+                           const PlyElement& face, const PlyHeader& header,
+                           std::vector<IndexType>& indices,
+                           std::vector<IndexType>& valences,
+                           const std::string& filename)
+{
+    const std::string error = "Failed to read PLY faces of " + filename;
+    const int list = face.find({"vertex_indices", "vertex_index"});
+    if (list < 0 || !face.properties[list].is_list)
+        throw IOException(error);
+
+    valences.resize(face.count);
+    indices.reserve(3 * face.count);
+
+    if (header.format == PlyHeader::Ascii)
+    {
+        for (size_t f = 0; f < face.count; ++f)
+        {
+            for (int j = 0; j < int(face.properties.size()); ++j)
+            {
+                long n = 1;
+                double value;
+                data = face.properties[j].is_list
+                           ? parse_ply_number(data, end, n)
+                           : parse_ply_number(data, end, value);
+                if (!data || n < 0)
+                    throw IOException(error);
+                if (!face.properties[j].is_list)
+                    continue;
+                if (j == list)
+                    valences[f] = IndexType(n);
+                for (long k = 0; k < n; ++k)
+                {
+                    data = parse_ply_number(data, end, value);
+                    if (!data)
+                        throw IOException(error);
+                    if (j == list)
+                        indices.push_back(IndexType(value));
+                }
+            }
+        }
+        const char* eol = (const char*)memchr(data, '\n', end - data);
+        return eol ? eol + 1 : end;
+    }
+
+    const bool swap = (header.format == PlyHeader::BinaryBigEndian) ==
+                      is_little_endian();
+    for (size_t f = 0; f < face.count; ++f)
+    {
+        for (int j = 0; j < int(face.properties.size()); ++j)
+        {
+            const PlyProperty& p = face.properties[j];
+            const size_t n =
+                p.is_list
+                    ? read_ply_count(data, end, p.count_type, swap, error)
+                    : 1;
+            const size_t size = ply_size(p.type);
+            if (size_t(end - data) < n * size)
+                throw IOException(error);
+            if (j == list)
+            {
+                valences[f] = IndexType(n);
+                for (size_t k = 0; k < n; ++k)
+                    indices.push_back(
+                        IndexType(ply_value(data + k * size, p.type, swap)));
+            }
+            data += n * size;
+        }
+    }
+    return data;
+}
 
-    // setup callbacks for basic properties
-    ply_set_read_cb(ply, "vertex", "x", vertexCallback, &mesh, 0);
-    ply_set_read_cb(ply, "vertex", "y", vertexCallback, &mesh, 1);
-    ply_set_read_cb(ply, "vertex", "z", vertexCallback, &mesh, 2);
+// skip the records of an element that is not read
+const char* skip_ply_element(const char* data, const char* end,
+                             const PlyElement& element,
+                             const PlyHeader& header,
+                             const std::string& filename)
+{
+    const std::string error = "Failed to read PLY element " + element.name +
+                              " of " + filename;
+    if (header.format == PlyHeader::Ascii)
+    {
+        for (size_t i = 0; i < element.count && data < end; ++i)
+        {
+            const char* eol = (const char*)memchr(data, '\n', end - data);
+            data = eol ? eol + 1 : end;
+        }
+        return data;
+    }
 
-    ply_set_read_cb(ply, "face", "vertex_indices", faceCallback, &mesh, 0);
+    const size_t stride = element.stride();
+    if (stride)
+    {
+        if (size_t(end - data) / stride < element.count)
+            throw IOException(error);
+        return data + stride * element.count;
+    }
 
-    // read the data
-    if (!ply_read(ply))
-        throw IOException("Failed to read PLY data!");
+    const bool swap = (header.format == PlyHeader::BinaryBigEndian) ==
+                      is_little_endian();
+    for (size_t i = 0; i < element.count; ++i)
+    {
+        for (const auto& p : element.properties)
+        {
+            const size_t n =
+                p.is_list
+                    ? read_ply_count(data, end, p.count_type, swap, error)
+                    : 1;
+            if (size_t(end - data) < n * ply_size(p.type))
+                throw IOException(error);
+            data += n * ply_size(p.type);
+        }
+    }
+    return data;
+}
 
-    ply_close(ply);
+} // namespace
 
-    // clean-up properties
-    mesh.remove_object_property(point);
-    mesh.remove_object_property(vertices);
+void SurfaceMeshIO::read_ply(SurfaceMesh& mesh)
+{
+    MappedFile file;
+    if (!file.open(filename_))
+        throw IOException("Failed to open file: " + filename_);
+    PlyHeader header;
+    read_ply_header(file.data(), file.size(), header, filename_);
+
+    // ASCII data is parsed from the mapped file as well
+    const char* data = file.data() + header.data_offset;
+    const char* end = file.data() + file.size();
+    const bool swap = (header.format == PlyHeader::BinaryBigEndian) ==
+                      is_little_endian();
+
+    std::unique_ptr<PlyVertexData> vertices;
+    std::vector<IndexType> indices, valences;
+    for (const auto& element : header.elements)
+    {
+        if (element.name == "vertex" && !vertices)
+        {
+            const PlyVertexLayout layout(element);
+            if (!layout.has(PlyVertexLayout::X, PlyVertexLayout::Z))
+                throw IOException("PLY vertices without positions in " +
+                                  filename_);
+            vertices.reset(new PlyVertexData(layout, element.count));
+            if (header.format == PlyHeader::Ascii)
+            {
+                data = read_ply_vertices_ascii(data, end, element, *vertices,
+                                               filename_);
+            }
+            else
+            {
+                const size_t stride = element.stride();
+                if (!stride || size_t(end - data) / stride < element.count)
+                    throw IOException("Failed to read PLY vertices of " +
+                                      filename_);
+                read_ply_vertices_binary(data, element, swap, *vertices);
+                data += stride * element.count;
+            }
+        }
+        else if (element.name == "face" && valences.empty())
+        {
+            data = read_ply_faces(data, end, element, header, indices,
+                                  valences, filename_);
+        }
+        else
+        {
+            data = skip_ply_element(data, end, element, header, filename_);
+        }
+    }
+    if (!vertices)
+        throw IOException("No vertices in PLY file " + filename_);
+
+    // without faces, the mesh is a point cloud
+    mesh.build(std::move(vertices->points), indices, valences);
+
+    if (!vertices->normals.empty())
+        mesh.vertex_property<Normal>("v:normal").vector() =
+            std::move(vertices->normals);
+    if (!vertices->colors.empty())
+        mesh.vertex_property<Color>("v:color").vector() =
+            std::move(vertices->colors);
+    if (!vertices->confidences.empty())
+        mesh.vertex_property<float>("v:confidence").vector() =
+            std::move(vertices->confidences);
 }
 
 void SurfaceMeshIO::write_ply(const SurfaceMesh& mesh)
 {
-    e_ply_storage_mode mode = flags_.use_binary ? PLY_LITTLE_ENDIAN : PLY_ASCII;
-    p_ply ply = ply_create(filename_.c_str(), mode, nullptr, 0, nullptr);
-
-    ply_add_comment(ply, "File written with pmp-library");
-    ply_add_element(ply, "vertex", mesh.n_vertices());
-    ply_add_scalar_property(ply, "x", PLY_FLOAT);
-    ply_add_scalar_property(ply, "y", PLY_FLOAT);
-    ply_add_scalar_property(ply, "z", PLY_FLOAT);
-    ply_add_element(ply, "face", mesh.n_faces());
-    ply_add_property(ply, "vertex_indices", PLY_LIST, PLY_UCHAR, PLY_INT);
-    ply_write_header(ply);
+    // deleted elements would break the vertex indices of faces
+    if (mesh.has_garbage())
+    {
+        SurfaceMesh copy = mesh;
+        copy.garbage_collection();
+        write_ply(copy);
+        return;
+    }
 
-    // write vertices
     auto points = mesh.get_vertex_property<Point>("v:point");
-    for (auto v : mesh.vertices())
+    auto normals = flags_.use_vertex_normals
+                       ? mesh.get_vertex_property<Normal>("v:normal")
+                       : VertexProperty<Normal>();
+    auto colors = flags_.use_vertex_colors
+                      ? mesh.get_vertex_property<Color>("v:color")
+                      : VertexProperty<Color>();
+    auto confidences = mesh.get_vertex_property<float>("v:confidence");
+    const bool binary = flags_.use_binary;
+    const auto nv = std::int64_t(mesh.n_vertices());
+    const auto nf = std::int64_t(mesh.n_faces());
+
+    FILE* out = fopen(filename_.c_str(), binary ? "wb" : "w");
+    if (!out)
+        throw IOException("Failed to open file: " + filename_);
+
+    // header
+    fprintf(out, "ply\nformat %s 1.0\n",
+            !binary ? "ascii"
+            : is_little_endian() ? "binary_little_endian"
+                                 : "binary_big_endian");
+    fprintf(out, "comment File written with pmp-library\n");
+    fprintf(out, "element vertex %lld\n", (long long)nv);
+    fprintf(out, "property float x\nproperty float y\nproperty float z\n");
+    if (normals)
+        fprintf(out,
+                "property float nx\nproperty float ny\nproperty float nz\n");
+    if (colors)
+        fprintf(out, "property uchar red\nproperty uchar green\n"
+                     "property uchar blue\n");
+    if (confidences)
+        fprintf(out, "property float confidence\n");
+    if (nf)
     {
-        ply_write(ply, points[v][0]);
-        ply_write(ply, points[v][1]);
-        ply_write(ply, points[v][2]);
+        fprintf(out, "element face %lld\n", (long long)nf);
+        fprintf(out, "property list uchar int vertex_indices\n");
+    }
+    fprintf(out, "end_header\n");
+
+    auto color_byte = [](Scalar c) {
+        return std::uint8_t(std::min(std::max(c, Scalar(0)), Scalar(1)) * 255 +
+                            Scalar(0.5));
+    };
+
+    // vertices and faces are written in blocks, binary records are packed in
+    // parallel
+    const std::int64_t block = 1 << 20;
+    std::vector<char> buffer;
+    bool ok = true;
+
+    const size_t stride = 12 + (normals ? 12 : 0) + (colors ? 3 : 0) +
+                          (confidences ? 4 : 0);
+    for (std::int64_t begin = 0; begin < nv && ok; begin += block)
+    {
+        const std::int64_t end = std::min(begin + block, nv);
+        if (binary)
+        {
+            buffer.resize((end - begin) * stride);
+#pragma omp parallel for
+            for (std::int64_t i = begin; i < end; ++i)
+            {
+                const auto v = static_cast<Vertex>(IndexType(i));
+                char* p = &buffer[(i - begin) * stride];
+                const Vector<float, 3> x(points[v]);
+                memcpy(p, x.data(), 12);
+                p += 12;
+                if (normals)
+                {
+                    const Vector<float, 3> n(normals[v]);
+                    memcpy(p, n.data(), 12);
+                    p += 12;
+                }
+                if (colors)
+                {
+                    for (int j = 0; j < 3; ++j)
+                        *p++ = char(color_byte(colors[v][j]));
+                }
+                if (confidences)
+                    memcpy(p, &confidences[v], 4);
+            }
+            ok = fwrite(buffer.data(), 1, buffer.size(), out) == buffer.size();
+        }
+        else
+        {
+            for (std::int64_t i = begin; i < end; ++i)
+            {
+                const auto v = static_cast<Vertex>(IndexType(i));
+                const Point& x = points[v];
+                fprintf(out, "%.9g %.9g %.9g", x[0], x[1], x[2]);
+                if (normals)
+                {
+                    const Normal& n = normals[v];
+                    fprintf(out, " %.9g %.9g %.9g", n[0], n[1], n[2]);
+                }
+                if (colors)
+                {
+                    const Color& c = colors[v];
+                    fprintf(out, " %d %d %d", color_byte(c[0]),
+                            color_byte(c[1]), color_byte(c[2]));
+                }
+                if (confidences)
+                    fprintf(out, " %.9g", confidences[v]);
+                fprintf(out, "\n");
+            }
+        }
     }
 
-    // write faces
-    for (auto f : mesh.faces())
+    std::vector<size_t> offset;
+    for (std::int64_t begin = 0; begin < nf && ok; begin += block)
     {
-        ply_write(ply, mesh.valence(f));
-        for (auto fv : mesh.vertices(f))
-            ply_write(ply, fv.idx());
+        const std::int64_t end = std::min(begin + block, nf);
+        if (binary)
+        {
+            // record offsets from the valences
+            offset.resize(end - begin + 1);
+            offset[0] = 0;
+            for (std::int64_t i = begin; i < end; ++i)
+                offset[i - begin + 1] =
+                    offset[i - begin] +
+                    1 + 4 * mesh.valence(Face(IndexType(i)));
+            buffer.resize(offset.back());
+#pragma omp parallel for
+            for (std::int64_t i = begin; i < end; ++i)
+            {
+                const auto f = static_cast<Face>(IndexType(i));
+                char* p = &buffer[offset[i - begin]];
+                *p++ = char(std::uint8_t((offset[i - begin + 1] -
+                                          offset[i - begin] - 1) / 4));
+                for (auto v : mesh.vertices(f))
+                {
+                    const std::int32_t idx = v.idx();
+                    memcpy(p, &idx, 4);
+                    p += 4;
+                }
+            }
+            ok = fwrite(buffer.data(), 1, buffer.size(), out) == buffer.size();
+        }
+        else
+        {
+            for (std::int64_t i = begin; i < end; ++i)
+            {
+                const auto f = static_cast<Face>(IndexType(i));
+                fprintf(out, "%d", int(mesh.valence(f)));
+                for (auto v : mesh.vertices(f))
+                    fprintf(out, " %d", int(v.idx()));
+                fprintf(out, "\n");
+            }
+        }
     }
 
-    ply_close(ply);
+    if (fclose(out) != 0 || !ok)
+        throw IOException("Failed to write file: " + filename_);
 }
 
 // helper class for STL reader
@@ -998,13 +1933,15 @@ void SurfaceMeshIO::read_stl(SurfaceMesh& mesh)
     std::array<char, 100> line;
     unsigned int i, nT(0);
     vec3 p;
-    Vertex v;
-    std::vector<Vertex> vertices(3);
+    IndexType v;
+    std::array<IndexType, 3> vertices;
+    std::vector<Point> points;
+    std::vector<IndexType> triangles;
     size_t n_items(0);
 
     CmpVec comp(std::numeric_limits<Scalar>::min());
-    std::map<vec3, Vertex, CmpVec> vMap(comp);
-    std::map<vec3, Vertex, CmpVec>::iterator vMapIt;
+    std::map<vec3, IndexType, CmpVec> vMap(comp);
+    std::map<vec3, IndexType, CmpVec>::iterator vMapIt;
 
     // open file (in ASCII mode)
     FILE* in = fopen(filename_.c_str(), "r");
@@ -1048,7 +1985,8 @@ void SurfaceMeshIO::read_stl(SurfaceMesh& mesh)
                 if ((vMapIt = vMap.find(p)) == vMap.end())
                 {
                     // No : add vertex and remember idx/vector mapping
-                    v = mesh.add_vertex((Point)p);
+                    v = points.size();
+                    points.push_back(p);
                     vertices[i] = v;
                     vMap[p] = v;
                 }
@@ -1062,7 +2000,8 @@ void SurfaceMeshIO::read_stl(SurfaceMesh& mesh)
             // Add face only if it is not degenerated
             if ((vertices[0] != vertices[1]) && (vertices[0] != vertices[2]) &&
                 (vertices[1] != vertices[2]))
-                mesh.add_face(vertices);
+                triangles.insert(triangles.end(), vertices.begin(),
+                                 vertices.end());
 
             n_items = fread(line.data(), 1, 2, in);
             PMP_ASSERT(n_items > 0);
@@ -1103,7 +2042,8 @@ void SurfaceMeshIO::read_stl(SurfaceMesh& mesh)
                     if ((vMapIt = vMap.find(p)) == vMap.end())
                     {
                         // No : add vertex and remember idx/vector mapping
-                        v = mesh.add_vertex((Point)p);
+                        v = points.size();
+                        points.push_back(p);
                         vertices[i] = v;
                         vMap[p] = v;
                     }
@@ -1118,12 +2058,15 @@ void SurfaceMeshIO::read_stl(SurfaceMesh& mesh)
                 if ((vertices[0] != vertices[1]) &&
                     (vertices[0] != vertices[2]) &&
                     (vertices[1] != vertices[2]))
-                    mesh.add_face(vertices);
+                    triangles.insert(triangles.end(), vertices.begin(),
+                                     vertices.end());
             }
         }
     }
 
     fclose(in);
+
+    mesh.build(std::move(points), triangles);
 }
 
 void SurfaceMeshIO::write_stl(const SurfaceMesh& mesh)
@@ -30,6 +30,7 @@ private:
     void read_stl(SurfaceMesh& mesh);
     void read_ply(SurfaceMesh& mesh);
     void read_pmp(SurfaceMesh& mesh);
+    void read_pmp_legacy(SurfaceMesh& mesh);
     void read_xyz(SurfaceMesh& mesh);
     void read_agi(SurfaceMesh& mesh);
 
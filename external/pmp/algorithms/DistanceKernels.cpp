@@ -0,0 +1,500 @@
+// Copyright 2011-2023 the Polygon Mesh Processing Library developers.
+// Distributed under a MIT-style license, see LICENSE.txt for details.
+
+#include "pmp/algorithms/DistanceKernels.h"
+
+#include <cstdlib>
+#include <cstring>
+#include <limits>
+
+#include "pmp/algorithms/DistancePointTriangle.h"
+
+// vectorized kernels need GCC/Clang on x86 and single precision scalars
+#if (defined(__GNUC__) || defined(__clang__)) && \
+    (defined(__x86_64__) || defined(__i386__)) && !defined(PMP_SCALAR_TYPE_64)
+#define PMP_X86_KERNELS
+#include <immintrin.h>
+#endif
+
+namespace pmp {
+
+namespace {
+
+enum KernelIsa
+{
+    ScalarIsa,
+    SSE2Isa,
+    AVX2Isa
+};
+
+// choose instruction set once, can be overridden by the environment
+// variable PMP_DISTANCE_KERNEL=scalar|sse2|avx2 (e.g. for benchmarking)
+KernelIsa detect_isa()
+{
+    KernelIsa isa = ScalarIsa;
+
+#ifdef PMP_X86_KERNELS
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("sse2"))
+        isa = SSE2Isa;
+    if (__builtin_cpu_supports("avx2"))
+        isa = AVX2Isa;
+#endif
+
+    const char* env = std::getenv("PMP_DISTANCE_KERNEL");
+    if (env && !std::strcmp(env, "scalar"))
+        isa = ScalarIsa;
+    else if (env && !std::strcmp(env, "sse2") && isa >= SSE2Isa)
+        isa = SSE2Isa;
+    else if (env && !std::strcmp(env, "avx2") && isa >= AVX2Isa)
+        isa = AVX2Isa;
+
+    return isa;
+}
+
+KernelIsa kernel_isa()
+{
+    static const KernelIsa isa = detect_isa();
+    return isa;
+}
+
+// exact test of triangle i, updates closest triangle if it is closer
+inline void test_triangle(const Scalar* const v[9], size_t i, const Point& p,
+                          Scalar& dist, Point& nearest_point, int& idx)
+{
+    Point np;
+    Scalar d = dist_point_triangle(p, Point(v[0][i], v[1][i], v[2][i]),
+                                   Point(v[3][i], v[4][i], v[5][i]),
+                                   Point(v[6][i], v[7][i], v[8][i]), np);
+    if (d < dist)
+    {
+        dist = d;
+        nearest_point = np;
+        idx = int(i);
+    }
+}
+
+// candidates are selected with some slack, since the vectorized distance
+// computation is less accurate than dist_point_triangle()
+constexpr Scalar relative_slack = 1e-4;
+constexpr Scalar absolute_slack = 1e-6; // relative to squared edge lengths
+
+//-----------------------------------------------------------------------------
+
+int nearest_point_scalar(const Scalar* x, const Scalar* y, const Scalar* z,
+                         size_t n, const Point& p, Scalar& sqr_dist)
+{
+    int idx = -1;
+    for (size_t i = 0; i < n; ++i)
+    {
+        const Scalar dx = x[i] - p[0];
+        const Scalar dy = y[i] - p[1];
+        const Scalar dz = z[i] - p[2];
+        const Scalar d = dx * dx + dy * dy + dz * dz;
+        if (d < sqr_dist)
+        {
+            sqr_dist = d;
+            idx = int(i);
+        }
+    }
+    return idx;
+}
+
+int nearest_triangle_scalar(const Scalar* const v[9], size_t n,
+                            const Point& p, Scalar& dist, Point& nearest_point)
+{
+    int idx = -1;
+    for (size_t i = 0; i < n; ++i)
+        test_triangle(v, i, p, dist, nearest_point, idx);
+    return idx;
+}
+
+//-----------------------------------------------------------------------------
+
+#ifdef PMP_X86_KERNELS
+
+__attribute__((target("sse2"))) int nearest_point_sse2(
+    const Scalar* x, const Scalar* y, const Scalar* z, size_t n,
+    const Point& p, Scalar& sqr_dist)
+{
+    const __m128 px = _mm_set1_ps(p[0]);
+    const __m128 py = _mm_set1_ps(p[1]);
+    const __m128 pz = _mm_set1_ps(p[2]);
+    __m128 bound = _mm_set1_ps(sqr_dist);
+    int idx = -1;
+
+    for (size_t i = 0; i < n; i += 4)
+    {
+        const __m128 dx = _mm_sub_ps(_mm_loadu_ps(x + i), px);
+        const __m128 dy = _mm_sub_ps(_mm_loadu_ps(y + i), py);
+        const __m128 dz = _mm_sub_ps(_mm_loadu_ps(z + i), pz);
+        const __m128 d =
+            _mm_add_ps(_mm_add_ps(_mm_mul_ps(dx, dx), _mm_mul_ps(dy, dy)),
+                       _mm_mul_ps(dz, dz));
+
+        // rarely taken: some lane is closer than the current bound
+        int mask = _mm_movemask_ps(_mm_cmplt_ps(d, bound));
+        if (mask)
+        {
+            alignas(16) float ds[4];
+            _mm_store_ps(ds, d);
+            for (int l = 0; l < 4; ++l)
+            {
+                if (ds[l] < sqr_dist)
+                {
+                    sqr_dist = ds[l];
+                    idx = int(i + l);
+                }
+            }
+            bound = _mm_set1_ps(sqr_dist);
+        }
+    }
+
+    return idx;
+}
+
+__attribute__((target("avx2"))) int nearest_point_avx2(
+    const Scalar* x, const Scalar* y, const Scalar* z, size_t n,
+    const Point& p, Scalar& sqr_dist)
+{
+    const __m256 px = _mm256_set1_ps(p[0]);
+    const __m256 py = _mm256_set1_ps(p[1]);
+    const __m256 pz = _mm256_set1_ps(p[2]);
+    __m256 bound = _mm256_set1_ps(sqr_dist);
+    int idx = -1;
+
+    for (size_t i = 0; i < n; i += 8)
+    {
+        const __m256 dx = _mm256_sub_ps(_mm256_loadu_ps(x + i), px);
+        const __m256 dy = _mm256_sub_ps(_mm256_loadu_ps(y + i), py);
+        const __m256 dz = _mm256_sub_ps(_mm256_loadu_ps(z + i), pz);
+        const __m256 d = _mm256_add_ps(
+            _mm256_add_ps(_mm256_mul_ps(dx, dx), _mm256_mul_ps(dy, dy)),
+            _mm256_mul_ps(dz, dz));
+
+        // rarely taken: some lane is closer than the current bound
+        int mask = _mm256_movemask_ps(_mm256_cmp_ps(d, bound, _CMP_LT_OQ));
+        if (mask)
+        {
+            alignas(32) float ds[8];
+            _mm256_store_ps(ds, d);
+            for (int l = 0; l < 8; ++l)
+            {
+                if (ds[l] < sqr_dist)
+                {
+                    sqr_dist = ds[l];
+                    idx = int(i + l);
+                }
+            }
+            bound = _mm256_set1_ps(sqr_dist);
+        }
+    }
+
+    return idx;
+}
+
+//-----------------------------------------------------------------------------
+
+__attribute__((target("sse2"))) inline __m128 dot_sse2(
+    __m128 ax, __m128 ay, __m128 az, __m128 bx, __m128 by, __m128 bz)
+{
+    return _mm_add_ps(_mm_add_ps(_mm_mul_ps(ax, bx), _mm_mul_ps(ay, by)),
+                      _mm_mul_ps(az, bz));
+}
+
+__attribute__((target("sse2"))) inline __m128 clamp01_sse2(__m128 t)
+{
+    return _mm_min_ps(_mm_max_ps(t, _mm_setzero_ps()), _mm_set1_ps(1.0f));
+}
+
+__attribute__((target("avx2"))) inline __m256 dot_avx2(
+    __m256 ax, __m256 ay, __m256 az, __m256 bx, __m256 by, __m256 bz)
+{
+    return _mm256_add_ps(
+        _mm256_add_ps(_mm256_mul_ps(ax, bx), _mm256_mul_ps(ay, by)),
+        _mm256_mul_ps(az, bz));
+}
+
+__attribute__((target("avx2"))) inline __m256 clamp01_avx2(__m256 t)
+{
+    return _mm256_min_ps(_mm256_max_ps(t, _mm256_setzero_ps()),
+                         _mm256_set1_ps(1.0f));
+}
+
+// squared point-triangle distance for four triangles: distance to the
+// supporting plane if p projects into the triangle, otherwise distance to
+// the closest edge. branch-free, degenerate triangles are handled by the
+// edge distances.
+__attribute__((target("sse2"))) int nearest_triangle_sse2(
+    const Scalar* const v[9], size_t n, const Point& p, Scalar& dist,
+    Point& nearest_point)
+{
+    const __m128 zero = _mm_setzero_ps();
+    const __m128 tiny = _mm_set1_ps(std::numeric_limits<float>::min());
+    const __m128 px = _mm_set1_ps(p[0]);
+    const __m128 py = _mm_set1_ps(p[1]);
+    const __m128 pz = _mm_set1_ps(p[2]);
+    int idx = -1;
+
+    for (size_t i = 0; i < n; i += 4)
+    {
+        const __m128 ax = _mm_loadu_ps(v[0] + i);
+        const __m128 ay = _mm_loadu_ps(v[1] + i);
+        const __m128 az = _mm_loadu_ps(v[2] + i);
+        const __m128 bx = _mm_loadu_ps(v[3] + i);
+        const __m128 by = _mm_loadu_ps(v[4] + i);
+        const __m128 bz = _mm_loadu_ps(v[5] + i);
+        const __m128 cx = _mm_loadu_ps(v[6] + i);
+        const __m128 cy = _mm_loadu_ps(v[7] + i);
+        const __m128 cz = _mm_loadu_ps(v[8] + i);
+
+        // edges and vectors to p
+        const __m128 e0x = _mm_sub_ps(bx, ax), e0y = _mm_sub_ps(by, ay),
+                     e0z = _mm_sub_ps(bz, az);
+        const __m128 e1x = _mm_sub_ps(cx, ax), e1y = _mm_sub_ps(cy, ay),
+                     e1z = _mm_sub_ps(cz, az);
+        const __m128 e2x = _mm_sub_ps(cx, bx), e2y = _mm_sub_ps(cy, by),
+                     e2z = _mm_sub_ps(cz, bz);
+        const __m128 apx = _mm_sub_ps(px, ax), apy = _mm_sub_ps(py, ay),
+                     apz = _mm_sub_ps(pz, az);
+        const __m128 bpx = _mm_sub_ps(px, bx), bpy = _mm_sub_ps(py, by),
+                     bpz = _mm_sub_ps(pz, bz);
+
+        const __m128 d00 = dot_sse2(e0x, e0y, e0z, e0x, e0y, e0z);
+        const __m128 d01 = dot_sse2(e0x, e0y, e0z, e1x, e1y, e1z);
+        const __m128 d11 = dot_sse2(e1x, e1y, e1z, e1x, e1y, e1z);
+        const __m128 d22 = dot_sse2(e2x, e2y, e2z, e2x, e2y, e2z);
+        const __m128 d20 = dot_sse2(apx, apy, apz, e0x, e0y, e0z);
+        const __m128 d21 = dot_sse2(apx, apy, apz, e1x, e1y, e1z);
+        const __m128 d2b = dot_sse2(bpx, bpy, bpz, e2x, e2y, e2z);
+
+        // unnormalized barycentric coordinates of projection of p
+        const __m128 det = _mm_sub_ps(_mm_mul_ps(d00, d11), _mm_mul_ps(d01, d01));
+        const __m128 bv = _mm_sub_ps(_mm_mul_ps(d11, d20), _mm_mul_ps(d01, d21));
+        const __m128 bw = _mm_sub_ps(_mm_mul_ps(d00, d21), _mm_mul_ps(d01, d20));
+        const __m128 inside = _mm_and_ps(
+            _mm_and_ps(_mm_cmpgt_ps(det, zero), _mm_cmpge_ps(bv, zero)),
+            _mm_and_ps(_mm_cmpge_ps(bw, zero),
+                       _mm_cmple_ps(_mm_add_ps(bv, bw), det)));
+
+        // distance to plane, normalized by |e0 x e1|^2 (not by det, which
+        // cancels on slivers)
+        const __m128 nx = _mm_sub_ps(_mm_mul_ps(e0y, e1z), _mm_mul_ps(e0z, e1y));
+        const __m128 ny = _mm_sub_ps(_mm_mul_ps(e0z, e1x), _mm_mul_ps(e0x, e1z));
+        const __m128 nz = _mm_sub_ps(_mm_mul_ps(e0x, e1y), _mm_mul_ps(e0y, e1x));
+        const __m128 s = dot_sse2(apx, apy, apz, nx, ny, nz);
+        const __m128 nn = dot_sse2(nx, ny, nz, nx, ny, nz);
+        const __m128 plane = _mm_div_ps(_mm_mul_ps(s, s), _mm_max_ps(nn, tiny));
+
+        // distances to the three edges
+        __m128 t = clamp01_sse2(_mm_div_ps(d20, _mm_max_ps(d00, tiny)));
+        __m128 rx = _mm_sub_ps(apx, _mm_mul_ps(t, e0x));
+        __m128 ry = _mm_sub_ps(apy, _mm_mul_ps(t, e0y));
+        __m128 rz = _mm_sub_ps(apz, _mm_mul_ps(t, e0z));
+        __m128 edge = dot_sse2(rx, ry, rz, rx, ry, rz);
+
+        t = clamp01_sse2(_mm_div_ps(d21, _mm_max_ps(d11, tiny)));
+        rx = _mm_sub_ps(apx, _mm_mul_ps(t, e1x));
+        ry = _mm_sub_ps(apy, _mm_mul_ps(t, e1y));
+        rz = _mm_sub_ps(apz, _mm_mul_ps(t, e1z));
+        edge = _mm_min_ps(edge, dot_sse2(rx, ry, rz, rx, ry, rz));
+
+        t = clamp01_sse2(_mm_div_ps(d2b, _mm_max_ps(d22, tiny)));
+        rx = _mm_sub_ps(bpx, _mm_mul_ps(t, e2x));
+        ry = _mm_sub_ps(bpy, _mm_mul_ps(t, e2y));
+        rz = _mm_sub_ps(bpz, _mm_mul_ps(t, e2z));
+        edge = _mm_min_ps(edge, dot_sse2(rx, ry, rz, rx, ry, rz));
+
+        // the cross product loses its direction on slivers, so the plane
+        // distance may overshoot; the edge distance bounds it from above
+        const __m128 d = _mm_or_ps(_mm_and_ps(inside, _mm_min_ps(plane, edge)),
+                                   _mm_andnot_ps(inside, edge));
+
+        // select candidates, test them exactly
+        const __m128 bound = _mm_add_ps(
+            _mm_set1_ps(dist * dist * (1 + relative_slack)),
+            _mm_mul_ps(_mm_set1_ps(absolute_slack), _mm_add_ps(d00, d11)));
+        int mask = _mm_movemask_ps(_mm_cmple_ps(d, bound));
+        for (int l = 0; mask; ++l, mask >>= 1)
+            if (mask & 1)
+                test_triangle(v, i + l, p, dist, nearest_point, idx);
+    }
+
+    return idx;
+}
+
+__attribute__((target("avx2"))) int nearest_triangle_avx2(
+    const Scalar* const v[9], size_t n, const Point& p, Scalar& dist,
+    Point& nearest_point)
+{
+    const __m256 zero = _mm256_setzero_ps();
+    const __m256 tiny = _mm256_set1_ps(std::numeric_limits<float>::min());
+    const __m256 px = _mm256_set1_ps(p[0]);
+    const __m256 py = _mm256_set1_ps(p[1]);
+    const __m256 pz = _mm256_set1_ps(p[2]);
+    int idx = -1;
+
+    for (size_t i = 0; i < n; i += 8)
+    {
+        const __m256 ax = _mm256_loadu_ps(v[0] + i);
+        const __m256 ay = _mm256_loadu_ps(v[1] + i);
+        const __m256 az = _mm256_loadu_ps(v[2] + i);
+        const __m256 bx = _mm256_loadu_ps(v[3] + i);
+        const __m256 by = _mm256_loadu_ps(v[4] + i);
+        const __m256 bz = _mm256_loadu_ps(v[5] + i);
+        const __m256 cx = _mm256_loadu_ps(v[6] + i);
+        const __m256 cy = _mm256_loadu_ps(v[7] + i);
+        const __m256 cz = _mm256_loadu_ps(v[8] + i);
+
+        // edges and vectors to p
+        const __m256 e0x = _mm256_sub_ps(bx, ax), e0y = _mm256_sub_ps(by, ay),
+                     e0z = _mm256_sub_ps(bz, az);
+        const __m256 e1x = _mm256_sub_ps(cx, ax), e1y = _mm256_sub_ps(cy, ay),
+                     e1z = _mm256_sub_ps(cz, az);
+        const __m256 e2x = _mm256_sub_ps(cx, bx), e2y = _mm256_sub_ps(cy, by),
+                     e2z = _mm256_sub_ps(cz, bz);
+        const __m256 apx = _mm256_sub_ps(px, ax), apy = _mm256_sub_ps(py, ay),
+                     apz = _mm256_sub_ps(pz, az);
+        const __m256 bpx = _mm256_sub_ps(px, bx), bpy = _mm256_sub_ps(py, by),
+                     bpz = _mm256_sub_ps(pz, bz);
+
+        const __m256 d00 = dot_avx2(e0x, e0y, e0z, e0x, e0y, e0z);
+        const __m256 d01 = dot_avx2(e0x, e0y, e0z, e1x, e1y, e1z);
+        const __m256 d11 = dot_avx2(e1x, e1y, e1z, e1x, e1y, e1z);
+        const __m256 d22 = dot_avx2(e2x, e2y, e2z, e2x, e2y, e2z);
+        const __m256 d20 = dot_avx2(apx, apy, apz, e0x, e0y, e0z);
+        const __m256 d21 = dot_avx2(apx, apy, apz, e1x, e1y, e1z);
+        const __m256 d2b = dot_avx2(bpx, bpy, bpz, e2x, e2y, e2z);
+
+        // unnormalized barycentric coordinates of projection of p
+        const __m256 det =
+            _mm256_sub_ps(_mm256_mul_ps(d00, d11), _mm256_mul_ps(d01, d01));
+        const __m256 bv =
+            _mm256_sub_ps(_mm256_mul_ps(d11, d20), _mm256_mul_ps(d01, d21));
+        const __m256 bw =
+            _mm256_sub_ps(_mm256_mul_ps(d00, d21), _mm256_mul_ps(d01, d20));
+        const __m256 inside = _mm256_and_ps(
+            _mm256_and_ps(_mm256_cmp_ps(det, zero, _CMP_GT_OQ),
+                          _mm256_cmp_ps(bv, zero, _CMP_GE_OQ)),
+            _mm256_and_ps(_mm256_cmp_ps(bw, zero, _CMP_GE_OQ),
+                          _mm256_cmp_ps(_mm256_add_ps(bv, bw), det,
+                                        _CMP_LE_OQ)));
+
+        // distance to plane, normalized by |e0 x e1|^2 (not by det, which
+        // cancels on slivers)
+        const __m256 nx =
+            _mm256_sub_ps(_mm256_mul_ps(e0y, e1z), _mm256_mul_ps(e0z, e1y));
+        const __m256 ny =
+            _mm256_sub_ps(_mm256_mul_ps(e0z, e1x), _mm256_mul_ps(e0x, e1z));
+        const __m256 nz =
+            _mm256_sub_ps(_mm256_mul_ps(e0x, e1y), _mm256_mul_ps(e0y, e1x));
+        const __m256 s = dot_avx2(apx, apy, apz, nx, ny, nz);
+        const __m256 nn = dot_avx2(nx, ny, nz, nx, ny, nz);
+        const __m256 plane =
+            _mm256_div_ps(_mm256_mul_ps(s, s), _mm256_max_ps(nn, tiny));
+
+        // distances to the three edges
+        __m256 t = clamp01_avx2(_mm256_div_ps(d20, _mm256_max_ps(d00, tiny)));
+        __m256 rx = _mm256_sub_ps(apx, _mm256_mul_ps(t, e0x));
+        __m256 ry = _mm256_sub_ps(apy, _mm256_mul_ps(t, e0y));
+        __m256 rz = _mm256_sub_ps(apz, _mm256_mul_ps(t, e0z));
+        __m256 edge = dot_avx2(rx, ry, rz, rx, ry, rz);
+
+        t = clamp01_avx2(_mm256_div_ps(d21, _mm256_max_ps(d11, tiny)));
+        rx = _mm256_sub_ps(apx, _mm256_mul_ps(t, e1x));
+        ry = _mm256_sub_ps(apy, _mm256_mul_ps(t, e1y));
+        rz = _mm256_sub_ps(apz, _mm256_mul_ps(t, e1z));
+        edge = _mm256_min_ps(edge, dot_avx2(rx, ry, rz, rx, ry, rz));
+
+        t = clamp01_avx2(_mm256_div_ps(d2b, _mm256_max_ps(d22, tiny)));
+        rx = _mm256_sub_ps(bpx, _mm256_mul_ps(t, e2x));
+        ry = _mm256_sub_ps(bpy, _mm256_mul_ps(t, e2y));
+        rz = _mm256_sub_ps(bpz, _mm256_mul_ps(t, e2z));
+        edge = _mm256_min_ps(edge, dot_avx2(rx, ry, rz, rx, ry, rz));
+
+        // the cross product loses its direction on slivers, so the plane
+        // distance may overshoot; the edge distance bounds it from above
+        const __m256 d =
+            _mm256_blendv_ps(edge, _mm256_min_ps(plane, edge), inside);
+
+        // select candidates, test them exactly
+        const __m256 bound = _mm256_add_ps(
+            _mm256_set1_ps(dist * dist * (1 + relative_slack)),
+            _mm256_mul_ps(_mm256_set1_ps(absolute_slack),
+                          _mm256_add_ps(d00, d11)));
+        int mask = _mm256_movemask_ps(_mm256_cmp_ps(d, bound, _CMP_LE_OQ));
+        for (int l = 0; mask; ++l, mask >>= 1)
+            if (mask & 1)
+                test_triangle(v, i + l, p, dist, nearest_point, idx);
+    }
+
+    return idx;
+}
+
+#endif // PMP_X86_KERNELS
+
+} // namespace
+
+//-----------------------------------------------------------------------------
+
+const char* distance_kernel_isa()
+{
+    switch (kernel_isa())
+    {
+        case AVX2Isa:
+            return "avx2";
+        case SSE2Isa:
+            return "sse2";
+        default:
+            return "scalar";
+    }
+}
+
+unsigned int distance_kernel_width()
+{
+    switch (kernel_isa())
+    {
+        case AVX2Isa:
+            return 8;
+        case SSE2Isa:
+            return 4;
+        default:
+            return 1;
+    }
+}
+
+int nearest_point(const Scalar* x, const Scalar* y, const Scalar* z, size_t n,
+                  const Point& p, Scalar& sqr_dist)
+{
+#ifdef PMP_X86_KERNELS
+    switch (kernel_isa())
+    {
+        case AVX2Isa:
+            return nearest_point_avx2(x, y, z, n, p, sqr_dist);
+        case SSE2Isa:
+            return nearest_point_sse2(x, y, z, n, p, sqr_dist);
+        default:
+            break;
+    }
+#endif
+    return nearest_point_scalar(x, y, z, n, p, sqr_dist);
+}
+
+int nearest_triangle(const Scalar* const v[9], size_t n, const Point& p,
+                     Scalar& dist, Point& nearest_point)
+{
+#ifdef PMP_X86_KERNELS
+    switch (kernel_isa())
+    {
+        case AVX2Isa:
+            return nearest_triangle_avx2(v, n, p, dist, nearest_point);
+        case SSE2Isa:
+            return nearest_triangle_sse2(v, n, p, dist, nearest_point);
+        default:
+            break;
+    }
+#endif
+    return nearest_triangle_scalar(v, n, p, dist, nearest_point);
+}
+
+} // namespace pmp
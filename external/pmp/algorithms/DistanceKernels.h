@@ -0,0 +1,55 @@
+// Copyright 2011-2023 the Polygon Mesh Processing Library developers.
+// Distributed under a MIT-style license, see LICENSE.txt for details.
+
+#pragma once
+
+#include <cstddef>
+
+#include "pmp/Types.h"
+
+namespace pmp {
+
+//! \addtogroup algorithms
+//! @{
+
+//! \brief Return the instruction set used by the distance kernels.
+//! \details Chosen once at runtime depending on the CPU: "avx2" (8 elements
+//! per step), "sse2" (4 elements per step), or "scalar".
+const char* distance_kernel_isa();
+
+//! \brief Number of elements the distance kernels process per step.
+//! \details Arrays passed to the kernels are read in blocks of this size,
+//! i.e., possibly beyond the given element count. Callers have to pad their
+//! arrays by distance_kernel_max_width()-1 valid elements.
+unsigned int distance_kernel_width();
+
+//! Maximum value of distance_kernel_width() over all instruction sets.
+constexpr unsigned int distance_kernel_max_width() { return 8; }
+
+//! \brief Find the point closest to \p p among the \p n points given by the
+//! coordinate arrays \p x, \p y, \p z.
+//! \details Only points with squared distance smaller than \p sqr_dist are
+//! considered, \p sqr_dist is updated to the squared distance of the closest
+//! point. Ties are resolved in favor of the smaller index. Since the arrays
+//! are processed in blocks, points beyond \p n may be reported as well.
+//! \return index of the closest point, or -1 if no point is closer than the
+//! initial \p sqr_dist.
+int nearest_point(const Scalar* x, const Scalar* y, const Scalar* z, size_t n,
+                  const Point& p, Scalar& sqr_dist);
+
+//! \brief Find the triangle closest to \p p among \p n triangles.
+//! \details The triangles are given by nine coordinate arrays \p v (x, y, z
+//! of the first, second, and third vertex). Only triangles closer than
+//! \p dist are considered, \p dist and \p nearest_point are updated to the
+//! distance and closest point of the closest triangle. Distances are computed
+//! by dist_point_triangle(), the vectorized kernels only select candidates.
+//! Since the arrays are processed in blocks, triangles beyond \p n may be
+//! reported as well.
+//! \return index of the closest triangle, or -1 if no triangle is closer
+//! than the initial \p dist.
+int nearest_triangle(const Scalar* const v[9], size_t n, const Point& p,
+                     Scalar& dist, Point& nearest_point);
+
+//! @}
+
+} // namespace pmp
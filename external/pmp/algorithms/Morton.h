@@ -0,0 +1,30 @@
+// Copyright 2011-2023 the Polygon Mesh Processing Library developers.
+// Distributed under a MIT-style license, see LICENSE.txt for details.
+
+#pragma once
+
+#include <cstdint>
+
+namespace pmp {
+
+//! \addtogroup algorithms
+//! @{
+
+//! \brief Spread the lower 21 bits of \p x such that there are two zero bits
+//! between each pair of consecutive bits.
+//! \details Interleaving three spread coordinates gives their 63-bit Morton
+//! code, i.e., the position along a Z-order curve.
+inline std::uint64_t spread_bits(std::uint64_t x)
+{
+    x &= 0x1fffff;
+    x = (x | x << 32) & 0x1f00000000ffff;
+    x = (x | x << 16) & 0x1f0000ff0000ff;
+    x = (x | x << 8) & 0x100f00f00f00f00f;
+    x = (x | x << 4) & 0x10c30c30c30c30c3;
+    x = (x | x << 2) & 0x1249249249249249;
+    return x;
+}
+
+//! @}
+
+} // namespace pmp
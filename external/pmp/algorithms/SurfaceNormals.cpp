@@ -3,15 +3,19 @@
 
 #include "pmp/algorithms/SurfaceNormals.h"
 
+#include <cstdint>
+
 namespace pmp {
 
-Normal SurfaceNormals::compute_face_normal(const SurfaceMesh& mesh, Face f)
+namespace {
+
+// normal of face f (see SurfaceNormals::compute_face_normal())
+Normal face_normal(const SurfaceMesh& mesh, const VertexProperty<Point>& vpoint,
+                   Face f)
 {
     Halfedge h = mesh.halfedge(f);
     Halfedge hend = h;
 
-    auto vpoint = mesh.get_vertex_property<Point>("v:point");
-
     Point p0 = vpoint[mesh.to_vertex(h)];
     h = mesh.next_halfedge(h);
     Point p1 = vpoint[mesh.to_vertex(h)];
@@ -42,19 +46,23 @@ Normal SurfaceNormals::compute_face_normal(const SurfaceMesh& mesh, Face f)
     }
 }
 
-Normal SurfaceNormals::compute_vertex_normal(const SurfaceMesh& mesh, Vertex v)
+// Angle-weighted average of the normals of the faces incident to v, where
+// normal_of(h, p1, p2) returns the normal of the (non-boundary) face of h,
+// given the two edges p1, p2 of the corner.
+template <class FaceNormal>
+Normal vertex_normal(const SurfaceMesh& mesh,
+                     const VertexProperty<Point>& vpoint, Vertex v,
+                     FaceNormal normal_of)
 {
     Point nn(0, 0, 0);
 
     if (!mesh.is_isolated(v))
     {
-        auto vpoint = mesh.get_vertex_property<Point>("v:point");
         const Point p0 = vpoint[v];
 
         Normal n;
         Point p1, p2;
         Scalar cosine, angle, denom;
-        bool is_triangle;
 
         for (auto h : mesh.halfedges(v))
         {
@@ -76,12 +84,7 @@ Normal SurfaceNormals::compute_vertex_normal(const SurfaceMesh& mesh, Vertex v)
                         cosine = 1.0;
                     angle = acos(cosine);
 
-                    // compute triangle or polygon normal
-                    is_triangle = (mesh.next_halfedge(mesh.next_halfedge(
-                                       mesh.next_halfedge(h))) == h);
-                    n = is_triangle ? normalize(cross(p1, p2))
-                                    : compute_face_normal(mesh, mesh.face(h));
-
+                    n = normal_of(h, p1, p2);
                     n *= angle;
                     nn += n;
                 }
@@ -94,15 +97,15 @@ Normal SurfaceNormals::compute_vertex_normal(const SurfaceMesh& mesh, Vertex v)
     return nn;
 }
 
-Normal SurfaceNormals::compute_corner_normal(const SurfaceMesh& mesh,
-                                             Halfedge h, Scalar crease_angle)
+// Angle-weighted average of the normals of the faces incident to the
+// target vertex of h that are within the crease angle of h's face, where
+// normal_of(h, p1, p2) returns the normal of the (non-boundary) face of h,
+// given the two edges p1, p2 of the corner.
+template <class FaceNormal>
+Normal corner_normal(const SurfaceMesh& mesh,
+                     const VertexProperty<Point>& vpoint, Halfedge h,
+                     Scalar crease_angle, FaceNormal normal_of)
 {
-    // catch the two trivial cases
-    if (crease_angle < 0.01)
-        return compute_face_normal(mesh, mesh.face(h));
-    else if (crease_angle > 179)
-        return compute_vertex_normal(mesh, mesh.from_vertex(h));
-
     // avoid numerical problems
     if (crease_angle < 0.001)
         crease_angle = 0.001;
@@ -112,18 +115,19 @@ Normal SurfaceNormals::compute_corner_normal(const SurfaceMesh& mesh,
 
     if (!mesh.is_boundary(h))
     {
-        auto vpoint = mesh.get_vertex_property<Point>("v:point");
-
         const Halfedge hend = h;
         const Vertex v0 = mesh.to_vertex(h);
         const Point p0 = vpoint[v0];
 
         Point n, p1, p2;
         Scalar cosine, angle, denom;
-        bool is_triangle;
 
         // compute normal of h's face
-        const Point nf = compute_face_normal(mesh, mesh.face(h));
+        p1 = vpoint[mesh.to_vertex(mesh.next_halfedge(h))];
+        p1 -= p0;
+        p2 = vpoint[mesh.from_vertex(h)];
+        p2 -= p0;
+        const Point nf = normal_of(h, p1, p2);
 
         // average over all incident faces
         do
@@ -135,11 +139,7 @@ Normal SurfaceNormals::compute_corner_normal(const SurfaceMesh& mesh,
                 p2 = vpoint[mesh.from_vertex(h)];
                 p2 -= p0;
 
-                // compute triangle or polygon normal
-                is_triangle = (mesh.next_halfedge(mesh.next_halfedge(
-                                   mesh.next_halfedge(h))) == h);
-                n = is_triangle ? normalize(cross(p1, p2))
-                                : compute_face_normal(mesh, mesh.face(h));
+                n = normal_of(h, p1, p2);
 
                 // check whether normal is withing crease_angle bound
                 if (dot(n, nf) >= cos_crease_angle)
@@ -170,18 +170,110 @@ Normal SurfaceNormals::compute_corner_normal(const SurfaceMesh& mesh,
     return nn;
 }
 
+} // namespace
+
+Normal SurfaceNormals::compute_face_normal(const SurfaceMesh& mesh, Face f)
+{
+    return face_normal(mesh, mesh.get_vertex_property<Point>("v:point"), f);
+}
+
+Normal SurfaceNormals::compute_vertex_normal(const SurfaceMesh& mesh, Vertex v)
+{
+    // compute triangle normals from the two corner edges p1, p2
+    auto normal_of = [&](Halfedge fh, const Point& p1, const Point& p2) {
+        const bool is_triangle = (mesh.next_halfedge(mesh.next_halfedge(
+                                      mesh.next_halfedge(fh))) == fh);
+        return is_triangle ? normalize(cross(p1, p2))
+                           : compute_face_normal(mesh, mesh.face(fh));
+    };
+    return vertex_normal(mesh, mesh.get_vertex_property<Point>("v:point"), v,
+                         normal_of);
+}
+
+Normal SurfaceNormals::compute_vertex_normal(
+    const SurfaceMesh& mesh, Vertex v, const FaceProperty<Normal>& fnormal)
+{
+    auto normal_of = [&](Halfedge fh, const Point&, const Point&) {
+        return fnormal[mesh.face(fh)];
+    };
+    return vertex_normal(mesh, mesh.get_vertex_property<Point>("v:point"), v,
+                         normal_of);
+}
+
+Normal SurfaceNormals::compute_corner_normal(const SurfaceMesh& mesh,
+                                             Halfedge h, Scalar crease_angle)
+{
+    // catch the two trivial cases
+    if (crease_angle < 0.01)
+        return compute_face_normal(mesh, mesh.face(h));
+    else if (crease_angle > 179)
+        return compute_vertex_normal(mesh, mesh.to_vertex(h));
+
+    // compute triangle normals from the two corner edges p1, p2
+    auto normal_of = [&](Halfedge fh, const Point& p1, const Point& p2) {
+        const bool is_triangle = (mesh.next_halfedge(mesh.next_halfedge(
+                                      mesh.next_halfedge(fh))) == fh);
+        return is_triangle ? normalize(cross(p1, p2))
+                           : compute_face_normal(mesh, mesh.face(fh));
+    };
+    return corner_normal(mesh, mesh.get_vertex_property<Point>("v:point"), h,
+                         crease_angle, normal_of);
+}
+
+Normal SurfaceNormals::compute_corner_normal(
+    const SurfaceMesh& mesh, Halfedge h, Scalar crease_angle,
+    const FaceProperty<Normal>& fnormal)
+{
+    // catch the two trivial cases
+    if (crease_angle < 0.01)
+        return fnormal[mesh.face(h)];
+    else if (crease_angle > 179)
+        return compute_vertex_normal(mesh, mesh.to_vertex(h), fnormal);
+
+    auto normal_of = [&](Halfedge fh, const Point&, const Point&) {
+        return fnormal[mesh.face(fh)];
+    };
+    return corner_normal(mesh, mesh.get_vertex_property<Point>("v:point"), h,
+                         crease_angle, normal_of);
+}
+
 void SurfaceNormals::compute_vertex_normals(SurfaceMesh& mesh)
 {
+    // face normals once, then vertex normals from the cached ones
+    compute_face_normals(mesh);
+    const auto fnormal = mesh.get_face_property<Normal>("f:normal");
+    const auto vpoint = mesh.get_vertex_property<Point>("v:point");
     auto vnormal = mesh.vertex_property<Normal>("v:normal");
-    for (auto v : mesh.vertices())
-        vnormal[v] = compute_vertex_normal(mesh, v);
+
+    auto normal_of = [&](Halfedge fh, const Point&, const Point&) {
+        return fnormal[mesh.face(fh)];
+    };
+
+    using Index = std::int64_t;
+    const Index n = mesh.vertices_size();
+#pragma omp parallel for schedule(static, 1024)
+    for (Index i = 0; i < n; ++i)
+    {
+        const Vertex v(static_cast<IndexType>(i));
+        if (!mesh.is_deleted(v))
+            vnormal[v] = vertex_normal(mesh, vpoint, v, normal_of);
+    }
 }
 
 void SurfaceNormals::compute_face_normals(SurfaceMesh& mesh)
 {
+    const auto vpoint = mesh.get_vertex_property<Point>("v:point");
     auto fnormal = mesh.face_property<Normal>("f:normal");
-    for (auto f : mesh.faces())
-        fnormal[f] = compute_face_normal(mesh, f);
+
+    using Index = std::int64_t;
+    const Index n = mesh.faces_size();
+#pragma omp parallel for schedule(static, 1024)
+    for (Index i = 0; i < n; ++i)
+    {
+        const Face f(static_cast<IndexType>(i));
+        if (!mesh.is_deleted(f))
+            fnormal[f] = face_normal(mesh, vpoint, f);
+    }
 }
 
 } // namespace pmp
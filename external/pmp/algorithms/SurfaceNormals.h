@@ -16,8 +16,10 @@ namespace pmp {
 //! \li per corner: compute_corner_normal()
 //!
 //! The convenience functions compute_vertex_normals() and compute_face_normals()
-//! compute the normals for the whole mesh and add a corresponding vertex or
-//! face property.
+//! compute the normals for the whole mesh in parallel and add a corresponding
+//! vertex or face property. The overloads taking a face property use
+//! precomputed face normals instead of evaluating each face for each of its
+//! corners.
 //! \ingroup algorithms
 class SurfaceNormals
 {
@@ -27,8 +29,10 @@ public:
     SurfaceNormals(const SurfaceNormals&) = delete;
 
     //! \brief Compute vertex normals for the whole \p mesh.
-    //! \details Calls compute_vertex_normal() for each vertex and adds a new
-    //! vertex property of type Normal named "v:normal".
+    //! \details First computes the face normals by compute_face_normals(),
+    //! then the vertex normals from these, and stores them in a vertex
+    //! property of type Normal named "v:normal". Both the face property
+    //! "f:normal" and the vertex property are added if not yet present.
     static void compute_vertex_normals(SurfaceMesh& mesh);
 
     //! \brief Compute face normals for the whole \p mesh.
@@ -39,6 +43,11 @@ public:
     //! \brief Compute the normal vector of vertex \p v.
     static Normal compute_vertex_normal(const SurfaceMesh& mesh, Vertex v);
 
+    //! \brief Compute the normal vector of vertex \p v from the precomputed
+    //! face normals \p fnormal.
+    static Normal compute_vertex_normal(const SurfaceMesh& mesh, Vertex v,
+                                        const FaceProperty<Normal>& fnormal);
+
     //! \brief Compute the normal vector of face \p f.
     //! \details Normal is computed as (normalized) sum of per-corner
     //! cross products of the two incident edges. This corresponds to
@@ -51,6 +60,14 @@ public:
     //! of the face normal. \p crease_angle is in radians, not degrees.
     static Normal compute_corner_normal(const SurfaceMesh& mesh, Halfedge h,
                                         Scalar crease_angle);
+
+    //! \brief Compute the normal vector of the polygon corner specified by the
+    //! target vertex of halfedge \p h from the precomputed face normals
+    //! \p fnormal.
+    //! \details \p crease_angle is in radians, not degrees.
+    static Normal compute_corner_normal(const SurfaceMesh& mesh, Halfedge h,
+                                        Scalar crease_angle,
+                                        const FaceProperty<Normal>& fnormal);
 };
 
 } // namespace pmp
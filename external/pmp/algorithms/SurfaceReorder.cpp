@@ -0,0 +1,253 @@
+// Copyright 2011-2020 the Polygon Mesh Processing Library developers.
+// Distributed under a MIT-style license, see LICENSE.txt for details.
+
+#include "pmp/algorithms/SurfaceReorder.h"
+#include "pmp/algorithms/Morton.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <utility>
+
+namespace pmp {
+
+namespace {
+
+using Index = std::int64_t;
+
+// number of bits per coordinate of the space-filling curve keys
+const int n_bits = 21;
+
+// interleave the bits of the three coordinates, x being most significant
+std::uint64_t interleave(const std::uint32_t x[3])
+{
+    return spread_bits(x[0]) << 2 | spread_bits(x[1]) << 1 | spread_bits(x[2]);
+}
+
+// Transform integer coordinates to the "transposed" Hilbert index, whose
+// interleaved bits are the position along the Hilbert curve
+// (J. Skilling, Programming the Hilbert curve, AIP Conf. Proc. 707, 2004).
+void hilbert_transpose(std::uint32_t x[3])
+{
+    const std::uint32_t m = 1u << (n_bits - 1);
+
+    // inverse undo
+    for (std::uint32_t q = m; q > 1; q >>= 1)
+    {
+        const std::uint32_t p = q - 1;
+        for (int i = 0; i < 3; ++i)
+        {
+            // if bit q of x[i] is set, invert the low bits of x[0],
+            // otherwise exchange them with x[i] (without branching on the
+            // bits, which are unpredictable)
+            const std::uint32_t set = 0u - ((x[i] & q) != 0);
+            const std::uint32_t t = (x[0] ^ x[i]) & p & ~set;
+            x[0] ^= (p & set) | t;
+            x[i] ^= t;
+        }
+    }
+
+    // Gray encode
+    x[1] ^= x[0];
+    x[2] ^= x[1];
+    std::uint32_t t = 0;
+    for (std::uint32_t q = m; q > 1; q >>= 1)
+        if (x[2] & q)
+            t ^= q - 1;
+    for (int i = 0; i < 3; ++i)
+        x[i] ^= t;
+}
+
+// sort the vertices along a space-filling curve through their positions
+std::vector<IndexType> curve_order(const SurfaceMesh& mesh, bool hilbert)
+{
+    const Index n = mesh.vertices_size();
+    BoundingBox bb = mesh.bounds();
+    const Point bmin = bb.min();
+    const Point ext = bb.max() - bb.min();
+    const Scalar extent = std::max({ext[0], ext[1], ext[2], Scalar(1e-20)});
+    const double scale = double((1u << n_bits) - 1) / extent;
+
+    std::vector<std::pair<std::uint64_t, IndexType>> keys(n);
+#pragma omp parallel for
+    for (Index i = 0; i < n; ++i)
+    {
+        const Point& p = mesh.position(Vertex(IndexType(i)));
+        std::uint32_t x[3];
+        for (int j = 0; j < 3; ++j)
+            x[j] = std::uint32_t(std::max(0.0, (p[j] - bmin[j]) * scale));
+        if (hilbert)
+            hilbert_transpose(x);
+        keys[i] = std::make_pair(interleave(x), IndexType(i));
+    }
+
+    std::sort(keys.begin(), keys.end());
+
+    std::vector<IndexType> order(n);
+    for (Index i = 0; i < n; ++i)
+        order[i] = keys[i].second;
+    return order;
+}
+
+// reverse Cuthill-McKee ordering of the vertex adjacency graph, starting
+// each connected component at a pseudo-peripheral vertex
+std::vector<IndexType> rcm_order(const SurfaceMesh& mesh)
+{
+    const Index n = mesh.vertices_size();
+
+    // adjacency in compressed rows
+    std::vector<IndexType> begin(n + 1, 0);
+#pragma omp parallel for
+    for (Index i = 0; i < n; ++i)
+        begin[i + 1] = mesh.valence(Vertex(IndexType(i)));
+    for (Index i = 0; i < n; ++i)
+        begin[i + 1] += begin[i];
+    std::vector<IndexType> neighbors(begin[n]);
+#pragma omp parallel for
+    for (Index i = 0; i < n; ++i)
+    {
+        IndexType j = begin[i];
+        for (auto w : mesh.vertices(Vertex(IndexType(i))))
+            neighbors[j++] = w.idx();
+    }
+    auto degree = [&](IndexType v) { return begin[v + 1] - begin[v]; };
+
+    // Breadth-first search from v through the vertices that are not yet
+    // ordered, marking them with stamp and appending them to queue. Returns
+    // the number of levels and the position of the last level in queue.
+    const Index ordered = -2;
+    std::vector<Index> mark(n, -1);
+    auto bfs = [&](IndexType v, Index stamp, std::vector<IndexType>& queue,
+                   size_t& last_level) {
+        size_t levels = 1;
+        last_level = queue.size();
+        size_t level_end = queue.size() + 1;
+        queue.push_back(v);
+        mark[v] = stamp;
+        for (size_t head = last_level; head < queue.size();)
+        {
+            if (head == level_end)
+            {
+                ++levels;
+                last_level = head;
+                level_end = queue.size();
+            }
+            const IndexType u = queue[head++];
+            const size_t first = queue.size();
+            for (IndexType j = begin[u]; j < begin[u + 1]; ++j)
+            {
+                const IndexType w = neighbors[j];
+                if (mark[w] != stamp && mark[w] != ordered)
+                {
+                    mark[w] = stamp;
+                    queue.push_back(w);
+                }
+            }
+            // Cuthill-McKee: visit neighbors by increasing degree
+            std::sort(queue.begin() + first, queue.end(),
+                      [&](IndexType a, IndexType b) {
+                          return degree(a) < degree(b);
+                      });
+        }
+        return levels;
+    };
+
+    std::vector<IndexType> order, probe;
+    order.reserve(n);
+    Index stamp = 0;
+    size_t last_level;
+    for (Index i = 0; i < n; ++i)
+    {
+        if (mark[i] == ordered)
+            continue;
+
+        // find a pseudo-peripheral start vertex (George and Liu): move to
+        // a vertex of minimal degree in the last level as long as the
+        // number of levels increases
+        IndexType start = IndexType(i);
+        size_t levels = 0;
+        for (int iter = 0; iter < 8; ++iter)
+        {
+            probe.clear();
+            const size_t n_levels = bfs(start, stamp++, probe, last_level);
+            if (n_levels <= levels)
+                break;
+            levels = n_levels;
+            start = *std::min_element(probe.begin() + last_level, probe.end(),
+                                      [&](IndexType a, IndexType b) {
+                                          return degree(a) < degree(b);
+                                      });
+        }
+
+        bfs(start, ordered, order, last_level);
+    }
+
+    std::reverse(order.begin(), order.end());
+    return order;
+}
+
+// stable counting sort of the elements 0..key.size()-1 by their key
+std::vector<IndexType> order_by_key(const std::vector<IndexType>& key,
+                                    size_t n_keys)
+{
+    std::vector<IndexType> count(n_keys + 1, 0);
+    for (auto k : key)
+        ++count[k + 1];
+    for (size_t k = 0; k < n_keys; ++k)
+        count[k + 1] += count[k];
+    std::vector<IndexType> order(key.size());
+    for (size_t i = 0; i < key.size(); ++i)
+        order[count[key[i]]++] = IndexType(i);
+    return order;
+}
+
+} // namespace
+
+void reorder(SurfaceMesh& mesh, ReorderStrategy strategy)
+{
+    mesh.garbage_collection();
+
+    const Index nv = mesh.vertices_size();
+    const Index ne = mesh.edges_size();
+    const Index nf = mesh.faces_size();
+
+    std::vector<IndexType> vorder;
+    switch (strategy)
+    {
+        case ReorderStrategy::Morton:
+            vorder = curve_order(mesh, false);
+            break;
+        case ReorderStrategy::Hilbert:
+            vorder = curve_order(mesh, true);
+            break;
+        case ReorderStrategy::RCM:
+            vorder = rcm_order(mesh);
+            break;
+    }
+
+    std::vector<IndexType> vmap(nv);
+#pragma omp parallel for
+    for (Index i = 0; i < nv; ++i)
+        vmap[vorder[i]] = IndexType(i);
+
+    // edges and faces follow their first vertex in the new order
+    std::vector<IndexType> ekey(ne), fkey(nf);
+#pragma omp parallel for
+    for (Index i = 0; i < ne; ++i)
+    {
+        const auto e = static_cast<Edge>(IndexType(i));
+        ekey[i] = std::min(vmap[mesh.vertex(e, 0).idx()],
+                           vmap[mesh.vertex(e, 1).idx()]);
+    }
+#pragma omp parallel for
+    for (Index i = 0; i < nf; ++i)
+    {
+        IndexType k = PMP_MAX_INDEX;
+        for (auto v : mesh.vertices(Face(IndexType(i))))
+            k = std::min(k, vmap[v.idx()]);
+        fkey[i] = k;
+    }
+
+    mesh.permute(vorder, order_by_key(ekey, nv), order_by_key(fkey, nv));
+}
+
+} // namespace pmp
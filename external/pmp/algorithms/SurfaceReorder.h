@@ -0,0 +1,35 @@
+// Copyright 2011-2020 the Polygon Mesh Processing Library developers.
+// Distributed under a MIT-style license, see LICENSE.txt for details.
+
+#pragma once
+
+#include "pmp/SurfaceMesh.h"
+
+namespace pmp {
+
+//! \brief Vertex orderings used by reorder().
+//! \ingroup algorithms
+enum class ReorderStrategy
+{
+    Morton,  //!< Z-order curve through the vertex positions
+    Hilbert, //!< Hilbert curve through the vertex positions
+    RCM      //!< reverse Cuthill-McKee ordering of the vertex graph
+};
+
+//! \brief Reorder the elements of \p mesh for better memory locality.
+//! \details Mesh extraction algorithms such as marching cubes or Poisson
+//! reconstruction emit vertices and faces in the order in which they visit
+//! cells, such that neighboring elements are often far apart in memory.
+//! This function sorts the vertices along a space-filling curve (Morton,
+//! Hilbert) or by the reverse Cuthill-McKee algorithm, which minimizes the
+//! bandwidth of the vertex adjacency. Faces and edges are then sorted by
+//! their smallest new vertex index, such that circulators and property
+//! lookups access nearby memory. All vertex, halfedge, edge, and face
+//! properties are permuted consistently. Deleted elements are removed by
+//! garbage_collection() first.
+//! \sa SurfaceMesh::permute()
+//! \ingroup algorithms
+void reorder(SurfaceMesh& mesh,
+             ReorderStrategy strategy = ReorderStrategy::Hilbert);
+
+} // namespace pmp
@@ -0,0 +1,378 @@
+// Copyright 2011-2020 the Polygon Mesh Processing Library developers.
+// Distributed under a MIT-style license, see LICENSE.txt for details.
+
+#include "pmp/algorithms/SurfaceSimplification.h"
+
+#include <cassert>
+#include <cmath>
+#include <algorithm>
+#include <cstdint>
+
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+#include "pmp/algorithms/Heap.h"
+#include "pmp/algorithms/SurfaceNormals.h"
+#include "pmp/Timer.h"
+
+namespace pmp {
+
+namespace {
+
+using Index = std::int64_t;
+
+// regions have at least this many vertices
+const size_t min_region_size = 1000;
+
+// heap interface for the vertex priority queue
+class HeapInterface
+{
+public:
+    HeapInterface(VertexProperty<double> priority, VertexProperty<int> pos)
+        : priority_(priority), pos_(pos)
+    {
+    }
+
+    bool less(Vertex v0, Vertex v1) { return priority_[v0] < priority_[v1]; }
+    bool greater(Vertex v0, Vertex v1) { return priority_[v0] > priority_[v1]; }
+    int get_heap_position(Vertex v) { return pos_[v]; }
+    void set_heap_position(Vertex v, int pos) { pos_[v] = pos; }
+
+private:
+    VertexProperty<double> priority_;
+    VertexProperty<int> pos_;
+};
+
+using PriorityQueue = Heap<Vertex, HeapInterface>;
+
+} // namespace
+
+SurfaceSimplification::SurfaceSimplification(SurfaceMesh& mesh) : mesh_(mesh)
+{
+    if (!mesh_.is_triangle_mesh())
+        throw InvalidInputException("Input is not a triangle mesh!");
+    vpoint_ = mesh_.vertex_property<Point>("v:point");
+}
+
+void SurfaceSimplification::simplify(size_t n_faces, Scalar max_error,
+                                     bool parallel)
+{
+    Timer timer;
+    timer.start();
+    statistics_ = SimplificationStatistics();
+
+    mesh_.garbage_collection();
+    const Index nv = mesh_.vertices_size();
+    const Index nf = mesh_.faces_size();
+    const double max_quadric_error =
+        max_error < std::sqrt(std::numeric_limits<double>::max())
+            ? double(max_error) * double(max_error)
+            : std::numeric_limits<double>::max();
+
+    vquadric_ = mesh_.add_vertex_property<Quadric>("v:quadric");
+    vpriority_ = mesh_.add_vertex_property<double>("v:simplification_priority");
+    vtarget_ = mesh_.add_vertex_property<Halfedge>("v:simplification_target");
+    vheap_ = mesh_.add_vertex_property<int>("v:simplification_heap", -1);
+    locked_.assign(nv, 0);
+
+    // quadrics of the face planes, summed per vertex
+    std::vector<Normal> fnormal(nf);
+#pragma omp parallel for
+    for (Index i = 0; i < nf; ++i)
+        fnormal[i] =
+            SurfaceNormals::compute_face_normal(mesh_, Face(IndexType(i)));
+#pragma omp parallel for
+    for (Index i = 0; i < nv; ++i)
+    {
+        const auto v = static_cast<Vertex>(IndexType(i));
+        Quadric q;
+        for (auto f : mesh_.faces(v))
+            q += Quadric(fnormal[f.idx()], vpoint_[v]);
+        vquadric_[v] = q;
+    }
+    std::vector<Normal>().swap(fnormal);
+
+    std::vector<Vertex> vertices(mesh_.vertices().begin(),
+                                 mesh_.vertices().end());
+
+    // parallel rounds with changing regions, as long as they make progress
+    int n_threads = 1;
+#ifdef _OPENMP
+    n_threads = omp_get_max_threads();
+#endif
+    unsigned int levels = 0;
+    while ((size_t(2) << levels) <= size_t(2 * n_threads) &&
+           vertices.size() >> (levels + 1) >= min_region_size)
+        ++levels;
+    if (n_threads < 2 || levels == 0)
+        parallel = false;
+
+    size_t n_current = mesh_.n_faces();
+    std::vector<size_t> bounds;
+    for (unsigned int round = 0; parallel && n_current > n_faces; ++round)
+    {
+        const size_t n_excess = n_current - n_faces;
+        const size_t n_regions = partition(vertices, levels, round, bounds);
+
+        // Each region removes the share of the excess faces of its unlocked
+        // vertices, such that all unlocked parts are decimated at the same
+        // rate. The locked borders remain for later rounds.
+        size_t n_removed = 0, n_collapses = 0;
+        const auto n = Index(n_regions);
+#pragma omp parallel for schedule(dynamic) reduction(+ : n_removed, n_collapses)
+        for (Index r = 0; r < n; ++r)
+        {
+            std::vector<Vertex> region;
+            region.reserve(bounds[r + 1] - bounds[r]);
+            for (size_t i = bounds[r]; i < bounds[r + 1]; ++i)
+                if (!locked_[vertices[i].idx()])
+                    region.push_back(vertices[i]);
+            const size_t n_remove = size_t(
+                double(n_excess) * region.size() / vertices.size() + 0.5);
+            n_removed += decimate(region, n_remove, max_quadric_error, true,
+                                  n_collapses);
+        }
+
+        statistics_.parallel_collapses += n_collapses;
+        statistics_.collapses += n_collapses;
+        statistics_.regions = (unsigned int)n_regions;
+        ++statistics_.rounds;
+        n_current -= std::min(n_current, n_removed);
+
+        // the rest is left to the serial pass once the regions hardly make
+        // progress
+        if (n_removed < n_excess / 4 || n_current < n_faces + n_faces / 100)
+            break;
+
+        vertices.erase(std::remove_if(vertices.begin(), vertices.end(),
+                                      [&](Vertex v) {
+                                          return mesh_.is_deleted(v);
+                                      }),
+                       vertices.end());
+    }
+
+    // serial pass over all vertices to reach the exact target
+    if (n_current > n_faces)
+    {
+        std::fill(locked_.begin(), locked_.end(), 0);
+        vertices.erase(std::remove_if(vertices.begin(), vertices.end(),
+                                      [&](Vertex v) {
+                                          return mesh_.is_deleted(v);
+                                      }),
+                       vertices.end());
+        decimate(vertices, n_current - n_faces, max_quadric_error, false,
+                 statistics_.collapses);
+    }
+
+    mesh_.remove_vertex_property(vquadric_);
+    mesh_.remove_vertex_property(vpriority_);
+    mesh_.remove_vertex_property(vtarget_);
+    mesh_.remove_vertex_property(vheap_);
+    std::vector<char>().swap(locked_);
+    std::vector<int>().swap(region_);
+
+    mesh_.garbage_collection();
+
+    timer.stop();
+    statistics_.seconds = timer.elapsed() / 1000.0;
+}
+
+size_t SurfaceSimplification::partition(std::vector<Vertex>& vertices,
+                                        unsigned int levels,
+                                        unsigned int round,
+                                        std::vector<size_t>& bounds)
+{
+    // recursive median cuts, the cut axis cycles with depth and round
+    bounds.assign(1, 0);
+    bounds.push_back(vertices.size());
+    for (unsigned int level = 0; level < levels; ++level)
+    {
+        const int axis = (level + round) % 3;
+        std::vector<size_t> split(1, 0);
+        for (size_t i = 0; i + 1 < bounds.size(); ++i)
+        {
+            const auto begin = vertices.begin() + bounds[i];
+            const auto end = vertices.begin() + bounds[i + 1];
+            const auto middle = begin + (end - begin) / 2;
+            std::nth_element(begin, middle, end, [&](Vertex a, Vertex b) {
+                return vpoint_[a][axis] < vpoint_[b][axis];
+            });
+            split.push_back(middle - vertices.begin());
+            split.push_back(bounds[i + 1]);
+        }
+        bounds.swap(split);
+    }
+    const size_t n_regions = bounds.size() - 1;
+
+    // regions of the vertices
+    region_.assign(mesh_.vertices_size(), -1);
+    for (size_t r = 0; r < n_regions; ++r)
+        for (size_t i = bounds[r]; i < bounds[r + 1]; ++i)
+            region_[vertices[i].idx()] = int(r);
+
+    // Lock the vertices with a neighbor in another region and their
+    // neighbors. A collapse of an unlocked vertex then only modifies faces
+    // whose vertices are all in its region and not at the border, while
+    // other threads only read faces with a vertex in their own region.
+    const auto n = Index(vertices.size());
+    std::fill(locked_.begin(), locked_.end(), 0);
+#pragma omp parallel for
+    for (Index i = 0; i < n; ++i)
+    {
+        const Vertex v = vertices[i];
+        for (auto w : mesh_.vertices(v))
+        {
+            if (region_[w.idx()] != region_[v.idx()])
+            {
+                locked_[v.idx()] = 2;
+                break;
+            }
+        }
+    }
+#pragma omp parallel for
+    for (Index i = 0; i < n; ++i)
+    {
+        const Vertex v = vertices[i];
+        if (locked_[v.idx()])
+            continue;
+        for (auto w : mesh_.vertices(v))
+        {
+            if (locked_[w.idx()] == 2)
+            {
+                locked_[v.idx()] = 1;
+                break;
+            }
+        }
+    }
+
+    return n_regions;
+}
+
+size_t SurfaceSimplification::decimate(const std::vector<Vertex>& vertices,
+                                       size_t n_remove, double max_error,
+                                       bool concurrent, size_t& collapses)
+{
+    PriorityQueue queue(HeapInterface(vpriority_, vheap_));
+
+    // find the best collapse of v and update its position in the queue
+    auto enqueue = [&](Vertex v) {
+        if (locked_[v.idx()])
+            return;
+
+        Halfedge target;
+        double min_error = std::numeric_limits<double>::max();
+        for (auto h : mesh_.halfedges(v))
+        {
+            if (!is_collapse_legal(h))
+                continue;
+            const Vertex w = mesh_.to_vertex(h);
+            Quadric q = vquadric_[v];
+            q += vquadric_[w];
+            const double error = q(vpoint_[w]);
+            if (error < min_error)
+            {
+                min_error = error;
+                target = h;
+            }
+        }
+
+        vtarget_[v] = target;
+        if (target.is_valid())
+        {
+            vpriority_[v] = min_error;
+            if (queue.is_stored(v))
+                queue.update(v);
+            else
+                queue.insert(v);
+        }
+        else if (queue.is_stored(v))
+        {
+            queue.remove(v);
+        }
+    };
+
+    queue.reserve((unsigned int)vertices.size());
+    for (auto v : vertices)
+        vheap_[v] = -1;
+    for (auto v : vertices)
+        enqueue(v);
+
+    size_t removed = 0;
+    while (removed < n_remove && !queue.empty())
+    {
+        const Vertex v0 = queue.front();
+        if (vpriority_[v0] > max_error)
+            break;
+        queue.pop_front();
+
+        // the neighborhood may have changed since the priority was computed
+        const Halfedge h = vtarget_[v0];
+        if (!is_collapse_legal(h))
+        {
+            enqueue(v0);
+            continue;
+        }
+
+        const Vertex v1 = mesh_.to_vertex(h);
+        removed += !mesh_.is_boundary(h) +
+                   !mesh_.is_boundary(mesh_.opposite_halfedge(h));
+        vquadric_[v1] += vquadric_[v0];
+
+        // the deletion flags and counters of the mesh are shared
+        if (concurrent)
+        {
+#pragma omp critical(pmp_simplification_collapse)
+            mesh_.collapse(h);
+        }
+        else
+        {
+            mesh_.collapse(h);
+        }
+        ++collapses;
+
+        // the errors of v1 and its neighbors have changed
+        enqueue(v1);
+        for (auto v : mesh_.vertices(v1))
+            enqueue(v);
+    }
+
+    return removed;
+}
+
+bool SurfaceSimplification::is_collapse_legal(Halfedge v0v1) const
+{
+    const Vertex v0 = mesh_.from_vertex(v0v1);
+    const Vertex v1 = mesh_.to_vertex(v0v1);
+
+    // locked vertices stay, boundary vertices move along the boundary
+    if (locked_[v0.idx()])
+        return false;
+    if (mesh_.is_boundary(v0) && !mesh_.is_boundary(v1))
+        return false;
+    if (!mesh_.is_collapse_ok(v0v1))
+        return false;
+
+    // the faces that remain must not flip or degenerate
+    const Point& p0 = vpoint_[v0];
+    const Point& p1 = vpoint_[v1];
+    for (auto h : mesh_.halfedges(v0))
+    {
+        if (mesh_.is_boundary(h))
+            continue;
+        const Vertex va = mesh_.to_vertex(h);
+        const Vertex vb = mesh_.to_vertex(mesh_.next_halfedge(h));
+        if (va == v1 || vb == v1)
+            continue;
+        const Point& pa = vpoint_[va];
+        const Point& pb = vpoint_[vb];
+        const Normal n0 = cross(pa - p0, pb - p0);
+        const Normal n1 = cross(pa - p1, pb - p1);
+        if (sqrnorm(n1) == 0 || dot(n0, n1) < 0)
+            return false;
+    }
+
+    return true;
+}
+
+} // namespace pmp
@@ -0,0 +1,103 @@
+// Copyright 2011-2020 the Polygon Mesh Processing Library developers.
+// Distributed under a MIT-style license, see LICENSE.txt for details.
+
+#pragma once
+
+#include <limits>
+#include <vector>
+
+#include "pmp/SurfaceMesh.h"
+#include "pmp/algorithms/Quadric.h"
+
+namespace pmp {
+
+//! \brief Statistics of SurfaceSimplification::simplify().
+//! \ingroup algorithms
+struct SimplificationStatistics
+{
+    size_t collapses{0};          //!< number of halfedge collapses
+    size_t parallel_collapses{0}; //!< collapses done in parallel rounds
+    unsigned int rounds{0};       //!< number of parallel rounds
+    unsigned int regions{0};      //!< number of regions per parallel round
+    double seconds{0.0};          //!< run time of simplify()
+
+    //! collapse throughput
+    double collapses_per_second() const
+    {
+        return seconds > 0.0 ? collapses / seconds : 0.0;
+    }
+};
+
+//! \brief Mesh decimation by halfedge collapses based on error quadrics.
+//! \details Each vertex accumulates the quadric of the planes of its incident
+//! faces (M. Garland and P. Heckbert, Surface simplification using quadric
+//! error metrics, SIGGRAPH 1997). Vertices are collapsed into the neighbor
+//! that minimizes the summed quadric error, in order of increasing error, as
+//! long as the collapse keeps the mesh manifold, does not flip faces, and
+//! moves boundary vertices only along the boundary.
+//!
+//! In parallel mode (with OpenMP and more than one thread), the vertices are
+//! split into spatial regions by recursive median cuts. Each region is
+//! decimated by its own thread with its own priority queue. Vertices at the
+//! border between regions and their neighbors are locked, such that no two
+//! threads ever touch the same faces. The cut planes change from round to
+//! round, so formerly locked vertices are decimated in later rounds. A
+//! final serial pass over all vertices reaches the exact target.
+//! \ingroup algorithms
+class SurfaceSimplification
+{
+public:
+    //! \brief Construct with the \p mesh to be simplified.
+    //! \throw InvalidInputException if the input is not a triangle mesh.
+    explicit SurfaceSimplification(SurfaceMesh& mesh);
+
+    // delete copy constructor and assignment
+    SurfaceSimplification(const SurfaceSimplification&) = delete;
+    SurfaceSimplification& operator=(const SurfaceSimplification&) = delete;
+
+    //! \brief Collapse edges until the mesh has at most \p n_faces faces or
+    //! the error of every remaining collapse exceeds \p max_error.
+    //! \details The error of a collapse is the square root of the summed
+    //! quadric error, i.e., a root of the sum of squared distances to the
+    //! planes of the original faces. Deleted elements are removed by
+    //! garbage_collection() at the end.
+    //! \param n_faces target number of faces
+    //! \param max_error bound on the error of each collapse
+    //! \param parallel decimate spatial regions in parallel first
+    void simplify(size_t n_faces,
+                  Scalar max_error = std::numeric_limits<Scalar>::max(),
+                  bool parallel = true);
+
+    //! statistics of the last call of simplify()
+    const SimplificationStatistics& statistics() const { return statistics_; }
+
+private:
+    // Collapse the vertices in \p vertices in order of increasing error
+    // until \p n_remove faces have been removed or the error exceeds
+    // \p max_error. Locked vertices are skipped. Returns the number of
+    // removed faces, \p collapses is incremented for each collapse.
+    size_t decimate(const std::vector<Vertex>& vertices, size_t n_remove,
+                    double max_error, bool concurrent, size_t& collapses);
+
+    // split the vertices into regions and lock the vertices at their borders
+    size_t partition(std::vector<Vertex>& vertices, unsigned int levels,
+                     unsigned int round, std::vector<size_t>& bounds);
+
+    // is the collapse of halfedge \p v0v1 legal?
+    bool is_collapse_legal(Halfedge v0v1) const;
+
+    SurfaceMesh& mesh_;
+    SimplificationStatistics statistics_;
+
+    VertexProperty<Point> vpoint_;
+    VertexProperty<Quadric> vquadric_;
+    VertexProperty<double> vpriority_;
+    VertexProperty<Halfedge> vtarget_;
+    VertexProperty<int> vheap_;
+
+    // region of each vertex, and vertices locked during a parallel round
+    std::vector<int> region_;
+    std::vector<char> locked_;
+};
+
+} // namespace pmp
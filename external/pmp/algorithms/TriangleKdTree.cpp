@@ -3,28 +3,62 @@
 
 #include "pmp/algorithms/TriangleKdTree.h"
 
+#include <algorithm>
+#include <cstdint>
 #include <limits>
 
+#include "pmp/algorithms/DistanceKernels.h"
 #include "pmp/algorithms/DistancePointTriangle.h"
+#include "pmp/algorithms/Morton.h"
 #include "pmp/BoundingBox.h"
 
 namespace pmp {
 
-TriangleKdTree::TriangleKdTree(std::shared_ptr<const SurfaceMesh> mesh,
-                               unsigned int max_faces, unsigned int max_depth)
+namespace {
+
+// number of bins per axis of the SAH tree
+constexpr unsigned int n_bins = 16;
+
+// subtrees with at most this many faces are built by a single task
+constexpr IndexType task_faces = 4096;
+
+// half the surface area of a box
+Scalar half_area(BoundingBox& box)
+{
+    const Point d = box.max() - box.min();
+    return d[0] * d[1] + d[1] * d[2] + d[2] * d[0];
+}
+
+// squared distance of point p to the box [min, max]
+Scalar sqr_distance(const Point& min, const Point& max, const Point& p)
 {
-    // init
-    root_ = new Node();
-    root_->faces = new Faces();
+    Scalar d = 0;
+    for (int i = 0; i < 3; ++i)
+    {
+        const Scalar e = std::max({min[i] - p[i], p[i] - max[i], Scalar(0)});
+        d += e * e;
+    }
+    return d;
+}
 
-    // collect faces and points
-    root_->faces->reserve(mesh->n_faces());
-    face_points_.reserve(mesh->n_faces());
+} // namespace
+
+TriangleKdTree::TriangleKdTree(std::shared_ptr<const SurfaceMesh> mesh,
+                               unsigned int max_faces, unsigned int max_depth,
+                               BuildMethod method)
+{
+    // collect points of the faces
     auto points = mesh->get_vertex_property<Point>("v:point");
+    face_points_.resize(mesh->faces_size());
 
-    for (const auto& f : mesh->faces())
+    using Index = std::int64_t;
+    const Index nf = mesh->faces_size();
+#pragma omp parallel for schedule(static, 1024)
+    for (Index i = 0; i < nf; ++i)
     {
-        root_->faces->push_back(f);
+        const Face f(static_cast<IndexType>(i));
+        if (mesh->is_deleted(f))
+            continue;
 
         auto v = mesh->vertices(f);
         const auto& p0 = points[*v];
@@ -32,11 +66,43 @@ TriangleKdTree::TriangleKdTree(std::shared_ptr<const SurfaceMesh> mesh,
         const auto& p1 = points[*v];
         ++v;
         const auto& p2 = points[*v];
-        face_points_.push_back({p0, p1, p2});
+        face_points_[f.idx()] = {p0, p1, p2};
+    }
+
+    if (method == BuildMethod::Midpoint)
+    {
+        root_ = new Node();
+        root_->faces = new Faces(mesh->faces().begin(), mesh->faces().end());
+
+        // call recursive helper
+        build_recurse(root_, max_faces, max_depth);
+
+        // store leaves contiguously
+        gather_leaves(root_);
+    }
+    else
+    {
+        face_order_.reserve(mesh->n_faces());
+        for (const auto& f : mesh->faces())
+            face_order_.push_back(f.idx());
+
+        build_flat(max_faces, max_depth, method);
+    }
+
+    // pad for the distance kernels
+    if (!leaf_faces_.empty())
+    {
+        for (unsigned int i = 1; i < distance_kernel_max_width(); ++i)
+        {
+            for (auto& coords : leaf_points_)
+                coords.push_back(coords.back());
+        }
     }
 
-    // call recursive helper
-    build_recurse(root_, max_faces, max_depth);
+    // free memory
+    std::vector<std::array<Point, 3>>().swap(face_points_);
+    std::vector<Point>().swap(face_centroids_);
+    std::vector<IndexType>().swap(face_order_);
 }
 
 void TriangleKdTree::build_recurse(Node* node, unsigned int max_faces,
@@ -141,31 +207,388 @@ void TriangleKdTree::build_recurse(Node* node, unsigned int max_faces,
     }
 }
 
+void TriangleKdTree::gather_leaves(Node* node)
+{
+    ++n_nodes_;
+    if (node->left_child)
+    {
+        gather_leaves(node->left_child);
+        gather_leaves(node->right_child);
+        return;
+    }
+
+    node->begin = leaf_faces_.size();
+    for (const auto& f : *node->faces)
+    {
+        leaf_faces_.push_back(f);
+        const auto& pos = face_points_[f.idx()];
+        for (int i = 0; i < 3; ++i)
+            for (int j = 0; j < 3; ++j)
+                leaf_points_[3 * i + j].push_back(pos[i][j]);
+    }
+    node->end = leaf_faces_.size();
+
+    delete node->faces;
+    node->faces = nullptr;
+}
+
+void TriangleKdTree::build_flat(unsigned int max_faces, unsigned int max_depth,
+                                BuildMethod method)
+{
+    const auto n = IndexType(face_order_.size());
+    if (n == 0)
+        return;
+
+    face_centroids_.resize(face_points_.size());
+    using Index = std::int64_t;
+#pragma omp parallel for schedule(static, 1024)
+    for (Index i = 0; i < Index(n); ++i)
+    {
+        const auto& pos = face_points_[face_order_[i]];
+        face_centroids_[face_order_[i]] = (pos[0] + pos[1] + pos[2]) / 3;
+    }
+
+    // the top of the tree is split by tasks, which build small subtrees
+    // into their own arrays
+    std::vector<Subtree> subtrees;
+    nodes_.resize(1);
+#pragma omp parallel
+#pragma omp single
+    build_flat_task(0, 0, n, max_faces, max_depth, method, &subtrees);
+
+    // append the subtrees in the order of their faces, node i > 0 of a
+    // subtree becomes node offset + i
+    std::sort(subtrees.begin(), subtrees.end(),
+              [](const Subtree& a, const Subtree& b) {
+                  return a.begin < b.begin;
+              });
+    size_t size = nodes_.size();
+    for (const auto& subtree : subtrees)
+        size += subtree.nodes.size() - 1;
+    nodes_.reserve(size);
+    for (auto& subtree : subtrees)
+    {
+        const auto offset = IndexType(nodes_.size() - 1);
+        auto relocate = [offset](FlatNode node) {
+            if (!node.count)
+                node.first += offset;
+            return node;
+        };
+        nodes_[subtree.node] = relocate(subtree.nodes[0]);
+        for (size_t i = 1; i < subtree.nodes.size(); ++i)
+            nodes_.push_back(relocate(subtree.nodes[i]));
+        std::vector<FlatNode>().swap(subtree.nodes);
+    }
+    n_nodes_ = nodes_.size();
+
+    // store faces and their points in leaf order
+    leaf_faces_.resize(n);
+    for (auto& coords : leaf_points_)
+        coords.resize(n);
+#pragma omp parallel for schedule(static, 1024)
+    for (Index i = 0; i < Index(n); ++i)
+    {
+        const auto idx = face_order_[i];
+        leaf_faces_[i] = Face(idx);
+        const auto& pos = face_points_[idx];
+        for (int j = 0; j < 3; ++j)
+            for (int k = 0; k < 3; ++k)
+                leaf_points_[3 * j + k][i] = pos[j][k];
+    }
+}
+
+IndexType TriangleKdTree::split_flat(IndexType begin, IndexType end,
+                                     FlatNode& node, unsigned int max_faces,
+                                     unsigned int depth, BuildMethod method)
+{
+    // bounding boxes of the faces and of their centroids
+    BoundingBox bbox, cbox;
+    for (IndexType i = begin; i < end; ++i)
+    {
+        const auto idx = face_order_[i];
+        for (const auto& p : face_points_[idx])
+            bbox += p;
+        cbox += face_centroids_[idx];
+    }
+    node.min = bbox.min();
+    node.max = bbox.max();
+
+    // should we stop at this level?
+    if (depth == 0 || end - begin <= max_faces)
+        return begin;
+
+    // longest side of the box of the centroids, stop if they coincide
+    const Point min = cbox.min();
+    const Point extent = cbox.max() - min;
+    int axis = 0;
+    if (extent[1] > extent[axis])
+        axis = 1;
+    if (extent[2] > extent[axis])
+        axis = 2;
+    if (extent[axis] <= 0)
+        return begin;
+
+    const auto first = face_order_.begin() + begin;
+    const auto last = face_order_.begin() + end;
+
+    // split at the median centroid
+    if (method == BuildMethod::Median)
+    {
+        const auto middle = first + (end - begin) / 2;
+        std::nth_element(first, middle, last, [&](IndexType a, IndexType b) {
+            return face_centroids_[a][axis] < face_centroids_[b][axis];
+        });
+        return IndexType(middle - face_order_.begin());
+    }
+
+    // bin the centroids along the longest side
+    const Scalar scale = n_bins / extent[axis];
+    auto bin = [&](IndexType idx) {
+        const auto b = int((face_centroids_[idx][axis] - min[axis]) * scale);
+        return std::min(b, int(n_bins) - 1);
+    };
+
+    struct Bin
+    {
+        BoundingBox box;
+        IndexType count{0};
+    };
+    std::array<Bin, n_bins> bins;
+    for (IndexType i = begin; i < end; ++i)
+    {
+        const auto idx = face_order_[i];
+        auto& b = bins[bin(idx)];
+        for (const auto& p : face_points_[idx])
+            b.box += p;
+        ++b.count;
+    }
+
+    // split between the bins that minimizes the surface areas of the
+    // children weighted by their number of faces. Both children are
+    // non-empty, since the first and last bin contain a centroid.
+    std::array<Scalar, n_bins> right_cost;
+    BoundingBox box;
+    IndexType count = 0;
+    for (int b = n_bins - 1; b > 0; --b)
+    {
+        box += bins[b].box;
+        count += bins[b].count;
+        right_cost[b] = count ? half_area(box) * count : 0;
+    }
+
+    Scalar min_cost = std::numeric_limits<Scalar>::max();
+    int split = n_bins / 2;
+    box = BoundingBox();
+    count = 0;
+    for (int b = 1; b < int(n_bins); ++b)
+    {
+        box += bins[b - 1].box;
+        count += bins[b - 1].count;
+        const Scalar cost =
+            (count ? half_area(box) * count : 0) + right_cost[b];
+        if (cost < min_cost)
+        {
+            min_cost = cost;
+            split = b;
+        }
+    }
+
+    const auto middle = std::partition(
+        first, last, [&](IndexType idx) { return bin(idx) < split; });
+    return IndexType(middle - face_order_.begin());
+}
+
+void TriangleKdTree::build_flat_task(IndexType node, IndexType begin,
+                                     IndexType end, unsigned int max_faces,
+                                     unsigned int depth, BuildMethod method,
+                                     std::vector<Subtree>* subtrees)
+{
+    if (end - begin <= task_faces)
+    {
+        Subtree subtree{node, begin, std::vector<FlatNode>(1)};
+        build_flat_recurse(subtree.nodes, 0, begin, end, max_faces, depth,
+                           method);
+#pragma omp critical(pmp_triangle_kd_tree)
+        subtrees->push_back(std::move(subtree));
+        return;
+    }
+
+    FlatNode n;
+    const IndexType middle =
+        split_flat(begin, end, n, max_faces, depth, method);
+    if (middle == begin)
+    {
+        n.first = begin;
+        n.count = end - begin;
+    }
+    else
+    {
+        n.count = 0;
+    }
+
+    // nodes_ may grow in other tasks
+#pragma omp critical(pmp_triangle_kd_tree)
+    {
+        if (!n.count)
+        {
+            n.first = IndexType(nodes_.size());
+            nodes_.resize(nodes_.size() + 2);
+        }
+        nodes_[node] = n;
+    }
+
+    if (n.count)
+        return;
+
+    const IndexType left = n.first;
+#pragma omp task
+    build_flat_task(left, begin, middle, max_faces, depth - 1, method,
+                    subtrees);
+#pragma omp task
+    build_flat_task(left + 1, middle, end, max_faces, depth - 1, method,
+                    subtrees);
+}
+
+void TriangleKdTree::build_flat_recurse(std::vector<FlatNode>& nodes,
+                                        IndexType node, IndexType begin,
+                                        IndexType end, unsigned int max_faces,
+                                        unsigned int depth, BuildMethod method)
+{
+    const IndexType middle =
+        split_flat(begin, end, nodes[node], max_faces, depth, method);
+
+    // leaf
+    if (middle == begin)
+    {
+        nodes[node].first = begin;
+        nodes[node].count = end - begin;
+        return;
+    }
+
+    // inner node, children are stored next to each other
+    const auto left = IndexType(nodes.size());
+    nodes[node].first = left;
+    nodes[node].count = 0;
+    nodes.resize(nodes.size() + 2);
+    build_flat_recurse(nodes, left, begin, middle, max_faces, depth - 1,
+                       method);
+    build_flat_recurse(nodes, left + 1, middle, end, max_faces, depth - 1,
+                       method);
+}
+
+size_t TriangleKdTree::memory_usage() const
+{
+    size_t bytes = nodes_.capacity() * sizeof(FlatNode) +
+                   leaf_faces_.capacity() * sizeof(Face);
+    if (root_)
+        bytes += n_nodes_ * sizeof(Node);
+    for (const auto& coords : leaf_points_)
+        bytes += coords.capacity() * sizeof(Scalar);
+    return bytes;
+}
+
 TriangleKdTree::NearestNeighbor TriangleKdTree::nearest(const Point& p) const
 {
     NearestNeighbor data;
     data.dist = std::numeric_limits<Scalar>::max();
-    nearest_recurse(root_, p, data);
+    IndexType leaf = PMP_MAX_INDEX;
+    if (root_)
+        nearest_recurse(root_, p, data, leaf);
+    else if (!nodes_.empty())
+        nearest_flat(0, p, data, leaf);
     return data;
 }
 
+void TriangleKdTree::nearest(const Point* points, size_t n,
+                             NearestNeighbor* results) const
+{
+    if (n == 0)
+        return;
+
+    // sort the points along a Morton curve through their bounding box
+    BoundingBox bbox;
+    for (size_t i = 0; i < n; ++i)
+        bbox += points[i];
+    const Point bb_min = bbox.min();
+    const Point bb_size = bbox.max() - bbox.min();
+    const Scalar scale = (1 << 21) - 1;
+
+    std::vector<std::pair<uint64_t, size_t>> order(n);
+    using Index = std::int64_t;
+#pragma omp parallel for schedule(static, 1024)
+    for (Index i = 0; i < Index(n); ++i)
+    {
+        uint64_t code = 0;
+        for (int j = 0; j < 3; ++j)
+        {
+            const Scalar t =
+                bb_size[j] > 0 ? (points[i][j] - bb_min[j]) / bb_size[j] : 0;
+            code |= spread_bits(uint64_t(t * scale)) << j;
+        }
+        order[i] = std::make_pair(code, size_t(i));
+    }
+    std::sort(order.begin(), order.end());
+
+    // process chunks of consecutive points in parallel
+    const Index chunk_size = 256;
+    const Index n_chunks = (Index(n) + chunk_size - 1) / chunk_size;
+#pragma omp parallel for schedule(dynamic)
+    for (Index c = 0; c < n_chunks; ++c)
+    {
+        const Index begin = c * chunk_size;
+        const Index end = std::min(begin + chunk_size, Index(n));
+        IndexType previous = PMP_MAX_INDEX;
+
+        for (Index i = begin; i < end; ++i)
+        {
+            const size_t q = order[i].second;
+            const Point& p = points[q];
+
+            NearestNeighbor data;
+            data.dist = std::numeric_limits<Scalar>::max();
+            IndexType leaf = previous;
+
+            // the nearest face of the previous point is close, its distance
+            // is a tight upper bound
+            if (previous != PMP_MAX_INDEX)
+            {
+                Point v[3];
+                for (int j = 0; j < 3; ++j)
+                    for (int k = 0; k < 3; ++k)
+                        v[j][k] = leaf_points_[3 * j + k][previous];
+                data.dist =
+                    dist_point_triangle(p, v[0], v[1], v[2], data.nearest);
+                data.face = leaf_faces_[previous];
+            }
+
+            if (root_)
+                nearest_recurse(root_, p, data, leaf);
+            else if (!nodes_.empty())
+                nearest_flat(0, p, data, leaf);
+
+            results[q] = data;
+            previous = leaf;
+        }
+    }
+}
+
 void TriangleKdTree::nearest_recurse(Node* node, const Point& point,
-                                     NearestNeighbor& data) const
+                                     NearestNeighbor& data,
+                                     IndexType& leaf) const
 {
     // terminal node?
     if (!node->left_child)
     {
-        for (const auto& f : *node->faces)
+        const Scalar* v[9];
+        for (int i = 0; i < 9; ++i)
+            v[i] = leaf_points_[i].data() + node->begin;
+
+        int i = nearest_triangle(v, node->end - node->begin, point,
+                                 data.dist, data.nearest);
+        if (i >= 0)
         {
-            Point n;
-            const auto& pos = face_points_[f.idx()];
-            auto d = dist_point_triangle(point, pos[0], pos[1], pos[2], n);
-            if (d < data.dist)
-            {
-                data.dist = d;
-                data.face = f;
-                data.nearest = n;
-            }
+            leaf = node->begin + i;
+            data.face = leaf_faces_[leaf];
         }
     }
 
@@ -176,17 +599,53 @@ void TriangleKdTree::nearest_recurse(Node* node, const Point& point,
 
         if (dist <= 0.0)
         {
-            nearest_recurse(node->left_child, point, data);
+            nearest_recurse(node->left_child, point, data, leaf);
             if (fabs(dist) < data.dist)
-                nearest_recurse(node->right_child, point, data);
+                nearest_recurse(node->right_child, point, data, leaf);
         }
         else
         {
-            nearest_recurse(node->right_child, point, data);
+            nearest_recurse(node->right_child, point, data, leaf);
             if (fabs(dist) < data.dist)
-                nearest_recurse(node->left_child, point, data);
+                nearest_recurse(node->left_child, point, data, leaf);
+        }
+    }
+}
+
+void TriangleKdTree::nearest_flat(IndexType node, const Point& point,
+                                  NearestNeighbor& data, IndexType& leaf) const
+{
+    const FlatNode& n = nodes_[node];
+
+    // terminal node?
+    if (n.count)
+    {
+        const Scalar* v[9];
+        for (int i = 0; i < 9; ++i)
+            v[i] = leaf_points_[i].data() + n.first;
+
+        int i = nearest_triangle(v, n.count, point, data.dist, data.nearest);
+        if (i >= 0)
+        {
+            leaf = n.first + i;
+            data.face = leaf_faces_[leaf];
         }
+        return;
+    }
+
+    // visit the closer child first, skip children farther away than the
+    // nearest face found so far
+    Scalar dist[2];
+    for (int i = 0; i < 2; ++i)
+    {
+        const FlatNode& child = nodes_[n.first + i];
+        dist[i] = sqr_distance(child.min, child.max, point);
     }
+    const int near = dist[1] < dist[0];
+    if (dist[near] < data.dist * data.dist)
+        nearest_flat(n.first + near, point, data, leaf);
+    if (dist[1 - near] < data.dist * data.dist)
+        nearest_flat(n.first + 1 - near, point, data, leaf);
 }
 
 } // namespace pmp
@@ -3,6 +3,7 @@
 
 #pragma once
 
+#include <array>
 #include <vector>
 #include <memory>
 
@@ -11,13 +12,29 @@
 namespace pmp {
 
 //! \brief A k-d tree for triangles
+//! \details The Midpoint tree is built recursively by a single thread. It
+//! splits the bounding box of each node in the middle of its longest side
+//! and stores faces that straddle the split plane in both children. The
+//! Median and SAH trees assign each face to one child by its centroid and
+//! store the bounding box of each node instead of a split plane, so
+//! children may overlap. They partition one array of face indices in place,
+//! build the subtrees as OpenMP tasks, and store all nodes in one array.
 //! \ingroup algorithms
 class TriangleKdTree
 {
 public:
+    //! construction method of the tree
+    enum class BuildMethod
+    {
+        Midpoint, //!< serial, split in the middle of the box, linked nodes
+        Median,   //!< parallel, split at the median centroid, flat nodes
+        SAH       //!< parallel, binned surface area heuristic, flat nodes
+    };
+
     //! Construct with mesh.
     TriangleKdTree(std::shared_ptr<const SurfaceMesh> mesh,
-                   unsigned int max_faces = 10, unsigned int max_depth = 30);
+                   unsigned int max_faces = 10, unsigned int max_depth = 30,
+                   BuildMethod method = BuildMethod::SAH);
 
     //! destructor
     ~TriangleKdTree() { delete root_; }
@@ -33,11 +50,50 @@ public:
     //! Return handle of the nearest neighbor
     NearestNeighbor nearest(const Point& p) const;
 
+    //! \brief Find the nearest faces of the \p n points \p points and store
+    //! them in \p results.
+    //! \details The points are processed in Morton order, in chunks that are
+    //! distributed over all threads if OpenMP is available. Within a chunk,
+    //! the distance to the nearest face of the previous point is the initial
+    //! bound of the search, which prunes most of the tree for close points.
+    void nearest(const Point* points, size_t n, NearestNeighbor* results) const;
+
+    //! number of nodes of the tree
+    size_t n_nodes() const { return n_nodes_; }
+
+    //! \brief Number of faces stored in the leaves.
+    //! \details Larger than the number of faces of the mesh for the Midpoint
+    //! tree, which stores faces in all leaves they overlap.
+    size_t n_leaf_faces() const { return leaf_faces_.size(); }
+
+    //! memory used by the nodes and leaves of the tree, in bytes
+    size_t memory_usage() const;
+
 private:
     // vector of Faces
     using Faces = std::vector<Face>;
 
-    // Node of the tree: contains parent, children and splitting plane
+    // Node of the Median and SAH trees. The children of an inner node are
+    // nodes [first, first+1], a leaf stores the faces [first, first+count).
+    struct FlatNode
+    {
+        Point min, max;
+        IndexType first;
+        IndexType count; // zero for inner nodes
+    };
+
+    // Subtree of the Median and SAH trees built by one task, to be stored
+    // at node index node of nodes_ (its own nodes are numbered from zero)
+    struct Subtree
+    {
+        IndexType node;
+        IndexType begin;
+        std::vector<FlatNode> nodes;
+    };
+
+    // Node of the tree: contains parent, children and splitting plane.
+    // After the build, the faces of a leaf are the range [begin, end) of
+    // leaf_faces_.
     struct Node
     {
         Node() = default;
@@ -52,6 +108,8 @@ private:
         unsigned char axis;
         Scalar split;
         Faces* faces{nullptr};
+        unsigned int begin{0};
+        unsigned int end{0};
         Node* left_child{nullptr};
         Node* right_child{nullptr};
     };
@@ -60,13 +118,59 @@ private:
     void build_recurse(Node* node, unsigned int max_handles,
                        unsigned int depth);
 
-    // Recursive part of nearest()
-    void nearest_recurse(Node* node, const Point& point,
-                         NearestNeighbor& data) const;
+    // Copy leaf faces into contiguous arrays, recursive
+    void gather_leaves(Node* node);
+
+    // Recursive part of nearest(), leaf is set to the position of the
+    // nearest face in leaf_faces_
+    void nearest_recurse(Node* node, const Point& point, NearestNeighbor& data,
+                         IndexType& leaf) const;
+
+    // Build the Median or SAH tree from face_order_
+    void build_flat(unsigned int max_faces, unsigned int max_depth,
+                    BuildMethod method);
+
+    // Compute the bounding box of the faces [begin, end) of face_order_ and
+    // partition them for a split. Returns the first face of the right child,
+    // or begin if the node is a leaf.
+    IndexType split_flat(IndexType begin, IndexType end, FlatNode& node,
+                         unsigned int max_faces, unsigned int depth,
+                         BuildMethod method);
+
+    // Build the subtree of node of nodes_ for the faces [begin, end), spawn
+    // tasks for the children of large nodes
+    void build_flat_task(IndexType node, IndexType begin, IndexType end,
+                         unsigned int max_faces, unsigned int depth,
+                         BuildMethod method, std::vector<Subtree>* subtrees);
 
-    Node* root_;
+    // Recursive part of build_flat() within one task
+    void build_flat_recurse(std::vector<FlatNode>& nodes, IndexType node,
+                            IndexType begin, IndexType end,
+                            unsigned int max_faces, unsigned int depth,
+                            BuildMethod method);
 
+    // Recursive part of nearest() for the Median and SAH trees
+    void nearest_flat(IndexType node, const Point& point, NearestNeighbor& data,
+                      IndexType& leaf) const;
+
+    // Midpoint tree
+    Node* root_{nullptr};
+
+    // Median and SAH trees
+    std::vector<FlatNode> nodes_;
+
+    size_t n_nodes_{0};
+
+    // only during build: vertices and centroids of the faces (by face
+    // index), order of the faces in the leaves of the Median and SAH trees
     std::vector<std::array<Point, 3>> face_points_;
+    std::vector<Point> face_centroids_;
+    std::vector<IndexType> face_order_;
+
+    // faces of all leaves, and their vertex coordinates as structure of
+    // arrays (x, y, z of the three vertices) for the vectorized leaf scan
+    Faces leaf_faces_;
+    std::array<std::vector<Scalar>, 9> leaf_points_;
 };
 
 } // namespace pmp
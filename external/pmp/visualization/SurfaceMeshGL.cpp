@@ -5,6 +5,8 @@
 
 #include <stb_image.h>
 
+#include <cstdint>
+
 #include "pmp/visualization/PhongShader.h"
 #include "pmp/visualization/MatCapShader.h"
 #include "pmp/visualization/ColdWarmTexture.h"
@@ -23,15 +25,30 @@ SurfaceMeshGL::SurfaceMeshGL()
     edge_buffer_ = 0;
     feature_buffer_ = 0;
     seam_buffer_ = 0;
+    triangle_buffer_ = 0;
+    vertex_buffer_size_ = 0;
+    color_buffer_size_ = 0;
+    normal_buffer_size_ = 0;
+    tex_coord_buffer_size_ = 0;
+    edge_buffer_size_ = 0;
+    feature_buffer_size_ = 0;
+    seam_buffer_size_ = 0;
+    triangle_buffer_size_ = 0;
 
     // initialize buffer sizes
     n_vertices_ = 0;
     n_edges_ = 0;
     n_triangles_ = 0;
     n_features_ = 0;
+    n_seams_ = 0;
     has_texcoords_ = false;
     has_vertex_colors_ = false;
 
+    // no buffer layout yet
+    indexed_ = false;
+    layout_vertices_ = 0;
+    layout_faces_ = 0;
+
     // material parameters
     front_color_ = vec3(0.6, 0.6, 0.6);
     back_color_ = vec3(0.5, 0.0, 0.0);
@@ -57,6 +74,16 @@ SurfaceMeshGL::~SurfaceMeshGL()
 
 void SurfaceMeshGL::deleteBuffers()
 {
+    // rebuild the buffer layout on the next update
+    buffer_vertices_.clear();
+    buffer_corners_.clear();
+    layout_vertices_ = 0;
+    layout_faces_ = 0;
+
+    // nothing else to do (in particular without OpenGL context)?
+    if (!vertex_array_object_)
+        return;
+
     // delete OpenGL buffers
     glDeleteBuffers(1, &vertex_buffer_);
     glDeleteBuffers(1, &color_buffer_);
@@ -65,6 +92,7 @@ void SurfaceMeshGL::deleteBuffers()
     glDeleteBuffers(1, &edge_buffer_);
     glDeleteBuffers(1, &feature_buffer_);
     glDeleteBuffers(1, &seam_buffer_);
+    glDeleteBuffers(1, &triangle_buffer_);
     glDeleteVertexArrays(1, &vertex_array_object_);
 
     // initialize GL buffers to zero
@@ -76,12 +104,22 @@ void SurfaceMeshGL::deleteBuffers()
     edge_buffer_ = 0;
     feature_buffer_ = 0;
     seam_buffer_ = 0;
+    triangle_buffer_ = 0;
+    vertex_buffer_size_ = 0;
+    color_buffer_size_ = 0;
+    normal_buffer_size_ = 0;
+    tex_coord_buffer_size_ = 0;
+    edge_buffer_size_ = 0;
+    feature_buffer_size_ = 0;
+    seam_buffer_size_ = 0;
+    triangle_buffer_size_ = 0;
 
     // initialize buffer sizes
     n_vertices_ = 0;
     n_edges_ = 0;
     n_triangles_ = 0;
     n_features_ = 0;
+    n_seams_ = 0;
     has_texcoords_ = false;
     has_vertex_colors_ = false;
 }
@@ -260,11 +298,53 @@ void SurfaceMeshGL::set_crease_angle(Scalar ca)
     if (ca != crease_angle_)
     {
         crease_angle_ = std::max(Scalar(0), std::min(Scalar(180), ca));
-        update_opengl_buffers();
+
+        // buffers not yet created are set up by draw()
+        if (vertex_array_object_)
+            update_opengl_buffers(UpdateNormals);
+    }
+}
+
+namespace {
+
+// upload data to buffer, reallocating it only if the size has changed
+template <class T>
+void upload_buffer(GLenum target, GLuint buffer, const std::vector<T>& data,
+                   GLsizeiptr& size)
+{
+    const GLsizeiptr bytes = data.size() * sizeof(T);
+    glBindBuffer(target, buffer);
+    if (bytes == size)
+    {
+        if (bytes)
+            glBufferSubData(target, 0, bytes, data.data());
+    }
+    else
+    {
+        glBufferData(target, bytes, data.data(), GL_STATIC_DRAW);
+        size = bytes;
     }
 }
 
-void SurfaceMeshGL::update_opengl_buffers()
+// upload a vertex attribute array and enable it, or disable it if empty
+template <class T>
+bool upload_attribute(GLuint index, GLint components, GLuint buffer,
+                      const std::vector<T>& data, GLsizeiptr& size)
+{
+    if (data.empty())
+    {
+        glDisableVertexAttribArray(index);
+        return false;
+    }
+    upload_buffer(GL_ARRAY_BUFFER, buffer, data, size);
+    glVertexAttribPointer(index, components, GL_FLOAT, GL_FALSE, 0, nullptr);
+    glEnableVertexAttribArray(index);
+    return true;
+}
+
+} // namespace
+
+void SurfaceMeshGL::update_opengl_buffers(unsigned int changed)
 {
     // are buffers already initialized?
     if (!vertex_array_object_)
@@ -278,356 +358,333 @@ void SurfaceMeshGL::update_opengl_buffers()
         glGenBuffers(1, &edge_buffer_);
         glGenBuffers(1, &feature_buffer_);
         glGenBuffers(1, &seam_buffer_);
+        glGenBuffers(1, &triangle_buffer_);
+        changed = UpdateAll;
     }
 
+    // build the arrays of the changed parts
+    BufferArrays arrays;
+    changed = build_buffer_arrays(arrays, changed);
+
     // activate VAO
     glBindVertexArray(vertex_array_object_);
 
+    // upload vertex attributes
+    if (changed & UpdatePositions)
+    {
+        upload_attribute(0, 3, vertex_buffer_, arrays.positions,
+                         vertex_buffer_size_);
+        n_vertices_ = arrays.positions.size();
+    }
+    if (changed & (UpdatePositions | UpdateNormals))
+        upload_attribute(1, 3, normal_buffer_, arrays.normals,
+                         normal_buffer_size_);
+    if (changed & UpdateTopology)
+        has_texcoords_ = upload_attribute(2, 2, tex_coord_buffer_,
+                                          arrays.texcoords,
+                                          tex_coord_buffer_size_);
+    if (changed & UpdateColors)
+        has_vertex_colors_ = upload_attribute(3, 3, color_buffer_,
+                                              arrays.colors,
+                                              color_buffer_size_);
+
+    // upload triangle and edge indices
+    if (changed & UpdateTopology)
+    {
+        upload_buffer(GL_ELEMENT_ARRAY_BUFFER, triangle_buffer_,
+                      arrays.triangles, triangle_buffer_size_);
+        n_triangles_ = arrays.triangles.size() / 3;
+        upload_buffer(GL_ELEMENT_ARRAY_BUFFER, seam_buffer_, arrays.seams,
+                      seam_buffer_size_);
+        n_seams_ = arrays.seams.size();
+        upload_buffer(GL_ELEMENT_ARRAY_BUFFER, edge_buffer_, arrays.edges,
+                      edge_buffer_size_);
+        n_edges_ = arrays.edges.size();
+        upload_buffer(GL_ELEMENT_ARRAY_BUFFER, feature_buffer_,
+                      arrays.features, feature_buffer_size_);
+        n_features_ = arrays.features.size();
+    }
+
+    // unbind vertex array
+    glBindVertexArray(0);
+}
+
+unsigned int SurfaceMeshGL::build_buffer_arrays(BufferArrays& arrays,
+                                                unsigned int changed)
+{
+    using Index = std::int64_t;
+
     // get properties
     auto vpos = get_vertex_property<Point>("v:point");
+    auto vnormal = get_vertex_property<Normal>("v:normal");
     auto vcolor = get_vertex_property<Color>("v:color");
     auto vtex = get_vertex_property<TexCoord>("v:tex");
     auto htex = get_halfedge_property<TexCoord>("h:tex");
     auto fcolor = get_face_property<Color>("f:color");
 
-    // index array for remapping vertex indices during duplication
-    auto vertex_indices = add_vertex_property<size_t>("v:index");
-
-    // produce arrays of points, normals, and texcoords
-    // (duplicate vertices to allow for flat shading)
-    std::vector<vec3> position_array;
-    std::vector<vec3> color_array;
-    std::vector<vec3> normal_array;
-    std::vector<vec2> tex_array;
-    std::vector<ivec3> triangles;
-
-    // we have a mesh: fill arrays by looping over faces
-    if (n_faces())
-    {
-        // reserve memory
-        position_array.reserve(3 * n_faces());
-        normal_array.reserve(3 * n_faces());
-        if (htex || vtex)
-            tex_array.reserve(3 * n_faces());
-
-        if ((vcolor || fcolor) && use_colors_)
-            color_array.reserve(3 * n_faces());
-
-        // precompute normals for easy cases
-        FaceProperty<Normal> fnormals;
-        VertexProperty<Normal> vnormals;
-        if (crease_angle_ < 1)
-        {
-            fnormals = add_face_property<Normal>("gl:fnormal");
-            for (auto f : faces())
-                fnormals[f] = SurfaceNormals::compute_face_normal(*this, f);
-        }
-        else if (crease_angle_ > 170)
-        {
-            vnormals = add_vertex_property<Normal>("gl:vnormal");
-            for (auto v : vertices())
-                vnormals[v] = SurfaceNormals::compute_vertex_normal(*this, v);
-        }
+    // vertex colors take precedence over face colors
+    const bool use_vcolor = vcolor && use_colors_;
+    const bool use_fcolor = !use_vcolor && fcolor && use_colors_;
+
+    // smooth shading and point clouds share vertices between triangles,
+    // everything else needs a buffer vertex per triangle corner
+    const bool indexed =
+        !n_faces() || (crease_angle_ > 170 && !htex && !use_fcolor);
+
+    if (indexed != indexed_ || n_vertices() != layout_vertices_ ||
+        n_faces() != layout_faces_)
+        changed |= UpdateTopology;
+
+    if (changed & UpdateTopology)
+    {
+        changed = UpdateAll;
+        indexed_ = indexed;
+        layout_vertices_ = n_vertices();
+        layout_faces_ = n_faces();
+        buffer_vertices_.clear();
+        buffer_corners_.clear();
+        arrays.triangles.clear();
+
+        // buffer vertex of each mesh vertex (one of them if not indexed)
+        std::vector<unsigned int> vertex_index(vertices_size(), 0);
 
-        // data per face (for all corners)
         std::vector<Halfedge> corner_halfedges;
-        std::vector<Vertex> corner_vertices;
         std::vector<vec3> corner_positions;
-        std::vector<vec3> corner_colors;
-        std::vector<vec3> corner_normals;
-        std::vector<vec2> corner_texcoords;
-
-        // convert from degrees to radians
-        const Scalar crease_angle_radians = crease_angle_ / 180.0 * M_PI;
+        std::vector<ivec3> triangles;
 
-        size_t vidx(0);
+        if (indexed_)
+        {
+            buffer_vertices_.reserve(n_vertices());
+            for (auto v : vertices())
+            {
+                vertex_index[v.idx()] = buffer_vertices_.size();
+                buffer_vertices_.push_back(v);
+            }
+            arrays.triangles.reserve(3 * n_faces());
+        }
+        else
+        {
+            buffer_corners_.reserve(3 * n_faces());
+        }
 
-        // loop over all faces
+        // tessellate faces into triangles
         for (auto f : faces())
         {
-            // collect corner positions and normals
             corner_halfedges.clear();
-            corner_vertices.clear();
-            corner_positions.clear();
-            corner_colors.clear();
-            corner_normals.clear();
-            corner_texcoords.clear();
-            Vertex v;
-            Normal n;
-
             for (auto h : halfedges(f))
-            {
-                v = to_vertex(h);
                 corner_halfedges.push_back(h);
-                corner_vertices.push_back(v);
-                corner_positions.push_back((vec3)vpos[v]);
+            assert(corner_halfedges.size() >= 3);
 
-                if (crease_angle_ < 1)
-                {
-                    n = fnormals[f];
-                }
-                else if (crease_angle_ > 170)
-                {
-                    n = vnormals[v];
-                }
-                else
-                {
-                    n = SurfaceNormals::compute_corner_normal(
-                        *this, h, crease_angle_radians);
-                }
-                corner_normals.push_back((vec3)n);
-
-                if (htex)
-                {
-                    corner_texcoords.push_back((vec2)htex[h]);
-                }
-                else if (vtex)
-                {
-                    corner_texcoords.push_back((vec2)vtex[v]);
-                }
-
-                if (vcolor && use_colors_)
-                {
-                    corner_colors.push_back((vec3)vcolor[v]);
-                }
-                else if (fcolor && use_colors_)
-                {
-                    corner_colors.push_back((vec3)fcolor[f]);
-                }
+            if (corner_halfedges.size() == 3)
+            {
+                triangles.assign(1, ivec3(0, 1, 2));
+            }
+            else
+            {
+                corner_positions.clear();
+                for (auto h : corner_halfedges)
+                    corner_positions.push_back((vec3)vpos[to_vertex(h)]);
+                tesselate(corner_positions, triangles);
             }
-            assert(corner_vertices.size() >= 3);
 
-            // tessellate face into triangles
-            tesselate(corner_positions, triangles);
             for (auto& t : triangles)
             {
-                int i0 = t[0];
-                int i1 = t[1];
-                int i2 = t[2];
-
-                position_array.push_back(corner_positions[i0]);
-                position_array.push_back(corner_positions[i1]);
-                position_array.push_back(corner_positions[i2]);
-
-                normal_array.push_back(corner_normals[i0]);
-                normal_array.push_back(corner_normals[i1]);
-                normal_array.push_back(corner_normals[i2]);
-
-                if (htex || vtex)
-                {
-                    tex_array.push_back(corner_texcoords[i0]);
-                    tex_array.push_back(corner_texcoords[i1]);
-                    tex_array.push_back(corner_texcoords[i2]);
-                }
-
-                if ((vcolor || fcolor) && use_colors_)
+                for (int i = 0; i < 3; ++i)
                 {
-                    color_array.push_back(corner_colors[i0]);
-                    color_array.push_back(corner_colors[i1]);
-                    color_array.push_back(corner_colors[i2]);
+                    const Halfedge h = corner_halfedges[t[i]];
+                    if (indexed_)
+                    {
+                        arrays.triangles.push_back(
+                            vertex_index[to_vertex(h).idx()]);
+                    }
+                    else
+                    {
+                        vertex_index[to_vertex(h).idx()] =
+                            buffer_corners_.size();
+                        buffer_corners_.push_back(h);
+                    }
                 }
-
-                vertex_indices[corner_vertices[i0]] = vidx++;
-                vertex_indices[corner_vertices[i1]] = vidx++;
-                vertex_indices[corner_vertices[i2]] = vidx++;
             }
         }
 
-        // clean up
-        if (vnormals)
-            remove_vertex_property(vnormals);
-        if (fnormals)
-            remove_face_property(fnormals);
-    }
-
-    // we have a point cloud
-    else if (n_vertices())
-    {
-        auto position = vertex_property<Point>("v:point");
-        if (position)
+        // texture coordinates
+        arrays.texcoords.clear();
+        if (indexed_ && vtex)
         {
-            position_array.reserve(n_vertices());
-            for (auto v : vertices())
-                position_array.push_back((vec3)position[v]);
+            arrays.texcoords.resize(buffer_vertices_.size());
+            for (size_t i = 0; i < buffer_vertices_.size(); ++i)
+                arrays.texcoords[i] = (vec2)vtex[buffer_vertices_[i]];
         }
-
-        auto normals = get_vertex_property<Point>("v:normal");
-        if (normals)
+        else if (!indexed_ && (htex || vtex))
         {
-            normal_array.reserve(n_vertices());
-            for (auto v : vertices())
-                normal_array.push_back((vec3)normals[v]);
+            arrays.texcoords.resize(buffer_corners_.size());
+            for (size_t i = 0; i < buffer_corners_.size(); ++i)
+            {
+                const Halfedge h = buffer_corners_[i];
+                arrays.texcoords[i] =
+                    htex ? (vec2)htex[h] : (vec2)vtex[to_vertex(h)];
+            }
         }
 
-        if (vcolor && use_colors_)
+        // texture seams
+        EdgeProperty<bool> texture_seams;
+        if (htex)
         {
-            color_array.reserve(n_vertices());
-            for (auto v : vertices())
-                color_array.push_back((vec3)vcolor[v]);
+            texture_seams = edge_property<bool>("e:seam");
+            for (auto e : edges())
+            {
+                // texcoords are stored in halfedge pointing towards a vertex
+                Halfedge h0 = halfedge(e, 0);
+                Halfedge h1 = halfedge(e, 1);     //opposite halfedge
+                Halfedge h0p = prev_halfedge(h0); // start point edge 0
+                Halfedge h1p = prev_halfedge(h1); // start point edge 1
+
+                // if start or end points differs more than seam_threshold
+                // the corresponding edge is a texture seam
+                texture_seams[e] = norm(htex[h1] - htex[h0p]) > 1e-2 ||
+                                   norm(htex[h0] - htex[h1p]) > 1e-2;
+            }
         }
-    }
 
-    // upload vertices
-    if (!position_array.empty())
-    {
-        glBindBuffer(GL_ARRAY_BUFFER, vertex_buffer_);
-        glBufferData(GL_ARRAY_BUFFER, position_array.size() * 3 * sizeof(float),
-                     position_array.data(), GL_STATIC_DRAW);
-        glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 0, nullptr);
-        glEnableVertexAttribArray(0);
-        n_vertices_ = position_array.size();
-    }
-    else
-    {
-        glDisableVertexAttribArray(0);
-        n_vertices_ = 0;
+        // edge indices, seam and feature edges
+        auto efeature = get_edge_property<bool>("e:feature");
+        arrays.edges.clear();
+        arrays.seams.clear();
+        arrays.features.clear();
+        if (n_faces())
+        {
+            arrays.edges.reserve(2 * n_edges());
+            for (auto e : edges())
+            {
+                const unsigned int i0 = vertex_index[vertex(e, 0).idx()];
+                const unsigned int i1 = vertex_index[vertex(e, 1).idx()];
+                arrays.edges.push_back(i0);
+                arrays.edges.push_back(i1);
+                if (texture_seams && texture_seams[e])
+                {
+                    arrays.seams.push_back(i0);
+                    arrays.seams.push_back(i1);
+                }
+                if (efeature && efeature[e])
+                {
+                    arrays.features.push_back(i0);
+                    arrays.features.push_back(i1);
+                }
+            }
+        }
     }
 
-    // upload normals
-    if (!normal_array.empty())
-    {
-        glBindBuffer(GL_ARRAY_BUFFER, normal_buffer_);
-        glBufferData(GL_ARRAY_BUFFER, normal_array.size() * 3 * sizeof(float),
-                     normal_array.data(), GL_STATIC_DRAW);
-        glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, 0, nullptr);
-        glEnableVertexAttribArray(1);
-    }
-    else
-    {
-        glDisableVertexAttribArray(1);
-    }
+    // vertex of each buffer vertex
+    const Index n = indexed_ ? buffer_vertices_.size() : buffer_corners_.size();
+    auto buffer_vertex = [&](Index i) {
+        return indexed_ ? buffer_vertices_[i] : to_vertex(buffer_corners_[i]);
+    };
 
-    // upload texture coordinates
-    if (!tex_array.empty())
+    // positions
+    if (changed & UpdatePositions)
     {
-        glBindBuffer(GL_ARRAY_BUFFER, tex_coord_buffer_);
-        glBufferData(GL_ARRAY_BUFFER, tex_array.size() * 2 * sizeof(float),
-                     tex_array.data(), GL_STATIC_DRAW);
-        glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, 0, nullptr);
-        glEnableVertexAttribArray(2);
-        has_texcoords_ = true;
-    }
-    else
-    {
-        glDisableVertexAttribArray(2);
-        has_texcoords_ = false;
+        arrays.positions.resize(n);
+#pragma omp parallel for schedule(static, 4096)
+        for (Index i = 0; i < n; ++i)
+            arrays.positions[i] = (vec3)vpos[buffer_vertex(i)];
     }
 
-    // upload colors of vertices
-    if (!color_array.empty())
-    {
-        glBindBuffer(GL_ARRAY_BUFFER, color_buffer_);
-        glBufferData(GL_ARRAY_BUFFER, color_array.size() * 3 * sizeof(float),
-                     color_array.data(), GL_STATIC_DRAW);
-        glVertexAttribPointer(3, 3, GL_FLOAT, GL_FALSE, 0, nullptr);
-        glEnableVertexAttribArray(3);
-        has_vertex_colors_ = true;
-    }
-    else
+    // normals: from "v:normal" for point clouds, otherwise computed from the
+    // positions according to the crease angle
+    if (changed & (UpdatePositions | UpdateNormals))
     {
-        glDisableVertexAttribArray(3);
-        has_vertex_colors_ = false;
-    }
-
-    size_t seam_count = 0;
-    auto texcoords = get_halfedge_property<TexCoord>("h:tex");
-    EdgeProperty<bool> texture_seams;
-    if (texcoords)
-    {
-        texture_seams = edge_property<bool>("e:seam");
-        for (auto e : edges())
+        arrays.normals.clear();
+        if (!n_faces() && vnormal)
         {
-            // texcoords are stored in halfedge pointing towards a vertex
-            Halfedge h0 = halfedge(e, 0);
-            Halfedge h1 = halfedge(e, 1);     //opposite halfedge
-            Halfedge h0p = prev_halfedge(h0); // start point edge 0
-            Halfedge h1p = prev_halfedge(h1); // start point edge 1
-
-            // if start or end points differs more than seam_threshold
-            // the corresponding edge is a texture seam
-            if (norm(texcoords[h1] - texcoords[h0p]) > 1e-2 ||
-                norm(texcoords[h0] - texcoords[h1p]) > 1e-2)
+            arrays.normals.resize(n);
+#pragma omp parallel for schedule(static, 4096)
+            for (Index i = 0; i < n; ++i)
+                arrays.normals[i] = (vec3)vnormal[buffer_vertex(i)];
+        }
+        else if (n_faces())
+        {
+            // face normals are needed in all cases
+            auto fnormals = add_face_property<Normal>("gl:fnormal");
+            const Index nf = faces_size();
+#pragma omp parallel for schedule(static, 1024)
+            for (Index i = 0; i < nf; ++i)
             {
-                texture_seams[e] = true;
+                const Face f(static_cast<IndexType>(i));
+                if (!is_deleted(f))
+                    fnormals[f] = SurfaceNormals::compute_face_normal(*this, f);
+            }
+
+            arrays.normals.resize(n);
+            if (crease_angle_ < 1)
+            {
+#pragma omp parallel for schedule(static, 4096)
+                for (Index i = 0; i < n; ++i)
+                    arrays.normals[i] =
+                        (vec3)fnormals[face(buffer_corners_[i])];
+            }
+            else if (indexed_)
+            {
+#pragma omp parallel for schedule(static, 1024)
+                for (Index i = 0; i < n; ++i)
+                    arrays.normals[i] =
+                        (vec3)SurfaceNormals::compute_vertex_normal(
+                            *this, buffer_vertices_[i], fnormals);
+            }
+            else if (crease_angle_ > 170)
+            {
+                // smooth shading with corner texcoords or face colors
+                auto vnormals = add_vertex_property<Normal>("gl:vnormal");
+                const Index nv = vertices_size();
+#pragma omp parallel for schedule(static, 1024)
+                for (Index i = 0; i < nv; ++i)
+                {
+                    const Vertex v(static_cast<IndexType>(i));
+                    if (!is_deleted(v))
+                        vnormals[v] = SurfaceNormals::compute_vertex_normal(
+                            *this, v, fnormals);
+                }
+#pragma omp parallel for schedule(static, 4096)
+                for (Index i = 0; i < n; ++i)
+                    arrays.normals[i] = (vec3)vnormals[buffer_vertex(i)];
+                remove_vertex_property(vnormals);
             }
             else
             {
-                texture_seams[e] = false;
+                // convert from degrees to radians
+                const Scalar crease_radians = crease_angle_ / 180.0 * M_PI;
+#pragma omp parallel for schedule(static, 1024)
+                for (Index i = 0; i < n; ++i)
+                    arrays.normals[i] =
+                        (vec3)SurfaceNormals::compute_corner_normal(
+                            *this, buffer_corners_[i], crease_radians,
+                            fnormals);
             }
+
+            remove_face_property(fnormals);
         }
-        for (auto e : edges())
-            if (texture_seams && texture_seams[e])
-                seam_count++;
     }
 
-    // edge indices & if available seam indices
-    if (n_edges())
+    // colors
+    if (changed & UpdateColors)
     {
-        std::vector<unsigned int> edgeArray;
-        edgeArray.reserve(n_edges());
-
-        std::vector<unsigned int> seamArray;
-        seamArray.reserve(seam_count);
-
-        for (auto e : edges())
-        {
-            edgeArray.push_back(vertex_indices[vertex(e, 0)]);
-            edgeArray.push_back(vertex_indices[vertex(e, 1)]);
-            if (texture_seams && texture_seams[e])
-            {
-                seamArray.push_back(vertex_indices[vertex(e, 0)]);
-                seamArray.push_back(vertex_indices[vertex(e, 1)]);
-            }
-        }
-        if (texture_seams)
+        arrays.colors.clear();
+        if (use_vcolor)
         {
-            glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, seam_buffer_);
-            glBufferData(GL_ELEMENT_ARRAY_BUFFER,
-                         seamArray.size() * sizeof(unsigned int),
-                         seamArray.data(), GL_STATIC_DRAW);
-            n_seams_ = seamArray.size();
+            arrays.colors.resize(n);
+#pragma omp parallel for schedule(static, 4096)
+            for (Index i = 0; i < n; ++i)
+                arrays.colors[i] = (vec3)vcolor[buffer_vertex(i)];
         }
-        else
-            n_seams_ = 0;
-
-        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, edge_buffer_);
-        glBufferData(GL_ELEMENT_ARRAY_BUFFER,
-                     edgeArray.size() * sizeof(unsigned int), edgeArray.data(),
-                     GL_STATIC_DRAW);
-        n_edges_ = edgeArray.size();
-    }
-    else
-        n_edges_ = 0;
-
-    // feature edges
-    auto efeature = get_edge_property<bool>("e:feature");
-    if (efeature)
-    {
-        std::vector<unsigned int> features;
-
-        for (auto e : edges())
+        else if (use_fcolor)
         {
-            if (efeature[e])
-            {
-                features.push_back(vertex_indices[vertex(e, 0)]);
-                features.push_back(vertex_indices[vertex(e, 1)]);
-            }
+            arrays.colors.resize(n);
+#pragma omp parallel for schedule(static, 4096)
+            for (Index i = 0; i < n; ++i)
+                arrays.colors[i] = (vec3)fcolor[face(buffer_corners_[i])];
         }
-
-        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, feature_buffer_);
-        glBufferData(GL_ELEMENT_ARRAY_BUFFER,
-                     features.size() * sizeof(unsigned int), features.data(),
-                     GL_STATIC_DRAW);
-        n_features_ = features.size();
     }
-    else
-        n_features_ = 0;
-
-    // unbind vertex array
-    glBindVertexArray(0);
 
-    // remove vertex index property again
-    remove_vertex_property(vertex_indices);
+    return changed;
 }
 
 void SurfaceMeshGL::draw(const mat4& projection_matrix,
@@ -935,6 +992,15 @@ void SurfaceMeshGL::tesselate(const std::vector<vec3>& points,
 
 void SurfaceMeshGL::drawTriangles() const
 {
+    // shared vertices
+    if (indexed_)
+    {
+        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, triangle_buffer_);
+        glDrawElements(GL_TRIANGLES, 3 * n_triangles_, GL_UNSIGNED_INT,
+                       nullptr);
+        return;
+    }
+
 #ifndef __EMSCRIPTEN__
     glDrawArrays(GL_TRIANGLES, 0, n_vertices_);
 #else
@@ -84,8 +84,49 @@ public:
     void draw(const mat4& projection_matrix, const mat4& modelview_matrix,
               const std::string draw_mode);
 
-    //! update all opengl buffers for efficient core profile rendering
-    void update_opengl_buffers();
+    //! Parts of the OpenGL buffers that can be updated selectively, to be
+    //! combined as flags for update_opengl_buffers()
+    enum BufferUpdate : unsigned int
+    {
+        UpdatePositions = 1, //!< positions (and normals of faces using them)
+        UpdateNormals = 2,   //!< normals (e.g., after changing "v:normal")
+        UpdateColors = 4,    //!< vertex or face colors
+        UpdateTopology = 8,  //!< everything, including texture coordinates,
+                             //!< triangles, and edges
+        UpdateAll = 15
+    };
+
+    //! Arrays uploaded to the OpenGL buffers, see build_buffer_arrays()
+    struct BufferArrays
+    {
+        std::vector<vec3> positions;
+        std::vector<vec3> normals;
+        std::vector<vec3> colors;
+        std::vector<vec2> texcoords;
+        std::vector<unsigned int> triangles; //!< empty if not indexed
+        std::vector<unsigned int> edges;
+        std::vector<unsigned int> seams;
+        std::vector<unsigned int> features;
+    };
+
+    //! \brief Update the opengl buffers for efficient core profile rendering.
+    //! \details \p changed is a combination of BufferUpdate flags. Only the
+    //! arrays of these parts are rebuilt and uploaded, by glBufferSubData()
+    //! if their size did not change. The topology is rebuilt anyway if the
+    //! number of vertices or faces or the shading mode has changed.
+    void update_opengl_buffers(unsigned int changed = UpdateAll);
+
+    //! \brief Build the arrays for the opengl buffers without any OpenGL call.
+    //! \details Smooth shading without halfedge texture coordinates or face
+    //! colors (and point clouds) use one buffer vertex per mesh vertex and an
+    //! index array of triangles. Otherwise each triangle corner gets its own
+    //! buffer vertex. Only the arrays of the parts in \p changed are filled,
+    //! the others are left untouched. This is used by update_opengl_buffers()
+    //! and allows to time the buffer construction without a GPU.
+    //! \return the parts that have been rebuilt (\p changed, or UpdateAll
+    //! if the topology had to be rebuilt)
+    unsigned int build_buffer_arrays(BufferArrays& arrays,
+                                     unsigned int changed = UpdateAll);
 
     //! use color map to visualize scalar fields
     void use_cold_warm_texture();
@@ -159,9 +200,19 @@ private:
     void tesselate(const std::vector<vec3>& points,
                    std::vector<ivec3>& triangles);
 
-    // circumvent WebGL bug in Chrome 99
+    // draw the triangles, by their indices or (to circumvent a WebGL bug in
+    // Chrome 99) as batches of arrays
     void drawTriangles() const;
 
+    // layout of the buffer vertices, set up by build_buffer_arrays() when
+    // the topology changes: buffer vertex i is the mesh vertex
+    // buffer_vertices_[i] (indexed) or the triangle corner at the target
+    // of buffer_corners_[i]
+    bool indexed_;
+    std::vector<Vertex> buffer_vertices_;
+    std::vector<Halfedge> buffer_corners_;
+    size_t layout_vertices_, layout_faces_;
+
     // OpenGL buffers
     GLuint vertex_array_object_;
     GLuint vertex_buffer_;
@@ -171,6 +222,18 @@ private:
     GLuint edge_buffer_;
     GLuint feature_buffer_;
     GLuint seam_buffer_;
+    GLuint triangle_buffer_;
+
+    // allocated sizes (in bytes) of the buffers, to decide between
+    // glBufferData() and glBufferSubData()
+    GLsizeiptr vertex_buffer_size_;
+    GLsizeiptr color_buffer_size_;
+    GLsizeiptr normal_buffer_size_;
+    GLsizeiptr tex_coord_buffer_size_;
+    GLsizeiptr edge_buffer_size_;
+    GLsizeiptr feature_buffer_size_;
+    GLsizeiptr seam_buffer_size_;
+    GLsizeiptr triangle_buffer_size_;
 
     // buffer sizes
     GLsizei n_vertices_;
@@ -51,9 +51,15 @@ public:
 	Allocator(void){
 		blockSize=index=remains=0;
 	}
+	Allocator( size_t blockSize ){
+		this->blockSize=index=remains=0;
+		set(blockSize);
+	}
 	~Allocator(void){
 		reset();
 	}
+	Allocator( const Allocator& ) = delete;
+	Allocator& operator = ( const Allocator& ) = delete;
 
 	/* This method is the allocators destructor. It frees up any of the memory that
 	  * it has allocated. */
@@ -62,6 +68,11 @@ public:
 		memory.clear();
 		blockSize=index=remains=0;
 	}
+	/* This method returns the number of bytes of the allocated blocks. */
+	size_t memoryUsage(void) const{
+		return memory.size()*blockSize*sizeof(T);
+	}
+
 	/* This method returns the memory state of the allocator. */
 	AllocatorState getState(void) const{
 		AllocatorState s;
@@ -92,32 +103,18 @@ public:
 	  * again, so after this method has been called, assumptions about the state of the values
 	  * in memory are no longer valid. */
 	void rollBack(const AllocatorState& state){
-		if(state.index<index || (state.index==index && state.remains<remains)){
-			if(state.index<index){
-				for(size_t j=state.remains;j<blockSize;j++){
-					memory[state.index][j].~T();
-					new(&memory[state.index][j]) T();
-				}
-				for(size_t i=state.index+1;i<index-1;i++){
-					for(size_t j=0;j<blockSize;j++){
-						memory[i][j].~T();
-						new(&memory[i][j]) T();
-					}
-				}
-				for(size_t j=0;j<remains;j++){
-					memory[index][j].~T();
-					new(&memory[index][j]) T();
-				}
-				index=state.index;
-				remains=state.remains;
-			}
-			else{
-				for(size_t j=0;j<state.remains;j++){
-					memory[index][j].~T();
-					new(&memory[index][j]) T();
+		// the elements of a block are handed out from its front, blockSize-remains of them are in use
+		if(state.index<index || (state.index==index && state.remains>remains)){
+			for(size_t i=state.index;i<=index;i++){
+				size_t begin = (i==state.index) ? blockSize-state.remains : 0;
+				size_t end   = (i==index) ? blockSize-remains : blockSize;
+				for(size_t j=begin;j<end;j++){
+					memory[i][j].~T();
+					new(&memory[i][j]) T();
 				}
-				remains=state.remains;
 			}
+			index=state.index;
+			remains=state.remains;
 		}
 	}
 
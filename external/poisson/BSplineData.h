@@ -30,6 +30,11 @@ DAMAGE.
 #define BSPLINE_DATA_INCLUDED
 
 
+#include <map>
+#include <memory>
+#include <mutex>
+#include <tuple>
+#include <vector>
 #include "PPolynomial.h"
 #include "Array.h"
 
@@ -117,6 +122,12 @@ public:
 	virtual void   setValueTables( int flags , double valueSmooth , double normalSmooth );
 	virtual void clearValueTables( void );
 
+	// The dot-product and value tables only depend on the depth and boundary type passed to set and on the arguments of
+	// setDotTables/setValueTables. They are computed once per process and shared by all BSplineData (and threads) with
+	// the same parameters. The cache keeps the most recently used tables up to the given number of bytes, 0 disables it.
+	static void SetTableCacheSize( size_t bytes );
+	static void ClearTableCache( void );
+
 	void setSampleSpan( int idx , int& start , int& end , double smooth=0 ) const;
 
 	/********************************************************
@@ -133,6 +144,26 @@ public:
 	inline int Index( int i1 , int i2 ) const;
 	static inline int SymmetricIndex( int i1 , int i2 );
 	static inline int SymmetricIndex( int i1 , int i2 , int& index  );
+
+private:
+	// The tables are keyed by (table flag, depth, boundary type, dot ratios and inset, smoothing)
+	typedef std::shared_ptr< std::vector< Real > > _Table;
+	typedef std::tuple< int , int , int , int , double > _TableKey;
+	struct _TableCache
+	{
+		std::mutex mutex;
+		std::map< _TableKey , std::pair< _Table , unsigned long long > > tables;
+		size_t bytes , maxBytes;
+		unsigned long long useCount;
+		_TableCache( void ) : bytes(0) , maxBytes( size_t(128)<<20 ) , useCount(0) {}
+	};
+	static _TableCache& _GetTableCache( void ){ static _TableCache cache ; return cache; }
+	static _Table _FindTable( _TableCache& cache , const _TableKey& key );
+	static void _AddTable( _TableCache& cache , const _TableKey& key , const _Table& table );
+	static void _EvictTables( _TableCache& cache , const _TableKey* keep );
+	void _computeDotTables( int flags , bool inset , Pointer( Real ) vv , Pointer( Real ) dv , Pointer( Real ) dd ) const;
+	void _computeValueTables( int flags , double valueSmooth , double derivativeSmooth , Pointer( Real ) values , Pointer( Real ) dValues ) const;
+	_Table _vvDotTable , _dvDotTable , _ddDotTable , _valueTables , _dValueTables;
 };
 
 template< int Degree1 , int Degree2 > void SetBSplineElementIntegrals( double integrals[Degree1+1][Degree2+1] );
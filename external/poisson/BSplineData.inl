@@ -78,20 +78,18 @@ BSplineData<Degree,Real>::BSplineData( void )
 {
 	vvDotTable = dvDotTable = ddDotTable = NullPointer< Real >();
 	valueTables = dValueTables = NullPointer< Real >();
+	baseFunctions = NullPointer< PPolynomial< Degree > >();
+	baseBSplines = NullPointer< BSplineComponents >();
 	functionCount = sampleCount = 0;
 }
 
 template< int Degree , class Real >
 BSplineData< Degree , Real >::~BSplineData(void)
 {
-	if( functionCount )
-	{
-		if( vvDotTable ) DeletePointer( vvDotTable );
-		if( dvDotTable ) DeletePointer( dvDotTable );
-		if( ddDotTable ) DeletePointer( ddDotTable );
-		if(  valueTables ) DeletePointer(  valueTables );
-		if( dValueTables ) DeletePointer( dValueTables );
-	}
+	clearDotTables( VV_DOT_FLAG | DV_DOT_FLAG | DD_DOT_FLAG );
+	clearValueTables();
+	DeletePointer( baseFunctions );
+	DeletePointer( baseBSplines );
 	functionCount = 0;
 }
 
@@ -101,6 +99,11 @@ void BSplineData<Degree,Real>::set( int maxDepth , bool useDotRatios , int bound
 	this->useDotRatios = useDotRatios;
 	this->boundaryType = boundaryType;
 
+	clearDotTables( VV_DOT_FLAG | DV_DOT_FLAG | DD_DOT_FLAG );
+	clearValueTables();
+	DeletePointer( baseFunctions );
+	DeletePointer( baseBSplines );
+
 	depth = maxDepth;
 	// [Warning] This assumes that the functions spacing is dual
 	functionCount = BinaryNode< double >::CumulativeCenterCount( depth );
@@ -170,27 +173,84 @@ void BSplineData<Degree,Real>::set( int maxDepth , bool useDotRatios , int bound
 		}
 	}
 }
+template< int Degree , class Real >
+typename BSplineData< Degree , Real >::_Table BSplineData< Degree , Real >::_FindTable( _TableCache& cache , const _TableKey& key )
+{
+	typename std::map< _TableKey , std::pair< _Table , unsigned long long > >::iterator iter = cache.tables.find( key );
+	if( iter==cache.tables.end() ) return _Table();
+	iter->second.second = ++cache.useCount;
+	return iter->second.first;
+}
+template< int Degree , class Real >
+void BSplineData< Degree , Real >::_AddTable( _TableCache& cache , const _TableKey& key , const _Table& table )
+{
+	if( !cache.maxBytes ) return;
+	cache.tables[key] = std::make_pair( table , ++cache.useCount );
+	cache.bytes += table->size() * sizeof( Real );
+	_EvictTables( cache , &key );
+}
+template< int Degree , class Real >
+void BSplineData< Degree , Real >::_EvictTables( _TableCache& cache , const _TableKey* keep )
+{
+	// Release the least recently used tables, those still in use are freed by their last user
+	while( cache.bytes>cache.maxBytes )
+	{
+		typename std::map< _TableKey , std::pair< _Table , unsigned long long > >::iterator oldest = cache.tables.end();
+		for( typename std::map< _TableKey , std::pair< _Table , unsigned long long > >::iterator iter=cache.tables.begin() ; iter!=cache.tables.end() ; iter++ )
+			if( ( !keep || iter->first!=*keep ) && ( oldest==cache.tables.end() || iter->second.second<oldest->second.second ) ) oldest = iter;
+		if( oldest==cache.tables.end() ) break;
+		cache.bytes -= oldest->second.first->size() * sizeof( Real );
+		cache.tables.erase( oldest );
+	}
+}
+template< int Degree , class Real >
+void BSplineData< Degree , Real >::SetTableCacheSize( size_t bytes )
+{
+	_TableCache& cache = _GetTableCache();
+	std::lock_guard< std::mutex > lock( cache.mutex );
+	cache.maxBytes = bytes;
+	_EvictTables( cache , NULL );
+}
+template< int Degree , class Real >
+void BSplineData< Degree , Real >::ClearTableCache( void )
+{
+	_TableCache& cache = _GetTableCache();
+	std::lock_guard< std::mutex > lock( cache.mutex );
+	cache.tables.clear();
+	cache.bytes = 0;
+}
 template<int Degree,class Real>
 void BSplineData<Degree,Real>::setDotTables( int flags , bool inset )
 {
 	clearDotTables( flags );
-	int size = ( functionCount*functionCount + functionCount )>>1;
-	int fullSize = functionCount*functionCount;
-	if( flags & VV_DOT_FLAG )
-	{
-		vvDotTable = NewPointer< Real >( size );
-		memset( vvDotTable , 0 , sizeof(Real)*size );
-	}
-	if( flags & DV_DOT_FLAG )
-	{
-		dvDotTable = NewPointer< Real >( fullSize );
-		memset( dvDotTable , 0 , sizeof(Real)*fullSize );
-	}
-	if( flags & DD_DOT_FLAG )
+	size_t size = ( size_t(functionCount)*functionCount + functionCount )>>1;
+	size_t fullSize = size_t(functionCount)*functionCount;
+	int option = ( useDotRatios ? 2 : 0 ) | ( inset ? 1 : 0 );
+	_TableKey vvKey( VV_DOT_FLAG , depth , boundaryType , option , 0 );
+	_TableKey dvKey( DV_DOT_FLAG , depth , boundaryType , option , 0 );
+	_TableKey ddKey( DD_DOT_FLAG , depth , boundaryType , option , 0 );
+
+	// The tables that are not cached are computed in one pass, under the lock so that they are only computed once
+	_TableCache& cache = _GetTableCache();
+	std::lock_guard< std::mutex > lock( cache.mutex );
+	int missing = 0;
+	if( ( flags & VV_DOT_FLAG ) && !( _vvDotTable = _FindTable( cache , vvKey ) ) ) _vvDotTable = std::make_shared< std::vector< Real > >(     size , Real(0) ) , missing |= VV_DOT_FLAG;
+	if( ( flags & DV_DOT_FLAG ) && !( _dvDotTable = _FindTable( cache , dvKey ) ) ) _dvDotTable = std::make_shared< std::vector< Real > >( fullSize , Real(0) ) , missing |= DV_DOT_FLAG;
+	if( ( flags & DD_DOT_FLAG ) && !( _ddDotTable = _FindTable( cache , ddKey ) ) ) _ddDotTable = std::make_shared< std::vector< Real > >(     size , Real(0) ) , missing |= DD_DOT_FLAG;
+	if( missing )
 	{
-		ddDotTable = NewPointer< Real >( size );
-		memset( ddDotTable , 0 , sizeof(Real)*size );
+		_computeDotTables( missing , inset , ( missing & VV_DOT_FLAG ) ? &(*_vvDotTable)[0] : NullPointer< Real >() , ( missing & DV_DOT_FLAG ) ? &(*_dvDotTable)[0] : NullPointer< Real >() , ( missing & DD_DOT_FLAG ) ? &(*_ddDotTable)[0] : NullPointer< Real >() );
+		if( missing & VV_DOT_FLAG ) _AddTable( cache , vvKey , _vvDotTable );
+		if( missing & DV_DOT_FLAG ) _AddTable( cache , dvKey , _dvDotTable );
+		if( missing & DD_DOT_FLAG ) _AddTable( cache , ddKey , _ddDotTable );
 	}
+	if( flags & VV_DOT_FLAG ) vvDotTable = &(*_vvDotTable)[0];
+	if( flags & DV_DOT_FLAG ) dvDotTable = &(*_dvDotTable)[0];
+	if( flags & DD_DOT_FLAG ) ddDotTable = &(*_ddDotTable)[0];
+}
+template< int Degree , class Real >
+void BSplineData< Degree , Real >::_computeDotTables( int flags , bool inset , Pointer( Real ) vv , Pointer( Real ) dv , Pointer( Real ) dd ) const
+{
 	double vvIntegrals[Degree+1][Degree+1];
 	double vdIntegrals[Degree+1][Degree  ];
 	double dvIntegrals[Degree  ][Degree+1];
@@ -262,18 +322,18 @@ void BSplineData<Degree,Real>::setDotTables( int flags , bool inset )
 					vdDot /= ( b1.denominator * b2.denominator );
 					ddDot /= ( b1.denominator * b2.denominator );
 					if( fabs(vvDot)<1e-15 ) continue;
-					if( flags & VV_DOT_FLAG ) vvDotTable [idx] = Real( vvDot );
+					if( flags & VV_DOT_FLAG ) vv[idx] = Real( vvDot );
 					if( useDotRatios )
 					{
-						if( flags & DV_DOT_FLAG ) dvDotTable[idx1] = Real( dvDot / vvDot );
-						if( flags & DV_DOT_FLAG ) dvDotTable[idx2] = Real( vdDot / vvDot );
-						if( flags & DD_DOT_FLAG ) ddDotTable[idx ] = Real( ddDot / vvDot );
+						if( flags & DV_DOT_FLAG ) dv[idx1] = Real( dvDot / vvDot );
+						if( flags & DV_DOT_FLAG ) dv[idx2] = Real( vdDot / vvDot );
+						if( flags & DD_DOT_FLAG ) dd[idx ] = Real( ddDot / vvDot );
 					}
 					else
 					{
-						if( flags & DV_DOT_FLAG ) dvDotTable[idx1] = Real( dvDot );
-						if( flags & DV_DOT_FLAG ) dvDotTable[idx2] = Real( dvDot );
-						if( flags & DD_DOT_FLAG ) ddDotTable[idx ] = Real( ddDot );
+						if( flags & DV_DOT_FLAG ) dv[idx1] = Real( dvDot );
+						if( flags & DV_DOT_FLAG ) dv[idx2] = Real( dvDot );
+						if( flags & DD_DOT_FLAG ) dd[idx ] = Real( ddDot );
 					}
 				}
 				BSplineElements< Degree > b;
@@ -292,9 +352,9 @@ void BSplineData<Degree,Real>::setDotTables( int flags , bool inset )
 template<int Degree,class Real>
 void BSplineData<Degree,Real>::clearDotTables( int flags )
 {
-	if( (flags & VV_DOT_FLAG) && vvDotTable ) DeletePointer( vvDotTable );
-	if( (flags & DV_DOT_FLAG) && dvDotTable ) DeletePointer( dvDotTable );
-	if( (flags & DD_DOT_FLAG) && ddDotTable ) DeletePointer( ddDotTable );
+	if( flags & VV_DOT_FLAG ) _vvDotTable.reset() , vvDotTable = NullPointer< Real >();
+	if( flags & DV_DOT_FLAG ) _dvDotTable.reset() , dvDotTable = NullPointer< Real >();
+	if( flags & DD_DOT_FLAG ) _ddDotTable.reset() , ddDotTable = NullPointer< Real >();
 }
 template< int Degree , class Real >
 void BSplineData< Degree , Real >::setSampleSpan( int idx , int& start , int& end , double smooth ) const
@@ -318,51 +378,53 @@ void BSplineData< Degree , Real >::setSampleSpan( int idx , int& start , int& en
 template<int Degree,class Real>
 void BSplineData<Degree,Real>::setValueTables( int flags , double smooth )
 {
-	clearValueTables();
-	if( flags &   VALUE_FLAG )  valueTables = NewPointer< Real >( functionCount*sampleCount );
-	if( flags & D_VALUE_FLAG ) dValueTables = NewPointer< Real >( functionCount*sampleCount );
-	PPolynomial<Degree+1> function;
-	PPolynomial<Degree>  dFunction;
-	for( int i=0 ; i<functionCount ; i++ )
-	{
-		if(smooth>0)
-		{
-			function  = baseFunctions[i].MovingAverage(smooth);
-			dFunction = baseFunctions[i].derivative().MovingAverage(smooth);
-		}
-		else
-		{
-			function  = baseFunctions[i];
-			dFunction = baseFunctions[i].derivative();
-		}
-		for( int j=0 ; j<sampleCount ; j++ )
-		{
-			double x=double(j)/(sampleCount-1);
-			if( flags &   VALUE_FLAG )  valueTables[j*functionCount+i] = Real(  function(x) );
-			if( flags & D_VALUE_FLAG ) dValueTables[j*functionCount+i] = Real( dFunction(x) );
-		}
-	}
+	setValueTables( flags , smooth , smooth );
 }
 template<int Degree,class Real>
 void BSplineData<Degree,Real>::setValueTables( int flags , double valueSmooth , double derivativeSmooth )
 {
 	clearValueTables();
-	if(flags &   VALUE_FLAG)  valueTables = NewPointer< Real >( functionCount*sampleCount );
-	if(flags & D_VALUE_FLAG) dValueTables = NewPointer< Real >( functionCount*sampleCount );
+	size_t size = size_t(functionCount)*sampleCount;
+	_TableKey  valueKey(   VALUE_FLAG<<3 , depth , boundaryType , 0 , valueSmooth>0      ? valueSmooth      : 0 );
+	_TableKey dValueKey( D_VALUE_FLAG<<3 , depth , boundaryType , 0 , derivativeSmooth>0 ? derivativeSmooth : 0 );
+
+	_TableCache& cache = _GetTableCache();
+	std::lock_guard< std::mutex > lock( cache.mutex );
+	int missing = 0;
+	if( ( flags &   VALUE_FLAG ) && !(  _valueTables = _FindTable( cache ,  valueKey ) ) )  _valueTables = std::make_shared< std::vector< Real > >( size ) , missing |=   VALUE_FLAG;
+	if( ( flags & D_VALUE_FLAG ) && !( _dValueTables = _FindTable( cache , dValueKey ) ) ) _dValueTables = std::make_shared< std::vector< Real > >( size ) , missing |= D_VALUE_FLAG;
+	if( missing )
+	{
+		_computeValueTables( missing , valueSmooth , derivativeSmooth , ( missing & VALUE_FLAG ) ? &(*_valueTables)[0] : NullPointer< Real >() , ( missing & D_VALUE_FLAG ) ? &(*_dValueTables)[0] : NullPointer< Real >() );
+		if( missing &   VALUE_FLAG ) _AddTable( cache ,  valueKey ,  _valueTables );
+		if( missing & D_VALUE_FLAG ) _AddTable( cache , dValueKey , _dValueTables );
+	}
+	if( flags &   VALUE_FLAG )  valueTables = &(* _valueTables)[0];
+	if( flags & D_VALUE_FLAG ) dValueTables = &(*_dValueTables)[0];
+}
+template< int Degree , class Real >
+void BSplineData< Degree , Real >::_computeValueTables( int flags , double valueSmooth , double derivativeSmooth , Pointer( Real ) values , Pointer( Real ) dValues ) const
+{
 	PPolynomial<Degree+1> function;
 	PPolynomial<Degree>  dFunction;
 	for( int i=0 ; i<functionCount ; i++ )
 	{
-		if( valueSmooth>0 )      function=baseFunctions[i].MovingAverage( valueSmooth );
-		else                     function=baseFunctions[i];
-		if( derivativeSmooth>0 ) dFunction=baseFunctions[i].derivative().MovingAverage( derivativeSmooth );
-		else                     dFunction=baseFunctions[i].derivative();
+		if( flags & VALUE_FLAG )
+		{
+			if( valueSmooth>0 )      function=baseFunctions[i].MovingAverage( valueSmooth );
+			else                     function=baseFunctions[i];
+		}
+		if( flags & D_VALUE_FLAG )
+		{
+			if( derivativeSmooth>0 ) dFunction=baseFunctions[i].derivative().MovingAverage( derivativeSmooth );
+			else                     dFunction=baseFunctions[i].derivative();
+		}
 
 		for( int j=0 ; j<sampleCount ; j++ )
 		{
 			double x=double(j)/(sampleCount-1);
-			if( flags &   VALUE_FLAG )  valueTables[j*functionCount+i] = Real( function(x));
-			if( flags & D_VALUE_FLAG ) dValueTables[j*functionCount+i] = Real(dFunction(x));
+			if( flags &   VALUE_FLAG )  values[j*functionCount+i] = Real( function(x));
+			if( flags & D_VALUE_FLAG ) dValues[j*functionCount+i] = Real(dFunction(x));
 		}
 	}
 }
@@ -370,8 +432,8 @@ void BSplineData<Degree,Real>::setValueTables( int flags , double valueSmooth ,
 
 template<int Degree,class Real>
 void BSplineData<Degree,Real>::clearValueTables(void){
-	if(  valueTables ) DeletePointer(  valueTables );
-	if( dValueTables ) DeletePointer( dValueTables );
+	_valueTables.reset() , valueTables = NullPointer< Real >();
+	_dValueTables.reset() , dValueTables = NullPointer< Real >();
 }
 
 template<int Degree,class Real>
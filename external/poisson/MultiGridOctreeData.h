@@ -139,6 +139,10 @@ public:
 	SortedTreeNodes( void );
 	~SortedTreeNodes( void );
 	void set( TreeOctNode& root );
+	// Sets the spans [first,last) of the nodes below rootNode (or of the whole tree if NULL)
+	// in treeNodes for all depths up to maxDepth, with (-1,-1) for depths without nodes.
+	// Returns the depth of rootNode.
+	int setSpans( std::vector< std::pair< int , int > >& spans , const TreeOctNode* rootNode , int maxDepth ) const;
 	struct CornerIndices
 	{
 		int idx[Cube::CORNERS];
@@ -189,17 +193,71 @@ public:
 	int getMaxEdgeCount( const TreeOctNode* rootNode , int depth , int threads ) const ;
 };
 
+// A Morton index of the nodes of SortedTreeNodes, the nodes themselves stay in the OctNode tree. Each depth is a
+// range of nodes sorted by their Morton keys (key = parentKey<<3 | corner index, as for the samples in
+// Octree::setTree), so a node is found by a binary search
+// for its key, the parent and the first of the eight consecutive children of a node are found by key arithmetic when
+// the octree is set, and the neighbors of a node are the children of the neighbors of its parent. The node pointers
+// are not followed, only the node data is read through them.
+// With three bits per depth, trees deeper than MaxDepth are not supported.
+template< bool OutputDensity >
+class LinearOctree
+{
+	typedef OctNode< TreeNodeData< OutputDensity > , Real > TreeOctNode;
+	const SortedTreeNodes< OutputDensity >* _sNodes;
+	std::vector< unsigned long long > _keys;
+	std::vector< int > _parents , _children;	// the index of the parent and of the first child (-1 for leaves)
+public:
+	static const int MaxDepth = 21;
+	LinearOctree( void ) { _sNodes = NULL; }
+	// Sets the keys of the nodes of sNodes, returns false (and clears the octree) if the tree is too deep.
+	bool set( const SortedTreeNodes< OutputDensity >& sNodes , int threads );
+	void clear( void );
+	bool empty( void ) const { return _sNodes==NULL; }
+	static unsigned long long Key( const int off[3] , int depth );
+	// The index of the node with the given key at the given depth, -1 if there is none
+	int index( unsigned long long key , int depth ) const;
+	int parent( int idx ) const { return _sNodes ? _parents[idx] : -1; }
+
+	// A neighbor key (Key is one of the neighbor keys of TreeOctNode, with neighborhoods of Width^3 Neighbors) that sets
+	// the neighbors from the linear octree passed to set, or from the node pointers as Key does if it is NULL.
+	template< class Key , class Neighbors , int Width >
+	class NeighborKey : public Key
+	{
+		const LinearOctree* _tree;
+		std::vector< int > _indices;	// the neighbor indices, Width^3 per depth
+		void _setNeighbors( int idx , int depth );
+	public:
+		NeighborKey( void ) { _tree = NULL; }
+		void set( int depth , const LinearOctree* tree );
+		// idx is the index of node in the sorted nodes, if it is -1 it is found from the key of node and the nodes in the key
+		template< class Node > Neighbors& getNeighbors( Node* node , int idx=-1 );
+	};
+};
+
 
 template< int Degree , bool OutputDensity >
 class Octree
 {
 	typedef OctNode< TreeNodeData< OutputDensity > , Real > TreeOctNode;
+	// The neighbor keys of the solver and the iso-surface extraction, using _lNodes if it is set
+	typedef typename LinearOctree< OutputDensity >::template NeighborKey< typename TreeOctNode::NeighborKey3 , typename TreeOctNode::Neighbors3 , 3 > NeighborKey3;
+	typedef typename LinearOctree< OutputDensity >::template NeighborKey< typename TreeOctNode::NeighborKey5 , typename TreeOctNode::Neighbors5 , 5 > NeighborKey5;
+	typedef typename LinearOctree< OutputDensity >::template NeighborKey< typename TreeOctNode::ConstNeighborKey3 , typename TreeOctNode::ConstNeighbors3 , 3 > ConstNeighborKey3;
+	typedef typename LinearOctree< OutputDensity >::template NeighborKey< typename TreeOctNode::ConstNeighborKey5 , typename TreeOctNode::ConstNeighbors5 , 5 > ConstNeighborKey5;
+	Allocator< TreeOctNode > _nodeAllocator;
 	SortedTreeNodes< OutputDensity > _sNodes;
+	LinearOctree< OutputDensity > _lNodes;
+	// Sets _sNodes (and _lNodes if linearOctree is set) from the tree
+	void _setSortedNodes( void );
+	// The linear octree for the neighbor keys, NULL if the neighbors are set from the node pointers
+	const LinearOctree< OutputDensity >* _linearTree( void ) const { return _lNodes.empty() ? NULL : &_lNodes; }
 	Real samplesPerNode;
 	int splatDepth;
 	int _minDepth;
 	bool _constrainValues;
 	int _boundaryType;
+	int _finalizedDepth;	// the subdivision depth of the last finalize, -1 before
 	Real _scale;
 	Point3D< Real > _center;
 	std::vector< int > _pointCount;
@@ -250,10 +308,13 @@ class Octree
 
 	int _SolveFixedDepthMatrix( int depth , const SortedTreeNodes< OutputDensity >& sNodes , Real* subConstraints ,                     bool showResidual , int minIters , double accuracy , bool noSolve = false , int fixedIters=-1 );
 	int _SolveFixedDepthMatrix( int depth , const SortedTreeNodes< OutputDensity >& sNodes , Real* subConstraints , int startingDepth , bool showResidual , int minIters , double accuracy , bool noSolve = false , int fixedIters=-1 );
+	int _SolveSystem( const CSRSymmetricMatrix< MatrixReal >& M , const PoissonVector< Real >& B , int iters , PoissonVector< Real >& X , Real eps , bool addDCTerm );
 
 	void SetMatrixRowBounds( const TreeOctNode* node , int rDepth , const int rOff[3] , int& xStart , int& xEnd , int& yStart , int& yEnd , int& zStart , int& zEnd ) const;
 	int GetMatrixRowSize( const typename TreeOctNode::Neighbors5& neighbors5 ) const;
 	int GetMatrixRowSize( const typename TreeOctNode::Neighbors5& neighbors5 , int xStart , int xEnd , int yStart , int yEnd , int zStart , int zEnd ) const;
+	// The row size if all neighbors within the bounds exist
+	static int GetMatrixRowBound( int xStart , int xEnd , int yStart , int yEnd , int zStart , int zEnd );
 	int SetMatrixRow( const typename TreeOctNode::Neighbors5& neighbors5 , Pointer( MatrixEntry< MatrixReal > ) row , int offset , const double stencil[5][5][5] ) const;
 	int SetMatrixRow( const typename TreeOctNode::Neighbors5& neighbors5 , Pointer( MatrixEntry< MatrixReal > ) row , int offset , const double stencil[5][5][5] , int xStart , int xEnd , int yStart , int yEnd , int zStart , int zEnd ) const;
 	void SetDivergenceStencil( int depth , Point3D< double > stencil[5][5][5] , bool scatter ) const;
@@ -271,10 +332,10 @@ class Octree
 	void DownSampleFinerConstraints( int depth , SortedTreeNodes< OutputDensity >& sNodes ) const;
 	template< class C > void DownSample( int depth , const SortedTreeNodes< OutputDensity >& sNodes , C* constraints ) const;
 	template< class C > void   UpSample( int depth , const SortedTreeNodes< OutputDensity >& sNodes , C* coefficients ) const;
-	int GetFixedDepthLaplacian( SparseSymmetricMatrix< Real >& matrix , int depth , const SortedTreeNodes< OutputDensity >& sNodes , Real* subConstraints );
-	int GetRestrictedFixedDepthLaplacian( SparseSymmetricMatrix< Real >& matrix , int depth , const int* entries , int entryCount , const TreeOctNode* rNode, Real radius , const SortedTreeNodes< OutputDensity >& sNodes , Real* subConstraints );
+	int GetFixedDepthLaplacian( CSRSymmetricMatrix< MatrixReal >& matrix , int depth , const SortedTreeNodes< OutputDensity >& sNodes , Real* subConstraints );
+	int GetRestrictedFixedDepthLaplacian( CSRSymmetricMatrix< MatrixReal >& matrix , int depth , const int* entries , int entryCount , const TreeOctNode* rNode, Real radius , const SortedTreeNodes< OutputDensity >& sNodes , Real* subConstraints );
 
-	void SetIsoCorners( Real isoValue , TreeOctNode* leaf , typename SortedTreeNodes< OutputDensity >::CornerTableData& cData , Pointer( char ) valuesSet , Pointer( Real ) values , typename TreeOctNode::ConstNeighborKey3& nKey , const Real* metSolution , const Stencil< Real , 3 > stencil1[8] , const Stencil< Real , 3 > stencil2[8][8] );
+	void SetIsoCorners( Real isoValue , TreeOctNode* leaf , typename SortedTreeNodes< OutputDensity >::CornerTableData& cData , Pointer( char ) valuesSet , Pointer( Real ) values , ConstNeighborKey3& nKey , const Real* metSolution , const Stencil< Real , 3 > stencil1[8] , const Stencil< Real , 3 > stencil2[8][8] );
 	static int IsBoundaryFace( const TreeOctNode* node , int faceIndex , int subdivideDepth );
 	static int IsBoundaryEdge( const TreeOctNode* node , int edgeIndex , int subdivideDepth );
 	static int IsBoundaryEdge( const TreeOctNode* node , int dir , int x , int y , int subidivideDepth );
@@ -299,7 +360,7 @@ class Octree
 	template< class Vertex >
 	int SetBoundaryMCRootPositions( int sDepth , Real isoValue , RootData& rootData , CoredMeshData< Vertex >* mesh , int nonLinearFit );
 	template< class Vertex >
-	int SetMCRootPositions( TreeOctNode* node , int sDepth , Real isoValue , typename TreeOctNode::ConstNeighborKey5& neighborKey5 , RootData& rootData ,
+	int SetMCRootPositions( TreeOctNode* node , int sDepth , Real isoValue , ConstNeighborKey5& neighborKey5 , RootData& rootData ,
 		std::vector< Vertex >* interiorVertices , CoredMeshData< Vertex >* mesh , const Real* metSolution , int nonLinearFit );
 	template< class Vertex >
 	int GetMCIsoTriangles( TreeOctNode* node , CoredMeshData< Vertex >* mesh , RootData& rootData ,
@@ -313,7 +374,7 @@ class Octree
 	static int EdgeRootCount( const TreeOctNode* node , int edgeIndex , int maxDepth );
 	static void GetRootSpan( const RootInfo< OutputDensity >& ri , Point3D< Real >& start , Point3D< Real >& end );
 	template< class Vertex >
-	int GetRoot( const RootInfo< OutputDensity >& ri , Real isoValue , typename TreeOctNode::ConstNeighborKey5& neighborKey5 , Vertex& vertex , RootData& rootData , int sDepth , const Real* metSolution , int nonLinearFit );
+	int GetRoot( const RootInfo< OutputDensity >& ri , Real isoValue , ConstNeighborKey5& neighborKey5 , Vertex& vertex , RootData& rootData , int sDepth , const Real* metSolution , int nonLinearFit );
 	static int GetRootIndex( const TreeOctNode* node , int edgeIndex , int maxDepth , RootInfo< OutputDensity >& ri );
 	static int GetRootIndex( const TreeOctNode* node , int edgeIndex , int maxDepth , int sDepth , RootInfo< OutputDensity >& ri );
 	static int GetRootIndex( const RootInfo< OutputDensity >& ri , RootData& rootData , CoredPointIndex& index );
@@ -333,6 +394,25 @@ class Octree
 	Real SplatOrientedPoint( const Point3D<Real>& point , const Point3D<Real>& normal , typename TreeOctNode::NeighborKey3& neighborKey , int kernelDepth , Real samplesPerNode , int minDepth , int maxDepth );
 	Real SplatOrientedPoint( const Point3D<Real>& point , const Point3D<Real>& normal , typename TreeOctNode::NeighborKey3& neighborKey3 , typename TreeOctNode::NeighborKey5& neighborKey5 , int kernelDepth , Real samplesPerNode , int minDepth , int maxDepth );
 
+	// The sorted (parallel) construction of setTree. The samples are sorted by their Morton keys, such that the samples
+	// in a node at any depth form a range of the sorted samples. The nodes are created level by level for these ranges,
+	// and the splats are summed per range and added to the neighbors of the range's node.
+	typedef std::pair< unsigned long long , size_t > SampleKey;
+	struct SampleRange
+	{
+		size_t begin , end;
+		TreeOctNode* node;
+	};
+	template< class PointT >
+	int _setSortedTree( const PointT* _pts , const PointT* _normals , size_t _n , int maxDepth , int splatDepth , Real samplesPerNode ,
+	                    int useConfidence , const XForm4x4< Real >& xForm , const XForm3x3< Real >& xFormN , double& pointWeightSum );
+	static unsigned long long _SampleKey( const Point3D< Real >& position , int maxDepth );
+	static void _SortSampleKeys( std::vector< SampleKey >& keys , int threads );
+	static int _SplatDepth( Real depth , int minDepth , int maxDepth , double& dx );
+	TreeOctNode* _sampleNode( unsigned long long key , int depth , int maxDepth );
+	void _splitSampleRanges( const std::vector< SampleRange >& ranges , const std::vector< SampleKey >& keys , int depth , int maxDepth , bool existing , std::vector< SampleRange >& children ) const;
+	void _colorSampleRanges( const std::vector< SampleRange >& ranges , const std::vector< size_t >& indices , std::vector< size_t >& order , std::vector< size_t >& colorStart ) const;
+
 	int HasNormals(TreeOctNode* node,Real epsilon);
 	Real getCornerValue( const typename TreeOctNode::ConstNeighborKey3& neighborKey3 , const TreeOctNode* node , int corner , const Real* metSolution );
 	Point3D< Real > getCornerNormal( const typename TreeOctNode::ConstNeighborKey5& neighborKey5 , const TreeOctNode* node , int corner , const Real* metSolution );
@@ -342,11 +422,21 @@ class Octree
 	static bool _IsInsetSupported( const TreeOctNode* node );
 public:
 	int threads;
+	// solve the linear systems in double instead of float precision (the matrices stay in float)
+	bool doublePrecisionSolver;
+	// build the tree from the Morton-sorted samples (see _setSortedTree) instead of inserting them one by one
+	bool sortedTree;
+	// set the neighbors in the solver and the iso-surface extraction from the linear octree (see LinearOctree)
+	// instead of following the node pointers (off by default: the index is built on top of the node pointers, it adds
+	// 16 bytes per node and is not faster)
+	bool linearOctree;
 	std::vector< Point3D<Real> >* normals;
 	Real postDerivativeSmooth;
 	TreeOctNode tree;
 	BSplineData< Degree , Real > fData;
 	Octree( void );
+	// bytes of the blocks holding the nodes of this tree
+	size_t nodeMemoryUsage( void ) const { return _nodeAllocator.memoryUsage(); }
 
 	void setBSplineData( int maxDepth , int boundaryType=BSplineElements< Degree >::NONE );
 	void finalize( int subdivisionDepth );
@@ -356,8 +446,12 @@ public:
         // int setTree( char* fileName , int maxDepth , int minDepth , int kernelDepth , Real samplesPerNode ,
         //              Real scaleFactor , int useConfidence , Real constraintWeight , int adaptiveExponent , XForm4x4< Real > xForm=XForm4x4< Real >::Identity );
 
-    int setTree(std::vector< Point3D<float> >& _points,
-                std::vector< Point3D<float> >& _normals,
+    // _points and _normals are arrays of _n elements of a type with
+    // operator[] for the coordinates, e.g. Point3D<float>
+    template< class PointT >
+    int setTree(const PointT* _points,
+                const PointT* _normals,
+                size_t _n,
                 int maxDepth ,
                 int minDepth ,
                 int kernelDepth ,
@@ -375,6 +469,17 @@ public:
 	Real GetIsoValue( void );
 	template< class Vertex >
 	void GetMCIsoTriangles( Real isoValue , int subdivideDepth , CoredMeshData< Vertex >* mesh , int fullDepthIso=0 , int nonLinearFit=1 , bool addBarycenter=false , bool polygonMesh=false );
+	// Extract the iso-surface as GetMCIsoTriangles does, after refining the tree for subdivideDepth as finalize does. The
+	// nodes added for the extraction are removed afterwards, so that a solved tree can be extracted repeatedly with
+	// different subdivision depths and the result does not depend on earlier extractions.
+	template< class Vertex >
+	void ExtractMCIsoTriangles( Real isoValue , int subdivideDepth , CoredMeshData< Vertex >* mesh , bool addBarycenter=false , bool polygonMesh=false );
+
+	// Write/read the solved tree: the B-spline data parameters, the transformation to the unit cube, the subdivision
+	// depth it was finalized for, and the topology, solution coefficients and center weights of the nodes, such that
+	// GetIsoValue and ExtractMCIsoTriangles can be called on the read tree. read expects a tree without nodes besides the root. Both return 0 on failure.
+	int write( FILE* fp ) const;
+	int read( FILE* fp );
 };
 
 #include "MultiGridOctreeData.inl"
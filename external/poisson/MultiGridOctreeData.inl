@@ -28,10 +28,11 @@ DAMAGE.
 
 #include "Octree.h"
 #include "MAT.h"
+#include <algorithm>
+#include <cstring>
 
 #define ITERATION_POWER 1.0/3
 #define MEMORY_ALLOCATOR_BLOCK_SIZE 1<<12
-//#define MEMORY_ALLOCATOR_BLOCK_SIZE 0
 #define SPLAT_ORDER 2
 
 const Real MATRIX_ENTRY_EPSILON = Real(0);
@@ -84,35 +85,24 @@ void SortedTreeNodes< OutputDensity >::set( TreeOctNode& root )
 	for( int i=0 ; i<nodeCount[maxDepth] ; i++ ) treeNodes[i]->nodeData.nodeIndex = i;
 }
 template< bool OutputDensity >
-typename SortedTreeNodes< OutputDensity >::CornerIndices& SortedTreeNodes< OutputDensity >::CornerTableData::operator[] ( const TreeOctNode* node ) { return cTable[ node->nodeData.nodeIndex + offsets[node->d] ]; }
-template< bool OutputDensity >
-const typename SortedTreeNodes< OutputDensity >::CornerIndices& SortedTreeNodes< OutputDensity >::CornerTableData::operator[] ( const TreeOctNode* node ) const { return cTable[ node->nodeData.nodeIndex + offsets[node->d] ]; }
-template< bool OutputDensity >
-typename SortedTreeNodes< OutputDensity >::CornerIndices& SortedTreeNodes< OutputDensity >::CornerTableData::cornerIndices( const TreeOctNode* node ) { return cTable[ node->nodeData.nodeIndex + offsets[node->d] ]; }
-template< bool OutputDensity >
-const typename SortedTreeNodes< OutputDensity >::CornerIndices& SortedTreeNodes< OutputDensity >::CornerTableData::cornerIndices( const TreeOctNode* node ) const { return cTable[ node->nodeData.nodeIndex + offsets[node->d] ]; }
-template< bool OutputDensity >
-void SortedTreeNodes< OutputDensity >::setCornerTable( CornerTableData& cData , const TreeOctNode* rootNode , int maxDepth , int threads ) const
+int SortedTreeNodes< OutputDensity >::setSpans( std::vector< std::pair< int , int > >& spans , const TreeOctNode* rootNode , int maxDepth ) const
 {
-	if( threads<=0 ) threads = 1;
-	// The vector of per-depth node spans
-	std::vector< std::pair< int , int > > spans( this->maxDepth , std::pair< int , int >( -1 , -1 ) );
-	int minDepth , off[3];
-	cData.offsets.resize( this->maxDepth , -1 );
+	// The nodes of each depth are in Morton order, so the descendants of a
+	// node at a finer depth are the nodes between the first child of the
+	// first and the last child of the last interior node of the span above.
+	spans.assign( this->maxDepth , std::pair< int , int >( -1 , -1 ) );
+	int minDepth;
 	int start = 0;
 	int end = 0;
-	if( rootNode ) rootNode->depthAndOffset( minDepth , off ) , start = end = rootNode->nodeData.nodeIndex;
+	if( rootNode ) minDepth = rootNode->depth() , start = end = rootNode->nodeData.nodeIndex;
 	else
 	{
 		start = 0;
 		for( minDepth=0 ; minDepth<=this->maxDepth ; minDepth++ ) if( nodeCount[minDepth+1] ){ end = nodeCount[minDepth+1]-1 ; break; }
 	}
-	int nodeCount = 0;
 	for( int d=minDepth ; d<=maxDepth ; d++ )
 	{
 		spans[d] = std::pair< int , int >( start , end+1 );
-		cData.offsets[d] = nodeCount - spans[d].first;
-		nodeCount += spans[d].second - spans[d].first;
 		if( d<maxDepth )
 		{
 			while( start< end && !treeNodes[start]->children ) start++;
@@ -122,6 +112,31 @@ void SortedTreeNodes< OutputDensity >::setCornerTable( CornerTableData& cData ,
 			end   = treeNodes[end  ]->children[7].nodeData.nodeIndex;
 		}
 	}
+	return minDepth;
+}
+template< bool OutputDensity >
+typename SortedTreeNodes< OutputDensity >::CornerIndices& SortedTreeNodes< OutputDensity >::CornerTableData::operator[] ( const TreeOctNode* node ) { return cTable[ node->nodeData.nodeIndex + offsets[node->d] ]; }
+template< bool OutputDensity >
+const typename SortedTreeNodes< OutputDensity >::CornerIndices& SortedTreeNodes< OutputDensity >::CornerTableData::operator[] ( const TreeOctNode* node ) const { return cTable[ node->nodeData.nodeIndex + offsets[node->d] ]; }
+template< bool OutputDensity >
+typename SortedTreeNodes< OutputDensity >::CornerIndices& SortedTreeNodes< OutputDensity >::CornerTableData::cornerIndices( const TreeOctNode* node ) { return cTable[ node->nodeData.nodeIndex + offsets[node->d] ]; }
+template< bool OutputDensity >
+const typename SortedTreeNodes< OutputDensity >::CornerIndices& SortedTreeNodes< OutputDensity >::CornerTableData::cornerIndices( const TreeOctNode* node ) const { return cTable[ node->nodeData.nodeIndex + offsets[node->d] ]; }
+template< bool OutputDensity >
+void SortedTreeNodes< OutputDensity >::setCornerTable( CornerTableData& cData , const TreeOctNode* rootNode , int maxDepth , int threads ) const
+{
+	if( threads<=0 ) threads = 1;
+	// The vector of per-depth node spans
+	std::vector< std::pair< int , int > > spans;
+	int minDepth = setSpans( spans , rootNode , maxDepth ) , off[3] = { 0 , 0 , 0 };
+	if( rootNode ) rootNode->depthAndOffset( minDepth , off );
+	cData.offsets.resize( this->maxDepth , -1 );
+	int nodeCount = 0;
+	for( int d=minDepth ; d<=maxDepth && spans[d].first>=0 ; d++ )
+	{
+		cData.offsets[d] = nodeCount - spans[d].first;
+		nodeCount += spans[d].second - spans[d].first;
+	}
 
 	cData.cTable.resize( nodeCount );
 	std::vector< int > count( threads );
@@ -293,35 +308,15 @@ template< bool OutputDensity >
 void SortedTreeNodes< OutputDensity >::setEdgeTable( EdgeTableData& eData , const TreeOctNode* rootNode , int maxDepth , int threads )
 {
 	if( threads<=0 ) threads = 1;
-	std::vector< std::pair< int , int > > spans( this->maxDepth , std::pair< int , int >( -1 , -1 ) );
-
-	int minDepth;
+	std::vector< std::pair< int , int > > spans;
+	int minDepth = setSpans( spans , rootNode , maxDepth );
 	eData.offsets.resize( this->maxDepth , -1 );
-	int start = 0;
-	int end = 0;
-	if( rootNode ) minDepth = rootNode->depth() , start = end = rootNode->nodeData.nodeIndex;
-	else
-	{
-		start = 0;
-		for( minDepth=0 ; minDepth<=this->maxDepth ; minDepth++ ) if( nodeCount[minDepth+1] ){ end = nodeCount[minDepth+1]-1 ; break; }
-	}
 
 	int nodeCount = 0;
+	for( int d=minDepth ; d<=maxDepth && spans[d].first>=0 ; d++ )
 	{
-		for( int d=minDepth ; d<=maxDepth ; d++ )
-		{
-			spans[d] = std::pair< int , int >( start , end+1 );
-			eData.offsets[d] = nodeCount - spans[d].first;
-			nodeCount += spans[d].second - spans[d].first;
-			if( d<maxDepth )
-			{
-				while( start< end && !treeNodes[start]->children ) start++;
-				while( end> start && !treeNodes[end  ]->children ) end--;
-				if(    start==end && !treeNodes[start]->children ) break;
-				start = treeNodes[start]->children[0].nodeData.nodeIndex;
-				end   = treeNodes[end  ]->children[7].nodeData.nodeIndex;
-			}
-		}
+		eData.offsets[d] = nodeCount - spans[d].first;
+		nodeCount += spans[d].second - spans[d].first;
 	}
 	eData.eTable.resize( nodeCount );
 	std::vector< int > count( threads );
@@ -471,6 +466,139 @@ int SortedTreeNodes< OutputDensity >::getMaxEdgeCount( const TreeOctNode* /*root
 }
 
 
+//////////////////
+// LinearOctree //
+//////////////////
+template< bool OutputDensity >
+bool LinearOctree< OutputDensity >::set( const SortedTreeNodes< OutputDensity >& sNodes , int threads )
+{
+	clear();
+	if( sNodes.maxDepth-1>MaxDepth ) return false;
+	int nodeCount = sNodes.nodeCount[ sNodes.maxDepth ];
+	_keys.resize( nodeCount ) , _parents.resize( nodeCount ) , _children.resize( nodeCount );
+#pragma omp parallel for num_threads( threads )
+	for( int i=0 ; i<nodeCount ; i++ )
+	{
+		int d , off[3];
+		sNodes.treeNodes[i]->depthAndOffset( d , off );
+		_keys[i] = Key( off , d ) , _children[i] = -1;
+	}
+	_sNodes = &sNodes;
+
+	// The key of the parent is the key of the node without the last corner index, and the eight children of a node
+	// are stored consecutively, starting with the child at corner index zero.
+	_parents[0] = -1;
+	for( int d=1 ; d<sNodes.maxDepth ; d++ )
+	{
+#pragma omp parallel for num_threads( threads )
+		for( int i=sNodes.nodeCount[d] ; i<sNodes.nodeCount[d+1] ; i++ )
+		{
+			_parents[i] = index( _keys[i]>>3 , d-1 );
+			if( !( _keys[i]&7 ) ) _children[ _parents[i] ] = i;
+		}
+	}
+	return true;
+}
+template< bool OutputDensity >
+void LinearOctree< OutputDensity >::clear( void )
+{
+	_sNodes = NULL;
+	std::vector< unsigned long long >().swap( _keys );
+	std::vector< int >().swap( _parents );
+	std::vector< int >().swap( _children );
+}
+template< bool OutputDensity >
+unsigned long long LinearOctree< OutputDensity >::Key( const int off[3] , int depth )
+{
+	unsigned long long key = 0;
+	for( int d=depth-1 ; d>=0 ; d-- ) key = ( key<<3 ) | (unsigned long long)( ( (off[0]>>d)&1 ) | ( ( (off[1]>>d)&1 )<<1 ) | ( ( (off[2]>>d)&1 )<<2 ) );
+	return key;
+}
+template< bool OutputDensity >
+int LinearOctree< OutputDensity >::index( unsigned long long key , int depth ) const
+{
+	if( depth<0 || depth>=_sNodes->maxDepth ) return -1;
+	const unsigned long long* begin = &_keys[0] + _sNodes->nodeCount[depth];
+	const unsigned long long* end   = &_keys[0] + _sNodes->nodeCount[depth+1];
+	const unsigned long long* iter = std::lower_bound( begin , end , key );
+	return ( iter!=end && *iter==key ) ? int( iter - &_keys[0] ) : -1;
+}
+template< bool OutputDensity >
+template< class Key , class Neighbors , int Width >
+void LinearOctree< OutputDensity >::NeighborKey< Key , Neighbors , Width >::set( int depth , const LinearOctree* tree )
+{
+	Key::set( depth );
+	_tree = tree;
+	if( _tree ) _indices.assign( (depth+1) * Width * Width * Width , -1 );
+	else std::vector< int >().swap( _indices );
+}
+template< bool OutputDensity >
+template< class Key , class Neighbors , int Width >
+template< class Node >
+Neighbors& LinearOctree< OutputDensity >::NeighborKey< Key , Neighbors , Width >::getNeighbors( Node* node , int idx )
+{
+	if( !_tree ) return Key::getNeighbors( node );
+	int depth = node->depth();
+	if( idx<0 )
+	{
+		if( Key::neighbors[depth].neighbors[Width/2][Width/2][Width/2]==node ) return Key::neighbors[depth];
+		// Descend from the finest ancestor in the key (the root at the latest) by the corner indices in the key of node
+		const int W3 = Width*Width*Width , center = ( (Width/2)*Width+Width/2 )*Width+Width/2;
+		int d , off[3];
+		node->depthAndOffset( d , off );
+		unsigned long long key = LinearOctree::Key( off , d );
+		int a = d;
+		while( a>0 && ( _indices[ a*W3+center ]<0 || _tree->_keys[ _indices[ a*W3+center ] ]!=( key>>( 3*(d-a) ) ) ) ) a--;
+		idx = a>0 ? _indices[ a*W3+center ] : 0;
+		for( a++ ; a<=d && idx>=0 ; a++ ) idx = _tree->_children[idx]<0 ? -1 : _tree->_children[idx] + int( ( key>>( 3*(d-a) ) ) & 7 );
+		if( idx<0 ) fprintf( stderr , "[ERROR] LinearOctree::NeighborKey::getNeighbors: node not in the octree\n" ) , exit( 0 );
+	}
+	_setNeighbors( idx , depth );
+	return Key::neighbors[depth];
+}
+template< bool OutputDensity >
+template< class Key , class Neighbors , int Width >
+void LinearOctree< OutputDensity >::NeighborKey< Key , Neighbors , Width >::_setNeighbors( int idx , int depth )
+{
+	const int R = Width/2 , W3 = Width*Width*Width;
+	int* indices = &_indices[ depth*W3 ];
+	if( indices[ (R*Width+R)*Width+R ]==idx ) return;
+	if( !depth )
+	{
+		for( int i=0 ; i<W3 ; i++ ) indices[i] = -1;
+		indices[ (R*Width+R)*Width+R ] = idx;
+	}
+	else
+	{
+		// The neighbor at offset i-R of a node with corner index c1 is the child with corner index (c1+i-R)&1 of
+		// the neighbor at offset floor( (c1+i-R)/2 ) of the parent. The indices are shifted by two to stay positive.
+		_setNeighbors( _tree->_parents[idx] , depth-1 );
+		const int* pIndices = &_indices[ (depth-1)*W3 ];
+		int c1 = int( _tree->_keys[idx] & 7 ) , x1 = c1&1 , y1 = (c1>>1)&1 , z1 = (c1>>2)&1;
+		for( int i=0 ; i<Width ; i++ )
+		{
+			int x = x1+i-R+2 , pi = R-1+(x>>1);
+			for( int j=0 ; j<Width ; j++ )
+			{
+				int y = y1+j-R+2 , pj = R-1+(y>>1);
+				for( int k=0 ; k<Width ; k++ )
+				{
+					int z = z1+k-R+2 , pk = R-1+(z>>1);
+					int p = pIndices[ (pi*Width+pj)*Width+pk ];
+					indices[ (i*Width+j)*Width+k ] = ( p>=0 && _tree->_children[p]>=0 ) ? _tree->_children[p] + ( (x&1) | ((y&1)<<1) | ((z&1)<<2) ) : -1;
+				}
+			}
+		}
+	}
+	Neighbors& neighbors = Key::neighbors[depth];
+	for( int i=0 ; i<Width ; i++ ) for( int j=0 ; j<Width ; j++ ) for( int k=0 ; k<Width ; k++ )
+	{
+		int n = indices[ (i*Width+j)*Width+k ];
+		neighbors.neighbors[i][j][k] = n>=0 ? _tree->_sNodes->treeNodes[n] : NULL;
+	}
+}
+
+
 
 //////////////////
 // TreeNodeData //
@@ -496,11 +624,16 @@ TreeNodeData< OutputDensity >::~TreeNodeData( void ) { }
 template< int Degree , bool OutputDensity >
 Octree< Degree , OutputDensity >::Octree(void)
 {
+	_nodeAllocator.set( MEMORY_ALLOCATOR_BLOCK_SIZE );
 	threads = 1;
+	doublePrecisionSolver = false;
+	sortedTree = true;
+	linearOctree = false;
 	radius = 0;
 	width = 0;
 	postDerivativeSmooth = 0;
 	_constrainValues = false;
+	_finalizedDepth = -1;
 }
 
 template< int Degree , bool OutputDensity >
@@ -800,7 +933,7 @@ Real Octree< Degree , OutputDensity >::SplatOrientedPoint( const Point3D<Real>&
 template< int Degree , bool OutputDensity >
 void Octree< Degree , OutputDensity >::GetSampleDepthAndWeight( const TreeOctNode* node , const Point3D<Real>& position , typename TreeOctNode::ConstNeighborKey3& neighborKey , Real samplesPerNode , Real& depth , Real& weight )
 {
-	TreeOctNode* temp=node;
+	const TreeOctNode* temp=node;
 	weight = Real(1.0)/GetSampleWeight( temp , position , neighborKey );
 	if( weight>=samplesPerNode ) depth = Real( temp->depth() + log( weight / samplesPerNode ) / log(double(1<<(DIMENSION-1))) );
 	else
@@ -944,7 +1077,7 @@ Real Octree< Degree, OutputDensity >::GetSampleWeight( const TreeOctNode* node ,
 	Real weight=0;
 	double x,dxdy,dx[DIMENSION][3];
 	double width;
-	typename TreeOctNode::ConstNeighbors5& neighbors = neighborKey.getNeighbors( node );
+	typename TreeOctNode::ConstNeighbors3& neighbors = neighborKey.getNeighbors( node );
 	Point3D<Real> center;
 	Real w;
 	node->centerAndWidth( center , w );
@@ -1040,11 +1173,13 @@ bool Octree< Degree , OutputDensity >::_inBounds( Point3D< Real > p ) const
 
 // Non-original implementation; modified by Jascha
 template< int Degree , bool OutputDensity >
-int Octree< Degree , OutputDensity >::setTree( std::vector< Point3D<float> >& _pts, std::vector< Point3D<float> >& _normals, int maxDepth , int minDepth ,
+template< class PointT >
+int Octree< Degree , OutputDensity >::setTree( const PointT* _pts, const PointT* _normals, size_t _n, int maxDepth , int minDepth ,
                                                int splatDepth , Real samplesPerNode , Real scaleFactor ,
                                                int useConfidence , Real constraintWeight , int adaptiveExponent ,
                                                XForm4x4< Real > xForm )
 {
+	typename TreeOctNode::AllocatorScope allocatorScope( _nodeAllocator );
 	if( splatDepth<0 ) splatDepth = 0;
 	this->samplesPerNode = samplesPerNode;
 	this->splatDepth = splatDepth;
@@ -1071,9 +1206,9 @@ int Octree< Degree , OutputDensity >::setTree( std::vector< Point3D<float> >& _p
 	// Read through once to get the center and scale
 	{
 		Point3D< Real > p , n;
-        for (unsigned int pi(0); pi < _pts.size(); ++pi)
+        for (size_t pi(0); pi < _n; ++pi)
 		{
-                    p = _pts[pi];
+                    p = Point3D< Real >( _pts[pi][0] , _pts[pi][1] , _pts[pi][2] );
 			p = xForm * p;
 			for( i=0 ; i<DIMENSION ; i++ )
 			{
@@ -1090,80 +1225,101 @@ int Octree< Degree , OutputDensity >::setTree( std::vector< Point3D<float> >& _p
 
 	_scale *= scaleFactor;
 	for( i=0 ; i<DIMENSION ; i++ ) _center[i] -= _scale/2;
-	if( splatDepth>0 )
+	normals = new std::vector< Point3D<Real> >();
+	// The Morton keys of the sorted construction hold the child indices of all depths in 64 bits
+	if( sortedTree && maxDepth<=21 ) cnt = _setSortedTree( _pts , _normals , _n , maxDepth , splatDepth , samplesPerNode , useConfidence , xForm , xFormN , pointWeightSum );
+	else
 	{
-		cnt = 0;
-		Point3D< Real > p , n;
-        for (unsigned int pi(0); pi < _pts.size(); ++pi)
+		if( splatDepth>0 )
 		{
-			p = _pts[pi];
-			n = _normals[pi];
+			cnt = 0;
+			Point3D< Real > p , n;
+	        for (size_t pi(0); pi < _n; ++pi)
+			{
+				p = Point3D< Real >( _pts[pi][0] , _pts[pi][1] , _pts[pi][2] );
+				n = Point3D< Real >( _normals[pi][0] , _normals[pi][1] , _normals[pi][2] );
+
+				p = xForm * p , n = xFormN * n;
+				p = ( p - _center ) / _scale;
+				if( !_inBounds(p) ) continue;
+				myCenter = Point3D< Real >( Real(0.5) , Real(0.5) , Real(0.5) );
+				myWidth = Real(1.0);
+				Real weight=Real( 1. );
+				if( useConfidence ) weight = Real( Length(n) );
+				temp = &tree;
+				int d=0;
+				while( d<splatDepth )
+				{
+					UpdateWeightContribution( temp , p , neighborKey , weight );
+					if( !temp->children ) temp->initChildren();
+					int cIndex=TreeOctNode::CornerIndex( myCenter , p );
+					temp = temp->children + cIndex;
+					myWidth/=2;
+					if( cIndex&1 ) myCenter[0] += myWidth/2;
+					else           myCenter[0] -= myWidth/2;
+					if( cIndex&2 ) myCenter[1] += myWidth/2;
+					else           myCenter[1] -= myWidth/2;
+					if( cIndex&4 ) myCenter[2] += myWidth/2;
+					else           myCenter[2] -= myWidth/2;
+					d++;
+				}
+				UpdateWeightContribution( temp , p , neighborKey , weight );
+				cnt++;
+			}
+		}
 
+		cnt = 0;
+	//	pointStream->reset();
+		Point3D< Real > p , n;
+	//	while( pointStream->nextPoint( p , n ) )
+	        for (size_t pi(0); pi < _n; ++pi)
+	        {
+	            p = Point3D< Real >( _pts[pi][0] , _pts[pi][1] , _pts[pi][2] );
+	            n = Point3D< Real >( _normals[pi][0] , _normals[pi][1] , _normals[pi][2] );
+			n *= Real(-1.);
 			p = xForm * p , n = xFormN * n;
 			p = ( p - _center ) / _scale;
 			if( !_inBounds(p) ) continue;
 			myCenter = Point3D< Real >( Real(0.5) , Real(0.5) , Real(0.5) );
 			myWidth = Real(1.0);
-			Real weight=Real( 1. );
-			if( useConfidence ) weight = Real( Length(n) );
-			temp = &tree;
-			int d=0;
-			while( d<splatDepth )
+			Real l = Real( Length( n ) );
+			if( l!=l || l<=EPSILON ) continue;
+			if( !useConfidence ) n /= l;
+
+			l = Real(1.);
+			Real pointWeight = Real(1.f);
+			if( samplesPerNode>0 && splatDepth )
 			{
-				UpdateWeightContribution( temp , p , neighborKey , weight );
-				if( !temp->children ) temp->initChildren();
-				int cIndex=TreeOctNode::CornerIndex( myCenter , p );
-				temp = temp->children + cIndex;
-				myWidth/=2;
-				if( cIndex&1 ) myCenter[0] += myWidth/2;
-				else           myCenter[0] -= myWidth/2;
-				if( cIndex&2 ) myCenter[1] += myWidth/2;
-				else           myCenter[1] -= myWidth/2;
-				if( cIndex&4 ) myCenter[2] += myWidth/2;
-				else           myCenter[2] -= myWidth/2;
-				d++;
+				pointWeight = SplatOrientedPoint( p , n , neighborKey , splatDepth , samplesPerNode , _minDepth , maxDepth );
 			}
-			UpdateWeightContribution( temp , p , neighborKey , weight );
-			cnt++;
-		}
-	}
-
-	normals = new std::vector< Point3D<Real> >();
-	cnt = 0;
-//	pointStream->reset();
-	Point3D< Real > p , n;
-//	while( pointStream->nextPoint( p , n ) )
-        for (unsigned int pi(0); pi < _pts.size(); ++pi)
-        {
-            p = _pts[pi];
-            n = _normals[pi];
-		n *= Real(-1.);
-		p = xForm * p , n = xFormN * n;
-		p = ( p - _center ) / _scale;
-		if( !_inBounds(p) ) continue;
-		myCenter = Point3D< Real >( Real(0.5) , Real(0.5) , Real(0.5) );
-		myWidth = Real(1.0);
-		Real l = Real( Length( n ) );
-		if( l!=l || l<=EPSILON ) continue;
-		if( !useConfidence ) n /= l;
-
-		l = Real(1.);
-		Real pointWeight = Real(1.f);
-		if( samplesPerNode>0 && splatDepth )
-		{
-			pointWeight = SplatOrientedPoint( p , n , neighborKey , splatDepth , samplesPerNode , _minDepth , maxDepth );
-		}
-		else
-		{
-			temp = &tree;
-			int d=0;
-			if( splatDepth )
+			else
 			{
-				while( d<splatDepth )
+				temp = &tree;
+				int d=0;
+				if( splatDepth )
 				{
+					while( d<splatDepth )
+					{
+						int cIndex=TreeOctNode::CornerIndex(myCenter,p);
+						temp = &temp->children[cIndex];
+						myWidth /= 2;
+						if(cIndex&1) myCenter[0] += myWidth/2;
+						else		 myCenter[0] -= myWidth/2;
+						if(cIndex&2) myCenter[1] += myWidth/2;
+						else		 myCenter[1] -= myWidth/2;
+						if(cIndex&4) myCenter[2] += myWidth/2;
+						else		 myCenter[2] -= myWidth/2;
+						d++;
+					}
+					pointWeight = GetSampleWeight( temp , p , neighborKey );
+				}
+				for( i=0 ; i<DIMENSION ; i++ ) n[i] *= pointWeight;
+				while( d<maxDepth )
+				{
+					if( !temp->children ) temp->initChildren();
 					int cIndex=TreeOctNode::CornerIndex(myCenter,p);
-					temp = &temp->children[cIndex];
-					myWidth /= 2;
+					temp=&temp->children[cIndex];
+					myWidth/=2;
 					if(cIndex&1) myCenter[0] += myWidth/2;
 					else		 myCenter[0] -= myWidth/2;
 					if(cIndex&2) myCenter[1] += myWidth/2;
@@ -1172,61 +1328,45 @@ int Octree< Degree , OutputDensity >::setTree( std::vector< Point3D<float> >& _p
 					else		 myCenter[2] -= myWidth/2;
 					d++;
 				}
-				pointWeight = GetSampleWeight( temp , p , neighborKey );
+				SplatOrientedPoint( temp , p , n , neighborKey );
 			}
-			for( i=0 ; i<DIMENSION ; i++ ) n[i] *= pointWeight;
-			while( d<maxDepth )
+			pointWeightSum += pointWeight;
+			if( _constrainValues )
 			{
-				if( !temp->children ) temp->initChildren();
-				int cIndex=TreeOctNode::CornerIndex(myCenter,p);
-				temp=&temp->children[cIndex];
-				myWidth/=2;
-				if(cIndex&1) myCenter[0] += myWidth/2;
-				else		 myCenter[0] -= myWidth/2;
-				if(cIndex&2) myCenter[1] += myWidth/2;
-				else		 myCenter[1] -= myWidth/2;
-				if(cIndex&4) myCenter[2] += myWidth/2;
-				else		 myCenter[2] -= myWidth/2;
-				d++;
-			}
-			SplatOrientedPoint( temp , p , n , neighborKey );
-		}
-		pointWeightSum += pointWeight;
-		if( _constrainValues )
-		{
-			int d = 0;
-			TreeOctNode* temp = &tree;
-			myCenter = Point3D< Real >( Real(0.5) , Real(0.5) , Real(0.5) );
-			myWidth = Real(1.0);
-			while( 1 )
-			{
-				int idx = temp->nodeData.pointIndex;
-				if( idx==-1 )
-				{
-					idx = int( _points.size() );
-					_points.push_back( PointData( p , Real(1.) ) );
-					temp->nodeData.pointIndex = idx;
-				}
-				else
+				int d = 0;
+				TreeOctNode* temp = &tree;
+				myCenter = Point3D< Real >( Real(0.5) , Real(0.5) , Real(0.5) );
+				myWidth = Real(1.0);
+				while( 1 )
 				{
-					_points[idx].weight += Real(1.);
-					_points[idx].position += p;
-				}
+					int idx = temp->nodeData.pointIndex;
+					if( idx==-1 )
+					{
+						idx = int( _points.size() );
+						_points.push_back( PointData( p , Real(1.) ) );
+						temp->nodeData.pointIndex = idx;
+					}
+					else
+					{
+						_points[idx].weight += Real(1.);
+						_points[idx].position += p;
+					}
 
-				int cIndex = TreeOctNode::CornerIndex( myCenter , p );
-				if( !temp->children ) break;
-				temp = &temp->children[cIndex];
-				myWidth /= 2;
-				if( cIndex&1 ) myCenter[0] += myWidth/2;
-				else		   myCenter[0] -= myWidth/2;
-				if( cIndex&2 ) myCenter[1] += myWidth/2;
-				else		   myCenter[1] -= myWidth/2;
-				if( cIndex&4 ) myCenter[2] += myWidth/2;
-				else		   myCenter[2] -= myWidth/2;
-				d++;
+					int cIndex = TreeOctNode::CornerIndex( myCenter , p );
+					if( !temp->children ) break;
+					temp = &temp->children[cIndex];
+					myWidth /= 2;
+					if( cIndex&1 ) myCenter[0] += myWidth/2;
+					else		   myCenter[0] -= myWidth/2;
+					if( cIndex&2 ) myCenter[1] += myWidth/2;
+					else		   myCenter[1] -= myWidth/2;
+					if( cIndex&4 ) myCenter[2] += myWidth/2;
+					else		   myCenter[2] -= myWidth/2;
+					d++;
+				}
 			}
+			cnt++;
 		}
-		cnt++;
 	}
 
 	if( _boundaryType==0 ) pointWeightSum *= Real(4.);
@@ -1260,6 +1400,406 @@ int Octree< Degree , OutputDensity >::setTree( std::vector< Point3D<float> >& _p
 
 	return cnt;
 }
+// The sorted construction builds the same tree as the serial one and splats the same weights and normals, only the
+// order of the floating-point sums differs, and it does not depend on the number of threads:
+// - The in-bounds samples are sorted by their Morton keys, so the samples in a node at any depth form a range of
+//   the sorted samples, and the ranges of a depth are split into the ranges of the next one.
+// - The nodes are created serially, per range instead of per sample (the allocator is not thread-safe). The tree
+//   does not depend on the order in which the nodes are created.
+// - The splats of a range are summed by one thread and added to the 3x3x3 neighbors of its node. The ranges are
+//   processed in 27 rounds by the offsets of their nodes modulo 3, so the neighborhoods of a round are disjoint.
+// Unlike the serial construction, the value constraints of a sample are added to all nodes on its path through the
+// final tree, not only to those that exist when the sample is inserted.
+template< int Degree , bool OutputDensity >
+template< class PointT >
+int Octree< Degree , OutputDensity >::_setSortedTree( const PointT* _pts , const PointT* _normals , size_t _n , int maxDepth , int splatDepth , Real samplesPerNode ,
+                                                      int useConfidence , const XForm4x4< Real >& xForm , const XForm3x3< Real >& xFormN , double& pointWeightSum )
+{
+	int threads = std::max< int >( 1 , this->threads );
+	bool adaptive = samplesPerNode>0 && splatDepth;
+
+	// The Morton keys of the samples in bounds
+	std::vector< SampleKey > keys;
+	{
+		std::vector< std::vector< SampleKey > > _keys( threads );
+#pragma omp parallel for num_threads( threads )
+		for( int t=0 ; t<threads ; t++ )
+			for( size_t pi=(_n*t)/threads ; pi<(_n*(t+1))/threads ; pi++ )
+			{
+				Point3D< Real > p( _pts[pi][0] , _pts[pi][1] , _pts[pi][2] );
+				p = xForm * p;
+				p = ( p - _center ) / _scale;
+				if( _inBounds(p) ) _keys[t].push_back( SampleKey( _SampleKey( p , maxDepth ) , pi ) );
+			}
+		size_t count = 0;
+		for( int t=0 ; t<threads ; t++ ) count += _keys[t].size();
+		keys.reserve( count );
+		for( int t=0 ; t<threads ; t++ ) keys.insert( keys.end() , _keys[t].begin() , _keys[t].end() ) , std::vector< SampleKey >().swap( _keys[t] );
+	}
+	_SortSampleKeys( keys , threads );
+
+	// The sorted samples. A negative depth marks a sample without a normal, which only contributes to the sample density.
+	size_t count = keys.size();
+	std::vector< Point3D< Real > > positions( count ) , orientations( count );
+	std::vector< Real > weights( count ) , depths( count );
+#pragma omp parallel for num_threads( threads )
+	for( int t=0 ; t<threads ; t++ )
+		for( size_t i=(count*t)/threads ; i<(count*(t+1))/threads ; i++ )
+		{
+			size_t pi = keys[i].second;
+			Point3D< Real > p( _pts[pi][0] , _pts[pi][1] , _pts[pi][2] ) , n( _normals[pi][0] , _normals[pi][1] , _normals[pi][2] );
+			n *= Real(-1.);
+			p = xForm * p , n = xFormN * n;
+			positions[i] = ( p - _center ) / _scale;
+			Real l = Real( Length( n ) );
+			weights[i] = useConfidence ? l : Real(1.);
+			if( l!=l || l<=EPSILON ) depths[i] = Real(-1.);
+			else
+			{
+				depths[i] = Real(0.);
+				if( !useConfidence ) n /= l;
+			}
+			orientations[i] = n;
+		}
+
+	typename TreeOctNode::NeighborKey3 neighborKey;
+	neighborKey.set( maxDepth );
+	std::vector< SampleRange > ranges( 1 ) , children;
+	std::vector< size_t > indices , order , colorStart;
+	ranges[0].begin = 0 , ranges[0].end = count , ranges[0].node = &tree;
+
+	// Splat the sample density down to the splatting depth
+	for( int d=0 ; splatDepth>0 ; d++ )
+	{
+		for( size_t r=0 ; r<ranges.size() ; r++ )
+		{
+			neighborKey.setNeighbors( ranges[r].node );
+			if( d<splatDepth && !ranges[r].node->children ) ranges[r].node->initChildren();
+		}
+		indices.resize( ranges.size() );
+		for( size_t r=0 ; r<ranges.size() ; r++ ) indices[r] = r;
+		_colorSampleRanges( ranges , indices , order , colorStart );
+		const double SAMPLE_SCALE = 1. / ( 0.125 * 0.125 + 0.75 * 0.75 + 0.125 * 0.125 );
+		for( int c=0 ; c<27 ; c++ )
+		{
+			size_t start = colorStart[c] , width = colorStart[c+1]-colorStart[c];
+#pragma omp parallel for num_threads( threads )
+			for( int t=0 ; t<threads ; t++ )
+			{
+				typename TreeOctNode::NeighborKey3 neighborKey;
+				neighborKey.set( d );
+				for( size_t o=start+(width*t)/threads ; o<start+(width*(t+1))/threads ; o++ )
+				{
+					const SampleRange& range = ranges[ order[o] ];
+					typename TreeOctNode::Neighbors3& neighbors = neighborKey.getNeighbors( range.node );
+					Point3D< Real > center;
+					Real w;
+					range.node->centerAndWidth( center , w );
+					double x , dxdy , dx[DIMENSION][3] , width=w , sums[3][3][3];
+					for( int i=0 ; i<3 ; i++ ) for( int j=0 ; j<3 ; j++ ) for( int k=0 ; k<3 ; k++ ) sums[i][j][k] = 0;
+					for( size_t s=range.begin ; s<range.end ; s++ )
+					{
+						for( int i=0 ; i<DIMENSION ; i++ )
+						{
+							x = ( center[i] - positions[s][i] - width ) / width;
+							dx[i][0] = 1.125 + 1.500*x + 0.500*x*x;
+							x = ( center[i] - positions[s][i] ) / width;
+							dx[i][1] = 0.750           -       x*x;
+							dx[i][2] = 1. - dx[i][1] - dx[i][0];
+							dx[i][0] *= SAMPLE_SCALE;
+						}
+						for( int i=0 ; i<3 ; i++ ) for( int j=0 ; j<3 ; j++ )
+						{
+							dxdy = dx[0][i] * dx[1][j] * weights[s];
+							for( int k=0 ; k<3 ; k++ ) sums[i][j][k] += Real( dxdy * dx[2][k] );
+						}
+					}
+					for( int i=0 ; i<3 ; i++ ) for( int j=0 ; j<3 ; j++ ) for( int k=0 ; k<3 ; k++ ) if( neighbors.neighbors[i][j][k] )
+						neighbors.neighbors[i][j][k]->nodeData.centerWeightContribution[0] += Real( sums[i][j][k] );
+				}
+			}
+		}
+		if( d==splatDepth ) break;
+		_splitSampleRanges( ranges , keys , d , maxDepth , false , children );
+		ranges.swap( children );
+	}
+
+	// The depths and weights of the samples from the density at the splatting depth
+#pragma omp parallel for num_threads( threads )
+	for( int t=0 ; t<threads ; t++ )
+	{
+		typename TreeOctNode::ConstNeighborKey3 neighborKey;
+		neighborKey.set( maxDepth );
+		for( size_t r=(ranges.size()*t)/threads ; r<(ranges.size()*(t+1))/threads ; r++ )
+			for( size_t s=ranges[r].begin ; s<ranges[r].end ; s++ )
+			{
+				if( depths[s]<0 ) continue;
+				if( adaptive )
+				{
+					Real weight , depth;
+					GetSampleDepthAndWeight( ranges[r].node , positions[s] , neighborKey , samplesPerNode , depth , weight );
+					if( depth<_minDepth ) depth = Real(_minDepth);
+					if( depth>maxDepth ) depth = Real(maxDepth);
+					weights[s] = weight , depths[s] = depth;
+				}
+				else
+				{
+					weights[s] = splatDepth ? GetSampleWeight( ranges[r].node , positions[s] , neighborKey ) : Real(1.);
+					depths[s] = Real(maxDepth);
+				}
+			}
+	}
+	int cnt = 0;
+	pointWeightSum = 0;
+	for( size_t s=0 ; s<count ; s++ ) if( depths[s]>=0 ) pointWeightSum += weights[s] , cnt++;
+
+	// Splat the normals, the samples at fractional depths into the nodes at the two depths around it
+	ranges.resize( 1 );
+	ranges[0].begin = 0 , ranges[0].end = count , ranges[0].node = &tree;
+	for( int d=0 ; d<=maxDepth ; d++ )
+	{
+		if( d>=_minDepth )
+		{
+			std::vector< char > splat( ranges.size() );
+#pragma omp parallel for num_threads( threads )
+			for( int t=0 ; t<threads ; t++ )
+				for( size_t r=(ranges.size()*t)/threads ; r<(ranges.size()*(t+1))/threads ; r++ )
+				{
+					splat[r] = 0;
+					for( size_t s=ranges[r].begin ; s<ranges[r].end && !splat[r] ; s++ ) if( depths[s]>=0 )
+					{
+						double dx;
+						int topDepth = _SplatDepth( depths[s] , _minDepth , maxDepth , dx );
+						splat[r] = topDepth==d || ( topDepth==d+1 && fabs(1.0-dx) > EPSILON );
+					}
+				}
+			indices.clear();
+			for( size_t r=0 ; r<ranges.size() ; r++ ) if( splat[r] )
+			{
+				if( !ranges[r].node ) ranges[r].node = _sampleNode( keys[ ranges[r].begin ].first , d , maxDepth );
+				typename TreeOctNode::Neighbors3& neighbors = neighborKey.setNeighbors( ranges[r].node );
+				for( int i=0 ; i<3 ; i++ ) for( int j=0 ; j<3 ; j++ ) for( int k=0 ; k<3 ; k++ )
+				{
+					TreeOctNode* _node = neighbors.neighbors[i][j][k];
+					if( _node && _node->nodeData.normalIndex<0 )
+					{
+						Point3D<Real> n;
+						n[0] = n[1] = n[2] = 0;
+						_node->nodeData.nodeIndex = 0;
+						_node->nodeData.normalIndex = int(normals->size());
+						normals->push_back(n);
+					}
+				}
+				indices.push_back( r );
+			}
+			_colorSampleRanges( ranges , indices , order , colorStart );
+			for( int c=0 ; c<27 ; c++ )
+			{
+				size_t start = colorStart[c] , width = colorStart[c+1]-colorStart[c];
+#pragma omp parallel for num_threads( threads )
+				for( int t=0 ; t<threads ; t++ )
+				{
+					typename TreeOctNode::NeighborKey3 neighborKey;
+					neighborKey.set( d );
+					for( size_t o=start+(width*t)/threads ; o<start+(width*(t+1))/threads ; o++ )
+					{
+						const SampleRange& range = ranges[ order[o] ];
+						typename TreeOctNode::Neighbors3& neighbors = neighborKey.getNeighbors( range.node );
+						Point3D< Real > center;
+						Real w;
+						range.node->centerAndWidth( center , w );
+						double x , dxdydz , dx[DIMENSION][3] , width=w , sums[3][3][3][DIMENSION];
+						for( int i=0 ; i<3 ; i++ ) for( int j=0 ; j<3 ; j++ ) for( int k=0 ; k<3 ; k++ ) for( int l=0 ; l<DIMENSION ; l++ ) sums[i][j][k][l] = 0;
+						for( size_t s=range.begin ; s<range.end ; s++ )
+						{
+							if( depths[s]<0 ) continue;
+							double _dx;
+							int topDepth = _SplatDepth( depths[s] , _minDepth , maxDepth , _dx );
+							if( topDepth==d+1 && fabs(1.0-_dx) > EPSILON ) _dx = Real(1.0-_dx);
+							else if( topDepth!=d ) continue;
+							Point3D< Real > n = orientations[s];
+							if( adaptive ) n = n * weights[s] / Real( pow( 1.0 / ( 1<<d ) , 3 ) ) * Real( _dx );
+							else for( int i=0 ; i<DIMENSION ; i++ ) n[i] *= weights[s];
+							for( int i=0 ; i<DIMENSION ; i++ )
+							{
+								x = ( center[i] - positions[s][i] - width ) / width;
+								dx[i][0] = 1.125+1.500*x+0.500*x*x;
+								x = ( center[i] - positions[s][i] ) / width;
+								dx[i][1] = 0.750        -      x*x;
+								dx[i][2] = 1. - dx[i][1] - dx[i][0];
+							}
+							for( int i=0 ; i<3 ; i++ ) for( int j=0 ; j<3 ; j++ ) for( int k=0 ; k<3 ; k++ )
+							{
+								dxdydz = dx[0][i] * dx[1][j] * dx[2][k];
+								Point3D< Real > _n = n * Real( dxdydz );
+								for( int l=0 ; l<DIMENSION ; l++ ) sums[i][j][k][l] += _n[l];
+							}
+						}
+						for( int i=0 ; i<3 ; i++ ) for( int j=0 ; j<3 ; j++ ) for( int k=0 ; k<3 ; k++ ) if( neighbors.neighbors[i][j][k] )
+						{
+							Point3D< Real >& normal = (*normals)[ neighbors.neighbors[i][j][k]->nodeData.normalIndex ];
+							for( int l=0 ; l<DIMENSION ; l++ ) normal[l] += Real( sums[i][j][k][l] );
+						}
+					}
+				}
+			}
+		}
+		if( d==maxDepth ) break;
+		_splitSampleRanges( ranges , keys , d , maxDepth , false , children );
+		ranges.swap( children );
+	}
+
+	// Add the samples to the value constraints of the nodes on their paths
+	if( _constrainValues )
+	{
+		ranges.resize( 1 );
+		ranges[0].begin = 0 , ranges[0].end = count , ranges[0].node = &tree;
+		std::vector< PointData > points;
+		for( int d=0 ; ; d++ )
+		{
+			points.resize( ranges.size() );
+#pragma omp parallel for num_threads( threads )
+			for( int t=0 ; t<threads ; t++ )
+				for( size_t r=(ranges.size()*t)/threads ; r<(ranges.size()*(t+1))/threads ; r++ )
+				{
+					double position[] = { 0 , 0 , 0 } , weight = 0;
+					for( size_t s=ranges[r].begin ; s<ranges[r].end ; s++ ) if( depths[s]>=0 )
+					{
+						for( int i=0 ; i<DIMENSION ; i++ ) position[i] += positions[s][i];
+						weight += 1.;
+					}
+					points[r] = PointData( Point3D< Real >( Real(position[0]) , Real(position[1]) , Real(position[2]) ) , Real(weight) );
+				}
+			for( size_t r=0 ; r<ranges.size() ; r++ ) if( points[r].weight>0 )
+			{
+				ranges[r].node->nodeData.pointIndex = int( _points.size() );
+				_points.push_back( points[r] );
+			}
+			if( d==maxDepth ) break;
+			_splitSampleRanges( ranges , keys , d , maxDepth , true , children );
+			if( children.empty() ) break;
+			ranges.swap( children );
+		}
+	}
+	return cnt;
+}
+template< int Degree , bool OutputDensity >
+unsigned long long Octree< Degree , OutputDensity >::_SampleKey( const Point3D< Real >& position , int maxDepth )
+{
+	// The same descent as in setTree, so that the key is consistent with the tree for samples on cell boundaries
+	unsigned long long key = 0;
+	Point3D< Real > myCenter( Real(0.5) , Real(0.5) , Real(0.5) );
+	Real myWidth = Real(1.0);
+	for( int d=0 ; d<maxDepth ; d++ )
+	{
+		int cIndex = TreeOctNode::CornerIndex( myCenter , position );
+		key = ( key<<3 ) | (unsigned long long)cIndex;
+		myWidth /= 2;
+		if( cIndex&1 ) myCenter[0] += myWidth/2;
+		else           myCenter[0] -= myWidth/2;
+		if( cIndex&2 ) myCenter[1] += myWidth/2;
+		else           myCenter[1] -= myWidth/2;
+		if( cIndex&4 ) myCenter[2] += myWidth/2;
+		else           myCenter[2] -= myWidth/2;
+	}
+	return key;
+}
+template< int Degree , bool OutputDensity >
+void Octree< Degree , OutputDensity >::_SortSampleKeys( std::vector< SampleKey >& keys , int threads )
+{
+	// Sort a block per thread, then merge pairs of blocks. The keys are unique, so the result does not depend on the number of threads.
+	std::vector< size_t > bounds( threads+1 );
+	for( int t=0 ; t<=threads ; t++ ) bounds[t] = ( keys.size()*t ) / threads;
+#pragma omp parallel for num_threads( threads )
+	for( int t=0 ; t<threads ; t++ ) std::sort( keys.begin()+bounds[t] , keys.begin()+bounds[t+1] );
+	if( threads==1 ) return;
+	std::vector< SampleKey > temp( keys.size() );
+	for( int step=1 ; step<threads ; step*=2 )
+	{
+		int merges = ( threads + 2*step - 1 ) / ( 2*step );
+#pragma omp parallel for num_threads( threads )
+		for( int m=0 ; m<merges ; m++ )
+		{
+			int begin = 2*m*step , middle = std::min< int >( begin+step , threads ) , end = std::min< int >( begin+2*step , threads );
+			std::merge( keys.begin()+bounds[begin] , keys.begin()+bounds[middle] , keys.begin()+bounds[middle] , keys.begin()+bounds[end] , temp.begin()+bounds[begin] );
+		}
+		keys.swap( temp );
+	}
+}
+template< int Degree , bool OutputDensity >
+int Octree< Degree , OutputDensity >::_SplatDepth( Real depth , int minDepth , int maxDepth , double& dx )
+{
+	// As in SplatOrientedPoint
+	int topDepth=int(ceil(depth));
+	dx = 1.0-(topDepth-depth);
+	if( topDepth<=minDepth )
+	{
+		topDepth=minDepth;
+		dx=1;
+	}
+	else if( topDepth>maxDepth )
+	{
+		topDepth=maxDepth;
+		dx=1;
+	}
+	return topDepth;
+}
+template< int Degree , bool OutputDensity >
+typename Octree< Degree , OutputDensity >::TreeOctNode* Octree< Degree , OutputDensity >::_sampleNode( unsigned long long key , int depth , int maxDepth )
+{
+	TreeOctNode* node = &tree;
+	for( int d=0 ; d<depth ; d++ )
+	{
+		if( !node->children ) node->initChildren();
+		node = node->children + ( ( key>>( 3*(maxDepth-1-d) ) ) & 7 );
+	}
+	return node;
+}
+template< int Degree , bool OutputDensity >
+void Octree< Degree , OutputDensity >::_splitSampleRanges( const std::vector< SampleRange >& ranges , const std::vector< SampleKey >& keys , int depth , int maxDepth , bool existing , std::vector< SampleRange >& children ) const
+{
+	// The ranges of the children at the next depth, in order. The node of a child range is only set if its parent's
+	// children exist already. If existing is set, only the ranges of existing children are returned.
+	int shift = 3*(maxDepth-1-depth) , threads = std::max< int >( 1 , this->threads );
+	std::vector< std::vector< SampleRange > > _children( threads );
+#pragma omp parallel for num_threads( threads )
+	for( int t=0 ; t<threads ; t++ )
+		for( size_t r=(ranges.size()*t)/threads ; r<(ranges.size()*(t+1))/threads ; r++ )
+		{
+			TreeOctNode* node = ranges[r].node;
+			if( existing && ( !node || !node->children ) ) continue;
+			for( size_t s=ranges[r].begin ; s<ranges[r].end ; )
+			{
+				int c = int( ( keys[s].first>>shift ) & 7 );
+				SampleRange child;
+				child.begin = s;
+				while( s<ranges[r].end && int( ( keys[s].first>>shift ) & 7 )==c ) s++;
+				child.end = s;
+				child.node = node && node->children ? node->children + c : NULL;
+				_children[t].push_back( child );
+			}
+		}
+	children.clear();
+	for( int t=0 ; t<threads ; t++ ) children.insert( children.end() , _children[t].begin() , _children[t].end() );
+}
+template< int Degree , bool OutputDensity >
+void Octree< Degree , OutputDensity >::_colorSampleRanges( const std::vector< SampleRange >& ranges , const std::vector< size_t >& indices , std::vector< size_t >& order , std::vector< size_t >& colorStart ) const
+{
+	// Sort the ranges by the offsets of their nodes modulo 3. The 3x3x3 neighborhoods of the nodes of a color are disjoint.
+	std::vector< int > colors( indices.size() );
+	colorStart.assign( 28 , 0 );
+	for( size_t i=0 ; i<indices.size() ; i++ )
+	{
+		int d , off[3];
+		ranges[ indices[i] ].node->depthAndOffset( d , off );
+		colors[i] = (off[0]%3) + 3*(off[1]%3) + 9*(off[2]%3);
+		colorStart[ colors[i]+1 ]++;
+	}
+	for( int c=0 ; c<27 ; c++ ) colorStart[c+1] += colorStart[c];
+	std::vector< size_t > next( colorStart.begin() , colorStart.end()-1 );
+	order.resize( indices.size() );
+	for( size_t i=0 ; i<indices.size() ; i++ ) order[ next[ colors[i] ]++ ] = indices[i];
+}
 
 
 
@@ -1279,6 +1819,7 @@ void Octree< Degree , OutputDensity >::setBSplineData( int maxDepth , int bounda
 template< int Degree , bool OutputDensity >
 void Octree< Degree , OutputDensity >::finalize( int subdivideDepth )
 {
+	typename TreeOctNode::AllocatorScope allocatorScope( _nodeAllocator );
 	int maxDepth = tree.maxDepth( );
 	typename TreeOctNode::NeighborKey5 nKey;
 	nKey.set( maxDepth );
@@ -1299,6 +1840,13 @@ void Octree< Degree , OutputDensity >::finalize( int subdivideDepth )
 				nKey.setNeighbors( node->parent , xStart , xEnd , yStart , yEnd , zStart , zEnd );
 			}
 	refineBoundary( subdivideDepth );
+	_finalizedDepth = subdivideDepth;
+}
+template< int Degree , bool OutputDensity >
+void Octree< Degree , OutputDensity >::_setSortedNodes( void )
+{
+	_sNodes.set( tree );
+	if( !linearOctree || !_lNodes.set( _sNodes , threads ) ) _lNodes.clear();
 }
 template< int Degree , bool OutputDensity > Real Octree< Degree , OutputDensity >::GetLaplacian( const int idx[DIMENSION] ) const
 {
@@ -1410,6 +1958,18 @@ int Octree< Degree , OutputDensity >::GetMatrixRowSize( const typename TreeOctNo
 	return count;
 }
 template< int Degree , bool OutputDensity >
+int Octree< Degree , OutputDensity >::GetMatrixRowBound( int xStart , int /*xEnd*/ , int yStart , int yEnd , int zStart , int zEnd )
+{
+	int count = 0;
+	for( int x=xStart ; x<=2 ; x++ )
+		for( int y=yStart ; y<yEnd ; y++ )
+			if( x==2 && y>2 ) continue;
+			else for( int z=zStart ; z<zEnd ; z++ )
+				if( x==2 && y==2 && z>2 ) continue;
+				else count++;
+	return count;
+}
+template< int Degree , bool OutputDensity >
 int Octree< Degree , OutputDensity >::SetMatrixRow( const typename TreeOctNode::Neighbors5& neighbors5 , Pointer( MatrixEntry< MatrixReal > ) row , int offset , const double stencil[5][5][5] ) const
 {
 	return SetMatrixRow( neighbors5 , row , offset , stencil , 0 , 5 , 0 , 5 , 0 , 5 );
@@ -1828,8 +2388,8 @@ void Octree< Degree , OutputDensity >::UpSampleCoarserSolution( int depth , cons
 #pragma omp parallel for num_threads( threads )
 		for( int t=0 ; t<threads ; t++ )
 		{
-			typename TreeOctNode::NeighborKey3 neighborKey;
-			neighborKey.set( depth );
+			NeighborKey3 neighborKey;
+			neighborKey.set( depth , _linearTree() );
 			for( int i=start+(range*t)/threads ; i<start+(range*(t+1))/threads ; i++ )
 			{
 				int d , off[3];
@@ -1842,7 +2402,7 @@ void Octree< Degree , OutputDensity >::UpSampleCoarserSolution( int depth , cons
 					else if( off[dd]%2             ) usData[dd] = UpSampleData( 1 , 0.75 , 0.25 );
 					else                             usData[dd] = UpSampleData( 0 , 0.25 , 0.75 );
 				}
-				neighborKey.getNeighbors( sNodes.treeNodes[i]->parent );
+				neighborKey.getNeighbors( sNodes.treeNodes[i]->parent , _lNodes.parent( i ) );
 				for( int ii=0 ; ii<2 ; ii++ )
 				{
 					int _ii = ii + usData[0].start;
@@ -1894,8 +2454,8 @@ void Octree< Degree , OutputDensity >::DownSampleFinerConstraints( int depth , S
 #pragma omp parallel for num_threads( threads )
 	for( int t=0 ; t<threads ; t++ )
 	{
-		typename TreeOctNode::NeighborKey3 neighborKey;
-		neighborKey.set( depth );
+		NeighborKey3 neighborKey;
+		neighborKey.set( depth , _linearTree() );
 		for( int i=start+(range*t)/threads ; i<start+(range*(t+1))/threads ; i++ )
 		{
 			int d , off[3];
@@ -1908,7 +2468,7 @@ void Octree< Degree , OutputDensity >::DownSampleFinerConstraints( int depth , S
 				else if( off[d]%2             ) usData[d] = UpSampleData( 1 , 0.75 , 0.25 );
 				else                            usData[d] = UpSampleData( 0 , 0.25 , 0.75 );
 			}
-			neighborKey.getNeighbors( sNodes.treeNodes[i]->parent );
+			neighborKey.getNeighbors( sNodes.treeNodes[i]->parent , _lNodes.parent( i ) );
 			typename TreeOctNode::Neighbors3& neighbors = neighborKey.neighbors[depth-1];
 			for( int ii=0 ; ii<2 ; ii++ )
 			{
@@ -1953,8 +2513,8 @@ void Octree< Degree , OutputDensity >::DownSample( int depth , const SortedTreeN
 #pragma omp parallel for num_threads( threads )
 	for( int t=0 ; t<threads ; t++ )
 	{
-		typename TreeOctNode::NeighborKey3 neighborKey;
-		neighborKey.set( depth );
+		NeighborKey3 neighborKey;
+		neighborKey.set( depth , _linearTree() );
 		for( int i=start+(range*t)/threads ; i<start+(range*(t+1))/threads ; i++ )
 		{
 			int d , off[3];
@@ -1967,7 +2527,7 @@ void Octree< Degree , OutputDensity >::DownSample( int depth , const SortedTreeN
 				else if( off[d]%2             ) usData[d] = UpSampleData( 1 , 0.75 , 0.25 );
 				else                            usData[d] = UpSampleData( 0 , 0.25 , 0.75 );
 			}
-			typename TreeOctNode::Neighbors3& neighbors = neighborKey.getNeighbors( sNodes.treeNodes[i]->parent );
+			typename TreeOctNode::Neighbors3& neighbors = neighborKey.getNeighbors( sNodes.treeNodes[i]->parent , _lNodes.parent( i ) );
 			C c = constraints[i];
 			for( int ii=0 ; ii<2 ; ii++ )
 			{
@@ -2011,8 +2571,8 @@ void Octree< Degree , OutputDensity >::UpSample( int depth , const SortedTreeNod
 #pragma omp parallel for num_threads( threads )
 	for( int t=0 ; t<threads ; t++ )
 	{
-		typename TreeOctNode::NeighborKey3 neighborKey;
-		neighborKey.set( depth-1 );
+		NeighborKey3 neighborKey;
+		neighborKey.set( depth-1 , _linearTree() );
 		for( int i=start+(range*t)/threads ; i<start+(range*(t+1))/threads ; i++ )
 		{
             //bool isInterior = true;
@@ -2027,7 +2587,7 @@ void Octree< Degree , OutputDensity >::UpSample( int depth , const SortedTreeNod
 				else if( off[d]%2             ) usData[d] = UpSampleData( 1 , 0.75 , 0.25 );
 				else                            usData[d] = UpSampleData( 0 , 0.25 , 0.75 );
 			}
-			typename TreeOctNode::Neighbors3& neighbors = neighborKey.getNeighbors( node->parent );
+			typename TreeOctNode::Neighbors3& neighbors = neighborKey.getNeighbors( node->parent , _lNodes.parent( i ) );
 			for( int ii=0 ; ii<2 ; ii++ )
 			{
 				int _ii = ii + usData[0].start;
@@ -2060,14 +2620,14 @@ void Octree< Degree , OutputDensity >::SetCoarserPointValues( int depth , const
 #pragma omp parallel for num_threads( threads )
 	for( int t=0 ; t<threads ; t++ )
 	{
-		typename TreeOctNode::NeighborKey3 neighborKey;
-		neighborKey.set( depth );
+		NeighborKey3 neighborKey;
+		neighborKey.set( depth , _linearTree() );
 		for( int i=start+(range*t)/threads ; i<start+(range*(t+1))/threads ; i++ )
 		{
 			int pIdx = sNodes.treeNodes[i]->nodeData.pointIndex;
 			if( pIdx!=-1 )
 			{
-				neighborKey.getNeighbors( sNodes.treeNodes[i] );
+				neighborKey.getNeighbors( sNodes.treeNodes[i] , i );
 				_points[ pIdx ].coarserValue = WeightedCoarserFunctionValue( neighborKey , sNodes.treeNodes[i] , metSolution );
 			}
 		}
@@ -2132,39 +2692,40 @@ Real Octree< Degree , OutputDensity >::WeightedCoarserFunctionValue( const typen
 	return Real( pointValue * weight );
 }
 template< int Degree , bool OutputDensity >
-int Octree< Degree , OutputDensity >::GetFixedDepthLaplacian( SparseSymmetricMatrix< Real >& matrix , int depth , const SortedTreeNodes< OutputDensity >& sNodes , Real* metSolution )
+int Octree< Degree , OutputDensity >::GetFixedDepthLaplacian( CSRSymmetricMatrix< MatrixReal >& matrix , int depth , const SortedTreeNodes< OutputDensity >& sNodes , Real* metSolution )
 {
 	int start = sNodes.nodeCount[depth] , end = sNodes.nodeCount[depth+1] , range = end-start;
 	double stencil[5][5][5];
 	SetLaplacianStencil( depth , stencil );
 	Stencil< double , 5 > stencils[2][2][2];
 	SetLaplacianStencils( depth , stencils );
-	matrix.Resize( range );
+
+	// Reserve all rows at once, with room for all neighbors (the unused entries are removed by finalize)
+	std::vector< int > rowSizes( range );
+	int rowBound = GetMatrixRowBound( 0 , 5 , 0 , 5 , 0 , 5 );
+#pragma omp parallel for num_threads( threads )
+	for( int i=0 ; i<range ; i++ ) rowSizes[i] = ( _boundaryType!=0 || _IsInsetSupported( sNodes.treeNodes[i+start] ) ) ? rowBound : 1;
+	matrix.resize( rowSizes , threads );
+
+	// Set the rows of each range of the matrix in order
 #pragma omp parallel for num_threads( threads )
 	for( int t=0 ; t<threads ; t++ )
 	{
-		typename TreeOctNode::NeighborKey5 neighborKey5;
-		neighborKey5.set( depth );
-		for( int i=(range*t)/threads ; i<(range*(t+1))/threads ; i++ )
+		NeighborKey5 neighborKey5;
+		neighborKey5.set( depth , _linearTree() );
+		std::vector< MatrixEntry< MatrixReal > > row( rowBound );
+		for( int i=matrix.rangeBegin( t ) ; i<matrix.rangeEnd( t ) ; i++ )
 		{
 			TreeOctNode* node = sNodes.treeNodes[i+start];
-			neighborKey5.getNeighbors( node );
-			// Get the matrix row size
+			neighborKey5.getNeighbors( node , i+start );
 			bool insetSupported = _boundaryType!=0 || _IsInsetSupported( node );
-			int count = insetSupported ? GetMatrixRowSize( neighborKey5.neighbors[depth] ) : 1;
-
-			// Allocate memory for the row
-#pragma omp critical (matrix_set_row_size)
-			{
-				matrix.SetRowSize( i , count );
-			}
 
 			// Set the row entries
-			if( insetSupported ) matrix.rowSizes[i] = SetMatrixRow( neighborKey5.neighbors[depth] , matrix[i] , start , stencil );
+			if( insetSupported ) matrix.setRow( i , &row[0] , SetMatrixRow( neighborKey5.neighbors[depth] , &row[0] , start , stencil ) );
 			else
 			{
-				matrix[i][0] = MatrixEntry< Real >( i , Real(1) );
-				matrix.rowSizes[i] = 1;
+				row[0] = MatrixEntry< MatrixReal >( i , MatrixReal(1) );
+				matrix.setRow( i , &row[0] , 1 );
 			}
 
 			// Offset the constraints using the solution from lower resolutions.
@@ -2178,10 +2739,11 @@ int Octree< Degree , OutputDensity >::GetFixedDepthLaplacian( SparseSymmetricMat
 			if( insetSupported ) UpdateConstraintsFromCoarser( neighborKey5 , node , metSolution , stencils[x][y][z] );
 		}
 	}
+	matrix.finalize();
 	return 1;
 }
 template< int Degree , bool OutputDensity >
-int Octree< Degree , OutputDensity>::GetRestrictedFixedDepthLaplacian( SparseSymmetricMatrix< Real >& matrix , int depth , const int* entries , int entryCount ,
+int Octree< Degree , OutputDensity>::GetRestrictedFixedDepthLaplacian( CSRSymmetricMatrix< MatrixReal >& matrix , int depth , const int* entries , int entryCount ,
     const TreeOctNode* rNode , Real /*radius*/ ,
 	const SortedTreeNodes< OutputDensity >& sNodes , Real* metSolution )
 {
@@ -2189,16 +2751,30 @@ int Octree< Degree , OutputDensity>::GetRestrictedFixedDepthLaplacian( SparseSym
 	double stencil[5][5][5];
 	int rDepth , rOff[3];
 	rNode->depthAndOffset( rDepth , rOff );
-	matrix.Resize( entryCount );
 	SetLaplacianStencil( depth , stencil );
 	Stencil< double , 5 > stencils[2][2][2];
 	SetLaplacianStencils( depth , stencils );
+
+	// Reserve all rows at once, with room for all neighbors within the bounds (the unused entries are removed by finalize)
+	std::vector< int > rowSizes( entryCount );
+#pragma omp parallel for num_threads( threads )
+	for( int i=0 ; i<entryCount ; i++ )
+	{
+		const TreeOctNode* node = sNodes.treeNodes[ entries[i] ];
+		int xStart , xEnd , yStart , yEnd , zStart , zEnd;
+		SetMatrixRowBounds( node , rDepth , rOff , xStart , xEnd , yStart , yEnd , zStart , zEnd );
+		rowSizes[i] = ( _boundaryType!=0 || _IsInsetSupported( node ) ) ? GetMatrixRowBound( xStart , xEnd , yStart , yEnd , zStart , zEnd ) : 1;
+	}
+	matrix.resize( rowSizes , threads );
+
+	// Set the rows of each range of the matrix in order
 #pragma omp parallel for num_threads( threads )
 	for( int t=0 ; t<threads ; t++ )
 	{
-		typename TreeOctNode::NeighborKey5 neighborKey5;
-		neighborKey5.set( depth );
-		for( int i=(entryCount*t)/threads ; i<(entryCount*(t+1))/threads ; i++ )
+		NeighborKey5 neighborKey5;
+		neighborKey5.set( depth , _linearTree() );
+		std::vector< MatrixEntry< MatrixReal > > row( GetMatrixRowBound( 0 , 5 , 0 , 5 , 0 , 5 ) );
+		for( int i=matrix.rangeBegin( t ) ; i<matrix.rangeEnd( t ) ; i++ )
 		{
 			TreeOctNode* node = sNodes.treeNodes[ entries[i] ];
 			int d , off[3];
@@ -2206,27 +2782,19 @@ int Octree< Degree , OutputDensity>::GetRestrictedFixedDepthLaplacian( SparseSym
 			off[0] >>= (depth-rDepth) , off[1] >>= (depth-rDepth) , off[2] >>= (depth-rDepth);
 			bool isInterior = ( off[0]==rOff[0] && off[1]==rOff[1] && off[2]==rOff[2] );
 
-			neighborKey5.getNeighbors( node );
+			neighborKey5.getNeighbors( node , entries[i] );
 
 			int xStart=0 , xEnd=5 , yStart=0 , yEnd=5 , zStart=0 , zEnd=5;
 			if( !isInterior ) SetMatrixRowBounds( neighborKey5.neighbors[depth].neighbors[2][2][2] , rDepth , rOff , xStart , xEnd , yStart , yEnd , zStart , zEnd );
 
-			// Get the matrix row size
 			bool insetSupported = _boundaryType!=0 || _IsInsetSupported( node );
-			int count = insetSupported ? GetMatrixRowSize( neighborKey5.neighbors[depth] , xStart , xEnd , yStart , yEnd , zStart , zEnd ) : 1;
-
-			// Allocate memory for the row
-#pragma omp critical (matrix_set_row_size)
-			{
-				matrix.SetRowSize( i , count );
-			}
 
 			// Set the matrix row entries
-			if( insetSupported ) matrix.rowSizes[i] = SetMatrixRow( neighborKey5.neighbors[depth] , matrix[i] , 0 , stencil , xStart , xEnd , yStart , yEnd , zStart , zEnd );
+			if( insetSupported ) matrix.setRow( i , &row[0] , SetMatrixRow( neighborKey5.neighbors[depth] , &row[0] , 0 , stencil , xStart , xEnd , yStart , yEnd , zStart , zEnd ) );
 			else
 			{
-				matrix[i][0] = MatrixEntry< Real >( i , Real(1) );
-				matrix.rowSizes[i] = 1;
+				row[0] = MatrixEntry< MatrixReal >( i , MatrixReal(1) );
+				matrix.setRow( i , &row[0] , 1 );
 			}
 
 			// Adjust the system constraints
@@ -2240,10 +2808,23 @@ int Octree< Degree , OutputDensity>::GetRestrictedFixedDepthLaplacian( SparseSym
 			if( insetSupported ) UpdateConstraintsFromCoarser( neighborKey5 , node , metSolution , stencils[x][y][z] );
 		}
 	}
+	matrix.finalize();
 	for( int i=0 ; i<entryCount ; i++ ) sNodes.treeNodes[entries[i]]->nodeData.nodeIndex = entries[i];
 	return 1;
 }
 
+template< int Degree , bool OutputDensity >
+int Octree< Degree , OutputDensity >::_SolveSystem( const CSRSymmetricMatrix< MatrixReal >& M , const PoissonVector< Real >& B , int iters , PoissonVector< Real >& X , Real eps , bool addDCTerm )
+{
+	if( !doublePrecisionSolver ) return CSRSymmetricMatrix< MatrixReal >::Solve( M , B , iters , X , eps , 0 , addDCTerm );
+
+	PoissonVector< double > b( B.Dimensions() ) , x( X.Dimensions() );
+	for( size_t i=0 ; i<B.Dimensions() ; i++ ) b[i] = B[i];
+	for( size_t i=0 ; i<X.Dimensions() ; i++ ) x[i] = X[i];
+	int iter = CSRSymmetricMatrix< MatrixReal >::Solve( M , b , iters , x , double( eps ) , 0 , addDCTerm );
+	for( size_t i=0 ; i<X.Dimensions() ; i++ ) X[i] = Real( x[i] );
+	return iter;
+}
 template< int Degree , bool OutputDensity >
 int Octree< Degree , OutputDensity >::LaplacianMatrixIteration( int subdivideDepth , bool showResidual , int minIters , double accuracy , int maxSolveDepth , int fixedIters )
 {
@@ -2269,7 +2850,7 @@ int Octree< Degree , OutputDensity >::_SolveFixedDepthMatrix( int depth , const
 {
 	int iter = 0;
 	PoissonVector< Real > X , B;
-	SparseSymmetricMatrix< Real > M;
+	CSRSymmetricMatrix< MatrixReal > M;
 	X.Resize( sNodes.nodeCount[depth+1]-sNodes.nodeCount[depth] );
 	if( depth<=_minDepth ) UpSampleCoarserSolution( depth , sNodes , X );
 	else
@@ -2291,6 +2872,7 @@ int Octree< Degree , OutputDensity >::_SolveFixedDepthMatrix( int depth , const
 		GetFixedDepthLaplacian( M , depth , sNodes , metSolution );
 		// Set the constraint vector
 		B.Resize( sNodes.nodeCount[depth+1]-sNodes.nodeCount[depth] );
+#pragma omp parallel for num_threads( threads )
 		for( int i=sNodes.nodeCount[depth] ; i<sNodes.nodeCount[depth+1] ; i++ )
 			if( _boundaryType!=0 || _IsInsetSupported( sNodes.treeNodes[i] ) ) B[i-sNodes.nodeCount[depth]] = sNodes.treeNodes[i]->nodeData.constraint;
 			else                                                               B[i-sNodes.nodeCount[depth]] = Real(0);
@@ -2298,33 +2880,29 @@ int Octree< Degree , OutputDensity >::_SolveFixedDepthMatrix( int depth , const
 
 
 	// Solve the linear system
-	Real _accuracy = Real( accuracy / 100000 ) * M.rows;
+	Real _accuracy = Real( accuracy / 100000 ) * M.rows();
 	int res = 1<<depth;
 
-	MapReducePoissonVector< Real > mrPoissonVector;
-	mrPoissonVector.resize( threads , M.rows );
-
 	if( _boundaryType==0 && depth>3 ) res -= 1<<(depth-2);
 	if( !noSolve )
     {
 		if( fixedIters>=0 )
         {
-            iter += SparseSymmetricMatrix< Real >::Solve( M , B , fixedIters                                                           , X , mrPoissonVector , Real(1e-10) , 0 , M.rows==res*res*res && !_constrainValues && _boundaryType!=-1 );
+            iter += _SolveSystem( M , B , fixedIters                                                             , X , Real(1e-10) , M.rows()==res*res*res && !_constrainValues && _boundaryType!=-1 );
         }
 		else
         {
-            iter += SparseSymmetricMatrix< Real >::Solve( M , B , std::max< int >( int( pow( M.rows , ITERATION_POWER ) ) , minIters ) , X , mrPoissonVector ,_accuracy    , 0 , M.rows==res*res*res && !_constrainValues && _boundaryType!=-1 );
+            iter += _SolveSystem( M , B , std::max< int >( int( pow( M.rows() , ITERATION_POWER ) ) , minIters ) , X , _accuracy   , M.rows()==res*res*res && !_constrainValues && _boundaryType!=-1 );
         }
     }
 	if( showResidual )
 	{
-		double mNorm = 0;
-		for( int i=0 ; i<M.rows ; i++ ) for( int j=0 ; j<M.rowSizes[i] ; j++ ) mNorm += M[i][j].Value * M[i][j].Value;
 //		double bNorm = B.Norm( 2 ) , rNorm = ( B - M * X ).Norm( 2 );
 //		DumpOutput( "\tResidual: (%d %g) %g -> %g (%f) [%d]\n" , M.Entries() , sqrt(mNorm) , bNorm , rNorm , rNorm/bNorm , iter );
 	}
 
 	// Copy the solution back into the tree (over-writing the constraints)
+#pragma omp parallel for num_threads( threads )
 	for( int i=sNodes.nodeCount[depth] ; i<sNodes.nodeCount[depth+1] ; i++ ) sNodes.treeNodes[i]->nodeData.solution = Real( X[i-sNodes.nodeCount[depth]] );
 
 	return iter;
@@ -2334,10 +2912,9 @@ int Octree< Degree , OutputDensity >::_SolveFixedDepthMatrix( int depth , const
 {
 	if( startingDepth>=depth ) return _SolveFixedDepthMatrix( depth , sNodes , metSolution , showResidual , minIters , accuracy , noSolve , fixedIters );
 	int i , j , d , tIter=0;
-	SparseSymmetricMatrix< Real > _M;
+	CSRSymmetricMatrix< MatrixReal > _M;
 	PoissonVector< Real > B , _B , _X;
 	AdjacencySetFunction asf;
-	AdjacencyCountFunction acf;
     Real myRadius;// , myRadius2;
 
 	if( depth>_minDepth )
@@ -2357,7 +2934,8 @@ int Octree< Degree , OutputDensity >::_SolveFixedDepthMatrix( int depth , const
 	B.Resize( sNodes.nodeCount[depth+1] - sNodes.nodeCount[depth] );
 
 	// Back-up the constraints
-	for( i=sNodes.nodeCount[depth] ; i<sNodes.nodeCount[depth+1] ; i++ )
+#pragma omp parallel for num_threads( threads )
+	for( int i=sNodes.nodeCount[depth] ; i<sNodes.nodeCount[depth+1] ; i++ )
 	{
 		if( _boundaryType!=0 || _IsInsetSupported( sNodes.treeNodes[i] ) ) B[i-sNodes.nodeCount[depth]] = sNodes.treeNodes[i]->nodeData.constraint;
 		else                                                               B[i-sNodes.nodeCount[depth]] = Real(0);
@@ -2371,8 +2949,11 @@ int Octree< Degree , OutputDensity >::_SolveFixedDepthMatrix( int depth , const
 	if( _boundaryType==0 ) d++;
 	std::vector< int > subDimension( sNodes.nodeCount[d+1]-sNodes.nodeCount[d] );
 	int maxDimension = 0;
-	for( i=sNodes.nodeCount[d] ; i<sNodes.nodeCount[d+1] ; i++ )
+	// The counts of the coarse nodes are independent, so compute them in parallel
+#pragma omp parallel for num_threads( threads ) schedule( dynamic ) reduction( max : maxDimension )
+	for( int i=sNodes.nodeCount[d] ; i<sNodes.nodeCount[d+1] ; i++ )
 	{
+		AdjacencyCountFunction acf;
 		// Count the number of nodes at depth "depth" that lie under sNodes.treeNodes[i]
 		acf.adjacencyCount = 0;
 		for( TreeOctNode* temp=sNodes.treeNodes[i]->nextNode() ; temp ; )
@@ -2380,7 +2961,7 @@ int Octree< Degree , OutputDensity >::_SolveFixedDepthMatrix( int depth , const
 			if( temp->depth()==depth ) acf.adjacencyCount++ , temp = sNodes.treeNodes[i]->nextBranch( temp );
 			else                                              temp = sNodes.treeNodes[i]->nextNode  ( temp );
 		}
-		for( j=sNodes.nodeCount[d] ; j<sNodes.nodeCount[d+1] ; j++ )
+		for( int j=sNodes.nodeCount[d] ; j<sNodes.nodeCount[d+1] ; j++ )
 		{
 			if( i==j ) continue;
 			TreeOctNode::ProcessFixedDepthNodeAdjacentNodes( fData.depth , sNodes.treeNodes[i] , 1 , sNodes.treeNodes[j] , 2*width-1 , depth , &acf );
@@ -2389,15 +2970,12 @@ int Octree< Degree , OutputDensity >::_SolveFixedDepthMatrix( int depth , const
 		maxDimension = std::max< int >( maxDimension , subDimension[i-sNodes.nodeCount[d]] );
 	}
 	asf.adjacencies = new int[maxDimension];
-	MapReducePoissonVector< Real > mrPoissonVector;
-	mrPoissonVector.resize( threads , maxDimension );
 	// Iterate through the coarse-level nodes
 	for( i=sNodes.nodeCount[d] ; i<sNodes.nodeCount[d+1] ; i++ )
 	{
 		int iter = 0;
-		// Count the number of nodes at depth "depth" that lie under sNodes.treeNodes[i]
-		acf.adjacencyCount = subDimension[i-sNodes.nodeCount[d]];
-		if( !acf.adjacencyCount ) continue;
+		// Skip coarse nodes without nodes at depth "depth" under or near them
+		if( !subDimension[i-sNodes.nodeCount[d]] ) continue;
 
 		// Set the indices for the nodes under, or near, sNodes.treeNodes[i].
 		asf.adjacencyCount = 0;
@@ -2430,22 +3008,20 @@ int Octree< Degree , OutputDensity >::_SolveFixedDepthMatrix( int depth , const
 
 		// Solve the matrix
 		// Since we don't have the full matrix, the system shouldn't be singular, so we shouldn't have to correct it
-		Real _accuracy = Real( accuracy / 100000 ) * _M.rows;
+		Real _accuracy = Real( accuracy / 100000 ) * _M.rows();
 		if( !noSolve )
         {
 			if( fixedIters>=0 )
-            {iter += SparseSymmetricMatrix< Real >::Solve( _M , _B , fixedIters                                                            , _X , mrPoissonVector ,  Real(1e-10) , 0 );
+            {iter += _SolveSystem( _M , _B , fixedIters                                                              , _X ,  Real(1e-10) , false );
             }
 			else
             {
-                iter += SparseSymmetricMatrix< Real >::Solve( _M , _B , std::max< int >( int( pow( _M.rows , ITERATION_POWER ) ) , minIters ) , _X , mrPoissonVector , _accuracy    , 0 );
+                iter += _SolveSystem( _M , _B , std::max< int >( int( pow( _M.rows() , ITERATION_POWER ) ) , minIters ) , _X , _accuracy    , false );
             }
         }
 
 		if( showResidual )
 		{
-			double mNorm = 0;
-			for( int i=0 ; i<_M.rows ; i++ ) for( int j=0 ; j<_M.rowSizes[i] ; j++ ) mNorm += _M[i][j].Value * _M[i][j].Value;
 //			double bNorm = _B.Norm( 2 ) , rNorm = ( _B - _M * _X ).Norm( 2 );
 //			DumpOutput( "\t\tResidual: (%d %g) %g -> %g (%f) [%d]\n" , _M.Entries() , sqrt(mNorm) , bNorm , rNorm , rNorm/bNorm , iter );
 		}
@@ -2516,15 +3092,15 @@ void Octree< Degree , OutputDensity >::SetLaplacianConstraints( void )
 #pragma omp parallel for num_threads( threads )
 		for( int t=0 ; t<threads ; t++ )
 		{
-			typename TreeOctNode::NeighborKey5 neighborKey5;
-			neighborKey5.set( fData.depth );
+			NeighborKey5 neighborKey5;
+			neighborKey5.set( fData.depth , _linearTree() );
 			int start = _sNodes.nodeCount[d] , end = _sNodes.nodeCount[d+1] , range = end-start;
 			for( int i=start+(range*t)/threads ; i<start+(range*(t+1))/threads ; i++ )
 			{
 				TreeOctNode* node = _sNodes.treeNodes[i];
 				int startX=0 , endX=5 , startY=0 , endY=5 , startZ=0 , endZ=5;
 				int depth = node->depth();
-				neighborKey5.getNeighbors( node );
+				neighborKey5.getNeighbors( node , i );
 
 				bool isInterior , isInterior2;
 				{
@@ -2638,8 +3214,8 @@ void Octree< Degree , OutputDensity >::SetLaplacianConstraints( void )
 #pragma omp parallel for num_threads( threads )
 		for( int t=0 ; t<threads ; t++ )
 		{
-			typename TreeOctNode::NeighborKey5 neighborKey5;
-			neighborKey5.set( maxDepth );
+			NeighborKey5 neighborKey5;
+			neighborKey5.set( maxDepth , _linearTree() );
 			for( int i=start+(range*t)/threads ; i<start+(range*(t+1))/threads ; i++ )
 			{
 				TreeOctNode* node = _sNodes.treeNodes[i];
@@ -2647,7 +3223,7 @@ void Octree< Degree , OutputDensity >::SetLaplacianConstraints( void )
 				if( !depth ) continue;
 				int startX=0 , endX=5 , startY=0 , endY=5 , startZ=0 , endZ=5;
 				UpdateCoarserSupportBounds( node , startX , endX , startY  , endY , startZ , endZ );
-				const typename TreeOctNode::Neighbors5& neighbors5 = neighborKey5.getNeighbors( node->parent );
+				const typename TreeOctNode::Neighbors5& neighbors5 = neighborKey5.getNeighbors( node->parent , _lNodes.parent( i ) );
 
 				bool isInterior;
 				{
@@ -2763,6 +3339,7 @@ void Octree< Degree , OutputDensity >::FaceEdgesFunction::Function( const TreeOc
 template< int Degree , bool OutputDensity >
 int Octree< Degree , OutputDensity >::refineBoundary( int subdivideDepth )
 {
+	typename TreeOctNode::AllocatorScope allocatorScope( _nodeAllocator );
 	// This implementation is somewhat tricky.
 	// We would like to ensure that leaf-nodes across a subdivision boundary have the same depth.
 	// We do this by calling the setNeighbors function.
@@ -2780,7 +3357,7 @@ int Octree< Degree , OutputDensity >::refineBoundary( int subdivideDepth )
 	if( _boundaryType==0 ) sDepth = std::max< int >( 2 , sDepth );
 	if( sDepth==0 )
 	{
-		_sNodes.set( tree );
+		_setSortedNodes();
 		return sDepth;
 	}
 
@@ -2830,7 +3407,7 @@ int Octree< Degree , OutputDensity >::refineBoundary( int subdivideDepth )
 				}
 			}
 		}
-	_sNodes.set( tree );
+	_setSortedNodes();
 	return sDepth;
 }
 template< int Degree , bool OutputDensity >
@@ -2873,13 +3450,14 @@ void Octree< Degree , OutputDensity >::GetMCIsoTriangles( Real isoValue , int su
 	memset( coarseRootData.cornerValuesSet  , 0 , sizeof( char ) * coarseRootData.cCount );
 	memset( coarseRootData.cornerNormalsSet , 0 , sizeof( char ) * coarseRootData.cCount );
 
-	std::vector< typename TreeOctNode::ConstNeighborKey3 > nKeys( threads );
-	for( int t=0 ; t<threads ; t++ ) nKeys[t].set( maxDepth );
-	typename TreeOctNode::ConstNeighborKey3 nKey;
-	std::vector< typename TreeOctNode::ConstNeighborKey5 > nKeys5( threads );
-	for( int t=0 ; t<threads ; t++ ) nKeys5[t].set( maxDepth );
-	typename TreeOctNode::ConstNeighborKey5 nKey5;
-	nKey5.set( maxDepth ) , nKey.set( maxDepth );
+	std::vector< ConstNeighborKey3 > nKeys( threads );
+	for( int t=0 ; t<threads ; t++ ) nKeys[t].set( maxDepth , _linearTree() );
+	ConstNeighborKey3 nKey;
+	std::vector< ConstNeighborKey5 > nKeys5( threads );
+	for( int t=0 ; t<threads ; t++ ) nKeys5[t].set( maxDepth , _linearTree() );
+	ConstNeighborKey5 nKey5;
+	nKey5.set( maxDepth , _linearTree() ) , nKey.set( maxDepth , _linearTree() );
+	std::vector< std::pair< int , int > > spans;
 	// First process all leaf nodes at depths strictly finer than sDepth, one subtree at a time.
 	for( int i=_sNodes.nodeCount[sDepth] ; i<_sNodes.nodeCount[sDepth+1] ; i++ )
 	{
@@ -2891,13 +3469,14 @@ void Octree< Degree , OutputDensity >::GetMCIsoTriangles( Real isoValue , int su
 		memset( rootData.cornerNormalsSet , 0 , sizeof( char ) * rootData.cCount );
 		memset( rootData.edgesSet         , 0 , sizeof( char ) * rootData.eCount );
 		interiorVertices = new std::vector< Vertex >();
+		_sNodes.setSpans( spans , _sNodes.treeNodes[i] , maxDepth );
 		for( int d=maxDepth ; d>sDepth ; d-- )
 		{
-			int leafNodeCount = 0;
-			std::vector< TreeOctNode* > leafNodes;
-			for( TreeOctNode* node=_sNodes.treeNodes[i]->nextLeaf() ; node ; node=_sNodes.treeNodes[i]->nextLeaf( node ) ) if( node->d==d && node->nodeData.nodeIndex!=-1 ) leafNodeCount++;
-			leafNodes.reserve( leafNodeCount );
-			for( TreeOctNode* node=_sNodes.treeNodes[i]->nextLeaf() ; node ; node=_sNodes.treeNodes[i]->nextLeaf( node ) ) if( node->d==d && node->nodeData.nodeIndex!=-1 ) leafNodes.push_back( node );
+			// The indices of the leaves of the subtree at depth d, in the same (Morton) order
+			// as a depth-first traversal, without walking the subtree
+			std::vector< int > leafNodes;
+			if( spans[d].first>=0 ) for( int j=spans[d].first ; j<spans[d].second ; j++ ) if( !_sNodes.treeNodes[j]->children ) leafNodes.push_back( j );
+			int leafNodeCount = (int)leafNodes.size();
 			Stencil< Real , 3 > stencil1[8] , stencil2[8][8];
 			SetEvaluationStencils( d , stencil1 , stencil2 );
 
@@ -2905,7 +3484,8 @@ void Octree< Degree , OutputDensity >::GetMCIsoTriangles( Real isoValue , int su
 #pragma omp parallel for num_threads( threads )
 			for( int t=0 ; t<threads ; t++ ) for( int i=(leafNodeCount*t)/threads ; i<(leafNodeCount*(t+1))/threads ; i++ )
 			{
-				TreeOctNode* leaf = leafNodes[i];
+				TreeOctNode* leaf = _sNodes.treeNodes[ leafNodes[i] ];
+				nKeys[t].getNeighbors( leaf , leafNodes[i] );
 				SetIsoCorners( isoValue , leaf , rootData , rootData.cornerValuesSet , rootData.cornerValues , nKeys[t] , &metSolution[0] , stencil1 , stencil2 );
 
 				// If this node shares a vertex with a coarser node, set the vertex value
@@ -2937,7 +3517,7 @@ void Octree< Degree , OutputDensity >::GetMCIsoTriangles( Real isoValue , int su
 #pragma omp parallel for num_threads( threads )
 			for( int t=0 ; t<threads ; t++ ) for( int i=(leafNodeCount*t)/threads ; i<(leafNodeCount*(t+1))/threads ; i++ )
 			{
-				TreeOctNode* leaf = leafNodes[i];
+				TreeOctNode* leaf = _sNodes.treeNodes[ leafNodes[i] ];
 				if( _boundaryType!=0 || _IsInset( leaf ) ) GetMCIsoTriangles( leaf , mesh , rootData , interiorVertices , offSet , sDepth , polygonMesh , barycenterPtr );
 			}
 			for( size_t i=0 ; i<barycenters.size() ; i++ ) interiorVertices->push_back( barycenters[i] );
@@ -2967,6 +3547,7 @@ void Octree< Degree , OutputDensity >::GetMCIsoTriangles( Real isoValue , int su
 			if( leaf->children ) continue;
 
 			// First set the corner values and associated marching-cube indices
+			nKey.getNeighbors( leaf , i );
 			SetIsoCorners( isoValue , leaf , coarseRootData , coarseRootData.cornerValuesSet , coarseRootData.cornerValues , nKey , &metSolution[0] , stencil1 , stencil2 );
 
 			// Now compute the iso-vertices
@@ -3183,13 +3764,13 @@ Real Octree< Degree , OutputDensity >::GetIsoValue( void )
 #pragma omp parallel for num_threads( threads ) reduction( + : isoValue , weightSum )
 	for( int t=0 ; t<threads ; t++)
 	{
-		typename TreeOctNode::ConstNeighborKey3 nKey;
-		nKey.set( _sNodes.maxDepth-1 );
+		ConstNeighborKey3 nKey;
+		nKey.set( _sNodes.maxDepth-1 , _linearTree() );
 		int nodeCount = _sNodes.nodeCount[ _sNodes.maxDepth ];
 		for( int i=(nodeCount*t)/threads ; i<(nodeCount*(t+1))/threads ; i++ )
 		{
 			TreeOctNode* temp = _sNodes.treeNodes[i];
-			nKey.getNeighbors( temp );
+			nKey.getNeighbors( temp , i );
 			Real w = temp->nodeData.centerWeightContribution[OutputDensity?1:0];
 			if( w!=0 )
 			{
@@ -3201,9 +3782,117 @@ Real Octree< Degree , OutputDensity >::GetIsoValue( void )
 	if( _boundaryType==-1 ) return isoValue/weightSum - Real(0.5);
 	else                    return isoValue/weightSum;
 }
+template< int Degree , bool OutputDensity >
+template< class Vertex >
+void Octree< Degree , OutputDensity >::ExtractMCIsoTriangles( Real isoValue , int subdivideDepth , CoredMeshData< Vertex >* mesh , bool addBarycenter , bool polygonMesh )
+{
+	// Mark the nodes with children and remember the allocator state, in depth-first order
+	std::vector< char > flags;
+	for( const TreeOctNode* node=tree.nextNode() ; node ; node=tree.nextNode( node ) ) flags.push_back( node->children ? 1 : 0 );
+	AllocatorState state = _nodeAllocator.getState();
+	int finalizedDepth = _finalizedDepth;
+
+	// A tree finalized for this depth is ready for the extraction, finalizing it again could add nodes
+	if( subdivideDepth!=_finalizedDepth ) finalize( subdivideDepth );
+	GetMCIsoTriangles( isoValue , subdivideDepth , mesh , 0 , 1 , addBarycenter , polygonMesh );
+
+	// The traversal skips the detached children, so the remaining nodes are visited in the original order
+	size_t i = 0;
+	for( TreeOctNode* node=tree.nextNode() ; node ; node=tree.nextNode( node ) , i++ ) if( !flags[i] ) node->children = NULL;
+	_nodeAllocator.rollBack( state );
+	_finalizedDepth = finalizedDepth;
+	_setSortedNodes();
+}
+template< int Degree , bool OutputDensity >
+int Octree< Degree , OutputDensity >::write( FILE* fp ) const
+{
+	// The nodes in depth-first order, with a flag for the nodes that have children
+	const int valueCount = 1 + int( sizeof( tree.nodeData.centerWeightContribution ) / sizeof( Real ) );
+	size_t nodeCount = 0;
+	for( const TreeOctNode* node=tree.nextNode() ; node ; node=tree.nextNode( node ) ) nodeCount++;
+	std::vector< char > flags( nodeCount );
+	std::vector< Real > values( nodeCount * valueCount );
+	nodeCount = 0;
+	for( const TreeOctNode* node=tree.nextNode() ; node ; node=tree.nextNode( node ) , nodeCount++ )
+	{
+		flags[nodeCount] = node->children ? 1 : 0;
+		values[ nodeCount*valueCount ] = node->nodeData.solution;
+		for( int i=1 ; i<valueCount ; i++ ) values[ nodeCount*valueCount+i ] = node->nodeData.centerWeightContribution[i-1];
+	}
+
+	int header[] = { Degree , OutputDensity ? 1 : 0 , int( sizeof( Real ) ) , fData.depth , _boundaryType , _minDepth , _finalizedDepth };
+	Real transform[] = { _scale , _center[0] , _center[1] , _center[2] };
+	if( fwrite( "PoissonTree" , 1 , 12 , fp )!=12 || fwrite( header , sizeof( int ) , 7 , fp )!=7 || fwrite( transform , sizeof( Real ) , 4 , fp )!=4 ||
+	    fwrite( &nodeCount , sizeof( size_t ) , 1 , fp )!=1 || fwrite( &flags[0] , 1 , nodeCount , fp )!=nodeCount ||
+	    fwrite( &values[0] , sizeof( Real ) , values.size() , fp )!=values.size() )
+	{
+		fprintf( stderr , "[ERROR] Octree::write: failed to write the tree\n" );
+		return 0;
+	}
+	return 1;
+}
+template< int Degree , bool OutputDensity >
+int Octree< Degree , OutputDensity >::read( FILE* fp )
+{
+	typename TreeOctNode::AllocatorScope allocatorScope( _nodeAllocator );
+	const int valueCount = 1 + int( sizeof( tree.nodeData.centerWeightContribution ) / sizeof( Real ) );
+	if( tree.children )
+	{
+		fprintf( stderr , "[ERROR] Octree::read: the tree is not empty\n" );
+		return 0;
+	}
+	char magic[12];
+	int header[7];
+	Real transform[4];
+	size_t nodeCount;
+	if( fread( magic , 1 , 12 , fp )!=12 || strncmp( magic , "PoissonTree" , 12 ) || fread( header , sizeof( int ) , 7 , fp )!=7 ||
+	    fread( transform , sizeof( Real ) , 4 , fp )!=4 || fread( &nodeCount , sizeof( size_t ) , 1 , fp )!=1 || !nodeCount )
+	{
+		fprintf( stderr , "[ERROR] Octree::read: not a Poisson tree\n" );
+		return 0;
+	}
+	if( header[0]!=Degree || header[1]!=( OutputDensity ? 1 : 0 ) || header[2]!=int( sizeof( Real ) ) )
+	{
+		fprintf( stderr , "[ERROR] Octree::read: the tree was written with degree %d, density %d, and %d-byte values\n" , header[0] , header[1] , header[2] );
+		return 0;
+	}
+	std::vector< char > flags( nodeCount );
+	std::vector< Real > values( nodeCount * valueCount );
+	if( fread( &flags[0] , 1 , nodeCount , fp )!=nodeCount || fread( &values[0] , sizeof( Real ) , values.size() , fp )!=values.size() )
+	{
+		fprintf( stderr , "[ERROR] Octree::read: failed to read the tree\n" );
+		return 0;
+	}
+
+	// setBSplineData increments the depth for free boundaries
+	setBSplineData( header[4]==0 ? header[3]-1 : header[3] , header[4] );
+	_minDepth = header[5] , _finalizedDepth = header[6];
+	_scale = transform[0] , _center = Point3D< Real >( transform[1] , transform[2] , transform[3] );
+
+	// The children of a node are created when it is read, before the traversal reaches them
+	size_t i = 0;
+	for( TreeOctNode* node=tree.nextNode() ; node ; node=tree.nextNode( node ) , i++ )
+	{
+		if( i==nodeCount )
+		{
+			fprintf( stderr , "[ERROR] Octree::read: inconsistent tree\n" );
+			return 0;
+		}
+		if( flags[i] ) node->initChildren();
+		node->nodeData.solution = values[ i*valueCount ];
+		for( int j=1 ; j<valueCount ; j++ ) node->nodeData.centerWeightContribution[j-1] = values[ i*valueCount+j ];
+	}
+	if( i!=nodeCount )
+	{
+		fprintf( stderr , "[ERROR] Octree::read: inconsistent tree\n" );
+		return 0;
+	}
+	_setSortedNodes();
+	return 1;
+}
 
 template< int Degree , bool OutputDensity >
-void Octree< Degree , OutputDensity >::SetIsoCorners( Real isoValue , TreeOctNode* leaf , typename SortedTreeNodes< OutputDensity >::CornerTableData& cData , Pointer( char ) valuesSet , Pointer( Real ) values , typename TreeOctNode::ConstNeighborKey3& nKey , const Real* metSolution , const Stencil< Real , 3 > stencil1[8] , const Stencil< Real , 3 > stencil2[8][8] )
+void Octree< Degree , OutputDensity >::SetIsoCorners( Real isoValue , TreeOctNode* leaf , typename SortedTreeNodes< OutputDensity >::CornerTableData& cData , Pointer( char ) valuesSet , Pointer( Real ) values , ConstNeighborKey3& nKey , const Real* metSolution , const Stencil< Real , 3 > stencil1[8] , const Stencil< Real , 3 > stencil2[8][8] )
 {
 	Real cornerValues[ Cube::CORNERS ];
 	const typename SortedTreeNodes< OutputDensity >::CornerIndices& cIndices = cData[ leaf ];
@@ -3429,7 +4118,7 @@ void SetVertexValue(      PlyVertex< Real >& /*vertex*/ , Real /*value*/ ){ ; }
 void SetVertexValue( PlyValueVertex< Real >& vertex , Real value ){ vertex.value = value; }
 template< int Degree , bool OutputDensity >
 template< class Vertex >
-int Octree< Degree , OutputDensity >::GetRoot( const RootInfo< OutputDensity >& ri , Real isoValue , typename TreeOctNode::ConstNeighborKey5& neighborKey5 , Vertex& vertex , RootData& rootData , int sDepth , const Real* metSolution , int nonLinearFit )
+int Octree< Degree , OutputDensity >::GetRoot( const RootInfo< OutputDensity >& ri , Real isoValue , ConstNeighborKey5& neighborKey5 , Vertex& vertex , RootData& rootData , int sDepth , const Real* metSolution , int nonLinearFit )
 {
 	Point3D< Real > position;
 	if( !MarchingCubes::HasRoots( ri.node->nodeData.mcIndex ) ) return 0;
@@ -3771,7 +4460,7 @@ int Octree< Degree , OutputDensity >::GetRootIndex( const RootInfo< OutputDensit
 }
 template< int Degree , bool OutputDensity >
 template< class Vertex >
-int Octree< Degree , OutputDensity >::SetMCRootPositions( TreeOctNode* node , int sDepth , Real isoValue , typename TreeOctNode::ConstNeighborKey5& neighborKey5 , RootData& rootData ,
+int Octree< Degree , OutputDensity >::SetMCRootPositions( TreeOctNode* node , int sDepth , Real isoValue , ConstNeighborKey5& neighborKey5 , RootData& rootData ,
 	std::vector< Vertex >* interiorVertices , CoredMeshData< Vertex >* mesh , const Real* metSolution , int nonLinearFit )
 {
 	Vertex vertex;
@@ -39,7 +39,7 @@ template< class NodeData , class Real=float >
 class OctNode
 {
 private:
-	static int UseAlloc;
+	static thread_local Allocator<OctNode>* CurrentAllocator;
 
 	class AdjacencyCountFunction
 	{
@@ -76,9 +76,23 @@ public:
 	static const int DepthShift,OffsetShift,OffsetShift1,OffsetShift2,OffsetShift3;
 	static const int DepthMask,OffsetMask;
 
-	static Allocator<OctNode> MyAllocator;
-	static int UseAllocator(void);
-	static void SetAllocator(int blockSize);
+	// Children are allocated in blocks from the allocator of the current
+	// thread and are released together with that allocator, never by their
+	// parent. An AllocatorScope makes the allocator of a tree the current
+	// one while the tree is modified, such that each tree owns its nodes and
+	// several trees can be built concurrently in different threads. Creating
+	// children outside of a scope is an error.
+	static const int DefaultBlockSize;
+	static Allocator<OctNode>& NodeAllocator(void);
+	class AllocatorScope
+	{
+		Allocator<OctNode>* previous;
+	public:
+		AllocatorScope( Allocator<OctNode>& allocator ){ previous = CurrentAllocator ; CurrentAllocator = &allocator; }
+		~AllocatorScope( void ){ CurrentAllocator = previous; }
+		AllocatorScope( const AllocatorScope& ) = delete;
+		AllocatorScope& operator = ( const AllocatorScope& ) = delete;
+	};
 
 	OctNode* parent;
 	OctNode* children;
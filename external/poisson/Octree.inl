@@ -26,6 +26,7 @@ ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF S
 DAMAGE.
 */
 
+#include <stdio.h>
 #include <stdlib.h>
 #include <math.h>
 #include <algorithm>
@@ -41,21 +42,15 @@ template<class NodeData,class Real> const int OctNode<NodeData,Real>::OffsetShif
 template<class NodeData,class Real> const int OctNode<NodeData,Real>::OffsetShift2=OffsetShift1+OffsetShift;
 template<class NodeData,class Real> const int OctNode<NodeData,Real>::OffsetShift3=OffsetShift2+OffsetShift;
 
-template<class NodeData,class Real> int OctNode<NodeData,Real>::UseAlloc=0;
-template<class NodeData,class Real> Allocator<OctNode<NodeData,Real> > OctNode<NodeData,Real>::MyAllocator;
+template<class NodeData,class Real> const int OctNode<NodeData,Real>::DefaultBlockSize=1<<12;
+template<class NodeData,class Real> thread_local Allocator<OctNode<NodeData,Real> >* OctNode<NodeData,Real>::CurrentAllocator=NULL;
 
 template<class NodeData,class Real>
-void OctNode<NodeData,Real>::SetAllocator(int blockSize)
+Allocator<OctNode<NodeData,Real> >& OctNode<NodeData,Real>::NodeAllocator(void)
 {
-	if(blockSize>0)
-	{
-		UseAlloc=1;
-		MyAllocator.set(blockSize);
-	}
-	else{UseAlloc=0;}
+	if( !CurrentAllocator ) fprintf( stderr , "[ERROR] OctNode::NodeAllocator: nodes allocated outside of an AllocatorScope\n" ) , abort();
+	return *CurrentAllocator;
 }
-template<class NodeData,class Real>
-int OctNode<NodeData,Real>::UseAllocator(void){return UseAlloc;}
 
 template <class NodeData,class Real>
 OctNode<NodeData,Real>::OctNode(void){
@@ -65,7 +60,6 @@ OctNode<NodeData,Real>::OctNode(void){
 
 template <class NodeData,class Real>
 OctNode<NodeData,Real>::~OctNode(void){
-	if(!UseAlloc){if(children){delete[] children;}}
 	parent=children=NULL;
 }
 template <class NodeData,class Real>
@@ -80,13 +74,7 @@ void OctNode<NodeData,Real>::setFullDepth(int maxDepth){
 template <class NodeData,class Real>
 int OctNode<NodeData,Real>::initChildren( void )
 {
-	if( UseAlloc ) children=MyAllocator.newElements(8);
-	else
-	{
-		if( children ) delete[] children;
-		children = NULL;
-		children = new OctNode[Cube::CORNERS];
-	}
+	children = NodeAllocator().newElements( Cube::CORNERS );
 	if( !children )
 	{
 		fprintf(stderr,"Failed to initialize children in OctNode::initChildren\n");
@@ -757,7 +745,6 @@ template <class NodeData,class Real>
 template<class NodeData2>
 OctNode<NodeData,Real>& OctNode<NodeData,Real>::operator = (const OctNode<NodeData2,Real>& node){
 	unsigned int i;
-	if(children){delete[] children;}
 	children=NULL;
 
 	this->depth=node.depth;
@@ -31,6 +31,16 @@ DAMAGE.
 
 #include "PoissonVector.h"
 #include "Array.h"
+#include <vector>
+#include <algorithm>
+
+// OpenMP 4 SIMD hint for the reduction in the next loop, ignored by older compilers
+#if defined( _OPENMP ) && _OPENMP>=201307
+#define SIMD_PRAGMA( x ) _Pragma( #x )
+#define SIMD_SUM_REDUCTION( var ) SIMD_PRAGMA( omp simd reduction( + : var ) )
+#else
+#define SIMD_SUM_REDUCTION( var )
+#endif
 
 template <class T>
 struct MatrixEntry
@@ -166,6 +176,68 @@ public:
 	void getDiagonal( PoissonVector< T2 >& diagonal ) const;
 };
 
+// A symmetric sparse matrix in compressed sparse row format. As in
+// SparseSymmetricMatrix, each row stores only half of the entries and an
+// entry (i,j) stands for both (i,j) and (j,i). The column indices and values
+// of all rows are stored in two separate arrays within a single allocation.
+//
+// The rows are split into one contiguous range per thread. The entries of a
+// row whose column is in the same range come first and are applied
+// symmetrically by the thread of the range. The transposes of the other
+// entries are additionally stored with the rows of their columns, such that
+// each thread only writes to its own part of the output and the product
+// needs no per-thread scratch vectors. The loops over these entries only
+// gather and are vectorized with AVX2 or AVX-512 if enabled by the compiler.
+template< class T >
+class CSRSymmetricMatrix
+{
+	int _rows , _threads;
+	size_t _entries , _capacity;
+	std::vector< int > _bounds;
+	std::vector< size_t > _rowStart , _rangeStart , _remoteStart;
+	std::vector< int > _localSizes;
+	Pointer( char ) _memory;
+	Pointer( int ) _columns;
+	Pointer( T ) _values;
+	std::vector< int > _remoteColumns;
+	std::vector< T > _remoteValues;
+	void _setRanges( void );
+public:
+	CSRSymmetricMatrix( void );
+	~CSRSymmetricMatrix( void );
+	CSRSymmetricMatrix( const CSRSymmetricMatrix& ) = delete;
+	CSRSymmetricMatrix& operator = ( const CSRSymmetricMatrix& ) = delete;
+
+	// Reserves room for rows with at most rowCapacities[i] entries and splits them into ranges of
+	// about the same capacity, one per thread. Only the pages that are written are actually used.
+	void resize( const std::vector< int >& rowCapacities , int threads );
+	// The rows [ rangeBegin(t) , rangeEnd(t) ) of range t
+	int rangeBegin( int t ) const { return _bounds[t]; }
+	int rangeEnd( int t ) const { return _bounds[t+1]; }
+	// Sets row i, with at most the capacity of the row. All rows have to be set, those of a range
+	// in order by one thread, such that the rows of a range are stored contiguously.
+	template< class T2 >
+	void setRow( int i , ConstPointer( MatrixEntry< T2 > ) row , int count );
+	// Moves the ranges next to each other, releases the unused capacity, and sorts the entries
+	// of each row by range, after all rows are set.
+	void finalize( void );
+	// Copies a (finalized) SparseSymmetricMatrix.
+	template< class T2 >
+	void set( const SparseSymmetricMatrix< T2 >& M , int threads );
+
+	int rows( void ) const { return _rows; }
+	int threads( void ) const { return _threads; }
+	size_t entries( void ) const { return _entries; }
+	size_t memoryUsage( void ) const;
+
+	template< class T2 >
+	void Multiply( const PoissonVector< T2 >& In , PoissonVector< T2 >& Out , bool addDCTerm=false ) const;
+
+	// Conjugate gradients with the threads of the matrix, the arithmetic is done in T2
+	template< class T2 >
+	static int Solve( const CSRSymmetricMatrix< T >& A , const PoissonVector< T2 >& b , int iters , PoissonVector< T2 >& solution , T2 eps=1e-8 , int reset=1 , bool addDCTerm=false );
+};
+
 #include "SparseMatrix.inl"
 
 #endif
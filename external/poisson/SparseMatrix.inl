@@ -308,8 +308,8 @@ int SparseMatrix<T>::SolveSymmetric( const SparseMatrix<T>& M , const PoissonVec
 	M.Multiply( solution , r );
 	r = b - r;
 	PoissonVector< T2 > d = r;
-	double delta_new , delta_0;
-	for( int i=0 ; i<r.Dimensions() ; i++ ) delta_new += r.m_pV[i] * r.m_pV[i];
+	double delta_new = 0 , delta_0;
+	for( int i=0 ; i<int( r.Dimensions() ) ; i++ ) delta_new += r.m_pV[i] * r.m_pV[i];
 	delta_0 = delta_new;
 	if( delta_new<eps ) return 0;
 	int ii;
@@ -319,10 +319,10 @@ int SparseMatrix<T>::SolveSymmetric( const SparseMatrix<T>& M , const PoissonVec
 	{
 		M.Multiply( d , q , threads );
         double dDotQ = 0 , alpha = 0;
-		for( int i=0 ; i<d.Dimensions() ; i++ ) dDotQ += d.m_pV[i] * q.m_pV[i];
+		for( int i=0 ; i<int( d.Dimensions() ) ; i++ ) dDotQ += d.m_pV[i] * q.m_pV[i];
 		alpha = delta_new / dDotQ;
 #pragma omp parallel for num_threads( threads ) schedule( static )
-		for( int i=0 ; i<r.Dimensions() ; i++ ) solution.m_pV[i] += d.m_pV[i] * T2( alpha );
+		for( int i=0 ; i<int( r.Dimensions() ) ; i++ ) solution.m_pV[i] += d.m_pV[i] * T2( alpha );
 		if( !(ii%50) )
 		{
 			r.Resize( solution.Dimensions() );
@@ -331,14 +331,14 @@ int SparseMatrix<T>::SolveSymmetric( const SparseMatrix<T>& M , const PoissonVec
 		}
 		else
 #pragma omp parallel for num_threads( threads ) schedule( static )
-			for( int i=0 ; i<r.Dimensions() ; i++ ) r.m_pV[i] = r.m_pV[i] - q.m_pV[i] * T2(alpha);
+			for( int i=0 ; i<int( r.Dimensions() ) ; i++ ) r.m_pV[i] = r.m_pV[i] - q.m_pV[i] * T2(alpha);
 
 		double delta_old = delta_new , beta;
 		delta_new = 0;
-		for( int i=0 ; i<r.Dimensions() ; i++ ) delta_new += r.m_pV[i]*r.m_pV[i];
+		for( int i=0 ; i<int( r.Dimensions() ) ; i++ ) delta_new += r.m_pV[i]*r.m_pV[i];
 		beta = delta_new / delta_old;
 #pragma omp parallel for num_threads( threads ) schedule( static )
-		for( int i=0 ; i<d.Dimensions() ; i++ ) d.m_pV[i] = r.m_pV[i] + d.m_pV[i] * T2( beta );
+		for( int i=0 ; i<int( d.Dimensions() ) ; i++ ) d.m_pV[i] = r.m_pV[i] + d.m_pV[i] * T2( beta );
 	}
 	return ii;
 }
@@ -804,7 +804,7 @@ int SparseSymmetricMatrix< T >::Solve( const SparseSymmetricMatrix<T>& A , const
 			if( solveNormal ) A.Multiply( x , temp , scratch , addDCTerm ) , A.Multiply( temp , r , scratch , addDCTerm );
 			else              A.Multiply( x , r , scratch , addDCTerm );
 #pragma omp parallel for num_threads( threads ) reduction( + : delta_new )
-			for( int i=0 ; i<dim ; i++ ) _r[i] = _b[i] - _r[i] , delta_new += _r[i] * _r[i] , _x[i] += _d[i] * alpha;
+			for( int i=0 ; i<dim ; i++ ) _r[i] = _b[i] - _r[i] , delta_new += _r[i] * _r[i];
 		}
 		else
 #pragma omp parallel for num_threads( threads ) reduction( + : delta_new )
@@ -891,7 +891,7 @@ int SparseSymmetricMatrix<T>::Solve( const SparseSymmetricMatrix<T>& A , const P
 				else            A.Multiply( x , r , addDCTerm );
 			}
 #pragma omp parallel for num_threads( threads ) reduction ( + : delta_new )
-			for( int i=0 ; i<dim ; i++ ) _r[i] = _b[i] - _r[i] , delta_new += _r[i] * _r[i] , _x[i] += _d[i] * alpha;
+			for( int i=0 ; i<dim ; i++ ) _r[i] = _b[i] - _r[i] , delta_new += _r[i] * _r[i];
 		}
 		else
 		{
@@ -940,3 +940,266 @@ void SparseSymmetricMatrix< T >::getDiagonal( PoissonVector< T2 >& diagonal ) co
 		for( int j=0 ; j<SparseMatrix< T >::rowSizes[i] ; j++ ) if( SparseMatrix< T >::m_ppElements[i][j].N==i ) diagonal[i] += SparseMatrix< T >::m_ppElements[i][j].Value * 2;
 	}
 }
+
+/////////////////////////
+// CSRSymmetricMatrix //
+/////////////////////////
+template< class T >
+CSRSymmetricMatrix< T >::CSRSymmetricMatrix( void )
+{
+	_rows = 0 , _threads = 1 , _entries = _capacity = 0;
+	_memory = NULL , _columns = NULL , _values = NULL;
+}
+template< class T >
+CSRSymmetricMatrix< T >::~CSRSymmetricMatrix( void ){ if( _memory ) free( _memory ); }
+
+template< class T >
+void CSRSymmetricMatrix< T >::resize( const std::vector< int >& rowCapacities , int threads )
+{
+	if( threads<1 ) threads = 1;
+	_rows = int( rowCapacities.size() ) , _threads = threads , _entries = 0;
+	std::vector< size_t > capacityStart( _rows+1 );
+	capacityStart[0] = 0;
+	for( int i=0 ; i<_rows ; i++ ) capacityStart[i+1] = capacityStart[i] + rowCapacities[i];
+	_capacity = capacityStart[_rows];
+
+	// The column indices, followed by the values on a new cache line
+	size_t valueOffset = ( ( _capacity*sizeof( int ) + 63 ) / 64 ) * 64;
+	if( _memory ) free( _memory );
+	_memory = (char*)malloc( valueOffset + _capacity*sizeof( T ) + 1 );
+	if( !_memory ){ fprintf( stderr , "[ERROR] Failed to allocate %zu matrix entries\n" , _capacity ) ; exit( 0 ); }
+	_columns = (int*)_memory;
+	_values = (T*)( _memory + valueOffset );
+
+	// Split the rows into ranges with about the same capacity
+	_bounds.resize( _threads+1 );
+	_bounds[0] = 0;
+	for( int t=1 ; t<_threads ; t++ )
+	{
+		size_t target = ( _capacity*t ) / _threads;
+		_bounds[t] = int( std::lower_bound( capacityStart.begin()+_bounds[t-1] , capacityStart.begin()+_rows , target ) - capacityStart.begin() );
+	}
+	_bounds[_threads] = _rows;
+	_rangeStart.resize( _threads );
+	for( int t=0 ; t<_threads ; t++ ) _rangeStart[t] = capacityStart[ _bounds[t] ];
+	_rowStart.assign( _rows+1 , 0 );
+	_localSizes.assign( _rows , 0 );
+}
+template< class T >
+template< class T2 >
+void CSRSymmetricMatrix< T >::setRow( int i , ConstPointer( MatrixEntry< T2 > ) row , int count )
+{
+	// The row follows the previous row of its range, its size is kept in _localSizes until the matrix is finalized
+	int t = int( std::upper_bound( _bounds.begin() , _bounds.end() , i ) - _bounds.begin() ) - 1;
+	size_t start = i==_bounds[t] ? _rangeStart[t] : _rowStart[i-1] + _localSizes[i-1];
+	int* columns = _columns + start;
+	T* values = _values + start;
+	for( int j=0 ; j<count ; j++ ) columns[j] = row[j].N , values[j] = T( row[j].Value );
+	_rowStart[i] = start , _localSizes[i] = count;
+}
+template< class T >
+void CSRSymmetricMatrix< T >::finalize( void )
+{
+	// Move the column indices of the ranges next to each other
+	std::vector< size_t > rangeSizes( _threads ) , rangeOffsets( _threads );
+	_entries = 0;
+	for( int t=0 ; t<_threads ; t++ )
+	{
+		int last = _bounds[t+1]-1;
+		rangeSizes[t] = _bounds[t+1]>_bounds[t] ? _rowStart[last] + _localSizes[last] - _rangeStart[t] : 0;
+		rangeOffsets[t] = _entries;
+		if( _entries!=_rangeStart[t] ) memmove( _columns+_entries , _columns+_rangeStart[t] , sizeof( int ) * rangeSizes[t] );
+		_entries += rangeSizes[t];
+	}
+
+	// Likewise for the values, and release the memory after them. The values are not moved
+	// next to the columns, as this would touch the unused pages in between.
+	for( int t=0 ; t<_threads ; t++ )
+		if( rangeOffsets[t]!=_rangeStart[t] ) memmove( _values+rangeOffsets[t] , _values+_rangeStart[t] , sizeof( T ) * rangeSizes[t] );
+	size_t valueOffset = (char*)_values - _memory;
+	if( _entries<_capacity )
+	{
+		char* memory = (char*)realloc( _memory , valueOffset + _entries*sizeof( T ) + 1 );
+		if( memory ) _memory = memory;
+	}
+	_columns = (int*)_memory;
+	_values = (T*)( _memory + valueOffset );
+	_capacity = _entries;
+
+	for( int t=0 ; t<_threads ; t++ )
+		for( int i=_bounds[t] ; i<_bounds[t+1] ; i++ ) _rowStart[i] = _rowStart[i] - _rangeStart[t] + rangeOffsets[t];
+	_rowStart[_rows] = _entries;
+	for( int t=0 ; t<_threads ; t++ ) _rangeStart[t] = rangeOffsets[t];
+	_setRanges();
+}
+template< class T >
+void CSRSymmetricMatrix< T >::_setRanges( void )
+{
+	_remoteStart.assign( _rows+1 , 0 );
+	_remoteColumns.clear() , _remoteValues.clear();
+	if( _threads==1 )
+	{
+		for( int i=0 ; i<_rows ; i++ ) _localSizes[i] = int( _rowStart[i+1]-_rowStart[i] );
+		return;
+	}
+
+	// Move the entries with columns in the range of the row to the front (keeping their order)
+	// and count the transposes of the other entries for the rows of their columns
+	std::vector< int > remoteCounts( _rows+1 , 0 );
+#pragma omp parallel for num_threads( _threads )
+	for( int t=0 ; t<_threads ; t++ )
+	{
+		std::vector< int > columns;
+		std::vector< T > values;
+		for( int i=_bounds[t] ; i<_bounds[t+1] ; i++ )
+		{
+			int* _c = _columns + _rowStart[i];
+			T* _v = _values + _rowStart[i];
+			int size = int( _rowStart[i+1]-_rowStart[i] ) , local = 0;
+			columns.clear() , values.clear();
+			for( int j=0 ; j<size ; j++ )
+				if( _c[j]>=_bounds[t] && _c[j]<_bounds[t+1] ) _c[local] = _c[j] , _v[local] = _v[j] , local++;
+				else
+				{
+					columns.push_back( _c[j] ) , values.push_back( _v[j] );
+#pragma omp atomic
+					remoteCounts[ _c[j] ]++;
+				}
+			for( size_t j=0 ; j<columns.size() ; j++ ) _c[local+j] = columns[j] , _v[local+j] = values[j];
+			_localSizes[i] = local;
+		}
+	}
+	for( int i=0 ; i<_rows ; i++ ) _remoteStart[i+1] = _remoteStart[i] + remoteCounts[i];
+	_remoteColumns.resize( _remoteStart[_rows] );
+	_remoteValues.resize( _remoteStart[_rows] );
+
+	// Store the transposes and sort them by column, so that the order does not depend on the scheduling
+	std::vector< size_t > position( _remoteStart.begin() , _remoteStart.end()-1 );
+#pragma omp parallel for num_threads( _threads )
+	for( int i=0 ; i<_rows ; i++ )
+		for( size_t j=_rowStart[i]+_localSizes[i] ; j<_rowStart[i+1] ; j++ )
+		{
+			size_t p;
+#pragma omp atomic capture
+			p = position[ _columns[j] ]++;
+			_remoteColumns[p] = i , _remoteValues[p] = _values[j];
+		}
+#pragma omp parallel for num_threads( _threads ) schedule( dynamic , 1024 )
+	for( int i=0 ; i<_rows ; i++ )
+		for( size_t j=_remoteStart[i]+1 ; j<_remoteStart[i+1] ; j++ )
+			for( size_t k=j ; k>_remoteStart[i] && _remoteColumns[k-1]>_remoteColumns[k] ; k-- )
+				std::swap( _remoteColumns[k-1] , _remoteColumns[k] ) , std::swap( _remoteValues[k-1] , _remoteValues[k] );
+}
+template< class T >
+template< class T2 >
+void CSRSymmetricMatrix< T >::set( const SparseSymmetricMatrix< T2 >& M , int threads )
+{
+	std::vector< int > rowSizes( M.rowSizes , M.rowSizes+M.rows );
+	resize( rowSizes , threads );
+#pragma omp parallel for num_threads( _threads )
+	for( int t=0 ; t<_threads ; t++ ) for( int i=_bounds[t] ; i<_bounds[t+1] ; i++ ) setRow( i , M[i] , M.rowSizes[i] );
+	finalize();
+}
+template< class T >
+size_t CSRSymmetricMatrix< T >::memoryUsage( void ) const
+{
+	return ( _memory ? size_t( (char*)_values - _memory ) + _capacity*sizeof( T ) : 0 ) +
+		( _rowStart.size() + _rangeStart.size() + _remoteStart.size() ) * sizeof( size_t ) + ( _localSizes.size() + _bounds.size() + _remoteColumns.size() ) * sizeof( int ) + _remoteValues.size() * sizeof( T );
+}
+template< class T >
+template< class T2 >
+void CSRSymmetricMatrix< T >::Multiply( const PoissonVector< T2 >& In , PoissonVector< T2 >& Out , bool addDCTerm ) const
+{
+	const T2* in = &In[0];
+	T2* out = &Out[0];
+	T2 dcTerm = T2( 0 );
+	if( addDCTerm )
+	{
+#pragma omp parallel for num_threads( _threads ) reduction( + : dcTerm )
+		for( int i=0 ; i<_rows ; i++ ) dcTerm += in[i];
+		dcTerm /= _rows;
+	}
+	const int* remoteColumns = _remoteColumns.data();
+	const T* remoteValues = _remoteValues.data();
+#pragma omp parallel for num_threads( _threads )
+	for( int t=0 ; t<_threads ; t++ )
+	{
+		for( int i=_bounds[t] ; i<_bounds[t+1] ; i++ ) out[i] = dcTerm;
+		for( int i=_bounds[t] ; i<_bounds[t+1] ; i++ )
+		{
+			const int* columns = _columns + _rowStart[i];
+			const T* values = _values + _rowStart[i];
+			const int size = int( _rowStart[i+1]-_rowStart[i] ) , localSize = _localSizes[i];
+			const T2 in_i = in[i];
+			T2 sum = T2( 0 );
+			// (i,j) and (j,i) for the entries in the range of this thread
+			for( int j=0 ; j<localSize ; j++ )
+			{
+				const T2 v = T2( values[j] );
+				sum += v * in[ columns[j] ];
+				out[ columns[j] ] += v * in_i;
+			}
+			// (i,j) for the other entries
+			SIMD_SUM_REDUCTION( sum )
+			for( int j=localSize ; j<size ; j++ ) sum += T2( values[j] ) * in[ columns[j] ];
+			// (j,i) for the entries of other ranges, stored with row i
+			const size_t remoteEnd = _remoteStart[i+1];
+			SIMD_SUM_REDUCTION( sum )
+			for( size_t j=_remoteStart[i] ; j<remoteEnd ; j++ ) sum += T2( remoteValues[j] ) * in[ remoteColumns[j] ];
+			out[i] += sum;
+		}
+	}
+}
+template< class T >
+template< class T2 >
+int CSRSymmetricMatrix< T >::Solve( const CSRSymmetricMatrix< T >& A , const PoissonVector< T2 >& b , int iters , PoissonVector< T2 >& x , T2 eps , int reset , bool addDCTerm )
+{
+#ifdef _OPENMP
+	int threads = A._threads;
+#endif
+	eps *= eps;
+	int dim = int( b.Dimensions() );
+	PoissonVector< T2 > r( dim ) , d( dim ) , q( dim );
+	if( reset ) x.Resize( dim );
+	T2 *_x = &x[0] , *_r = &r[0] , *_d = &d[0] , *_q = &q[0];
+	const T2* _b = &b[0];
+
+	double delta_new = 0 , delta_0;
+	A.Multiply( x , r , addDCTerm );
+#pragma omp parallel for num_threads( threads ) reduction( + : delta_new )
+	for( int i=0 ; i<dim ; i++ ) _d[i] = _r[i] = _b[i] - _r[i] , delta_new += _r[i] * _r[i];
+	delta_0 = delta_new;
+	if( delta_new<eps )
+	{
+		fprintf( stderr , "[WARNING] Initial residual too low: %g < %f\n" , delta_new , eps );
+		return 0;
+	}
+	int ii;
+	for( ii=0 ; ii<iters && delta_new>eps*delta_0 ; ii++ )
+	{
+		A.Multiply( d , q , addDCTerm );
+		double dDotQ = 0;
+#pragma omp parallel for num_threads( threads ) reduction( + : dDotQ )
+		for( int i=0 ; i<dim ; i++ ) dDotQ += _d[i] * _q[i];
+		T2 alpha = T2( delta_new / dDotQ );
+		double delta_old = delta_new;
+		delta_new = 0;
+		if( (ii%50)==(50-1) )
+		{
+			// Recompute the residual to avoid accumulating round-off errors
+#pragma omp parallel for num_threads( threads )
+			for( int i=0 ; i<dim ; i++ ) _x[i] += _d[i] * alpha;
+			A.Multiply( x , r , addDCTerm );
+#pragma omp parallel for num_threads( threads ) reduction( + : delta_new )
+			for( int i=0 ; i<dim ; i++ ) _r[i] = _b[i] - _r[i] , delta_new += _r[i] * _r[i];
+		}
+		else
+#pragma omp parallel for num_threads( threads ) reduction( + : delta_new )
+			for( int i=0 ; i<dim ; i++ ) _r[i] -= _q[i] * alpha , delta_new += _r[i] * _r[i] ,  _x[i] += _d[i] * alpha;
+
+		T2 beta = T2( delta_new / delta_old );
+#pragma omp parallel for num_threads( threads )
+		for( int i=0 ; i<dim ; i++ ) _d[i] = _r[i] + _d[i] * beta;
+	}
+	return ii;
+}
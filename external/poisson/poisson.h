@@ -11,13 +11,26 @@
 #endif
 
 
-template< int Degree , class Vertex , bool OutputDensity >
-int Execute(std::vector< Point3D<float> >& pts, std::vector< Point3D<float> >& normals,
-            CoredPoissonVectorMeshData< PlyVertex<float> >& mesh,
-            int octree_depth = 8, int solver_divide = 8, float point_weight = 4.0f,
-            float samples_per_node = 1.0f, float offset = 1.0f)
+// Build the octree of the points and solve for the indicator function, the
+// first part of Execute() below. pts and normals are arrays of n elements
+// of any type with operator[] for the coordinates (e.g. Point3D<float>),
+// they are read in place. threads is the number of OpenMP threads used for
+// setting up the tree and constraints, the solver, and the iso-surface
+// extraction; 0 uses omp_get_max_threads() (i.e., OMP_NUM_THREADS if set).
+// The tree is built from the Morton-sorted points (see Octree::setTree),
+// which gives the same result for any number of threads, including one.
+// The solver and the extraction follow the node pointers to find the
+// neighbors of the nodes; setting tree.linearOctree finds them in a Morton
+// index of the nodes instead (see LinearOctree), with the same results.
+// double_precision runs the conjugate gradient solver in double precision,
+// the system matrices are stored in float either way. Returns 0 on failure.
+template< int Degree , bool OutputDensity , class PointT >
+int PoissonSolve(Octree< Degree , OutputDensity >& tree,
+                 const PointT* pts, const PointT* normals, size_t n,
+                 int octree_depth = 8, int solver_divide = 8, float point_weight = 4.0f,
+                 float samples_per_node = 1.0f,
+                 int threads = 0, bool double_precision = false)
 {
-    float isoValue = 0;
     int MaxSolveDepth = octree_depth;
     int MinDepth = 5;
     int IsoDivide = 8;
@@ -30,41 +43,32 @@ int Execute(std::vector< Point3D<float> >& pts, std::vector< Point3D<float> >& n
     bool const clip_tree = true;
     bool ConfidenceSet = false;
     bool ShowResidual = false;
-    bool NonManifold = false;
-    bool PolygonMesh = false;
 
     XForm4x4< float > xForm = XForm4x4< float >::Identity();
 
-    Octree< Degree , OutputDensity > tree;
-
 #if _OPENMP
-    tree.threads = omp_get_num_procs();
+    tree.threads = threads > 0 ? threads : omp_get_max_threads();
 #else
+    (void)threads;
     tree.threads = 1;
 #endif
+    tree.doublePrecisionSolver = double_precision;
 
     if( solver_divide < MinDepth )
     {
         solver_divide = MinDepth;
     }
 
-    if( IsoDivide < MinDepth )
-    {
-        IsoDivide = MinDepth;
-    }
-
-    OctNode< TreeNodeData< OutputDensity > , float >::SetAllocator( MEMORY_ALLOCATOR_BLOCK_SIZE );
-
     int kernelDepth = octree_depth - 2;
 
     tree.setBSplineData( octree_depth , BoundaryType );
     if( kernelDepth > octree_depth )
     {
         fprintf( stderr,"[ERROR] kernelDepth can't be greater than octree_depth\n" );
-        return EXIT_FAILURE;
+        return 0;
     }
 
-    tree.setTree( pts, normals, octree_depth , MinDepth , kernelDepth , Real(samples_per_node) , Scale , ConfidenceSet , point_weight , AdaptiveExponent , xForm );
+    tree.setTree( pts, normals, n, octree_depth , MinDepth , kernelDepth , Real(samples_per_node) , Scale , ConfidenceSet , point_weight , AdaptiveExponent , xForm );
 
     if(clip_tree)
     {
@@ -76,18 +80,73 @@ int Execute(std::vector< Point3D<float> >& pts, std::vector< Point3D<float> >& n
 
     tree.LaplacianMatrixIteration( solver_divide, ShowResidual , MinIters , SolverAccuracy , MaxSolveDepth , FixedIters );
 
-    isoValue = tree.GetIsoValue();
+    return 1;
+}
+
+
+// Extract the iso-surface at isoValue (e.g., tree.GetIsoValue()) of a tree
+// solved by PoissonSolve() or read by Octree::read(), the second part of
+// Execute(). The iso-surface is streamed into mesh as it is extracted, which
+// can be any CoredMeshData (in memory, temporary files, or a custom sink).
+// The extraction can be repeated with other iso-values and options, the
+// nodes it adds along the boundaries of the iso_divide subtrees are removed
+// again (see Octree::ExtractMCIsoTriangles). manifold adds a barycenter to
+// polygons that would make the mesh non-manifold, polygon_mesh outputs
+// polygons instead of triangles.
+template< int Degree , bool OutputDensity >
+void PoissonExtract(Octree< Degree , OutputDensity >& tree, Real isoValue,
+                    CoredMeshData< PlyVertex<float> >& mesh,
+                    int iso_divide = 8, bool manifold = true, bool polygon_mesh = false)
+{
+    int MinDepth = 5;
+
+    if( iso_divide < MinDepth )
+    {
+        iso_divide = MinDepth;
+    }
+
+    tree.ExtractMCIsoTriangles( isoValue , iso_divide , &mesh , manifold , polygon_mesh );
+}
+
+
+// Poisson reconstruction of the points, see PoissonSolve() and
+// PoissonExtract(). The iso-value is the average of the indicator function
+// at the points, scaled by offset.
+template< int Degree , class Vertex , bool OutputDensity , class PointT >
+int Execute(const PointT* pts, const PointT* normals, size_t n,
+            CoredMeshData< PlyVertex<float> >& mesh,
+            int octree_depth = 8, int solver_divide = 8, float point_weight = 4.0f,
+            float samples_per_node = 1.0f, float offset = 1.0f,
+            int threads = 0, bool double_precision = false)
+{
+    Octree< Degree , OutputDensity > tree;
+
+    if( !PoissonSolve( tree, pts, normals, n, octree_depth, solver_divide, point_weight, samples_per_node, threads, double_precision ) )
+    {
+        return EXIT_FAILURE;
+    }
+
+    float isoValue = tree.GetIsoValue();
     isoValue *= offset; //?? im ursprungscode nicht drin
 
-    tree.GetMCIsoTriangles( isoValue , IsoDivide , &mesh , 0 , 1 , !NonManifold , PolygonMesh );
+    PoissonExtract( tree, isoValue, mesh );
 
     return 1;
 }
 
 
-int Execute2(std::vector< Point3D<float> >& pts, std::vector< Point3D<float> >& normals, CoredPoissonVectorMeshData< PlyVertex<float> >& mesh,
-             int octree = 8, int solver = 8, float point_weight = 4.0f, float samples = 1.0f, float offset = 1.0f)
+template< class PointT >
+int Execute2(const PointT* pts, const PointT* normals, size_t n, CoredMeshData< PlyVertex<float> >& mesh,
+             int octree = 8, int solver = 8, float point_weight = 4.0f, float samples = 1.0f, float offset = 1.0f,
+             int threads = 0, bool double_precision = false)
+{
+    return Execute< 2, PlyVertex<Real> , false >(pts, normals, n, mesh, octree, solver, point_weight, samples, offset, threads, double_precision);
+}
+
+inline int Execute2(std::vector< Point3D<float> >& pts, std::vector< Point3D<float> >& normals, CoredMeshData< PlyVertex<float> >& mesh,
+             int octree = 8, int solver = 8, float point_weight = 4.0f, float samples = 1.0f, float offset = 1.0f,
+             int threads = 0, bool double_precision = false)
 {
-    return Execute< 2, PlyVertex<Real> , false >(pts, normals, mesh, octree, solver, point_weight, samples, offset);
+    return Execute2(pts.data(), normals.data(), pts.size(), mesh, octree, solver, point_weight, samples, offset, threads, double_precision);
 }
 
@@ -0,0 +1,258 @@
+//=============================================================================
+//
+//   Exercise code for the lecture "Geometric Modeling"
+//   by Prof. Dr. Mario Botsch, TU Dortmund
+//
+//   Copyright (C) 2023 Computer Graphics Group, TU Dortmund.
+//
+//=============================================================================
+
+#include "AsciiParser.h"
+#include <pmp/MappedFile.h>
+#include <pmp/Timer.h>
+
+#include <algorithm>
+#include <charconv>
+#include <cstring>
+#include <limits>
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+
+//== IMPLEMENTATION ==========================================================
+
+
+namespace {
+
+/// result of parsing a part of a file
+struct Chunk
+{
+    std::vector<float>  values;
+    bool                complete = true; // no invalid token found
+};
+
+
+inline bool is_space(char c)
+{
+    return c == ' ' || c == '\t' || c == '\r' || c == '\v' || c == '\f';
+}
+
+
+/// parse a float starting at \c p, returns end of number or nullptr
+inline const char* parse_float(const char* p, const char* end, float& f)
+{
+    // leading '+' is accepted by scanf, but not by from_chars
+    if (p != end && *p == '+')
+    {
+        ++p;
+        if (p != end && *p == '-') return nullptr;
+    }
+
+    auto r = std::from_chars(p, end, f);
+    if (r.ec == std::errc())
+        return r.ptr;
+    if (r.ec != std::errc::result_out_of_range)
+        return nullptr;
+
+    // out of float range: round through double like scanf does, or
+    // saturate to inf/0 if even that overflows/underflows
+    double d;
+    auto rd = std::from_chars(p, end, d);
+    if (rd.ec == std::errc())
+    {
+        f = float(d);
+        return rd.ptr;
+    }
+    const char* e = std::find_if(p, r.ptr,
+                                 [](char c) { return c == 'e' || c == 'E'; });
+    const bool tiny = (e+1 < r.ptr && e[1] == '-');
+    f = tiny ? 0.0f : std::numeric_limits<float>::infinity();
+    if (*p == '-') f = -f;
+    return r.ptr;
+}
+
+
+/// parse lines of [_begin,_end), see read_float_columns()
+void parse_columns(const char* _begin, const char* _end,
+                   unsigned int _n_columns, std::vector<float>& _values)
+{
+    std::vector<float> line(_n_columns);
+
+    const char* p = _begin;
+    while (p < _end)
+    {
+        const char* eol = (const char*)std::memchr(p, '\n', _end - p);
+        if (!eol) eol = _end;
+
+        unsigned int k = 0;
+        while (k < _n_columns)
+        {
+            while (p < eol && is_space(*p)) ++p;
+            if (p == eol) break;
+            p = parse_float(p, eol, line[k]);
+            if (!p) break;
+            ++k;
+        }
+
+        if (k == _n_columns)
+            _values.insert(_values.end(), line.begin(), line.end());
+
+        p = eol + 1;
+    }
+}
+
+
+/// parse floats of [_begin,_end) until the first invalid token, returns
+/// false if such a token has been found
+bool parse_stream(const char* _begin, const char* _end,
+                  std::vector<float>& _values)
+{
+    const char* p = _begin;
+    float f;
+    while (true)
+    {
+        while (p < _end && (is_space(*p) || *p == '\n')) ++p;
+        if (p == _end) return true;
+        p = parse_float(p, _end, f);
+        if (!p) return false;
+        _values.push_back(f);
+    }
+}
+
+
+/// concatenate the values of the first \c _n_chunks chunks
+void concatenate(const std::vector<Chunk>& _chunks, size_t _n_chunks,
+                 std::vector<float>& _values)
+{
+    std::vector<size_t> offsets(_n_chunks+1, 0);
+    for (size_t i=0; i<_n_chunks; ++i)
+        offsets[i+1] = offsets[i] + _chunks[i].values.size();
+
+    _values.resize(offsets[_n_chunks]);
+
+#pragma omp parallel for schedule(dynamic)
+    for (int i=0; i<int(_n_chunks); ++i)
+        std::copy(_chunks[i].values.begin(), _chunks[i].values.end(),
+                  _values.begin() + offsets[i]);
+}
+
+
+/// map file, skip lines, split into chunks at line breaks and parse them in
+/// parallel by calling _parse(chunk, begin, end) for each chunk
+template <class Parse>
+bool parse_file(const char* _filename, unsigned int _skip_lines,
+                std::vector<Chunk>& _chunks,
+                ParseStatistics* _stats, const Parse& _parse)
+{
+    pmp::Timer timer;
+    timer.start();
+
+    pmp::MappedFile file;
+    if (!file.open(_filename))
+        return false;
+
+    const char* begin = file.data();
+    const char* end   = begin + file.size();
+
+    for (unsigned int i=0; i<_skip_lines && begin<end; ++i)
+    {
+        const char* eol = (const char*)std::memchr(begin, '\n', end - begin);
+        begin = eol ? eol+1 : end;
+    }
+
+    // chunks of at least 1MB, a few per thread for load balancing
+    size_t n_chunks = 1;
+#ifdef _OPENMP
+    n_chunks = 4 * omp_get_max_threads();
+#endif
+    n_chunks = std::max<size_t>(1, std::min<size_t>(n_chunks, (end-begin) >> 20));
+
+    std::vector<const char*> bounds(n_chunks+1, end);
+    bounds[0] = begin;
+    for (size_t i=1; i<n_chunks; ++i)
+    {
+        const char* p = std::max(bounds[i-1], begin + (end-begin)*i/n_chunks);
+        const char* eol = (const char*)std::memchr(p, '\n', end - p);
+        bounds[i] = eol ? eol+1 : end;
+    }
+
+    _chunks.clear();
+    _chunks.resize(n_chunks);
+
+#pragma omp parallel for schedule(dynamic)
+    for (int i=0; i<int(n_chunks); ++i)
+        _parse(_chunks[i], bounds[i], bounds[i+1]);
+
+    timer.stop();
+    if (_stats)
+    {
+        _stats->bytes = file.size();
+        _stats->milliseconds = timer.elapsed();
+    }
+
+    return true;
+}
+
+}
+
+
+//-----------------------------------------------------------------------------
+
+
+bool read_float_columns(const char* _filename,
+                        unsigned int _n_columns,
+                        unsigned int _skip_lines,
+                        std::vector<float>& _values,
+                        ParseStatistics* _stats)
+{
+    std::vector<Chunk> chunks;
+
+    bool ok = parse_file(_filename, _skip_lines, chunks, _stats,
+        [&](Chunk& chunk, const char* begin, const char* end) {
+            parse_columns(begin, end, _n_columns, chunk.values);
+        });
+    if (!ok) return false;
+
+    pmp::Timer timer;
+    timer.start();
+    concatenate(chunks, chunks.size(), _values);
+    timer.stop();
+    if (_stats) _stats->milliseconds += timer.elapsed();
+
+    return true;
+}
+
+
+//-----------------------------------------------------------------------------
+
+
+bool read_float_stream(const char* _filename,
+                       unsigned int _skip_lines,
+                       std::vector<float>& _values,
+                       ParseStatistics* _stats)
+{
+    std::vector<Chunk> chunks;
+
+    bool ok = parse_file(_filename, _skip_lines, chunks, _stats,
+        [&](Chunk& chunk, const char* begin, const char* end) {
+            chunk.complete = parse_stream(begin, end, chunk.values);
+        });
+    if (!ok) return false;
+
+    // the stream ends at the first invalid token, i.e., in the first chunk
+    // that has not been parsed completely
+    size_t n_chunks = 0;
+    while (n_chunks < chunks.size() && chunks[n_chunks++].complete) {}
+
+    pmp::Timer timer;
+    timer.start();
+    concatenate(chunks, n_chunks, _values);
+    timer.stop();
+    if (_stats) _stats->milliseconds += timer.elapsed();
+
+    return true;
+}
+
+
+//=============================================================================
@@ -0,0 +1,55 @@
+//=============================================================================
+//
+//   Exercise code for the lecture "Geometric Modeling"
+//   by Prof. Dr. Mario Botsch, TU Dortmund
+//
+//   Copyright (C) 2023 Computer Graphics Group, TU Dortmund.
+//
+//=============================================================================
+
+#pragma once
+
+#include <vector>
+#include <cstddef>
+
+//=============================================================================
+
+/// Size and timing of parsing an ASCII file
+struct ParseStatistics
+{
+    size_t  bytes = 0;
+    double  milliseconds = 0;
+
+    /// throughput in MB/s
+    double mb_per_second() const
+    {
+        return milliseconds > 0 ? bytes / 1024.0 / 1024.0 / (milliseconds / 1000.0) : 0;
+    }
+};
+
+
+/** Parse a text file of whitespace-separated float columns, like
+    sscanf(line, "%f %f ...") does for every line: for each line that starts
+    with at least \c _n_columns numbers, these are appended to \c _values
+    (in file order), all other lines are skipped. The first \c _skip_lines
+    lines are ignored. The file is memory-mapped, split into chunks at line
+    breaks, and chunks are parsed in parallel with a locale-independent
+    parser. Returns false if the file cannot be opened. */
+bool read_float_columns(const char* _filename,
+                        unsigned int _n_columns,
+                        unsigned int _skip_lines,
+                        std::vector<float>& _values,
+                        ParseStatistics* _stats = nullptr);
+
+
+/** Parse a text file as one stream of whitespace-separated floats (line
+    breaks have no meaning), like reading with std::ifstream >>. Parsing
+    stops at the first token that is not a number. The first \c _skip_lines
+    lines are ignored. Returns false if the file cannot be opened. */
+bool read_float_stream(const char* _filename,
+                       unsigned int _skip_lines,
+                       std::vector<float>& _values,
+                       ParseStatistics* _stats = nullptr);
+
+
+//=============================================================================
@@ -0,0 +1,241 @@
+//=============================================================================
+//
+//   Exercise code for the lecture "Geometric Modeling"
+//   by Prof. Dr. Mario Botsch, TU Dortmund
+//
+//   Copyright (C) 2023 Computer Graphics Group, TU Dortmund.
+//
+//=============================================================================
+
+#include "MappedPointSet.h"
+
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+
+using namespace pmp;
+
+
+//== IMPLEMENTATION ==========================================================
+
+
+namespace {
+
+/// header of the aligned .pts layout
+struct PtsHeader
+{
+    char           magic[4];  // "PTS2"
+    std::uint32_t  flags;     // bit 0: has colors
+    std::uint64_t  n_points;
+};
+
+static_assert(sizeof(PtsHeader) == 16, "unexpected .pts header size");
+static_assert(sizeof(Point) == 3*sizeof(float), "unexpected point size");
+
+const char pts_magic[4] = {'P', 'T', 'S', '2'};
+
+
+/// position and size of the arrays of a .pts file
+struct PtsLayout
+{
+    size_t  offset;      // begin of the point array
+    size_t  n_points;
+    bool    has_colors;
+    bool    aligned;     // aligned or legacy layout
+};
+
+
+/// Find the layout of a .pts file of \c _size bytes from its first bytes
+/// \c _data (at least 16 or the whole file). Trailing bytes after the
+/// arrays are ignored. Returns false if the file is invalid.
+bool pts_layout(const char* _data, size_t _size, PtsLayout& _layout)
+{
+    const size_t vec_size = sizeof(Point);
+
+    // aligned layout
+    PtsHeader header;
+    if (_size >= sizeof(header))
+    {
+        std::memcpy(&header, _data, sizeof(header));
+        const size_t k = (header.flags & 1) ? 3 : 2;
+        if (!std::memcmp(header.magic, pts_magic, 4) &&
+            header.n_points <= (_size - sizeof(header)) / (k*vec_size))
+        {
+            _layout.offset     = sizeof(header);
+            _layout.n_points   = header.n_points;
+            _layout.has_colors = header.flags & 1;
+            _layout.aligned    = true;
+            return true;
+        }
+    }
+
+    // legacy layout: uint32 number of points, one byte has-colors flag
+    std::uint32_t n;
+    if (_size >= sizeof(n) + 1)
+    {
+        std::memcpy(&n, _data, sizeof(n));
+        const bool has_colors = _data[sizeof(n)];
+        if (size_t(n)*vec_size*(has_colors ? 3 : 2) <= _size - sizeof(n) - 1)
+        {
+            _layout.offset     = sizeof(n) + 1;
+            _layout.n_points   = n;
+            _layout.has_colors = has_colors;
+            _layout.aligned    = false;
+            return true;
+        }
+    }
+
+    return false;
+}
+
+}
+
+
+//-----------------------------------------------------------------------------
+
+
+MappedPointSet::MappedPointSet()
+{
+}
+
+
+//-----------------------------------------------------------------------------
+
+
+MappedPointSet::~MappedPointSet()
+{
+    close();
+}
+
+
+//-----------------------------------------------------------------------------
+
+
+bool MappedPointSet::open(const char* _filename)
+{
+    close();
+
+    if (!file_.open(_filename))
+        return false;
+
+    const char* data = file_.data();
+    PtsLayout layout;
+    if (!pts_layout(data, file_.size(), layout))
+    {
+        close();
+        return false;
+    }
+
+    const size_t n = layout.n_points;
+    const char*  p = data + layout.offset;
+
+    // aligned layout: spans point into the mapped file
+    if (layout.aligned)
+    {
+        view_.points  = Span<Point>((const Point*)p, n);
+        view_.normals = Span<Normal>((const Normal*)(p + n*sizeof(Point)), n);
+        if (layout.has_colors)
+            view_.colors = Span<Color>((const Color*)(p + 2*n*sizeof(Point)), n);
+        return true;
+    }
+
+    // legacy layout: unaligned arrays, copy them
+    points_.resize(n);
+    normals_.resize(n);
+    std::memcpy((void*)points_.data(), p, n*sizeof(Point));
+    std::memcpy((void*)normals_.data(), p + n*sizeof(Point), n*sizeof(Point));
+    if (layout.has_colors)
+    {
+        colors_.resize(n);
+        std::memcpy((void*)colors_.data(), p + 2*n*sizeof(Point), n*sizeof(Point));
+    }
+    file_.close();
+
+    view_.points  = Span<Point>(points_);
+    view_.normals = Span<Normal>(normals_);
+    view_.colors  = Span<Color>(colors_);
+    return true;
+}
+
+
+//-----------------------------------------------------------------------------
+
+
+void MappedPointSet::close()
+{
+    file_.close();
+    std::vector<Point>().swap(points_);
+    std::vector<Normal>().swap(normals_);
+    std::vector<Color>().swap(colors_);
+    view_ = PointCloudView();
+}
+
+
+//-----------------------------------------------------------------------------
+
+
+bool read_pts(const char* _filename, std::vector<Point>& _points,
+              std::vector<Normal>& _normals, std::vector<Color>& _colors)
+{
+    FILE* in = fopen(_filename, "rb");
+    if (!in) return false;
+
+    // the first bytes and the file size determine the layout
+    char header[sizeof(PtsHeader)];
+    const size_t n_header = fread(header, 1, sizeof(header), in);
+    fseek(in, 0, SEEK_END);
+    const long size = ftell(in);
+    PtsLayout layout;
+    if (size < long(n_header) || !pts_layout(header, size, layout))
+    {
+        fclose(in);
+        return false;
+    }
+
+    // read the arrays directly into their final place
+    const size_t n = layout.n_points;
+    _points.resize(n);
+    _normals.resize(n);
+    _colors.clear();
+    fseek(in, long(layout.offset), SEEK_SET);
+    bool ok = fread(_points.data(), sizeof(Point), n, in) == n;
+    ok = ok && fread(_normals.data(), sizeof(Normal), n, in) == n;
+    if (layout.has_colors)
+    {
+        _colors.resize(n);
+        ok = ok && fread(_colors.data(), sizeof(Color), n, in) == n;
+    }
+
+    fclose(in);
+    return ok;
+}
+
+
+//-----------------------------------------------------------------------------
+
+
+bool write_pts(const char* _filename, const PointCloudView& _point_cloud)
+{
+    FILE* out = fopen(_filename, "wb");
+    if (!out) return false;
+
+    const size_t n = _point_cloud.size();
+    const bool has_colors = !_point_cloud.colors.empty();
+
+    PtsHeader header;
+    std::memcpy(header.magic, pts_magic, 4);
+    header.flags    = has_colors ? 1 : 0;
+    header.n_points = n;
+
+    bool ok = fwrite(&header, sizeof(header), 1, out) == 1;
+    ok = ok && fwrite(_point_cloud.points.data(), sizeof(Point), n, out) == n;
+    ok = ok && fwrite(_point_cloud.normals.data(), sizeof(Normal), n, out) == n;
+    if (has_colors)
+        ok = ok && fwrite(_point_cloud.colors.data(), sizeof(Color), n, out) == n;
+
+    fclose(out);
+    return ok;
+}
+
+
+//=============================================================================
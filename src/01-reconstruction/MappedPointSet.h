@@ -0,0 +1,89 @@
+//=============================================================================
+//
+//   Exercise code for the lecture "Geometric Modeling"
+//   by Prof. Dr. Mario Botsch, TU Dortmund
+//
+//   Copyright (C) 2023 Computer Graphics Group, TU Dortmund.
+//
+//=============================================================================
+
+#pragma once
+
+#include "PointCloudView.h"
+#include <pmp/MappedFile.h>
+#include <vector>
+
+//=============================================================================
+
+/** A binary .pts point cloud mapped into memory. Points, normals and colors
+    are exposed as read-only spans, which can be passed directly to
+    reconstruct_hoppe() and reconstruct_poisson().
+
+    Two file layouts are supported:
+    - aligned (written by write_pts()): 16 byte header (magic "PTS2",
+      uint32 flags with bit 0 = has colors, uint64 number of points),
+      followed by the point, normal, and color arrays. The spans point
+      directly into the mapped file, nothing is copied.
+    - legacy: uint32 number of points, one byte has-colors flag, followed
+      by the arrays. Since these are not 4-byte aligned, they are copied
+      once into aligned arrays and the file is unmapped.
+
+    Bytes after the arrays are ignored.
+*/
+class MappedPointSet
+{
+public:
+
+    /// constructor
+    MappedPointSet();
+
+    /// destructor, unmaps the file
+    ~MappedPointSet();
+
+    MappedPointSet(const MappedPointSet&) = delete;
+    MappedPointSet& operator=(const MappedPointSet&) = delete;
+
+    /// map a .pts file. returns false if it cannot be opened or is invalid.
+    bool open(const char* _filename);
+
+    /// unmap the file and release all data
+    void close();
+
+    /// points, normals, and colors (empty if the file has no colors)
+    const PointCloudView& view() const { return view_; }
+
+    /// do the spans point into the mapped file (true) or to copies (false)?
+    bool is_zero_copy() const { return file_.is_open(); }
+
+private:
+
+    pmp::MappedFile  file_;
+
+    // copies of the arrays of legacy files
+    std::vector<pmp::Point>   points_;
+    std::vector<pmp::Normal>  normals_;
+    std::vector<pmp::Color>   colors_;
+
+    PointCloudView  view_;
+};
+
+
+//=============================================================================
+
+
+/// Read a binary .pts file (either layout) directly into arrays, without
+/// mapping it. Colors are empty if the file has none.
+bool read_pts(const char* _filename, std::vector<pmp::Point>& _points,
+              std::vector<pmp::Normal>& _normals,
+              std::vector<pmp::Color>& _colors);
+
+
+//=============================================================================
+
+
+/// Write a point cloud to a binary .pts file in the aligned layout, which
+/// MappedPointSet maps without copying. Colors are written if not empty.
+bool write_pts(const char* _filename, const PointCloudView& _point_cloud);
+
+
+//=============================================================================
@@ -10,26 +10,94 @@
 //== INCLUDES =================================================================
 
 #include "MarchingCubes.h"
+#include <algorithm>
+#include <map>
+#ifdef _OPENMP
+#include <omp.h>
+#endif
 using namespace pmp;
 
 
 //== IMPLEMENTATION ==========================================================
 
+
+/* The grid is split into slabs of cube layers orthogonal to the x-axis
+   (the slowest varying index of Grid), which are processed in parallel.
+   Within a slab, vertices on cube edges are shared through two cached
+   slices of edge indices (the planes x and x+1) plus one array for the
+   x-edges in between. Vertices on the first plane of a slab are created by
+   the previous slab; they are stored as references into that slab's last
+   plane and resolved when stitching. Since slabs are stitched in order,
+   vertices and faces are enumerated exactly as in a serial traversal,
+   independent of the number of slabs or threads.
+
+   For a SparseGrid, only the active cells are visited. An edge on the
+   first plane of a slab then might not have been created by the previous
+   slab, in which case the vertex is added to the slab when stitching.
+   Sparse grids therefore use a fixed, brick-aligned slab partition.
+*/
+template <class GridT>
 class Marching_cubes
 {
 public:
 
-    Marching_cubes(const Grid& _grid, SurfaceMesh& _mesh, Scalar _isoval=0);
+    Marching_cubes(const GridT& _grid, SurfaceMesh& _mesh, Scalar _isoval=0);
 
 private:
 
-    void process_cube(unsigned int x, unsigned int y, unsigned int z);
-    Vertex add_vertex(const ivec3& p0, const ivec3& p1);
+    /// Vertices and triangles of a range of cube layers
+    struct Slab
+    {
+        unsigned int       x_begin, x_end;
+        std::vector<vec3>  points;
+
+        // three vertices per triangle: local vertex index, or (-2-slot)
+        // for a vertex stored in slot of the previous slab's last plane
+        std::vector<int>   triangles;
+
+        // (slot, local vertex index) of the vertices in plane x_end
+        std::vector<std::pair<unsigned int, int> >  last_plane;
+    };
+
+    /// Edge index caches of the current cube layer x. An entry is valid if
+    /// it has been created in layer x-1 or x (plane x), or in layer x
+    /// (plane x+1, x-edges), which is checked by comparing against the
+    /// number of slab vertices at the start of these layers. This avoids
+    /// clearing the caches for every layer.
+    struct Layer
+    {
+        std::vector<int>  lo;        // y- and z-edges in plane x
+        std::vector<int>  hi;        // y- and z-edges in plane x+1
+        std::vector<int>  xe;        // x-edges between both planes
+        int               lo_begin;  // first vertex of layer x-1
+        int               hi_begin;  // first vertex of layer x
+        bool              foreign;   // plane x belongs to previous slab
+    };
+
+    /// slot of the y- (\c _dir=0) or z-edge (\c _dir=1) at (y,z) in a plane
+    unsigned int plane_slot(unsigned int y, unsigned int z, int _dir) const
+    {
+        return 2*(y*grid_.z_resolution() + z) + _dir;
+    }
+
+    void process_slab(Slab& _slab) const;
+
+    void resolve_first_plane(Slab& _slab, const Slab& _previous) const;
 
-    const Grid&     grid_;
-    SurfaceMesh&   mesh_;
+    void process_cube(unsigned int x, unsigned int y, unsigned int z,
+                      Layer& _layer, Slab& _slab) const;
+
+    int add_vertex(int& _cached, int _begin, const ivec3& p0, const ivec3& p1,
+                   Slab& _slab) const;
+
+    int add_lo_vertex(Layer& _layer, unsigned int _slot, const ivec3& p0,
+                      const ivec3& p1, Slab& _slab) const;
+
+    vec3 edge_point(const ivec3& p0, const ivec3& p1) const;
+
+    const GridT&    grid_;
+    SurfaceMesh&    mesh_;
     Scalar          isoval_;
-    std::map<unsigned long int, Vertex> edge2vertex_;
 
     static int edgeTable[256];
     static int triTable[256][17];
@@ -39,42 +107,221 @@ private:
 //-----------------------------------------------------------------------------
 
 
-Marching_cubes::
-Marching_cubes(const Grid& _grid, SurfaceMesh& _mesh, Scalar isoval)
+namespace {
+
+/// visit all cells of cube layer x of a dense grid
+template <class F>
+void for_each_cell(const Grid& _grid, unsigned int, const F& _f)
+{
+    for (unsigned int y=0; y<_grid.y_resolution()-1; ++y)
+        for (unsigned int z=0; z<_grid.z_resolution()-1; ++z)
+            _f(y, z);
+}
+
+/// visit the active cells of cube layer x of a sparse grid
+template <class F>
+void for_each_cell(const SparseGrid& _grid, unsigned int x, const F& _f)
+{
+    _grid.for_each_active_cell(x, _f);
+}
+
+/// number of slabs for a dense grid: a few per thread balance the load
+unsigned int n_slabs(const Grid&, unsigned int _n_layers)
+{
+    unsigned int n = 1;
+#ifdef _OPENMP
+    n = 4 * omp_get_max_threads();
+#endif
+    return std::min(n, _n_layers);
+}
+
+/// number of slabs for a sparse grid: one per brick layer
+unsigned int n_slabs(const SparseGrid&, unsigned int _n_layers)
+{
+    return (_n_layers + SparseGrid::brick_size-1) / SparseGrid::brick_size;
+}
+
+/// first cube layer of slab s for a dense grid: equally sized slabs
+unsigned int slab_begin(const Grid&, unsigned int _s, unsigned int _n_slabs,
+                        unsigned int _n_layers)
+{
+    return _s * _n_layers / _n_slabs;
+}
+
+/// first cube layer of slab s for a sparse grid: aligned to brick layers
+unsigned int slab_begin(const SparseGrid&, unsigned int _s, unsigned int,
+                        unsigned int _n_layers)
+{
+    return std::min(_s * SparseGrid::brick_size, _n_layers);
+}
+
+}
+
+
+//-----------------------------------------------------------------------------
+
+
+template <class GridT>
+Marching_cubes<GridT>::
+Marching_cubes(const GridT& _grid, SurfaceMesh& _mesh, Scalar isoval)
 : grid_(_grid), mesh_(_mesh), isoval_(isoval)
 {
     // clear mesh first
     _mesh.clear();
 
-    // check whether resolution is small enough for edge2vertex-mapping
-    unsigned long int i = std::numeric_limits<unsigned long int>::max();
-    i /= grid_.x_resolution();
-    i /= grid_.y_resolution();
-    i /= grid_.z_resolution();
-    i >>= 2;
-    if (!i)
-    {
-        std::cerr << "Marching_cubes: grid resolution to high!\n";
+    const unsigned int n_layers = grid_.x_resolution()-1;
+    if (n_layers == 0 || grid_.y_resolution() < 2 || grid_.z_resolution() < 2)
         return;
+
+
+    // split cube layers into slabs
+    const unsigned int ns = n_slabs(grid_, n_layers);
+    std::vector<Slab> slabs(ns);
+    for (unsigned int s=0; s<ns; ++s)
+    {
+        slabs[s].x_begin = slab_begin(grid_, s,   ns, n_layers);
+        slabs[s].x_end   = slab_begin(grid_, s+1, ns, n_layers);
     }
 
-    // process all cubes
-    for (unsigned int x=0; x<grid_.x_resolution()-1; ++x)
-        for (unsigned int y=0; y<grid_.y_resolution()-1; ++y)
-            for (unsigned int z=0; z<grid_.z_resolution()-1; ++z)
-                process_cube(x,y,z);
+
+    // extract vertices and triangles of all slabs
+#pragma omp parallel for schedule(dynamic)
+    for (int s=0; s<int(ns); ++s)
+        process_slab(slabs[s]);
+
+
+    // stitch slabs: map references to the previous slab's vertices
+#pragma omp parallel for schedule(dynamic)
+    for (int s=1; s<int(ns); ++s)
+        resolve_first_plane(slabs[s], slabs[s-1]);
+
+    std::vector<int> offsets(ns+1, 0);
+    std::vector<size_t> t_offsets(ns+1, 0);
+    for (unsigned int s=0; s<ns; ++s)
+    {
+        offsets[s+1]   = offsets[s] + slabs[s].points.size();
+        t_offsets[s+1] = t_offsets[s] + slabs[s].triangles.size();
+    }
+
+
+    // concatenate the slabs in slab order, free memory early
+    std::vector<Point>     points(offsets[ns]);
+    std::vector<IndexType> indices(t_offsets[ns]);
+
+#pragma omp parallel for schedule(dynamic)
+    for (int s=0; s<int(ns); ++s)
+    {
+        Slab& slab = slabs[s];
+        std::copy(slab.points.begin(), slab.points.end(),
+                  points.begin() + offsets[s]);
+
+        const std::vector<int>& t = slab.triangles;
+        for (size_t i=0; i<t.size(); ++i)
+            indices[t_offsets[s] + i] =
+                (t[i] >= 0) ? offsets[s] + t[i] : offsets[s-1] + (-2-t[i]);
+
+        std::vector<vec3>().swap(slab.points);
+        std::vector<int>().swap(slab.triangles);
+    }
+
+
+    // build the mesh from the triangle soup
+    _mesh.build(std::move(points), indices);
+}
+
+
+//-----------------------------------------------------------------------------
+
+
+template <class GridT>
+void
+Marching_cubes<GridT>::
+process_slab(Slab& _slab) const
+{
+    const unsigned int n_slots = grid_.y_resolution()*grid_.z_resolution();
+
+    Layer layer;
+    layer.lo.resize(2*n_slots, -1);
+    layer.hi.resize(2*n_slots, -1);
+    layer.xe.resize(n_slots,   -1);
+    layer.lo_begin = 0;
+    layer.hi_begin = 0;
+
+    // vertices on the first plane belong to the previous slab
+    layer.foreign = (_slab.x_begin > 0);
+
+    for (unsigned int x=_slab.x_begin; x<_slab.x_end; ++x)
+    {
+        for_each_cell(grid_, x, [&](unsigned int y, unsigned int z) {
+            process_cube(x, y, z, layer, _slab);
+        });
+
+        // advance to next layer
+        layer.lo.swap(layer.hi);
+        layer.lo_begin = layer.hi_begin;
+        layer.hi_begin = _slab.points.size();
+        layer.foreign  = false;
+    }
+
+    // export vertices of last plane
+    for (unsigned int i=0; i<layer.lo.size(); ++i)
+        if (layer.lo[i] >= layer.lo_begin)
+            _slab.last_plane.emplace_back(i, layer.lo[i]);
 }
 
 
 //-----------------------------------------------------------------------------
 
 
+template <class GridT>
 void
-Marching_cubes::
-process_cube(unsigned int x, unsigned int y, unsigned int z)
+Marching_cubes<GridT>::
+resolve_first_plane(Slab& _slab, const Slab& _previous) const
+{
+    std::map<unsigned int, int> created;
+
+    for (int& idx : _slab.triangles)
+    {
+        if (idx >= 0) continue;
+
+        // vertex of the previous slab
+        const unsigned int slot = -2-idx;
+        auto it = std::lower_bound(_previous.last_plane.begin(),
+                                   _previous.last_plane.end(),
+                                   std::make_pair(slot, -1));
+        if (it != _previous.last_plane.end() && it->first == slot)
+        {
+            idx = -2-it->second;
+            continue;
+        }
+
+        // otherwise (sparse grids only) create it here
+        auto c = created.find(slot);
+        if (c == created.end())
+        {
+            const unsigned int yz = slot/2;
+            const ivec3 p0(_slab.x_begin, yz / grid_.z_resolution(),
+                           yz % grid_.z_resolution());
+            const ivec3 p1 = (slot & 1) ? p0 + ivec3(0,0,1) : p0 + ivec3(0,1,0);
+            c = created.emplace(slot, int(_slab.points.size())).first;
+            _slab.points.push_back(edge_point(p0, p1));
+        }
+        idx = c->second;
+    }
+}
+
+
+//-----------------------------------------------------------------------------
+
+
+template <class GridT>
+void
+Marching_cubes<GridT>::
+process_cube(unsigned int x, unsigned int y, unsigned int z,
+             Layer& _layer, Slab& _slab) const
 {
     ivec3               corner[8];
-    Vertex samples[12];
+    int                  samples[12];
     unsigned char        cubetype(0);
     unsigned int         i;
 
@@ -102,67 +349,91 @@ process_cube(unsigned int x, unsigned int y, unsigned int z)
 
 
     // compute samples on cube's edges
-    if (edgeTable[cubetype]&1)    samples[0]  = add_vertex(corner[0], corner[1]);
-    if (edgeTable[cubetype]&2)    samples[1]  = add_vertex(corner[1], corner[2]);
-    if (edgeTable[cubetype]&4)    samples[2]  = add_vertex(corner[3], corner[2]);
-    if (edgeTable[cubetype]&8)    samples[3]  = add_vertex(corner[0], corner[3]);
-    if (edgeTable[cubetype]&16)   samples[4]  = add_vertex(corner[4], corner[5]);
-    if (edgeTable[cubetype]&32)   samples[5]  = add_vertex(corner[5], corner[6]);
-    if (edgeTable[cubetype]&64)   samples[6]  = add_vertex(corner[7], corner[6]);
-    if (edgeTable[cubetype]&128)  samples[7]  = add_vertex(corner[4], corner[7]);
-    if (edgeTable[cubetype]&256)  samples[8]  = add_vertex(corner[0], corner[4]);
-    if (edgeTable[cubetype]&512)  samples[9]  = add_vertex(corner[1], corner[5]);
-    if (edgeTable[cubetype]&1024) samples[10] = add_vertex(corner[2], corner[6]);
-    if (edgeTable[cubetype]&2048) samples[11] = add_vertex(corner[3], corner[7]);
-
-    
+    std::vector<int>& xe = _layer.xe;
+    std::vector<int>& hi = _layer.hi;
+    const int b = _layer.hi_begin;
+    const unsigned int xi = y*grid_.z_resolution() + z; // x-edge at (y,z)
+    const unsigned int dy = grid_.z_resolution();
+    const int e = edgeTable[cubetype];
+    if (e&1)    samples[0]  = add_vertex(xe[xi],                      b, corner[0], corner[1], _slab);
+    if (e&2)    samples[1]  = add_vertex(hi[plane_slot(y,  z,  0)],   b, corner[1], corner[2], _slab);
+    if (e&4)    samples[2]  = add_vertex(xe[xi+dy],                   b, corner[3], corner[2], _slab);
+    if (e&8)    samples[3]  = add_lo_vertex(_layer, plane_slot(y,  z,  0), corner[0], corner[3], _slab);
+    if (e&16)   samples[4]  = add_vertex(xe[xi+1],                    b, corner[4], corner[5], _slab);
+    if (e&32)   samples[5]  = add_vertex(hi[plane_slot(y,  z+1,0)],   b, corner[5], corner[6], _slab);
+    if (e&64)   samples[6]  = add_vertex(xe[xi+dy+1],                 b, corner[7], corner[6], _slab);
+    if (e&128)  samples[7]  = add_lo_vertex(_layer, plane_slot(y,  z+1,0), corner[4], corner[7], _slab);
+    if (e&256)  samples[8]  = add_lo_vertex(_layer, plane_slot(y,  z,  1), corner[0], corner[4], _slab);
+    if (e&512)  samples[9]  = add_vertex(hi[plane_slot(y,  z,  1)],   b, corner[1], corner[5], _slab);
+    if (e&1024) samples[10] = add_vertex(hi[plane_slot(y+1,z,  1)],   b, corner[2], corner[6], _slab);
+    if (e&2048) samples[11] = add_lo_vertex(_layer, plane_slot(y+1,z,  1), corner[3], corner[7], _slab);
+
+
     // connect samples by triangles
-    for (i=0; triTable[cubetype][i] != -1; i+=3 )
-        mesh_.add_triangle(samples[triTable[cubetype][i  ]],
-                           samples[triTable[cubetype][i+1]],
-                           samples[triTable[cubetype][i+2]]);
+    for (i=0; triTable[cubetype][i] != -1; ++i)
+        _slab.triangles.push_back(samples[triTable[cubetype][i]]);
 }
 
 
 //-----------------------------------------------------------------------------
 
 
-Vertex
-Marching_cubes::
-add_vertex(const ivec3 &p0, const ivec3 &p1)
+template <class GridT>
+int
+Marching_cubes<GridT>::
+add_vertex(int& _cached, int _begin, const ivec3 &p0, const ivec3 &p1,
+           Slab& _slab) const
 {
-    // compute key for edge (p0,p1)
-    unsigned long int i0 = p0[0] + p0[1]*grid_.x_resolution() + p0[2]*grid_.x_resolution()*grid_.y_resolution();
-    unsigned long int i1 = p1[0] + p1[1]*grid_.x_resolution() + p1[2]*grid_.x_resolution()*grid_.y_resolution();
-    unsigned long int idx = std::min(i0, i1);
-    idx <<= 2;
-    if      (p0[0] != p1[0]) idx |= 0;
-    else if (p0[1] != p1[1]) idx |= 1;
-    else if (p0[2] != p1[2]) idx |= 2;
+    // vertex has been computed already
+    if (_cached >= _begin)
+        return _cached;
 
+    // otherwise generate new vertex
+    _cached = _slab.points.size();
+    _slab.points.push_back(edge_point(p0, p1));
+    return _cached;
+}
 
-    // find vertex if it has been computed already
-    std::map<unsigned long int, Vertex>::iterator it = edge2vertex_.find(idx);
-    if (it != edge2vertex_.end())
-        return it->second;
 
+//-----------------------------------------------------------------------------
 
-    // otherwise generate new vertex
+
+template <class GridT>
+int
+Marching_cubes<GridT>::
+add_lo_vertex(Layer& _layer, unsigned int _slot, const ivec3 &p0,
+              const ivec3 &p1, Slab& _slab) const
+{
+    // reference to the previous slab, resolved when stitching
+    if (_layer.foreign)
+        return -2-int(_slot);
+
+    return add_vertex(_layer.lo[_slot], _layer.lo_begin, p0, p1, _slab);
+}
+
+
+//-----------------------------------------------------------------------------
+
+
+template <class GridT>
+vec3
+Marching_cubes<GridT>::
+edge_point(const ivec3 &p0, const ivec3 &p1) const
+{
     vec3 pp0(grid_.point(p0));
     vec3 pp1(grid_.point(p1));
     float s0 = fabs(grid_(p0)-isoval_);
     float s1 = fabs(grid_(p1)-isoval_);
     float t  = s0 / (s0+s1);
-    Vertex v = mesh_.add_vertex((1.0f-t)*pp0 + t*pp1);
-    edge2vertex_[idx] = v;
-    return v;
+    return (1.0f-t)*pp0 + t*pp1;
 }
 
 
 //-----------------------------------------------------------------------------
 
 
-int Marching_cubes::edgeTable[256]=
+template <class GridT>
+int Marching_cubes<GridT>::edgeTable[256]=
 {
     0x0  , 0x109, 0x203, 0x30a, 0x406, 0x50f, 0x605, 0x70c,
     0x80c, 0x905, 0xa0f, 0xb06, 0xc0a, 0xd03, 0xe09, 0xf00,
@@ -202,7 +473,8 @@ int Marching_cubes::edgeTable[256]=
 //-----------------------------------------------------------------------------
 
 
-int Marching_cubes::triTable[256][17] =
+template <class GridT>
+int Marching_cubes<GridT>::triTable[256][17] =
 {
     {-1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1},
     {0, 8, 3, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1},
@@ -468,7 +740,16 @@ int Marching_cubes::triTable[256][17] =
 
 void marching_cubes(const Grid& _grid, SurfaceMesh& _mesh, Scalar isoval)
 {
-    Marching_cubes mc(_grid, _mesh, isoval);
+    Marching_cubes<Grid> mc(_grid, _mesh, isoval);
+}
+
+
+//-----------------------------------------------------------------------------
+
+
+void marching_cubes(const SparseGrid& _grid, SurfaceMesh& _mesh, Scalar isoval)
+{
+    Marching_cubes<SparseGrid> mc(_grid, _mesh, isoval);
 }
 
 
@@ -10,8 +10,9 @@
 #pragma once
 
 #include "Grid.h"
+#include "SparseGrid.h"
 #include <pmp/SurfaceMesh.h>
-#include <map>
+#include <vector>
 
 using namespace pmp;
 
@@ -19,9 +20,19 @@ using namespace pmp;
 
 /** use the Marching Cubes algorithm to extract the iso-surface to a certain
     iso-value (\c _isoval) from a grid of scalar values (\c _grid) and store
-    the resulting triangle mesh in \c _mesh. 
+    the resulting triangle mesh in \c _mesh. Slabs of the grid are processed
+    in parallel (if OpenMP is enabled); the resulting mesh does not depend on
+    the number of threads.
 */
 void marching_cubes(const Grid& _grid, SurfaceMesh& _mesh, Scalar _isoval=0);
 
+/** use the Marching Cubes algorithm to extract the iso-surface from a sparse
+    grid. Only the active cells of \c _grid (cells with all corners in
+    allocated bricks) are processed. The resulting mesh does not depend on
+    the number of threads.
+*/
+void marching_cubes(const SparseGrid& _grid, SurfaceMesh& _mesh,
+                    Scalar _isoval=0);
+
 
 //=============================================================================
@@ -0,0 +1,204 @@
+//=============================================================================
+//
+//   Exercise code for the lecture "Geometric Modeling"
+//   by Prof. Dr. Mario Botsch, TU Dortmund
+//
+//   Copyright (C) 2023 Computer Graphics Group, TU Dortmund.
+//
+//=============================================================================
+
+#include "MeshDistance.h"
+#include "kDTree.h"
+#include <pmp/algorithms/TriangleKdTree.h>
+#include <algorithm>
+#include <cmath>
+#include <memory>
+
+using namespace pmp;
+
+//=============================================================================
+
+
+Scalar percentile(std::vector<Scalar>& _distances, double _p)
+{
+    if (_distances.empty())
+        return 0;
+
+    const double rank = std::ceil(_p / 100.0 * _distances.size());
+    const size_t k = std::min(size_t(std::max(rank, 1.0)), _distances.size()) - 1;
+    std::nth_element(_distances.begin(), _distances.begin() + k,
+                     _distances.end());
+    return _distances[k];
+}
+
+
+//-----------------------------------------------------------------------------
+
+
+DistanceStatistics distance_statistics(std::vector<Scalar>& _distances)
+{
+    DistanceStatistics stats;
+    stats.n = _distances.size();
+    if (_distances.empty())
+        return stats;
+
+    double sum = 0, sqr_sum = 0;
+    for (Scalar d : _distances)
+    {
+        sum += d;
+        sqr_sum += double(d) * d;
+        stats.max = std::max(stats.max, d);
+    }
+    stats.mean = Scalar(sum / stats.n);
+    stats.rms  = Scalar(std::sqrt(sqr_sum / stats.n));
+
+    stats.median = percentile(_distances, 50);
+    stats.p90    = percentile(_distances, 90);
+    stats.p99    = percentile(_distances, 99);
+
+    return stats;
+}
+
+
+//-----------------------------------------------------------------------------
+
+
+bool point_to_mesh_distances(const Span<Point>& _points,
+                             const SurfaceMesh& _mesh,
+                             std::vector<Scalar>& _distances,
+                             std::vector<Point>* _closest,
+                             std::vector<Face>* _faces)
+{
+    if (!_mesh.is_triangle_mesh())
+        return false;
+
+    // the tree only reads the mesh during construction
+    std::shared_ptr<const SurfaceMesh> mesh(&_mesh, [](const SurfaceMesh*) {});
+    TriangleKdTree tree(mesh);
+
+    std::vector<TriangleKdTree::NearestNeighbor> nearest(_points.size());
+    tree.nearest(_points.data(), _points.size(), nearest.data());
+
+    _distances.resize(_points.size());
+    if (_closest) _closest->resize(_points.size());
+    if (_faces)   _faces->resize(_points.size());
+    for (size_t i = 0; i < _points.size(); ++i)
+    {
+        _distances[i] = nearest[i].dist;
+        if (_closest) (*_closest)[i] = nearest[i].nearest;
+        if (_faces)   (*_faces)[i] = nearest[i].face;
+    }
+
+    return true;
+}
+
+
+//-----------------------------------------------------------------------------
+
+
+void sample_surface(const SurfaceMesh& _mesh, Scalar _spacing,
+                    std::vector<Point>& _samples)
+{
+    auto vpoint = _mesh.get_vertex_property<Point>("v:point");
+
+    _samples.clear();
+    _samples.reserve(_mesh.n_vertices());
+    for (auto v : _mesh.vertices())
+        _samples.push_back(vpoint[v]);
+
+    if (_spacing <= 0)
+        return;
+
+    // number of segments such that samples are at most _spacing apart
+    auto segments = [&](Scalar _length) {
+        return std::max(1, int(std::ceil(_length / _spacing)));
+    };
+
+    // points inside the edges
+    for (auto e : _mesh.edges())
+    {
+        const Point& a = vpoint[_mesh.vertex(e, 0)];
+        const Point& b = vpoint[_mesh.vertex(e, 1)];
+        const int n = segments(distance(a, b));
+        for (int i = 1; i < n; ++i)
+            _samples.push_back(a + Scalar(i) / n * (b - a));
+    }
+
+    // points inside the triangles, on a barycentric grid whose rows are
+    // parallel to the edges
+    for (auto f : _mesh.faces())
+    {
+        if (_mesh.valence(f) != 3)
+            continue;
+
+        auto fv = _mesh.vertices(f);
+        const Point& a = vpoint[*fv];
+        const Point& b = vpoint[*(++fv)];
+        const Point& c = vpoint[*(++fv)];
+        const int n = segments(std::max({distance(a, b), distance(b, c),
+                                         distance(c, a)}));
+        for (int i = 1; i < n; ++i)
+            for (int j = 1; i + j < n; ++j)
+                _samples.push_back(a + Scalar(i) / n * (b - a) +
+                                   Scalar(j) / n * (c - a));
+    }
+}
+
+
+//-----------------------------------------------------------------------------
+
+
+void mesh_to_point_distances(const SurfaceMesh& _mesh,
+                             const Span<Point>& _points,
+                             std::vector<Scalar>& _distances,
+                             Scalar _spacing)
+{
+    _distances.clear();
+    if (_points.empty())
+        return;
+
+    std::vector<Point> samples;
+    sample_surface(_mesh, _spacing, samples);
+
+    kDTree tree(_points.data(), (unsigned int)_points.size());
+    tree.build(16);
+
+    std::vector<int> nearest(samples.size());
+    tree.nearest(samples.data(), (unsigned int)samples.size(),
+                 nearest.data());
+
+    _distances.resize(samples.size());
+#pragma omp parallel for schedule(static)
+    for (int i = 0; i < int(samples.size()); ++i)
+        _distances[i] = distance(samples[i], _points[nearest[i]]);
+}
+
+
+//-----------------------------------------------------------------------------
+
+
+bool reconstruction_error(const PointCloudView& _points,
+                          const SurfaceMesh& _mesh,
+                          ReconstructionError& _error)
+{
+    std::vector<Scalar> distances;
+    if (!point_to_mesh_distances(_points.points, _mesh, distances))
+        return false;
+    _error.points_to_mesh = distance_statistics(distances);
+
+    // spacing of the points if they uniformly sample a surface whose area
+    // is about the squared diagonal of their bounding box
+    _error.sample_spacing = 0;
+    if (!_points.points.empty())
+        _error.sample_spacing = _points.bounds().size() /
+                                std::sqrt(Scalar(_points.size()));
+
+    mesh_to_point_distances(_mesh, _points.points, distances,
+                            _error.sample_spacing);
+    _error.mesh_to_points = distance_statistics(distances);
+
+    return true;
+}
+
+
+//=============================================================================
@@ -0,0 +1,98 @@
+//=============================================================================
+//
+//   Exercise code for the lecture "Geometric Modeling"
+//   by Prof. Dr. Mario Botsch, TU Dortmund
+//
+//   Copyright (C) 2023 Computer Graphics Group, TU Dortmund.
+//
+//=============================================================================
+
+#pragma once
+
+#include <pmp/SurfaceMesh.h>
+#include "PointCloudView.h"
+#include <vector>
+#include <algorithm>
+
+//=============================================================================
+
+/// Summary of a set of distances
+struct DistanceStatistics
+{
+    size_t       n      = 0; ///< number of distances
+    pmp::Scalar  mean   = 0; ///< mean distance
+    pmp::Scalar  rms    = 0; ///< root mean square distance
+    pmp::Scalar  median = 0; ///< 50th percentile
+    pmp::Scalar  p90    = 0; ///< 90th percentile
+    pmp::Scalar  p99    = 0; ///< 99th percentile
+    pmp::Scalar  max    = 0; ///< maximum, i.e., one-sided Hausdorff distance
+};
+
+
+/// Deviation of a reconstructed mesh from its input points
+struct ReconstructionError
+{
+    /// distances of the input points to the mesh
+    DistanceStatistics points_to_mesh;
+
+    /// distances of samples on the mesh surface to the closest input point
+    DistanceStatistics mesh_to_points;
+
+    /// maximum distance between neighboring samples on the mesh surface
+    pmp::Scalar sample_spacing = 0;
+
+    /// symmetric Hausdorff distance, estimated from the surface samples.
+    /// The exact distance is at most \c sample_spacing larger.
+    pmp::Scalar hausdorff() const
+    {
+        return std::max(points_to_mesh.max, mesh_to_points.max);
+    }
+};
+
+
+//=============================================================================
+
+
+/// Return the \c _p-th percentile (0 to 100) of \c _distances by nearest
+/// rank. The distances are reordered.
+pmp::Scalar percentile(std::vector<pmp::Scalar>& _distances, double _p);
+
+/// Compute mean, RMS, percentiles, and maximum of \c _distances. The
+/// distances are reordered.
+DistanceStatistics distance_statistics(std::vector<pmp::Scalar>& _distances);
+
+/// Compute the distances of \c _points to the triangle mesh \c _mesh, and
+/// optionally the closest points and faces. The points are queried as one
+/// batch (see pmp::TriangleKdTree::nearest()), distributed over all threads.
+/// Returns false if \c _mesh is not a triangle mesh.
+bool point_to_mesh_distances(const Span<pmp::Point>& _points,
+                             const pmp::SurfaceMesh& _mesh,
+                             std::vector<pmp::Scalar>& _distances,
+                             std::vector<pmp::Point>* _closest = nullptr,
+                             std::vector<pmp::Face>* _faces = nullptr);
+
+/// Sample the surface of \c _mesh such that neighboring samples are at most
+/// \c _spacing apart: the vertices, points on the edges, and points inside
+/// the triangles. Only the vertices are sampled if \c _spacing is not
+/// positive; faces that are not triangles contribute only their boundary.
+void sample_surface(const pmp::SurfaceMesh& _mesh, pmp::Scalar _spacing,
+                    std::vector<pmp::Point>& _samples);
+
+/// Compute the distances of surface samples of \c _mesh (see
+/// sample_surface()) to the closest point of \c _points (see
+/// kDTree::nearest()). For \c _spacing=0 only the vertices are measured.
+void mesh_to_point_distances(const pmp::SurfaceMesh& _mesh,
+                             const Span<pmp::Point>& _points,
+                             std::vector<pmp::Scalar>& _distances,
+                             pmp::Scalar _spacing = 0);
+
+/// Measure the deviation of the triangle mesh \c _mesh reconstructed from
+/// \c _points in both directions. The mesh is sampled with the average
+/// spacing of the points, estimated from their bounding box. Returns false
+/// if \c _mesh is not a triangle mesh.
+bool reconstruction_error(const PointCloudView& _points,
+                          const pmp::SurfaceMesh& _mesh,
+                          ReconstructionError& _error);
+
+
+//=============================================================================
@@ -0,0 +1,80 @@
+//=============================================================================
+//
+//   Exercise code for the lecture "Geometric Modeling"
+//   by Prof. Dr. Mario Botsch, TU Dortmund
+//
+//   Copyright (C) 2023 Computer Graphics Group, TU Dortmund.
+//
+//=============================================================================
+
+#pragma once
+
+#include <pmp/Types.h>
+#include <pmp/BoundingBox.h>
+#include <vector>
+#include <cstddef>
+
+//=============================================================================
+
+/// Read-only view of a contiguous array (pointer and size), does not own
+/// the data.
+template <class T>
+class Span
+{
+public:
+
+    /// empty span
+    Span() : data_(nullptr), size_(0) {}
+
+    /// span of \c _size elements starting at \c _data
+    Span(const T* _data, size_t _size) : data_(_data), size_(_size) {}
+
+    /// span of all elements of a vector
+    Span(const std::vector<T>& _v) : data_(_v.data()), size_(_v.size()) {}
+
+    const T* data() const { return data_; }
+    size_t size() const { return size_; }
+    bool empty() const { return size_ == 0; }
+
+    const T& operator[](size_t i) const { return data_[i]; }
+
+    const T* begin() const { return data_; }
+    const T* end() const { return data_ + size_; }
+
+private:
+
+    const T*  data_;
+    size_t    size_;
+};
+
+
+//=============================================================================
+
+
+/// Read-only view of a point cloud: points, normals, and optionally colors
+/// (empty if not available). The data can live in a PointSet or in a
+/// memory-mapped file (see MappedPointSet).
+struct PointCloudView
+{
+    Span<pmp::Point>   points;
+    Span<pmp::Normal>  normals;
+    Span<pmp::Color>   colors;
+
+    /// number of points
+    size_t size() const { return points.size(); }
+
+    /// does the point cloud have no points?
+    bool empty() const { return points.empty(); }
+
+    /// bounding box of the points
+    pmp::BoundingBox bounds() const
+    {
+        pmp::BoundingBox bb;
+        for (const auto& p : points)
+            bb += p;
+        return bb;
+    }
+};
+
+
+//=============================================================================
@@ -9,10 +9,11 @@
 
 // our includes
 #include "PointSet.h"
+#include "MappedPointSet.h"
+#include "AsciiParser.h"
 #include <pmp/algorithms/SurfaceNormals.h>
 
 // system includes
-#include <fstream>
 #include <string>
 #include <clocale>
 
@@ -52,6 +53,26 @@ PointSet::PointSet()
 
 
 bool PointSet::read_data(const char *_filename)
+{
+    if (!read_points(_filename))
+        return false;
+
+    set_specular(0.15);
+    if(!has_colors_)
+        set_front_color(Color(1,0,0));
+
+    set_point_size(3);
+
+    update_opengl_buffers();
+
+    return true;
+}
+
+
+//-----------------------------------------------------------------------------
+
+
+bool PointSet::read_points(const char *_filename)
 {
     std::setlocale(LC_NUMERIC, "C");
 
@@ -81,6 +102,10 @@ bool PointSet::read_data(const char *_filename)
     {
         ok = read_pts(_filename);
     }
+    else if (ext == "ply")
+    {
+        ok = read_ply(_filename);
+    }
     else
     {
         has_colors_ = false;
@@ -91,17 +116,9 @@ bool PointSet::read_data(const char *_filename)
             // make sure normals are in v:normal
             SurfaceNormals::compute_vertex_normals(*this);
 
-            // set pointset to mesh vertices and normals
-            auto vnormal = get_vertex_property<Normal>("v:normal");
-            auto vpoint = get_vertex_property<Point>("v:point");
-
-            points_.resize(n_vertices());
-            normals_.resize(n_vertices());
-            for (auto v : vertices())
-            {
-                points_[v.idx()] = vpoint[v];
-                normals_[v.idx()] = vnormal[v];
-            }
+            // keep vertices and normals, drop the faces
+            points_  = std::move(positions());
+            normals_ = std::move(get_vertex_property<Normal>("v:normal").vector());
 
             ok = true;
         }
@@ -117,37 +134,14 @@ bool PointSet::read_data(const char *_filename)
         return false;
     }
 
-    clear();
-    for(size_t i = 0; i < points_.size(); i++)
-    {
-        add_vertex(points_[i]);
-    }
-
-    auto vnormal = vertex_property<Normal>("v:normal");
-    for(auto v : vertices())
-    {
-        vnormal[v] = normals_[v.idx()];
-    }
-
-    set_specular(0.15);
-    if(!has_colors_)
-    {
-        set_front_color(Color(1,0,0));
-        auto vcolor = get_vertex_property<Normal>("v:color");
-        if (vcolor) remove_vertex_property(vcolor);
-    }
-    else
-    {
-        auto vcolor = vertex_property<Color>("v:color");
-        for(auto v : vertices())
-        {
-            vcolor[v] = colors_[v.idx()];
-        }
-    }
-
-    set_point_size(3);
-
-    update_opengl_buffers();
+    // the read arrays become the vertex properties, without copying them
+    build(std::move(points_), {}, {});
+    vertex_property<Normal>("v:normal").vector() = std::move(normals_);
+    if (has_colors_)
+        vertex_property<Color>("v:color").vector() = std::move(colors_);
+    std::vector<Point>().swap(points_);
+    std::vector<Normal>().swap(normals_);
+    std::vector<Color>().swap(colors_);
 
     return true;
 }
@@ -158,15 +152,7 @@ bool PointSet::read_data(const char *_filename)
 
 void PointSet::update_opengl()
 {
-    auto vpoint = get_vertex_property<Point>("v:point");
-    auto vnormal = get_vertex_property<Normal>("v:normal");
-    for(auto v : vertices())
-    {
-        vpoint[v] = points_[v.idx()];
-        vnormal[v] = normals_[v.idx()];
-    }
-
-    update_opengl_buffers();
+    update_opengl_buffers(UpdatePositions | UpdateNormals);
 }
 
 
@@ -177,30 +163,23 @@ bool
 PointSet::
 read_xyz(const char* filename)
 {
-    FILE* in = fopen(filename, "r");
-    if (!in) return false;
+    // columns: x y z nx ny nz
+    std::vector<float> v;
+    if (!read_float_columns(filename, 6, 0, v)) return false;
 
-    char line[200];
-    float x, y, z;
-    float nx, ny, nz;
-    int n;
-
-    points_.clear();
-    normals_.clear();
-    colors_.clear();
+    const size_t n = v.size() / 6;
+    points_.resize(n);
+    normals_.resize(n);
+    colors_.assign(n, pmp::Color(0.0,0.0,0.0));
 
-    while (in && !feof(in) && fgets(line, 200, in))
+#pragma omp parallel for
+    for (long i = 0; i < (long)n; ++i)
     {
-        n = sscanf(line, "%f %f %f %f %f %f", &x, &y, &z, &nx, &ny, &nz);
-        if (n >= 6)
-        {
-            points_.push_back(pmp::Point(x,y,z));
-            normals_.push_back(pmp::Normal(nx,ny,nz));
-            colors_.push_back(pmp::Color(0.0,0.0,0.0));
-        }
+        const float* c = &v[6*i];
+        points_[i]  = pmp::Point(c[0],c[1],c[2]);
+        normals_[i] = pmp::Normal(c[3],c[4],c[5]);
     }
 
-    fclose(in);
     return true;
 }
 
@@ -212,31 +191,24 @@ bool
 PointSet::
 read_cnoff(const char* filename)
 {
-    FILE* in = fopen(filename, "r");
-    if (!in) return false;
-
-    char line[200];
-    float x, y, z;
-    float nx, ny, nz;
-    float cx, cy, cz;
-    int n;
+    // columns: x y z nx ny nz r g b (colors in [0,255])
+    std::vector<float> v;
+    if (!read_float_columns(filename, 9, 0, v)) return false;
 
-    points_.clear();
-    normals_.clear();
-    colors_.clear();
+    const size_t n = v.size() / 9;
+    points_.resize(n);
+    normals_.resize(n);
+    colors_.resize(n);
 
-    while (in && !feof(in) && fgets(line, 200, in))
+#pragma omp parallel for
+    for (long i = 0; i < (long)n; ++i)
     {
-        n = sscanf(line, "%f %f %f %f %f %f %f %f %f", &x, &y, &z, &nx, &ny, &nz, &cx, &cy, &cz);
-        if (n >= 9)
-        {
-            points_.push_back(pmp::Point(x,y,z));
-            normals_.push_back(pmp::Normal(nx,ny,nz));
-            colors_.push_back(pmp::Color(cx/255.0,cy/255.0,cz/255.0));
-        }
+        const float* c = &v[9*i];
+        points_[i]  = pmp::Point(c[0],c[1],c[2]);
+        normals_[i] = pmp::Normal(c[3],c[4],c[5]);
+        colors_[i]  = pmp::Color(c[6]/255.0,c[7]/255.0,c[8]/255.0);
     }
 
-    fclose(in);
     return true;
 }
 
@@ -248,32 +220,25 @@ bool
 PointSet::
 read_cxyz(const char* filename)
 {
-    std::ifstream ifs(filename);
-    if (!ifs) return false;
-
-    float x, y, z;
-    float nx, ny, nz;
-    float cx, cy, cz;
+    // two header lines, then x y z nx ny nz r g b (colors in [0,1]),
+    // line breaks do not matter
+    std::vector<float> v;
+    if (!read_float_stream(filename, 2, v)) return false;
 
-    points_.clear();
-    normals_.clear();
-    colors_.clear();
+    const size_t n = v.size() / 9;
+    points_.resize(n);
+    normals_.resize(n);
+    colors_.resize(n);
 
-    std::string dummy;
-    std::getline(ifs, dummy);
-    std::getline(ifs, dummy);
-    while (ifs && !ifs.eof())
+#pragma omp parallel for
+    for (long i = 0; i < (long)n; ++i)
     {
-        ifs >> x >> y >> z;
-        ifs >> nx >> ny >> nz;
-        ifs >> cx >> cy >> cz;
-        points_.push_back(pmp::Point(x,y,z));
-        normals_.push_back(pmp::Normal(nx,ny,nz));
-        colors_.push_back(pmp::Color(cx,cy,cz));
+        const float* c = &v[9*i];
+        points_[i]  = pmp::Point(c[0],c[1],c[2]);
+        normals_[i] = pmp::Normal(c[3],c[4],c[5]);
+        colors_[i]  = pmp::Color(c[6],c[7],c[8]);
     }
 
-    ifs.close();
-
     return true;
 }
 
@@ -285,31 +250,24 @@ bool
 PointSet::
 read_txt(const char* filename)
 {
-    FILE* in = fopen(filename, "r");
-    if (!in) return false;
+    // columns: x y z r g b nx ny nz (colors in [0,255])
+    std::vector<float> v;
+    if (!read_float_columns(filename, 9, 0, v)) return false;
 
-    char line[200];
-    float x, y, z;
-    float nx, ny, nz;
-    float cx, cy, cz;
-    int n;
-
-    points_.clear();
-    normals_.clear();
-    colors_.clear();
+    const size_t n = v.size() / 9;
+    points_.resize(n);
+    normals_.resize(n);
+    colors_.resize(n);
 
-    while (in && !feof(in) && fgets(line, 200, in))
+#pragma omp parallel for
+    for (long i = 0; i < (long)n; ++i)
     {
-        n = sscanf(line, "%f %f %f %f %f %f %f %f %f", &x, &y, &z, &cx, &cy, &cz, &nx, &ny, &nz);
-        if (n >= 9)
-        {
-            points_.push_back(pmp::Point(x,y,z));
-            normals_.push_back(pmp::Normal(nx,ny,nz));
-            colors_.push_back(pmp::Color(cx/255.0,cy/255.0,cz/255.0));
-        }
+        const float* c = &v[9*i];
+        points_[i]  = pmp::Point(c[0],c[1],c[2]);
+        normals_[i] = pmp::Normal(c[6],c[7],c[8]);
+        colors_[i]  = pmp::Color(c[3]/255.0,c[4]/255.0,c[5]/255.0);
     }
 
-    fclose(in);
     return true;
 }
 
@@ -321,26 +279,55 @@ bool
 PointSet::
 read_pts(const char* filename)
 {
-    FILE* in = fopen(filename, "rb");
-    if (!in) return false;
+    if (!::read_pts(filename, points_, normals_, colors_)) return false;
+    has_colors_ = !colors_.empty();
+    return true;
+}
 
-    unsigned int n;
-    tfread(in, n);
-    tfread(in, has_colors_);
 
-    std::cout << n << " points " << (has_colors_ ? "with" : "without") << " colors\n";
+//-----------------------------------------------------------------------------
 
-    points_.resize(n);
-    fread((char*)points_.data(), sizeof(pmp::Point), n, in);
 
-    normals_.resize(n);
-    fread((char*)normals_.data(), sizeof(pmp::Normal), n, in);
+bool
+PointSet::
+read_ply(const char* filename)
+{
+    SurfaceMesh mesh;
+    try
+    {
+        mesh.read(filename);
+    }
+    catch (const IOException& e)
+    {
+        std::cerr << e.what() << std::endl;
+        return false;
+    }
+
+    // meshes without normals get vertex normals from their faces
+    auto vnormal = mesh.get_vertex_property<Normal>("v:normal");
+    if (!vnormal && mesh.n_faces())
+    {
+        SurfaceNormals::compute_vertex_normals(mesh);
+        vnormal = mesh.get_vertex_property<Normal>("v:normal");
+    }
+    if (!vnormal)
+    {
+        std::cerr << "PLY point set without normals\n";
+        return false;
+    }
+
+    auto vcolor = mesh.get_vertex_property<Color>("v:color");
+    has_colors_ = bool(vcolor);
+
+    // "v:confidence" is not kept: the reconstructions weigh all points
+    // equally (Poisson runs without its confidence mode), so it would only
+    // cost memory
 
-    colors_.resize(n, pmp::Color(0,0,0));
+    points_  = std::move(mesh.positions());
+    normals_ = std::move(vnormal.vector());
     if (has_colors_)
-        fread((char*)colors_.data(), sizeof(pmp::Color), n, in);
+        colors_ = std::move(vcolor.vector());
 
-    fclose(in);
     return true;
 }
 
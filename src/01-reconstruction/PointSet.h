@@ -12,6 +12,7 @@
 // our includes
 #include <pmp/Types.h>
 #include <pmp/visualization/SurfaceMeshGL.h>
+#include "PointCloudView.h"
 
 // system includes
 #include <vector>
@@ -28,12 +29,30 @@ public:
     /// encapsulates read functions
     bool read_data(const char* _filename);
 
+    /// reads points, normals, and colors into the vertex properties like
+    /// read_data(), but does not upload them to OpenGL
+    bool read_points(const char* _filename);
+
     /// resets points and normals to original
     void reset();
 
-    /// copies point cloud data to Surfacemesh for openGL rendering
+    /// uploads changed points and normals for openGL rendering
     void update_opengl();
 
+    /// read-only view of points, normals and colors, which are stored in
+    /// the vertex properties only
+    PointCloudView view() const
+    {
+        PointCloudView pc;
+        auto vpoint = get_vertex_property<pmp::Point>("v:point");
+        pc.points = Span<pmp::Point>(vpoint.vector());
+        auto vnormal = get_vertex_property<pmp::Normal>("v:normal");
+        if (vnormal) pc.normals = Span<pmp::Normal>(vnormal.vector());
+        auto vcolor = get_vertex_property<pmp::Color>("v:color");
+        if (has_colors_ && vcolor) pc.colors = Span<pmp::Color>(vcolor.vector());
+        return pc;
+    }
+
 private:
 
     /// Read a point set with normals from a .xyz file.
@@ -48,15 +67,23 @@ private:
     /// Read a point set with normals and colors from a .txt file.
     bool read_txt(const char* filename);
 
-    /// Read a point set with normals and colors from a binary .pts file.
+    /// Read a point set with normals and colors from a binary .pts file
+    /// (legacy or aligned layout, see MappedPointSet).
     bool read_pts(const char* filename);
 
-public:
+    /// Read a point set with normals and (optional) colors from a binary or
+    /// ASCII .ply file. Meshes without normals get vertex normals, per-vertex
+    /// confidences are ignored.
+    bool read_ply(const char* filename);
 
+    // arrays filled by the read functions, moved into the vertex properties
+    // by read_points()
     std::vector<pmp::Point>  points_;
     std::vector<pmp::Normal> normals_;
     std::vector<pmp::Color>  colors_;
 
+public:
+
     bool has_colors_;
 };
 
@@ -0,0 +1,95 @@
+//=============================================================================
+//
+//   Exercise code for the lecture "Geometric Modeling"
+//   by Prof. Dr. Mario Botsch, TU Dortmund
+//
+//   Copyright (C) 2023 Computer Graphics Group, TU Dortmund.
+//
+//=============================================================================
+
+#include "SparseGrid.h"
+using namespace pmp;
+
+
+//== IMPLEMENTATION ==========================================================
+
+
+SparseGrid::
+SparseGrid(const vec3&  _origin,
+           const vec3&  _x_axis,
+           const vec3&  _y_axis,
+           const vec3&  _z_axis,
+           unsigned int  _x_res,
+           unsigned int  _y_res,
+           unsigned int  _z_res,
+           float         _background)
+{
+    // store bounding box
+    origin_ = _origin;
+    x_axis_ = _x_axis;
+    y_axis_ = _y_axis;
+    z_axis_ = _z_axis;
+
+    // store grid resolution
+    x_res_ = _x_res;
+    y_res_ = _y_res;
+    z_res_ = _z_res;
+
+    // brick resolution
+    bx_res_ = (x_res_ + brick_size-1) / brick_size;
+    by_res_ = (y_res_ + brick_size-1) / brick_size;
+    bz_res_ = (z_res_ + brick_size-1) / brick_size;
+
+    // no bricks allocated yet
+    background_ = _background;
+    bricks_.clear();
+    bricks_.resize(size_t(bx_res_)*by_res_*bz_res_, -1);
+    values_.clear();
+
+    // spacing
+    dx_ = x_axis_ / (float)(x_res_-1);
+    dy_ = y_axis_ / (float)(y_res_-1);
+    dz_ = z_axis_ / (float)(z_res_-1);
+}
+
+
+//-----------------------------------------------------------------------------
+
+
+int
+SparseGrid::
+allocate_brick(unsigned int bx, unsigned int by, unsigned int bz)
+{
+    int& b = bricks_[brick_index(bx, by, bz)];
+    if (b < 0)
+    {
+        b = values_.size();
+        values_.emplace_back(new float[brick_values]);
+        std::fill(values_.back().get(), values_.back().get() + brick_values,
+                  background_);
+    }
+    return b;
+}
+
+
+//-----------------------------------------------------------------------------
+
+
+std::vector<ivec3>
+SparseGrid::
+allocated_bricks() const
+{
+    std::vector<ivec3> bricks(n_allocated_bricks());
+    for (unsigned int bx=0; bx<bx_res_; ++bx)
+        for (unsigned int by=0; by<by_res_; ++by)
+            for (unsigned int bz=0; bz<bz_res_; ++bz)
+            {
+                int b = bricks_[brick_index(bx, by, bz)];
+                if (b >= 0)
+                    bricks[b] = ivec3(bx*brick_size, by*brick_size, bz*brick_size);
+            }
+    return bricks;
+}
+
+
+//=============================================================================
@@ -0,0 +1,237 @@
+//=============================================================================
+//
+//   Exercise code for the lecture "Geometric Modeling"
+//   by Prof. Dr. Mario Botsch, TU Dortmund
+//
+//   Copyright (C) 2023 Computer Graphics Group, TU Dortmund.
+//
+//=============================================================================
+
+#pragma once
+
+#include <pmp/MatVec.h>
+#include <vector>
+#include <memory>
+#include <algorithm>
+#include <cstddef>
+
+using namespace pmp;
+
+//=============================================================================
+
+/** Sparse 3D regular grid of float values, e.g., for narrow-band distance
+    fields. The grid is split into bricks of 8x8x8 values, which are only
+    allocated on request (allocate()). A dense array of brick indices (one
+    int per brick) serves as two-level index. Reading an unallocated value
+    returns the background value.
+
+    Reading matches the interface of Grid; values are written through
+    find() after allocating their bricks. In addition, the active cells
+    (grid cubes with all eight corners in allocated bricks) can be
+    enumerated, which is used by marching_cubes() to skip empty space.
+*/
+class SparseGrid
+{
+public:
+
+    /// number of grid values per brick along each axis
+    static const unsigned int brick_size = 8;
+
+
+    /** construct grid with origin and three axes of bounding box, the grid
+        resolution in x, y, z direction, and the value of unallocated grid
+        points */
+    SparseGrid(const vec3&  _origin = vec3(0,0,0),
+               const vec3&  _x_axis = vec3(1,0,0),
+               const vec3&  _y_axis = vec3(0,1,0),
+               const vec3&  _z_axis = vec3(0,0,1),
+               unsigned int  _x_res = 10,
+               unsigned int  _y_res = 10,
+               unsigned int  _z_res = 10,
+               float         _background = 0.0);
+
+
+    /// return grid's origin
+    const vec3& origin() const { return origin_; }
+    /// return grid's x-axis
+    const vec3& x_axis() const { return x_axis_; }
+    /// return grid's y-axis
+    const vec3& y_axis() const { return y_axis_; }
+    /// return grid's z-axis
+    const vec3& z_axis() const { return z_axis_; }
+
+    /// return grid's x-resolution
+    unsigned int x_resolution() const { return x_res_; }
+    /// return grid's y-resolution
+    unsigned int y_resolution() const { return y_res_; }
+    /// return grid's z-resolution
+    unsigned int z_resolution() const { return z_res_; }
+
+    /// return value of unallocated grid points
+    float background() const { return background_; }
+
+
+    /// return position of grid point at index (x,y,z)
+    vec3 point(unsigned int x, unsigned int y, unsigned int z) const {
+        return origin_ + dx_*x + dy_*y + dz_*z;
+    }
+    /// return position of grid point at index xyz
+    vec3 point(const ivec3& xyz) const {
+        return origin_ + dx_*xyz[0] + dy_*xyz[1] + dz_*xyz[2];
+    }
+
+
+    /// return scalar value at grid position/index (x,y,z)
+    float operator()(unsigned int x, unsigned int y, unsigned int z) const {
+        return value(x, y, z);
+    }
+    /// return scalar value at grid position/index xyz
+    float operator()(const ivec3& xyz) const {
+        return value(xyz[0], xyz[1], xyz[2]);
+    }
+
+    /** return scalar value at grid position/index (x,y,z), or the
+        background value if its brick is not allocated. never allocates. */
+    float value(unsigned int x, unsigned int y, unsigned int z) const {
+        const float* v = find(x, y, z);
+        return v ? *v : background_;
+    }
+
+    /** return pointer to the value at grid position/index (x,y,z), or
+        nullptr if its brick is not allocated. never allocates. bricks are
+        not moved, so the pointer stays valid when further bricks are
+        allocated, but allocate() is not thread-safe: allocate all bricks
+        before writing their values in parallel. */
+    float* find(unsigned int x, unsigned int y, unsigned int z) {
+        int b = bricks_[brick_index(x/brick_size, y/brick_size, z/brick_size)];
+        return (b < 0) ? nullptr : &values_[b][offset(x,y,z)];
+    }
+    /// return pointer to the value at (x,y,z), see above
+    const float* find(unsigned int x, unsigned int y, unsigned int z) const {
+        int b = bricks_[brick_index(x/brick_size, y/brick_size, z/brick_size)];
+        return (b < 0) ? nullptr : &values_[b][offset(x,y,z)];
+    }
+
+
+    /// allocate the brick containing grid point (x,y,z)
+    void allocate(unsigned int x, unsigned int y, unsigned int z) {
+        allocate_brick(x/brick_size, y/brick_size, z/brick_size);
+    }
+
+    /// is the brick containing grid point (x,y,z) allocated?
+    bool is_allocated(unsigned int x, unsigned int y, unsigned int z) const {
+        return bricks_[brick_index(x/brick_size, y/brick_size, z/brick_size)] >= 0;
+    }
+
+    /// index of the first grid point of each allocated brick
+    std::vector<ivec3> allocated_bricks() const;
+
+
+    /// total number of bricks covering the grid
+    size_t n_bricks() const { return bricks_.size(); }
+
+    /// number of allocated bricks
+    size_t n_allocated_bricks() const { return values_.size(); }
+
+    /// memory used by the brick index and the allocated bricks (in bytes)
+    size_t memory_usage() const {
+        return bricks_.capacity()*sizeof(int) +
+               values_.capacity()*sizeof(values_[0]) +
+               values_.size()*brick_values*sizeof(float);
+    }
+
+    /// memory a dense Grid of the same resolution would use (in bytes)
+    size_t dense_memory_usage() const {
+        return size_t(x_res_)*y_res_*z_res_*sizeof(float);
+    }
+
+
+    /** call \c _f(y,z) for all active cells (x,y,z) of the cube layer
+        between the grid planes x and x+1. A cell is active if all its
+        eight corners lie in allocated bricks. Cells are enumerated brick by
+        brick, in a fixed order. */
+    template <class F>
+    void for_each_active_cell(unsigned int x, const F& _f) const;
+
+
+private:
+
+    static const unsigned int brick_values = brick_size*brick_size*brick_size;
+
+    /// index of brick (bx,by,bz) in bricks_
+    size_t brick_index(unsigned int bx, unsigned int by, unsigned int bz) const {
+        return bz + by*size_t(bz_res_) + bx*size_t(bz_res_)*by_res_;
+    }
+
+    /// offset of grid point (x,y,z) within its brick
+    static unsigned int offset(unsigned int x, unsigned int y, unsigned int z) {
+        return (z%brick_size) + brick_size*((y%brick_size) + brick_size*(x%brick_size));
+    }
+
+    /// return index of brick (bx,by,bz), allocate it if necessary
+    int allocate_brick(unsigned int bx, unsigned int by, unsigned int bz);
+
+
+private:
+
+    vec3                origin_, x_axis_, y_axis_, z_axis_, dx_, dy_, dz_;
+    unsigned int        x_res_, y_res_, z_res_;
+    unsigned int        bx_res_, by_res_, bz_res_;
+    float               background_;
+
+    // per brick: index of brick in values_ or -1 if not allocated
+    std::vector<int>    bricks_;
+
+    // values of allocated bricks, brick_values per brick
+    std::vector<std::unique_ptr<float[]>>  values_;
+};
+
+
+//-----------------------------------------------------------------------------
+
+
+template <class F>
+void
+SparseGrid::
+for_each_active_cell(unsigned int x, const F& _f) const
+{
+    if (x+1 >= x_res_) return;
+
+    const unsigned int bx0 = x/brick_size, bx1 = (x+1)/brick_size;
+
+    for (unsigned int by=0; by<by_res_; ++by)
+    {
+        for (unsigned int bz=0; bz<bz_res_; ++bz)
+        {
+            if (bricks_[brick_index(bx0,by,bz)] < 0 ||
+                bricks_[brick_index(bx1,by,bz)] < 0)
+                continue;
+
+            const unsigned int y_end = std::min((by+1)*brick_size, y_res_-1);
+            const unsigned int z_end = std::min((bz+1)*brick_size, z_res_-1);
+
+            for (unsigned int y=by*brick_size; y<y_end; ++y)
+            {
+                for (unsigned int z=bz*brick_size; z<z_end; ++z)
+                {
+                    // cells on the upper brick faces need the neighbors
+                    const unsigned int by1 = (y+1)/brick_size;
+                    const unsigned int bz1 = (z+1)/brick_size;
+                    if ((by1 != by || bz1 != bz) &&
+                        (bricks_[brick_index(bx0,by1,bz1)] < 0 ||
+                         bricks_[brick_index(bx1,by1,bz1)] < 0 ||
+                         bricks_[brick_index(bx0,by, bz1)] < 0 ||
+                         bricks_[brick_index(bx1,by, bz1)] < 0 ||
+                         bricks_[brick_index(bx0,by1,bz )] < 0 ||
+                         bricks_[brick_index(bx1,by1,bz )] < 0))
+                        continue;
+
+                    _f(y, z);
+                }
+            }
+        }
+    }
+}
+
+
+//=============================================================================
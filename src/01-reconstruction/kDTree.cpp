@@ -8,7 +8,11 @@
 //=============================================================================
 
 #include "kDTree.h"
+#include <pmp/BoundingBox.h>
+#include <pmp/algorithms/DistanceKernels.h>
+#include <pmp/algorithms/Morton.h>
 #include <algorithm>
+#include <cstdint>
 #include <float.h>
 
 using namespace pmp;
@@ -19,20 +23,57 @@ using namespace pmp;
 unsigned int
 kDTree::build(unsigned int _max_handles, unsigned int _max_depth)
 {
+    n_nodes_ = 0;
+
     // copy points to element array
     elements_.clear();
-    elements_.reserve(points_.size());
-    ConstPointIter p_it;
-    int i;
+    elements_.reserve(n_points_);
+    for (unsigned int i=0; i<n_points_; ++i)
+        elements_.push_back( Element(points_[i], i) );
+
+
+    // flat layout: partition elements, then store them as SoA in leaf order
+    if (layout_ == Flat)
+    {
+        // rough estimate of the number of nodes to avoid re-allocations
+        nodes_.clear();
+        nodes_.reserve(4 * elements_.size() / std::max(_max_handles, 1u) + 1);
+
+        _build_flat(0, elements_.size(), _max_handles, _max_depth);
+
+        const unsigned int n = elements_.size();
+        xs_.resize(n);
+        ys_.resize(n);
+        zs_.resize(n);
+        indices_.resize(n);
+        for (unsigned int j=0; j<n; ++j)
+        {
+            xs_[j] = elements_[j].point[0];
+            ys_[j] = elements_[j].point[1];
+            zs_[j] = elements_[j].point[2];
+            indices_[j] = elements_[j].idx;
+        }
+
+        // the distance kernels read whole blocks beyond a leaf's end
+        if (n > 0)
+        {
+            const unsigned int pad = pmp::distance_kernel_max_width() - 1;
+            xs_.resize(n+pad, xs_.back());
+            ys_.resize(n+pad, ys_.back());
+            zs_.resize(n+pad, zs_.back());
+            indices_.resize(n+pad, indices_.back());
+        }
 
-    for (p_it=points_.begin(), i=0; p_it!=points_.end(); ++p_it, ++i)
-        elements_.push_back( Element(*p_it, i) );
+        // elements are not needed anymore
+        Elements().swap(elements_);
+
+        return n_nodes_;
+    }
 
 
     // init
     delete root_;
     root_ = new Node(elements_.begin(), elements_.end());
-    n_nodes_ = 0;
 
 
     // call recursive helper
@@ -104,6 +145,74 @@ _build(Node*         _node,
 //-----------------------------------------------------------------------------
 
 
+unsigned int
+kDTree::
+_build_flat(unsigned int  _begin,
+            unsigned int  _end,
+            unsigned int  _max_handles,
+            unsigned int  _depth)
+{
+    // create node, leaf by default
+    const unsigned int idx = nodes_.size();
+    FlatNode node;
+    node.cut_val_ = 0;
+    node.cut_dim_ = 3;
+    node.begin_   = _begin;
+    node.end_     = _end;
+    nodes_.push_back(node);
+
+
+    // should we stop at this level ?
+    const unsigned int n = _end-_begin;
+    if ((_depth == 0) || (n < _max_handles))
+        return idx;
+
+
+    // compute bounding box
+    ElementIter begin(elements_.begin()+_begin), end(elements_.begin()+_end);
+    ElementIter it(begin);
+    Point bb_min = it->point;
+    Point bb_max = it->point;
+    for (; it!=end; ++it)
+    {
+        bb_min = min(bb_min, it->point);
+        bb_max = max(bb_max, it->point);
+    }
+
+
+    // split longest side of bounding box
+    Point bb = bb_max - bb_min;
+    Scalar length = bb[0];
+    int axis = 0;
+    if (bb[1] > length) length = bb[axis=1];
+    if (bb[2] > length) length = bb[axis=2];
+    Scalar cv = 0.5*(bb_min[axis]+bb_max[axis]);
+
+
+    // partition for left and right child
+    it = std::partition(begin, end, PartPlane(axis, cv));
+    const unsigned int mid = it - elements_.begin();
+
+
+    // create children: left child directly follows its parent
+    n_nodes_ += 2;
+    _build_flat(_begin, mid, _max_handles, _depth-1);
+    const unsigned int right = _build_flat(mid, _end, _max_handles, _depth-1);
+
+
+    // turn into inner node (nodes_ might have been re-allocated)
+    nodes_[idx].cut_dim_ = axis;
+    nodes_[idx].cut_val_ = cv;
+    nodes_[idx].begin_   = right;
+    nodes_[idx].end_     = right;
+
+    return idx;
+}
+
+
+//-----------------------------------------------------------------------------
+
+
 kDTree::NearestNeighborData
 kDTree::
 nearest(const Point& _p) const
@@ -112,10 +221,11 @@ nearest(const Point& _p) const
     NearestNeighborData  data;
     data.ref        = _p;
     data.dist       = FLT_MAX;
+    data.nearest    = -1;
     data.leaf_tests = 0;
 
     // recursive search
-    _nearest(root_, data);
+    _nearest(data);
 
     // dist was computed as sqr-dist
     data.dist = sqrt(data.dist);
@@ -127,6 +237,93 @@ nearest(const Point& _p) const
 //-----------------------------------------------------------------------------
 
 
+void
+kDTree::
+nearest(const Point* _queries, unsigned int _n, int* _indices) const
+{
+    if (_n == 0)
+        return;
+
+
+    // sort queries along a Morton curve through their bounding box
+    BoundingBox bb;
+    for (unsigned int i=0; i<_n; ++i)
+        bb += _queries[i];
+    const Point  bb_min = bb.min();
+    const Point  bb_size = bb.max() - bb.min();
+    const Scalar scale = (1<<21) - 1;
+
+    std::vector<std::pair<uint64_t, unsigned int>> order(_n);
+    for (unsigned int i=0; i<_n; ++i)
+    {
+        uint64_t code = 0;
+        for (int j=0; j<3; ++j)
+        {
+            Scalar t = (bb_size[j] > 0) ? (_queries[i][j]-bb_min[j])/bb_size[j] : 0;
+            code |= spread_bits(uint64_t(t*scale)) << j;
+        }
+        order[i] = std::make_pair(code, i);
+    }
+    std::sort(order.begin(), order.end());
+
+
+    // process chunks of consecutive queries in parallel
+    const int chunk_size = 256;
+    const int n_chunks = (_n + chunk_size - 1) / chunk_size;
+
+#pragma omp parallel for schedule(dynamic)
+    for (int c=0; c<n_chunks; ++c)
+    {
+        const unsigned int begin = c*chunk_size;
+        const unsigned int end = std::min(begin+chunk_size, _n);
+        int previous = -1;
+
+        for (unsigned int i=begin; i<end; ++i)
+        {
+            const unsigned int q = order[i].second;
+
+            NearestNeighborData data;
+            data.ref        = _queries[q];
+            data.dist       = FLT_MAX;
+            data.nearest    = -1;
+            data.leaf_tests = 0;
+
+            // previous answer is a close point, hence a tight upper bound
+            if (previous >= 0)
+            {
+                data.dist    = sqrnorm(points_[previous] - data.ref);
+                data.nearest = previous;
+            }
+
+            _nearest(data);
+            _indices[q] = previous = data.nearest;
+        }
+    }
+}
+
+
+//-----------------------------------------------------------------------------
+
+
+void
+kDTree::
+_nearest(NearestNeighborData& _data) const
+{
+    if (layout_ == Flat)
+    {
+        if (!nodes_.empty())
+            _nearest_flat(0, _data);
+    }
+    else if (root_)
+    {
+        _nearest(root_, _data);
+    }
+}
+
+
+//-----------------------------------------------------------------------------
+
+
 void
 kDTree::
 _nearest(Node* _node, NearestNeighborData& _data) const
@@ -173,4 +370,267 @@ _nearest(Node* _node, NearestNeighborData& _data) const
 }
 
 
-//=============================================================================
\ No newline at end of file
+//-----------------------------------------------------------------------------
+
+
+void
+kDTree::
+_nearest_flat(unsigned int _node, NearestNeighborData& _data) const
+{
+    const FlatNode& node = nodes_[_node];
+
+    if (!node.is_leaf())
+    {
+        Scalar off = _data.ref[node.cut_dim_] - node.cut_val_;
+
+        if (off > 0.0)
+        {
+            _nearest_flat(_node+1, _data);
+            if (off*off < _data.dist)
+            {
+                _nearest_flat(node.begin_, _data);
+            }
+        }
+        else
+        {
+            _nearest_flat(node.begin_, _data);
+            if (off*off < _data.dist)
+            {
+                _nearest_flat(_node+1, _data);
+            }
+        }
+    }
+
+    // terminal node: scan contiguous coordinate arrays (SIMD if available).
+    // points of the next leaf scanned in the last block are valid results.
+    else
+    {
+        ++_data.leaf_tests;
+        const unsigned int b = node.begin_;
+        int i = pmp::nearest_point(&xs_[b], &ys_[b], &zs_[b],
+                                   node.end_ - b, _data.ref, _data.dist);
+        if (i >= 0)
+            _data.nearest = indices_[b+i];
+    }
+}
+
+
+//-----------------------------------------------------------------------------
+
+
+/// Keeps the k closest points seen so far in a max-heap, such that the
+/// current k-th distance (the pruning bound) is always at the front.
+struct kDTree::KNearestQuery
+{
+    KNearestQuery(const Point& _ref, unsigned int _k, Neighbors& _heap)
+        : ref(_ref), k(_k), n(0), heap(_heap) {}
+
+    static bool closer(const Neighbor& _a, const Neighbor& _b)
+    {
+        return _a.dist < _b.dist;
+    }
+
+    Scalar bound() const { return (n < k) ? FLT_MAX : heap[0].dist; }
+
+    void test(Scalar _dist, int _idx)
+    {
+        if (n < k)
+        {
+            heap[n].idx  = _idx;
+            heap[n].dist = _dist;
+            std::push_heap(heap.begin(), heap.begin()+(++n), closer);
+        }
+        else if (_dist < heap[0].dist)
+        {
+            std::pop_heap(heap.begin(), heap.begin()+n, closer);
+            heap[n-1].idx  = _idx;
+            heap[n-1].dist = _dist;
+            std::push_heap(heap.begin(), heap.begin()+n, closer);
+        }
+    }
+
+    Point         ref;
+    unsigned int  k, n;
+    Neighbors&    heap;
+};
+
+
+/// Collects all points within a given (squared) distance.
+struct kDTree::RadiusQuery
+{
+    RadiusQuery(const Point& _ref, Scalar _sqr_radius, Neighbors& _result)
+        : ref(_ref), sqr_radius(_sqr_radius), result(_result) {}
+
+    Scalar bound() const { return sqr_radius; }
+
+    void test(Scalar _dist, int _idx)
+    {
+        if (_dist <= sqr_radius)
+        {
+            Neighbor neighbor;
+            neighbor.idx  = _idx;
+            neighbor.dist = _dist;
+            result.push_back(neighbor);
+        }
+    }
+
+    Point       ref;
+    Scalar      sqr_radius;
+    Neighbors&  result;
+};
+
+
+//-----------------------------------------------------------------------------
+
+
+unsigned int
+kDTree::
+knearest(const Point& _p, unsigned int _k, Neighbors& _neighbors) const
+{
+    // the buffer keeps its capacity, so this allocates only once
+    _neighbors.resize(_k);
+
+    KNearestQuery query(_p, _k, _neighbors);
+    if (_k > 0)
+    {
+        if (layout_ == Flat)
+        {
+            if (!nodes_.empty())
+                _search_flat(0, query);
+        }
+        else if (root_)
+        {
+            _search(root_, query);
+        }
+    }
+
+    // sort by increasing distance, dist was computed as sqr-dist
+    std::sort_heap(_neighbors.begin(), _neighbors.begin()+query.n,
+                   KNearestQuery::closer);
+    _neighbors.resize(query.n);
+    for (auto& neighbor : _neighbors)
+        neighbor.dist = sqrt(neighbor.dist);
+
+    return query.n;
+}
+
+
+//-----------------------------------------------------------------------------
+
+
+unsigned int
+kDTree::
+radius(const Point& _p, Scalar _r, Neighbors& _neighbors) const
+{
+    _neighbors.clear();
+
+    RadiusQuery query(_p, _r*_r, _neighbors);
+    if (layout_ == Flat)
+    {
+        if (!nodes_.empty())
+            _search_flat(0, query);
+    }
+    else if (root_)
+    {
+        _search(root_, query);
+    }
+
+    // dist was computed as sqr-dist
+    for (auto& neighbor : _neighbors)
+        neighbor.dist = sqrt(neighbor.dist);
+
+    return _neighbors.size();
+}
+
+
+//-----------------------------------------------------------------------------
+
+
+template <class Query>
+void
+kDTree::
+_search(Node* _node, Query& _query) const
+{
+    if (_node->left_child_)
+    {
+        int cd = _node->cut_dim_;
+        Scalar off = _query.ref[cd] - _node->cut_val_;
+
+        if (off > 0.0)
+        {
+            _search(_node->left_child_, _query);
+            if (off*off <= _query.bound())
+            {
+                _search(_node->right_child_, _query);
+            }
+        }
+        else
+        {
+            _search(_node->right_child_, _query);
+            if (off*off <= _query.bound())
+            {
+                _search(_node->left_child_, _query);
+            }
+        }
+    }
+
+    // terminal node
+    else
+    {
+        for (ElementIter it=_node->begin_; it!=_node->end_; ++it)
+            _query.test(sqrnorm(it->point - _query.ref), it->idx);
+    }
+}
+
+
+//-----------------------------------------------------------------------------
+
+
+template <class Query>
+void
+kDTree::
+_search_flat(unsigned int _node, Query& _query) const
+{
+    const FlatNode& node = nodes_[_node];
+
+    if (!node.is_leaf())
+    {
+        Scalar off = _query.ref[node.cut_dim_] - node.cut_val_;
+
+        if (off > 0.0)
+        {
+            _search_flat(_node+1, _query);
+            if (off*off <= _query.bound())
+            {
+                _search_flat(node.begin_, _query);
+            }
+        }
+        else
+        {
+            _search_flat(node.begin_, _query);
+            if (off*off <= _query.bound())
+            {
+                _search_flat(_node+1, _query);
+            }
+        }
+    }
+
+    // terminal node: scan contiguous coordinate arrays
+    else
+    {
+        const Scalar rx = _query.ref[0];
+        const Scalar ry = _query.ref[1];
+        const Scalar rz = _query.ref[2];
+
+        for (unsigned int i=node.begin_; i<node.end_; ++i)
+        {
+            const Scalar dx = xs_[i] - rx;
+            const Scalar dy = ys_[i] - ry;
+            const Scalar dz = zs_[i] - rz;
+            _query.test(dx*dx + dy*dy + dz*dz, indices_[i]);
+        }
+    }
+}
+
+
+//=============================================================================
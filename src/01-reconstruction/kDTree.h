@@ -23,6 +23,13 @@ public:
 
     //-------------------------------------------------------------- public types
 
+    /// memory layout of the tree
+    enum Layout
+    {
+        Linked, ///< every node allocated separately, children linked by pointers
+        Flat    ///< all nodes in one array, leaves store point ranges as SoA
+    };
+
     typedef std::vector<Point>      Points;
     typedef Points::const_iterator  ConstPointIter;
 
@@ -68,6 +75,19 @@ public:
     };
 
 
+    /// A neighbor found by knearest() or radius()
+    struct Neighbor
+    {
+        // index of the point
+        int     idx;
+
+        // distance to the reference point
+        Scalar  dist;
+    };
+
+    typedef std::vector<Neighbor> Neighbors;
+
+
     /// Node of the tree: contains parent, children and splitting plane
     struct Node
     {
@@ -87,24 +107,74 @@ public:
     };
 
 
+    /** Node of the flat tree. Nodes are stored in depth-first order, hence
+        the left child of an inner node is the next node in the array and
+        only the right child has to be stored. A leaf refers to the range
+        [begin_, end_) of the (reordered) point arrays. */
+    struct FlatNode
+    {
+        bool is_leaf() const { return cut_dim_ == 3; }
+
+        Scalar        cut_val_;
+        unsigned int  cut_dim_;  // splitting axis, 3 for leaves
+        unsigned int  begin_;    // leaf: first point, inner node: right child
+        unsigned int  end_;      // leaf: one past the last point
+    };
+
+
 
 public:
 
     //----------------------------------------------------------- public methods
 
-    /** Constructor: need traits that define the types and
-        give us the points by traits_.point(PointHandle) */
-    kDTree(const Points& _points) : points_(_points), root_(0) {}
+    /** Constructor: store a reference to the points. The tree is stored
+        with the given memory \c _layout once build() is called. */
+    kDTree(const Points& _points, Layout _layout = Flat)
+        : points_(_points.data()), n_points_(_points.size()),
+          layout_(_layout), root_(0), n_nodes_(0) {}
+
+    /** Constructor: store a pointer to the \c _n points \c _points, e.g.,
+        read-only data of a memory-mapped file. */
+    kDTree(const Point* _points, unsigned int _n, Layout _layout = Flat)
+        : points_(_points), n_points_(_n),
+          layout_(_layout), root_(0), n_nodes_(0) {}
 
     /// Destructor
     ~kDTree() { delete root_; }
 
-    /// Build the tree. Returns number of nodes.
+    /** Build the tree. Returns number of nodes. With the flat layout, leaves
+        are scanned with SIMD kernels (see pmp::distance_kernel_width()), so
+        \c _max_handles should be a small multiple of the vector width
+        (e.g. 16 or 32). */
     unsigned int build(unsigned int _max_handles=100, unsigned int _max_depth=50);
 
     /// Return handle of the nearest neighbor
     NearestNeighborData nearest(const Point& _p) const;
 
+    /** Find the nearest neighbors of the \c _n points \c _queries and
+        store their indices in \c _indices. Queries are processed in Morton
+        order, such that consecutive queries visit similar parts of the tree
+        and can use the previous answer as initial upper bound. The batch is
+        distributed over all threads if OpenMP is available. */
+    void nearest(const Point* _queries, unsigned int _n, int* _indices) const;
+
+    /** Find the \c _k nearest neighbors of \c _p and store them in
+        \c _neighbors, sorted by increasing distance. The buffer is used as
+        a bounded max-heap during the search; reusing it for several queries
+        avoids any memory allocation. Returns the number of neighbors found,
+        which is less than \c _k only if the tree has less points. */
+    unsigned int knearest(const Point& _p, unsigned int _k,
+                          Neighbors& _neighbors) const;
+
+    /** Find all points within distance \c _r of \c _p and store them
+        (unsorted) in \c _neighbors. Reusing the buffer for several queries
+        avoids memory allocation. Returns the number of neighbors found. */
+    unsigned int radius(const Point& _p, Scalar _r,
+                        Neighbors& _neighbors) const;
+
+    /// Return the memory layout of the tree
+    Layout layout() const { return layout_; }
+
 private:
 
     //----------------------------------------------------------- private methods
@@ -114,15 +184,52 @@ private:
                 unsigned int _max_handles,
                 unsigned int _depth);
 
+    /// Start search for nearest neighbor from the root, \c _data has to be
+    /// initialized with the reference point and an upper bound
+    void _nearest(NearestNeighborData& _data) const;
+
     /// Recursive part of nearest()
     void _nearest(Node* _node, NearestNeighborData& _data) const;
 
+    /// Search state of knearest() (bounded max-heap)
+    struct KNearestQuery;
+
+    /// Search state of radius()
+    struct RadiusQuery;
+
+    /// Recursive part of knearest() and radius()
+    template <class Query>
+    void _search(Node* _node, Query& _query) const;
+
+    /// Recursive part of knearest() and radius() for the flat layout
+    template <class Query>
+    void _search_flat(unsigned int _node, Query& _query) const;
+
+    /// Recursive part of build() for the flat layout, returns node index
+    unsigned int _build_flat(unsigned int _begin,
+                             unsigned int _end,
+                             unsigned int _max_handles,
+                             unsigned int _depth);
+
+    /// Recursive part of nearest() for the flat layout
+    void _nearest_flat(unsigned int _node, NearestNeighborData& _data) const;
+
 
     //-------------------------------------------------------------- private data
 
-    const Points&  points_;
+    const Point*   points_;
+    unsigned int   n_points_;
+    Layout         layout_;
+
+    // linked layout
     Elements       elements_;
     Node           *root_;
+
+    // flat layout: nodes, point coordinates in leaf order, original indices
+    std::vector<FlatNode>  nodes_;
+    std::vector<Scalar>    xs_, ys_, zs_;
+    std::vector<int>       indices_;
+
     unsigned int   n_nodes_;
 };
 
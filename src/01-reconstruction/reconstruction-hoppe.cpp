@@ -9,6 +9,7 @@
 
 #include "reconstruction.h"
 #include "Grid.h"
+#include "SparseGrid.h"
 #include "MarchingCubes.h"
 #include "kDTree.h"
 #include <pmp/Timer.h>
@@ -21,10 +22,75 @@ using namespace pmp;
 void reconstruct_hoppe(const PointSet &pointset,
                        pmp::SurfaceMesh &mesh,
                        unsigned int resolution,
-                       unsigned int nneighbors)
+                       unsigned int nneighbors,
+                       bool narrow_band)
+{
+    reconstruct_hoppe(pointset.view(), mesh, resolution, nneighbors,
+                      narrow_band);
+}
+
+//-----------------------------------------------------------------------------
+
+namespace {
+
+/// signed distances of the \c n points \c queries to the tangent plane of
+/// their closest point, or averaged over their \c nneighbors closest points
+void signed_distances(const kDTree &kd_tree, const PointCloudView &pointset,
+                      unsigned int nneighbors, const std::vector<Point> &queries,
+                      std::vector<int> &closest, std::vector<float> &values)
+{
+    const auto& points  = pointset.points;
+    const auto& normals = pointset.normals;
+    const int n = queries.size();
+    values.resize(n);
+
+    // signed distance of grid node q w.r.t. tangent plane of point i
+    auto distance = [&](const Point& q, int i)
+    {
+        return dot(q - points[i], normals[i]);
+    };
+
+    // closest point only
+    if (nneighbors <= 1)
+    {
+        closest.resize(n);
+        kd_tree.nearest(queries.data(), n, closest.data());
+        for (int i = 0; i < n; ++i)
+            values[i] = distance(queries[i], closest[i]);
+    }
+
+    // average over k closest points
+    else
+    {
+#pragma omp parallel
+        {
+            kDTree::Neighbors neighbors;
+
+#pragma omp for schedule(dynamic, 256)
+            for (int i = 0; i < n; ++i)
+            {
+                unsigned int k = kd_tree.knearest(queries[i], nneighbors, neighbors);
+                Scalar d = 0;
+                for (unsigned int j = 0; j < k; ++j)
+                    d += distance(queries[i], neighbors[j].idx);
+                values[i] = d / k;
+            }
+        }
+    }
+}
+
+}
+
+//-----------------------------------------------------------------------------
+
+void reconstruct_hoppe(const PointCloudView &pointset,
+                       pmp::SurfaceMesh &mesh,
+                       unsigned int resolution,
+                       unsigned int nneighbors,
+                       bool narrow_band)
 {
     // we need some points...
-    if (pointset.points_.empty())
+    if (pointset.empty())
     {
         return;
     }
@@ -49,21 +115,109 @@ void reconstruct_hoppe(const PointSet &pointset,
     int res_z = std::max(2, (int)(bb_diag[2] / grid_spacing));
 
 
-    // setup grid for storing distance values
-    Grid grid(bb_min,
-              Point(bb_max[0] - bb_min[0], 0, 0),
-              Point(0, bb_max[1] - bb_min[1], 0),
-              Point(0, 0, bb_max[2] - bb_min[2]), 
-              res_x, res_y, res_z);
-
-    /**
-     * @todo Compite SDF for each grid node, extract mesh with marching cubes
-     * - Grid has resolution `(res_x, res_y, res_)`
-     * - Get the position of grid point with index (i,j,k) by `grid.point(i,j,k).
-     * - Get positions and normals of pointset with `pointset.points_[i]` and `pointset.normals_[i]`.
-     * - Store signed distance in `grid(i,j,k)`.
-     * - Extract mesh with `marching_cubes(grid, mesh)`
-     */
+    // build kD-tree for closest point queries
+    kDTree kd_tree(pointset.points.data(), pointset.points.size());
+    kd_tree.build(16);
+
+    std::vector<Point> queries;
+    std::vector<int>   closest;
+    std::vector<float> values;
+
+
+    // narrow band: only bricks with points and their neighbors are
+    // allocated, which keeps grid cells within at least one brick of the
+    // points. the surface is not extended across larger holes.
+    if (narrow_band)
+    {
+        SparseGrid grid(bb_min,
+                        Point(bb_max[0] - bb_min[0], 0, 0),
+                        Point(0, bb_max[1] - bb_min[1], 0),
+                        Point(0, 0, bb_max[2] - bb_min[2]),
+                        res_x, res_y, res_z, FLT_MAX);
+
+        const int res[3] = { res_x, res_y, res_z };
+        const int b = SparseGrid::brick_size;
+        for (const auto& p : pointset.points)
+        {
+            // range of bricks around the brick containing p
+            int lo[3], hi[3];
+            for (int k = 0; k < 3; ++k)
+            {
+                Scalar t = (p[k] - bb_min[k]) / (bb_max[k] - bb_min[k]);
+                int i = std::min(std::max(int(t * (res[k]-1)), 0), res[k]-1);
+                lo[k] = std::max(i/b - 1, 0);
+                hi[k] = std::min(i/b + 1, (res[k]-1)/b);
+            }
+            for (int x = lo[0]; x <= hi[0]; ++x)
+                for (int y = lo[1]; y <= hi[1]; ++y)
+                    for (int z = lo[2]; z <= hi[2]; ++z)
+                        grid.allocate(x*b, y*b, z*b);
+        }
+
+        // evaluate the allocated bricks in batches of about one x-slice
+        const std::vector<ivec3> bricks = grid.allocated_bricks();
+        const size_t batch = std::max(1, res_y * res_z / (b*b*b));
+        std::vector<float*> targets;
+        for (size_t begin = 0; begin < bricks.size(); begin += batch)
+        {
+            queries.clear();
+            targets.clear();
+            for (size_t i = begin; i < std::min(begin + batch, bricks.size()); ++i)
+            {
+                const ivec3& o = bricks[i];
+                for (int x = o[0]; x < std::min(o[0]+b, res_x); ++x)
+                    for (int y = o[1]; y < std::min(o[1]+b, res_y); ++y)
+                        for (int z = o[2]; z < std::min(o[2]+b, res_z); ++z)
+                        {
+                            queries.push_back(grid.point(x, y, z));
+                            targets.push_back(grid.find(x, y, z));
+                        }
+            }
+
+            signed_distances(kd_tree, pointset, nneighbors, queries, closest,
+                             values);
+            for (size_t i = 0; i < targets.size(); ++i)
+                *targets[i] = values[i];
+        }
+
+        std::cout << grid.n_allocated_bricks() << " of " << grid.n_bricks()
+                  << " bricks, " << grid.memory_usage() / 1024.0 / 1024.0
+                  << " MB (dense grid: "
+                  << grid.dense_memory_usage() / 1024.0 / 1024.0 << " MB)\n";
+
+        // extract zero level set
+        marching_cubes(grid, mesh);
+    }
+
+
+    // dense grid: compute SDF one x-slice at a time, queries within a slice
+    // are batched
+    else
+    {
+        Grid grid(bb_min,
+                  Point(bb_max[0] - bb_min[0], 0, 0),
+                  Point(0, bb_max[1] - bb_min[1], 0),
+                  Point(0, 0, bb_max[2] - bb_min[2]),
+                  res_x, res_y, res_z);
+
+        queries.resize(res_y * res_z);
+        for (int x = 0; x < res_x; ++x)
+        {
+            for (int y = 0; y < res_y; ++y)
+                for (int z = 0; z < res_z; ++z)
+                    queries[y * res_z + z] = grid.point(x, y, z);
+
+            signed_distances(kd_tree, pointset, nneighbors, queries, closest,
+                             values);
+
+            for (int y = 0; y < res_y; ++y)
+                for (int z = 0; z < res_z; ++z)
+                    grid(x, y, z) = values[y * res_z + z];
+        }
+
+        // extract zero level set
+        marching_cubes(grid, mesh);
+    }
 
 
     // print timing
@@ -9,73 +9,318 @@
 
 #include "reconstruction.h"
 #include <poisson/poisson.h>
+#include <algorithm>
+#include <cstdio>
 
 using namespace pmp;
 
 //=============================================================================
 
-void reconstruct_poisson(const PointSet &pointset,
-                         SurfaceMesh &mesh,
-                         int depth,
-                         int solver_divide,
-                         float point_weight)
+namespace {
+
+/** CoredMeshData sink that collects the extracted iso-surface as flat
+    arrays for SurfaceMesh::build(). Out-of-core points (the bulk of the
+    vertices) are stored as soon as the octree extractor emits them,
+    polygons are kept as flat index arrays until the in-core points (shared
+    between subtrees) are complete. finish() appends the in-core points and
+    builds the mesh in one go. This avoids the intermediate per-polygon
+    vectors of CoredPoissonVectorMeshData and a second copy of the points.
+
+    The extractor calls addOutOfCorePoint() and addPolygon() inside (two
+    different) critical sections, which touch disjoint data here.
+*/
+class SurfaceMeshSink : public CoredMeshData<PlyVertex<float>>
 {
-    // store points and normals in two arrays
-    const unsigned int N = pointset.points_.size();
-    std::vector<Point3D<float>> points(N), normals(N);
-    for (unsigned int i = 0; i < N; i++)
+public:
+    typedef PlyVertex<float> PlyV;
+
+    SurfaceMeshSink(SurfaceMesh& _mesh)
+        : mesh_(_mesh), n_ooc_points_(0), polygon_index_(0), index_(0),
+          ooc_point_index_(0)
     {
-        points[i].coords[0] = pointset.points_[i][0];
-        points[i].coords[1] = pointset.points_[i][1];
-        points[i].coords[2] = pointset.points_[i][2];
-        normals[i].coords[0] = pointset.normals_[i][0];
-        normals[i].coords[1] = pointset.normals_[i][1];
-        normals[i].coords[2] = pointset.normals_[i][2];
+        mesh_.clear();
     }
 
-    // perform Poisson reconstruction
-    CoredPoissonVectorMeshData<PlyVertex<float>> reconstructed_mesh;
-    Execute2(points, normals, reconstructed_mesh, depth, solver_divide,
-             point_weight);
+    int addOutOfCorePoint(const PlyV& _p) override
+    {
+        points_.push_back(vec3(_p.point[0], _p.point[1], _p.point[2]));
+        return n_ooc_points_++;
+    }
 
-    // initialize
-    mesh.clear();
-    reconstructed_mesh.resetIterator();
+    int addPolygon(const std::vector<CoredVertexIndex>& _vertices) override
+    {
+        // in-core points as idx >= 0, out-of-core points as -idx-1
+        for (const auto& v : _vertices)
+            indices_.push_back(v.inCore ? v.idx : -v.idx - 1);
+        sizes_.push_back((unsigned short)_vertices.size());
+        return int(sizes_.size()) - 1;
+    }
 
-    // add vertices to mesh
-    PlyVertex<float> p;
-    for (int i(0); i < (int)reconstructed_mesh.inCorePoints.size(); i++)
+    void resetIterator() override
+    {
+        polygon_index_ = index_ = ooc_point_index_ = 0;
+    }
+
+    int nextOutOfCorePoint(PlyV& _p) override
     {
-        p = reconstructed_mesh.inCorePoints[i];
-        mesh.add_vertex(
-            vec3(p.point.coords[0], p.point.coords[1], p.point.coords[2]));
+        if (ooc_point_index_ >= n_ooc_points_) return 0;
+        const Point& p = points_[ooc_point_index_++];
+        _p = PlyV(Point3D<float>(p[0], p[1], p[2]));
+        return 1;
     }
-    for (int i(0); i < reconstructed_mesh.outOfCorePointCount(); i++)
+
+    int nextPolygon(std::vector<CoredVertexIndex>& _vertices) override
     {
-        reconstructed_mesh.nextOutOfCorePoint(p);
-        mesh.add_vertex(
-            vec3(p.point.coords[0], p.point.coords[1], p.point.coords[2]));
+        if (polygon_index_ >= sizes_.size()) return 0;
+        _vertices.resize(sizes_[polygon_index_++]);
+        for (auto& v : _vertices)
+        {
+            const int i = indices_[index_++];
+            v.inCore = (i >= 0);
+            v.idx = v.inCore ? i : -i - 1;
+        }
+        return 1;
     }
 
-    // add faces to mesh
-    std::vector<CoredVertexIndex> polygon;
-    std::vector<Vertex> vertices;
-    for (int i(0); i < reconstructed_mesh.polygonCount(); i++)
+    int outOfCorePointCount() override { return n_ooc_points_; }
+
+    int polygonCount() override { return int(sizes_.size()); }
+
+    /// append in-core points, build the mesh, release the buffers
+    void finish()
     {
-        reconstructed_mesh.nextPolygon(polygon);
-        vertices.resize(polygon.size());
+        points_.reserve(n_ooc_points_ + inCorePoints.size());
+        for (const auto& p : inCorePoints)
+            points_.push_back(vec3(p.point[0], p.point[1], p.point[2]));
+        std::vector<PlyV>().swap(inCorePoints);
 
-        for (unsigned int j = 0; j < polygon.size(); ++j)
+        std::vector<IndexType> indices(indices_.size());
+        for (size_t k = 0; k < indices.size(); ++k)
         {
-            if (polygon[j].inCore)
-                vertices[j] = Vertex(polygon[j].idx);
-            else
-                vertices[j] =
-                    Vertex(polygon[j].idx +
-                           int(reconstructed_mesh.inCorePoints.size()));
+            const int i = indices_[k];
+            indices[k] = (i >= 0) ? n_ooc_points_ + i : -i - 1;
         }
-        mesh.add_face(vertices);
+        std::vector<int>().swap(indices_);
+
+        // valences are only needed for polygons other than triangles
+        std::vector<IndexType> valences;
+        if (std::any_of(sizes_.begin(), sizes_.end(),
+                        [](unsigned short n) { return n != 3; }))
+            valences.assign(sizes_.begin(), sizes_.end());
+        std::vector<unsigned short>().swap(sizes_);
+
+        mesh_.build(std::move(points_), indices, valences);
+    }
+
+private:
+    SurfaceMesh&                 mesh_;
+    std::vector<Point>           points_;
+    int                          n_ooc_points_;
+    std::vector<int>             indices_;
+    std::vector<unsigned short>  sizes_;
+    size_t                       polygon_index_, index_;
+    int                          ooc_point_index_;
+};
+
+
+//-----------------------------------------------------------------------------
+
+
+/// write cored mesh data as binary little-endian PLY file (in-core points
+/// first, then out-of-core points, as the polygon indices expect)
+bool write_ply(CoredMeshData<PlyVertex<float>>& _mesh, const char* _filename)
+{
+    FILE* out = fopen(_filename, "wb");
+    if (!out) return false;
+
+    const int n_in_core = int(_mesh.inCorePoints.size());
+    const int n_vertices = n_in_core + _mesh.outOfCorePointCount();
+    fprintf(out,
+            "ply\nformat binary_little_endian 1.0\n"
+            "element vertex %d\n"
+            "property float x\nproperty float y\nproperty float z\n"
+            "element face %d\n"
+            "property list uchar int vertex_indices\n"
+            "end_header\n",
+            n_vertices, _mesh.polygonCount());
+
+    _mesh.resetIterator();
+    bool ok = true;
+
+    PlyVertex<float> p;
+    for (const auto& q : _mesh.inCorePoints)
+        ok = ok && fwrite(q.point.coords, sizeof(float), 3, out) == 3;
+    while (ok && _mesh.nextOutOfCorePoint(p))
+        ok = fwrite(p.point.coords, sizeof(float), 3, out) == 3;
+
+    std::vector<CoredVertexIndex> polygon;
+    std::vector<int> indices;
+    while (ok && _mesh.nextPolygon(polygon))
+    {
+        const unsigned char n = (unsigned char)polygon.size();
+        indices.resize(n);
+        for (unsigned char j = 0; j < n; ++j)
+            indices[j] = polygon[j].inCore ? polygon[j].idx
+                                           : polygon[j].idx + n_in_core;
+        ok = fwrite(&n, 1, 1, out) == 1 &&
+             fwrite(indices.data(), sizeof(int), n, out) == n;
+    }
+
+    return (fclose(out) == 0) && ok;
+}
+
+} // namespace
+
+//=============================================================================
+
+void reconstruct_poisson(const PointSet &pointset,
+                         SurfaceMesh &mesh,
+                         int depth,
+                         int solver_divide,
+                         float point_weight,
+                         unsigned int threads)
+{
+    reconstruct_poisson(pointset.view(), mesh, depth, solver_divide,
+                        point_weight, threads);
+}
+
+//-----------------------------------------------------------------------------
+
+void reconstruct_poisson(const PointCloudView &pointset,
+                         SurfaceMesh &mesh,
+                         int depth,
+                         int solver_divide,
+                         float point_weight,
+                         unsigned int threads)
+{
+    // perform Poisson reconstruction, reading points and normals in place
+    // and streaming the iso-surface into the mesh
+    PoissonField field;
+    if (field.solve(pointset, depth, solver_divide, point_weight, threads))
+        field.extract(mesh);
+    else
+        mesh.clear();
+}
+
+//-----------------------------------------------------------------------------
+
+bool reconstruct_poisson(const PointCloudView &pointset,
+                         const char *filename,
+                         int depth,
+                         int solver_divide,
+                         float point_weight,
+                         unsigned int threads)
+{
+    // out-of-core points and polygons go to temporary files, which are
+    // then copied to the PLY file
+    CoredFileMeshData<PlyVertex<float>> reconstructed_mesh;
+    Execute2(pointset.points.data(), pointset.normals.data(), pointset.size(),
+             reconstructed_mesh, depth, solver_divide, point_weight, 1.0f, 1.0f,
+             threads);
+
+    return write_ply(reconstructed_mesh, filename);
+}
+
+//=============================================================================
+
+PoissonField::PoissonField() : iso_value_(0) {}
+
+PoissonField::~PoissonField() = default;
+
+//-----------------------------------------------------------------------------
+
+bool PoissonField::solve(const PointCloudView &points,
+                         int depth,
+                         int solver_divide,
+                         float point_weight,
+                         unsigned int threads)
+{
+    tree_ = std::make_unique<Octree<2, false>>();
+    if (!PoissonSolve(*tree_, points.points.data(), points.normals.data(),
+                      points.size(), depth, solver_divide, point_weight, 1.0f,
+                      threads))
+    {
+        clear();
+        return false;
+    }
+
+    // the extraction refines the tree, so compute the iso-value right away
+    iso_value_ = tree_->GetIsoValue();
+    return true;
+}
+
+//-----------------------------------------------------------------------------
+
+void PoissonField::extract(SurfaceMesh &mesh,
+                           float offset,
+                           int iso_divide,
+                           bool manifold,
+                           bool polygon_mesh)
+{
+    if (!tree_)
+    {
+        mesh.clear();
+        return;
+    }
+
+    SurfaceMeshSink sink(mesh);
+    PoissonExtract(*tree_, iso_value_ * offset, sink, iso_divide, manifold,
+                   polygon_mesh);
+    sink.finish();
+}
+
+//-----------------------------------------------------------------------------
+
+bool PoissonField::write(const char *filename) const
+{
+    if (!tree_) return false;
+
+    FILE* out = fopen(filename, "wb");
+    if (!out) return false;
+    const bool ok = tree_->write(out) != 0;
+    return (fclose(out) == 0) && ok;
+}
+
+//-----------------------------------------------------------------------------
+
+bool PoissonField::read(const char *filename, unsigned int threads)
+{
+    clear();
+
+    FILE* in = fopen(filename, "rb");
+    if (!in) return false;
+
+    tree_ = std::make_unique<Octree<2, false>>();
+#ifdef _OPENMP
+    tree_->threads = threads > 0 ? int(threads) : omp_get_max_threads();
+#else
+    (void)threads;
+#endif
+    const bool ok = tree_->read(in) != 0;
+    fclose(in);
+    if (!ok)
+    {
+        clear();
+        return false;
     }
+
+    iso_value_ = tree_->GetIsoValue();
+    return true;
+}
+
+//-----------------------------------------------------------------------------
+
+void PoissonField::clear()
+{
+    tree_.reset();
+    iso_value_ = 0;
+}
+
+//-----------------------------------------------------------------------------
+
+int PoissonField::depth() const
+{
+    return tree_ ? tree_->fData.depth : 0;
 }
 
 //=============================================================================
@@ -11,20 +11,110 @@
 
 #include <pmp/SurfaceMesh.h>
 #include "PointSet.h"
+#include "PointCloudView.h"
+#include <memory>
+
+template <int Degree, bool OutputDensity> class Octree;
 
 //=============================================================================
 
-//! reconstruct mesh using Poisson surface reconstruction
+//! reconstruct mesh using Poisson surface reconstruction with the given
+//! number of threads (0: all available, see omp_get_max_threads())
 void reconstruct_poisson(const PointSet &pointset,
                          pmp::SurfaceMesh &mesh,
                          int depth,
                          int solver_divide,
-                         float point_weight);
+                         float point_weight,
+                         unsigned int threads = 0);
 
-//! reconstruct mesh using Hoppe's approach
+//! reconstruct mesh using Hoppe's approach. narrow_band evaluates the
+//! distance field only in a band around the points (see SparseGrid)
+//! instead of the whole grid.
 void reconstruct_hoppe(const PointSet &pointset,
                        pmp::SurfaceMesh &mesh,
                        unsigned int resolution,
-                       unsigned int nneighbors = 1);
+                       unsigned int nneighbors = 1,
+                       bool narrow_band = false);
+
+//! reconstruct mesh using Poisson surface reconstruction from read-only
+//! point and normal arrays, e.g., of a MappedPointSet
+void reconstruct_poisson(const PointCloudView &points,
+                         pmp::SurfaceMesh &mesh,
+                         int depth,
+                         int solver_divide,
+                         float point_weight,
+                         unsigned int threads = 0);
+
+//! reconstruct mesh using Poisson surface reconstruction and write it as
+//! binary PLY file without building a SurfaceMesh; the extracted vertices
+//! and polygons are buffered in temporary files. returns false if the file
+//! cannot be written.
+bool reconstruct_poisson(const PointCloudView &points,
+                         const char *filename,
+                         int depth,
+                         int solver_divide,
+                         float point_weight,
+                         unsigned int threads = 0);
+
+//! Poisson surface reconstruction split into solving for the indicator
+//! function and extracting its iso-surface. The solved octree is kept, such
+//! that the surface can be extracted again with another iso-value offset or
+//! other extraction options, or from a field written to disk before, without
+//! solving again.
+class PoissonField
+{
+public:
+    PoissonField();
+    ~PoissonField();
+
+    //! build the octree of the points and solve for the indicator function
+    //! with the given number of threads (0: all available), replacing the
+    //! previous field. returns false on failure.
+    bool solve(const PointCloudView &points,
+               int depth,
+               int solver_divide,
+               float point_weight,
+               unsigned int threads = 0);
+
+    //! extract the iso-surface at the average of the function at the points
+    //! scaled by offset. iso_divide is the depth of the subtrees extracted
+    //! in parallel, manifold adds a vertex to polygons that would make the
+    //! mesh non-manifold, polygon_mesh keeps polygons instead of triangles.
+    //! the mesh is cleared if there is no field.
+    void extract(pmp::SurfaceMesh &mesh,
+                 float offset = 1.0f,
+                 int iso_divide = 8,
+                 bool manifold = true,
+                 bool polygon_mesh = false);
+
+    //! write the solved field as binary file. returns false on failure.
+    bool write(const char *filename) const;
+
+    //! read a field written by write(), extracting it with the given number
+    //! of threads (0: all available). returns false on failure, the field is
+    //! empty then.
+    bool read(const char *filename, unsigned int threads = 0);
+
+    //! release the field
+    void clear();
+
+    //! is there a field to extract?
+    bool empty() const { return !tree_; }
+
+    //! octree depth of the field (0 if empty)
+    int depth() const;
+
+private:
+    std::unique_ptr<Octree<2, false>> tree_;
+    float iso_value_;
+};
+
+//! reconstruct mesh using Hoppe's approach from read-only point and normal
+//! arrays, e.g., of a MappedPointSet
+void reconstruct_hoppe(const PointCloudView &points,
+                       pmp::SurfaceMesh &mesh,
+                       unsigned int resolution,
+                       unsigned int nneighbors = 1,
+                       bool narrow_band = false);
 
 //=============================================================================
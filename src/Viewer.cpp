@@ -10,8 +10,13 @@
 #include <Viewer.h>
 #include <01-reconstruction/reconstruction.h>
 #include <pmp/algorithms/SurfaceNormals.h>
+#include <pmp/algorithms/SurfaceSimplification.h>
 #include <imgui.h>
 #include <fstream>
+#include <algorithm>
+#ifdef _OPENMP
+#include <omp.h>
+#endif
 
 //=============================================================================
 
@@ -26,6 +31,17 @@ std::vector<std::string> meshes = {
     "bunny.off", "boar.off", "blubb.off", "dragon.off", "spot.off",
     "max.off", "open_bunny.off", "hemisphere.off", "sphere.off" };
 
+// file for the solved Poisson field of an input file: same name, extension
+// .field (e.g. bunny.pts -> bunny.field)
+std::string field_filename(const std::string &_filename)
+{
+    std::string::size_type dot = _filename.rfind('.');
+    std::string::size_type slash = _filename.find_last_of("/\\");
+    if (dot == std::string::npos || (slash != std::string::npos && dot < slash))
+        return _filename + ".field";
+    return _filename.substr(0, dot) + ".field";
+}
+
 //=============================================================================
 
 Viewer::Viewer(const char *title, int width, int height)
@@ -81,6 +97,7 @@ bool Viewer::load_data(const char *_filename)
 
     bool ok;
     mesh_.clear();
+    poisson_field_.clear();
 
     // load as pointset
     ok = pointset_.read_data(_filename);
@@ -183,7 +200,7 @@ void Viewer::process_imgui()
         ImGui::PopItemWidth();
 
         // output point statistics
-        ImGui::BulletText("%d points", (int)pointset_.points_.size());
+        ImGui::BulletText("%d points", (int)pointset_.n_vertices());
         ImGui::Unindent(10);
 
         ImGui::Spacing();
@@ -231,7 +248,7 @@ void Viewer::process_imgui()
         ImGui::Text("Point Cloud");
         ImGui::Spacing();
 
-        if (!pointset_.points_.empty())
+        if (!pointset_.is_empty())
         {
             ImGui::Indent(10);
             ImGui::Checkbox("Draw point cloud", &draw_pointset_);
@@ -293,19 +310,24 @@ void Viewer::process_imgui()
 
     if (ImGui::CollapsingHeader("Surface Reconstruction"))
     {
-        if (!pointset_.points_.empty())
+        if (!pointset_.is_empty())
         {
             // Hoppe parameters
             static int hoppe_resolution = 50;
             static int hoppe_nneighbors = 1;
+            static bool hoppe_narrow_band = false;
             ImGui::PushItemWidth(100);
             ImGui::Text("Grid resolution");
             ImGui::SliderInt("##MC Resolution", &hoppe_resolution, 10, 200);
+            ImGui::Text("Neighbors");
+            ImGui::SliderInt("##Hoppe Neighbors", &hoppe_nneighbors, 1, 10);
             ImGui::PopItemWidth();
+            ImGui::Checkbox("Narrow band", &hoppe_narrow_band);
 
             if (ImGui::Button("Hoppe reconstruction"))
             {
-                reconstruct_hoppe(pointset_, mesh_, hoppe_resolution, hoppe_nneighbors);
+                reconstruct_hoppe(pointset_, mesh_, hoppe_resolution,
+                                  hoppe_nneighbors, hoppe_narrow_band);
                 update_mesh();
                 draw_pointset_ = false;
             }
@@ -321,12 +343,82 @@ void Viewer::process_imgui()
             ImGui::SliderInt("##Poisson OD", &octree_depth, 5, 10);
             ImGui::PopItemWidth();
 
+            // number of threads for tree setup, solver, and extraction
+#ifdef _OPENMP
+            static int poisson_threads = omp_get_max_threads();
+            const int max_threads = std::max(omp_get_num_procs(), omp_get_max_threads());
+            ImGui::PushItemWidth(100);
+            ImGui::Text("Threads");
+            ImGui::SliderInt("##Poisson threads", &poisson_threads, 1, max_threads);
+            ImGui::PopItemWidth();
+#else
+            const int poisson_threads = 1;
+#endif
+
+            // iso-surface options, applied to the solved field by "Extract"
+            static float iso_offset = 1.0f;
+            static int iso_divide = 8;
+            static bool manifold = true;
+            static bool polygon_mesh = false;
+
             if (ImGui::Button("Poisson reconstruction"))
             {
-                reconstruct_poisson(pointset_, mesh_, octree_depth, 8, 2.0);
+                poisson_field_.solve(pointset_.view(), octree_depth, 8, 2.0,
+                                     poisson_threads);
+                poisson_field_.extract(mesh_, iso_offset, iso_divide, manifold,
+                                       polygon_mesh);
                 update_mesh();
                 draw_pointset_ = false;
             }
+
+            if (!poisson_field_.empty())
+            {
+                ImGui::Spacing();
+                ImGui::Text("Iso-surface (depth %d field)",
+                            poisson_field_.depth());
+                ImGui::PushItemWidth(100);
+                ImGui::Text("Iso-value offset");
+                ImGui::SliderFloat("##Poisson offset", &iso_offset, 0.8f, 1.2f);
+                ImGui::Text("Subtree depth");
+                ImGui::SliderInt("##Poisson iso divide", &iso_divide, 5, 10);
+                ImGui::PopItemWidth();
+                ImGui::Checkbox("Manifold", &manifold);
+                ImGui::Checkbox("Polygons", &polygon_mesh);
+
+                if (ImGui::Button("Extract"))
+                {
+                    poisson_field_.extract(mesh_, iso_offset, iso_divide,
+                                           manifold, polygon_mesh);
+                    update_mesh();
+                    draw_pointset_ = false;
+                }
+            }
+
+#ifndef __EMSCRIPTEN__
+            // save the solved field next to the input file, or extract one
+            // saved there before
+            const std::string field_file = field_filename(filename_);
+            if (!poisson_field_.empty() && ImGui::Button("Write field"))
+            {
+                if (!poisson_field_.write(field_file.c_str()))
+                    std::cerr << "cannot write " << field_file << std::endl;
+            }
+
+            if (ImGui::Button("Read field"))
+            {
+                if (poisson_field_.read(field_file.c_str(), poisson_threads))
+                {
+                    poisson_field_.extract(mesh_, iso_offset, iso_divide,
+                                           manifold, polygon_mesh);
+                    update_mesh();
+                    draw_pointset_ = false;
+                }
+                else
+                {
+                    std::cerr << "cannot read " << field_file << std::endl;
+                }
+            }
+#endif
         }
         else
         {
@@ -334,6 +426,37 @@ void Viewer::process_imgui()
         }
     }
 
+    ImGui::Spacing();
+    ImGui::Spacing();
+
+    if (ImGui::CollapsingHeader("Decimation"))
+    {
+        if (mesh_.n_faces() > 0 && mesh_.is_triangle_mesh())
+        {
+            static int face_percentage = 10;
+            ImGui::PushItemWidth(100);
+            ImGui::Text("Target faces (%%)");
+            ImGui::SliderInt("##Decimation faces", &face_percentage, 1, 99);
+            ImGui::PopItemWidth();
+
+            if (ImGui::Button("Decimate"))
+            {
+                SurfaceSimplification simplification(mesh_);
+                simplification.simplify(mesh_.n_faces() * face_percentage / 100);
+                const auto& stats = simplification.statistics();
+                std::cout << "Decimation: " << mesh_.n_faces() << " faces, "
+                          << stats.collapses << " collapses in "
+                          << stats.seconds << "s ("
+                          << stats.collapses_per_second() << " collapses/s)\n";
+                update_mesh();
+            }
+        }
+        else
+        {
+            ImGui::Text("Reconstruct triangle mesh first!");
+        }
+    }
+
 #ifndef __EMSCRIPTEN__
     ImGui::Spacing();
     ImGui::Spacing();
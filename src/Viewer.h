@@ -11,6 +11,7 @@
 
 #include <pmp/visualization/MeshViewer.h>
 #include <01-reconstruction/PointSet.h>
+#include <01-reconstruction/reconstruction.h>
 
 using namespace pmp;
 
@@ -47,6 +48,9 @@ private:
 
     /// draw the mesh?
     bool draw_mesh_;
+
+    /// solved Poisson field, kept to re-extract the iso-surface
+    PoissonField poisson_field_;
 };
 
 //=============================================================================